@@ -53,6 +53,7 @@ PG_SRC = \
 COMMON_SRC = \
             build/build_config.c \
             build/debug.c \
+            build/trace.c \
             build/version.c \
             main.c \
             common/bitarray.c \
@@ -133,6 +134,7 @@ COMMON_SRC = \
             io/usb_cdc_hid.c \
             io/usb_msc.c \
             msp/msp.c \
+            msp/msp_batch.c \
             msp/msp_box.c \
             msp/msp_build_info.c \
             msp/msp_serial.c \
@@ -357,6 +359,7 @@ RX_SRC = \
 FLASH_SRC += \
             drivers/flash/flash.c \
             drivers/flash/flash_m25p16.c \
+            drivers/flash/flash_ram.c \
             drivers/flash/flash_w25m.c \
             drivers/flash/flash_w25n.c \
             drivers/flash/flash_w25q128fv.c \
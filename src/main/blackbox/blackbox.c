@@ -104,14 +104,15 @@ void checkFlashStop(void);
 #define DEFAULT_BLACKBOX_DEVICE     BLACKBOX_DEVICE_NONE
 #endif
 
-PG_REGISTER_WITH_RESET_TEMPLATE(blackboxConfig_t, blackboxConfig, PG_BLACKBOX_CONFIG, 4);
+PG_REGISTER_WITH_RESET_TEMPLATE(blackboxConfig_t, blackboxConfig, PG_BLACKBOX_CONFIG, 5);
 
 PG_RESET_TEMPLATE(blackboxConfig_t, blackboxConfig,
     .fields_disabled_mask = 0, // default log all fields
     .sample_rate = BLACKBOX_RATE_QUARTER,
     .device = DEFAULT_BLACKBOX_DEVICE,
     .mode = BLACKBOX_MODE_NORMAL,
-    .high_resolution = false
+    .high_resolution = false,
+    .compression = BLACKBOX_COMPRESSION_NONE,
 );
 
 STATIC_ASSERT((sizeof(blackboxConfig()->fields_disabled_mask) * 8) >= FLIGHT_LOG_FIELD_SELECT_COUNT, too_many_flight_log_fields_selections);
@@ -803,26 +804,40 @@ static void writeIntraframe(void)
     blackboxLoggedAnyFrames = true;
 }
 
-static void blackboxWriteMainStateArrayUsingAveragePredictor(int arrOffsetInHistory, int count)
+static uint8_t *encodeMainStateArrayUsingAveragePredictor(uint8_t *dst, int arrOffsetInHistory, int count)
 {
     int16_t *curr  = (int16_t*) ((char*) (blackboxHistory[0]) + arrOffsetInHistory);
     int16_t *prev1 = (int16_t*) ((char*) (blackboxHistory[1]) + arrOffsetInHistory);
     int16_t *prev2 = (int16_t*) ((char*) (blackboxHistory[2]) + arrOffsetInHistory);
+    int32_t deltas[MAX(DEBUG16_VALUE_COUNT, MAX_SUPPORTED_MOTORS)];
 
     for (int i = 0; i < count; i++) {
         // Predictor is the average of the previous two history states
         int32_t predictor = (prev1[i] + prev2[i]) / 2;
 
-        blackboxWriteSignedVB(curr[i] - predictor);
+        deltas[i] = curr[i] - predictor;
     }
+
+    return blackboxEncodeSignedVBArray(dst, deltas, count);
 }
 
+// Largest P frame writeInterframe() can produce, it is encoded in one pass straight into the device staging buffer
+#define BLACKBOX_INTERFRAME_SIZE_MAX (1 + BLACKBOX_VB_SIZE_MAX \
+    + 4 * XYZ_AXIS_COUNT * BLACKBOX_VB_SIZE_MAX + BLACKBOX_TAG2_3S32_SIZE_MAX \
+    + 2 * BLACKBOX_TAG8_4S16_SIZE_MAX + BLACKBOX_TAG8_8SVB_SIZE_MAX(8) \
+    + (4 * XYZ_AXIS_COUNT + DEBUG16_VALUE_COUNT + 2 * MAX_SUPPORTED_MOTORS) * BLACKBOX_VB_SIZE_MAX \
+    + BLACKBOX_TAG8_8SVB_SIZE_MAX(MAX_SUPPORTED_SERVOS))
+
+STATIC_ASSERT(BLACKBOX_INTERFRAME_SIZE_MAX <= BLACKBOX_FRAME_BUFFER_SIZE, blackbox_interframe_exceeds_frame_buffer);
+
 static void writeInterframe(void)
 {
     blackboxMainState_t *blackboxCurrent = blackboxHistory[0];
     blackboxMainState_t *blackboxLast = blackboxHistory[1];
 
-    blackboxWrite('P');
+    uint8_t *dst = blackboxWriteBegin(BLACKBOX_INTERFRAME_SIZE_MAX);
+
+    *dst++ = 'P';
 
     //No need to store iteration count since its delta is always 1
 
@@ -830,21 +845,21 @@ static void writeInterframe(void)
      * Since the difference between the difference between successive times will be nearly zero (due to consistent
      * looptime spacing), use second-order differences.
      */
-    blackboxWriteSignedVB((int32_t) (blackboxHistory[0]->time - 2 * blackboxHistory[1]->time + blackboxHistory[2]->time));
+    dst = blackboxEncodeSignedVB(dst, (int32_t) (blackboxHistory[0]->time - 2 * blackboxHistory[1]->time + blackboxHistory[2]->time));
 
     int32_t deltas[8];
     int32_t setpointDeltas[4];
 
     if (testBlackboxCondition(CONDITION(PID))) {
         arraySubInt32(deltas, blackboxCurrent->axisPID_P, blackboxLast->axisPID_P, XYZ_AXIS_COUNT);
-        blackboxWriteSignedVBArray(deltas, XYZ_AXIS_COUNT);
+        dst = blackboxEncodeSignedVBArray(dst, deltas, XYZ_AXIS_COUNT);
 
         /*
          * The PID I field changes very slowly, most of the time +-2, so use an encoding
          * that can pack all three fields into one byte in that situation.
          */
         arraySubInt32(deltas, blackboxCurrent->axisPID_I, blackboxLast->axisPID_I, XYZ_AXIS_COUNT);
-        blackboxWriteTag2_3S32(deltas);
+        dst = blackboxEncodeTag2_3S32(dst, deltas);
 
         /*
          * The PID D term is frequently set to zero for yaw, which makes the result from the calculation
@@ -852,17 +867,17 @@ static void writeInterframe(void)
          */
         for (int x = 0; x < XYZ_AXIS_COUNT; x++) {
             if (testBlackboxCondition(FLIGHT_LOG_FIELD_CONDITION_NONZERO_PID_D_0 + x)) {
-                blackboxWriteSignedVB(blackboxCurrent->axisPID_D[x] - blackboxLast->axisPID_D[x]);
+                dst = blackboxEncodeSignedVB(dst, blackboxCurrent->axisPID_D[x] - blackboxLast->axisPID_D[x]);
             }
         }
 
         arraySubInt32(deltas, blackboxCurrent->axisPID_F, blackboxLast->axisPID_F, XYZ_AXIS_COUNT);
-        blackboxWriteSignedVBArray(deltas, XYZ_AXIS_COUNT);
+        dst = blackboxEncodeSignedVBArray(dst, deltas, XYZ_AXIS_COUNT);
 
 #ifdef USE_WING
         for (int x = 0; x < XYZ_AXIS_COUNT; x++) {
             if (testBlackboxCondition(CONDITION(NONZERO_WING_S_0) + x)) {
-                blackboxWriteSignedVB(blackboxCurrent->axisPID_S[x] - blackboxLast->axisPID_S[x]);
+                dst = blackboxEncodeSignedVB(dst, blackboxCurrent->axisPID_S[x] - blackboxLast->axisPID_S[x]);
             }
         }
 #endif
@@ -878,10 +893,10 @@ static void writeInterframe(void)
     }
 
     if (testBlackboxCondition(CONDITION(RC_COMMANDS))) {
-        blackboxWriteTag8_4S16(deltas);
+        dst = blackboxEncodeTag8_4S16(dst, deltas);
     }
     if (testBlackboxCondition(CONDITION(SETPOINT))) {
-        blackboxWriteTag8_4S16(setpointDeltas);
+        dst = blackboxEncodeTag8_4S16(dst, setpointDeltas);
     }
 
     //Check for sensors that are updated periodically (so deltas are normally zero)
@@ -919,32 +934,32 @@ static void writeInterframe(void)
         deltas[optionalFieldCount++] = (int32_t) blackboxCurrent->rssi - blackboxLast->rssi;
     }
 
-    blackboxWriteTag8_8SVB(deltas, optionalFieldCount);
+    dst = blackboxEncodeTag8_8SVB(dst, deltas, optionalFieldCount);
 
     //Since gyros, accs and motors are noisy, base their predictions on the average of the history:
     if (testBlackboxCondition(CONDITION(GYRO))) {
-        blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, gyroADC),   XYZ_AXIS_COUNT);
+        dst = encodeMainStateArrayUsingAveragePredictor(dst, offsetof(blackboxMainState_t, gyroADC),   XYZ_AXIS_COUNT);
     }
     if (testBlackboxCondition(CONDITION(GYROUNFILT))) {
-        blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, gyroUnfilt),   XYZ_AXIS_COUNT);
+        dst = encodeMainStateArrayUsingAveragePredictor(dst, offsetof(blackboxMainState_t, gyroUnfilt),   XYZ_AXIS_COUNT);
     }
 
 #ifdef USE_ACC
     if (testBlackboxCondition(CONDITION(ACC))) {
-        blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, accADC), XYZ_AXIS_COUNT);
+        dst = encodeMainStateArrayUsingAveragePredictor(dst, offsetof(blackboxMainState_t, accADC), XYZ_AXIS_COUNT);
     }
 
     if (testBlackboxCondition(CONDITION(ATTITUDE))) {
-        blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, imuAttitudeQuaternion3), XYZ_AXIS_COUNT);
+        dst = encodeMainStateArrayUsingAveragePredictor(dst, offsetof(blackboxMainState_t, imuAttitudeQuaternion3), XYZ_AXIS_COUNT);
     }
 #endif
 
     if (testBlackboxCondition(CONDITION(DEBUG_LOG))) {
-        blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, debug), DEBUG16_VALUE_COUNT);
+        dst = encodeMainStateArrayUsingAveragePredictor(dst, offsetof(blackboxMainState_t, debug), DEBUG16_VALUE_COUNT);
     }
 
     if (isFieldEnabled(FIELD_SELECT(MOTOR))) {
-        blackboxWriteMainStateArrayUsingAveragePredictor(offsetof(blackboxMainState_t, motor),     getMotorCount());
+        dst = encodeMainStateArrayUsingAveragePredictor(dst, offsetof(blackboxMainState_t, motor),     getMotorCount());
     }
 
 #ifdef USE_SERVOS
@@ -955,7 +970,7 @@ static void writeInterframe(void)
             out[x] = blackboxCurrent->servo[x] - blackboxLast->servo[x];
         }
 
-        blackboxWriteTag8_8SVB(out, ARRAYLEN(out));
+        dst = blackboxEncodeTag8_8SVB(dst, out, ARRAYLEN(out));
     }
 #endif
 
@@ -964,12 +979,14 @@ static void writeInterframe(void)
         const int motorCount = getMotorCount();
         for (int x = 0; x < motorCount; x++) {
             if (testBlackboxCondition(CONDITION(MOTOR_1_HAS_RPM) + x)) {
-                blackboxWriteSignedVB(blackboxCurrent->erpm[x] - blackboxLast->erpm[x]);
+                dst = blackboxEncodeSignedVB(dst, blackboxCurrent->erpm[x] - blackboxLast->erpm[x]);
             }
         }
     }
 #endif
 
+    blackboxWriteEnd(dst);
+
     //Rotate our history buffers
     blackboxHistory[2] = blackboxHistory[1];
     blackboxHistory[1] = blackboxHistory[0];
@@ -1715,6 +1732,7 @@ static bool blackboxWriteSysinfo(void)
         BLACKBOX_PRINT_HEADER_LINE(PARAM_NAME_RPM_FILTER_MIN_HZ, "%d",        rpmFilterConfig()->rpm_filter_min_hz);
         BLACKBOX_PRINT_HEADER_LINE(PARAM_NAME_RPM_FILTER_FADE_RANGE_HZ, "%d", rpmFilterConfig()->rpm_filter_fade_range_hz);
         BLACKBOX_PRINT_HEADER_LINE(PARAM_NAME_RPM_FILTER_LPF_HZ, "%d",        rpmFilterConfig()->rpm_filter_lpf_hz);
+        BLACKBOX_PRINT_HEADER_LINE(PARAM_NAME_RPM_FILTER_UPDATE_HZ, "%d",     rpmFilterConfig()->rpm_filter_update_hz);
 #endif
 #if defined(USE_ACC)
         BLACKBOX_PRINT_HEADER_LINE(PARAM_NAME_ACC_LPF_HZ, "%d",        (int)(accelerometerConfig()->acc_lpf_hz * 100.0f));
@@ -2221,6 +2239,9 @@ void blackboxUpdate(timeUs_t currentTimeUs)
         break;
     }
 
+    // Header and event bytes staged this iteration go to the device in a single write
+    blackboxDeviceCommit();
+
     // Did we run out of room on the device? Stop!
     if (isBlackboxDeviceFull()) {
 #ifdef USE_FLASHFS
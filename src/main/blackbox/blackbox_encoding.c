@@ -32,6 +32,7 @@
 #include "blackbox_io.h"
 
 #include "common/encoding.h"
+#include "common/maths.h"
 #include "common/printf.h"
 
 static void _putc(void *p, char c)
@@ -83,55 +84,113 @@ void blackboxPrintfHeaderLine(const char *name, const char *fmt, ...)
     blackboxHeaderBudget -= written + 3;
 }
 
+// Number of bytes needed to variable byte encode a value with the given number of significant bits
+static const uint8_t vbLengthByBits[33] = {
+    1,
+    1, 1, 1, 1, 1, 1, 1,
+    2, 2, 2, 2, 2, 2, 2,
+    3, 3, 3, 3, 3, 3, 3,
+    4, 4, 4, 4, 4, 4, 4,
+    5, 5, 5, 5
+};
+
+static inline uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
 /**
- * Write an unsigned integer to the blackbox serial port using variable byte encoding.
+ * Encode an unsigned integer into dst using variable byte encoding, returns the end of the encoded bytes.
  */
-void blackboxWriteUnsignedVB(uint32_t value)
+uint8_t *blackboxEncodeUnsignedVB(uint8_t *dst, uint32_t value)
 {
-    //While this isn't the final byte (we can only write 7 bits at a time)
-    while (value > 127) {
-        blackboxWrite((uint8_t) (value | 0x80)); // Set the high bit to mean "more bytes follow"
+    if (value < 0x80) {
+        *dst++ = value;
+        return dst;
+    }
+
+    const int length = vbLengthByBits[32 - __builtin_clz(value)];
+    //Every byte but the final one has the high bit set to mean "more bytes follow"
+    for (int i = 1; i < length; i++) {
+        *dst++ = value | 0x80;
         value >>= 7;
     }
-    blackboxWrite(value);
+    *dst++ = value;
+
+    return dst;
 }
 
 /**
- * Write a signed integer to the blackbox serial port using ZigZig and variable byte encoding.
+ * Encode a signed integer into dst using ZigZag and variable byte encoding.
  */
-void blackboxWriteSignedVB(int32_t value)
+uint8_t *blackboxEncodeSignedVB(uint8_t *dst, int32_t value)
 {
-    //ZigZag encode to make the value always positive
-    blackboxWriteUnsignedVB(zigzagEncode(value));
+    return blackboxEncodeUnsignedVB(dst, zigzag(value));
 }
 
-void blackboxWriteSignedVBArray(int32_t *array, int count)
+uint8_t *blackboxEncodeSignedVBArray(uint8_t *dst, const int32_t *values, int count)
 {
     for (int i = 0; i < count; i++) {
-        blackboxWriteSignedVB(array[i]);
+        dst = blackboxEncodeUnsignedVB(dst, zigzag(values[i]));
     }
+    return dst;
 }
 
-void blackboxWriteSigned16VBArray(int16_t *array, int count)
+uint8_t *blackboxEncodeSigned16VBArray(uint8_t *dst, const int16_t *values, int count)
 {
     for (int i = 0; i < count; i++) {
-        blackboxWriteSignedVB(array[i]);
+        dst = blackboxEncodeUnsignedVB(dst, zigzag(values[i]));
     }
+    return dst;
 }
 
-void blackboxWriteS16(int16_t value)
+static uint8_t *encodeFieldBytes(uint8_t *dst, int32_t value, int byteCount)
 {
-    blackboxWrite(value & 0xFF);
-    blackboxWrite((value >> 8) & 0xFF);
+    for (int i = 0; i < byteCount; i++) {
+        *dst++ = value;
+        value >>= 8;
+    }
+    return dst;
+}
+
+// Bytes needed to hold a value that is at least 8 bits wide, encoded as 0 - 8 bits, 1 - 16, 2 - 24 and 3 - 32 bits
+static int fieldByteSelector(int32_t value)
+{
+    if (value < 128 && value >= -128) {
+        return 0;
+    } else if (value < 32768 && value >= -32768) {
+        return 1;
+    } else if (value < 8388608 && value >= -8388608) {
+        return 2;
+    }
+    return 3;
 }
 
 /**
- * Write a 2 bit tag followed by 3 signed fields of 2, 4, 6 or 32 bits
+ * Follow a 2 bit tag of 32 bits with a selector byte and then each of the 3 fields in its chosen byte count.
  */
-void blackboxWriteTag2_3S32(int32_t *values)
+static uint8_t *encodeTag2_3Bytes(uint8_t *dst, const int32_t *values)
 {
-    static const int NUM_FIELDS = 3;
+    int selector2 = 0;
 
+    //Encode in reverse order so the first field is in the low bits:
+    for (int x = 2; x >= 0; x--) {
+        selector2 = (selector2 << 2) | fieldByteSelector(values[x]);
+    }
+
+    *dst++ = (3 << 6) | selector2;
+
+    for (int x = 0; x < 3; x++, selector2 >>= 2) {
+        dst = encodeFieldBytes(dst, values[x], (selector2 & 0x03) + 1);
+    }
+    return dst;
+}
+
+/**
+ * Encode a 2 bit tag followed by 3 signed fields of 2, 4, 6 or 32 bits
+ */
+uint8_t *blackboxEncodeTag2_3S32(uint8_t *dst, const int32_t *values)
+{
     //Need to be enums rather than const ints if we want to switch on them (due to being C)
     enum {
         BITS_2  = 0,
@@ -140,15 +199,6 @@ void blackboxWriteTag2_3S32(int32_t *values)
         BITS_32 = 3
     };
 
-    enum {
-        BYTES_1  = 0,
-        BYTES_2  = 1,
-        BYTES_3  = 2,
-        BYTES_4  = 3
-    };
-
-    int selector = BITS_2, selector2;
-
     /*
      * Find out how many bits the largest value requires to encode, and use it to choose one of the packing schemes
      * below:
@@ -160,7 +210,8 @@ void blackboxWriteTag2_3S32(int32_t *values)
      * 6 bits per field  ss11 1111 0022 2222 0033 3333
      * 32 bits per field sstt tttt followed by fields of various byte counts
      */
-    for (int x = 0; x < NUM_FIELDS; x++) {
+    int selector = BITS_2;
+    for (int x = 0; x < 3; x++) {
         //Require more than 6 bits?
         if (values[x] >= 32 || values[x] < -32) {
             selector = BITS_32;
@@ -169,84 +220,166 @@ void blackboxWriteTag2_3S32(int32_t *values)
 
         //Require more than 4 bits?
         if (values[x] >= 8 || values[x] < -8) {
-             if (selector < BITS_6) {
-                 selector = BITS_6;
-             }
+            selector = MAX(selector, BITS_6);
         } else if (values[x] >= 2 || values[x] < -2) { //Require more than 2 bits?
-            if (selector < BITS_4) {
-                selector = BITS_4;
-            }
+            selector = MAX(selector, BITS_4);
         }
     }
 
     switch (selector) {
     case BITS_2:
-        blackboxWrite((selector << 6) | ((values[0] & 0x03) << 4) | ((values[1] & 0x03) << 2) | (values[2] & 0x03));
+        *dst++ = (selector << 6) | ((values[0] & 0x03) << 4) | ((values[1] & 0x03) << 2) | (values[2] & 0x03);
         break;
     case BITS_4:
-        blackboxWrite((selector << 6) | (values[0] & 0x0F));
-        blackboxWrite((values[1] << 4) | (values[2] & 0x0F));
+        *dst++ = (selector << 6) | (values[0] & 0x0F);
+        *dst++ = (values[1] << 4) | (values[2] & 0x0F);
         break;
     case BITS_6:
-        blackboxWrite((selector << 6) | (values[0] & 0x3F));
-        blackboxWrite((uint8_t)values[1]);
-        blackboxWrite((uint8_t)values[2]);
+        *dst++ = (selector << 6) | (values[0] & 0x3F);
+        *dst++ = values[1];
+        *dst++ = values[2];
         break;
     case BITS_32:
-        /*
-         * Do another round to compute a selector for each field, assuming that they are at least 8 bits each
-         *
-         * Selector2 field possibilities
-         * 0 - 8 bits
-         * 1 - 16 bits
-         * 2 - 24 bits
-         * 3 - 32 bits
-         */
-        selector2 = 0;
-
-        //Encode in reverse order so the first field is in the low bits:
-        for (int x = NUM_FIELDS - 1; x >= 0; x--) {
-            selector2 <<= 2;
-
-            if (values[x] < 128 && values[x] >= -128) {
-                selector2 |= BYTES_1;
-            } else if (values[x] < 32768 && values[x] >= -32768) {
-                selector2 |= BYTES_2;
-            } else if (values[x] < 8388608 && values[x] >= -8388608) {
-                selector2 |= BYTES_3;
-            } else {
-                selector2 |= BYTES_4;
-            }
+        dst = encodeTag2_3Bytes(dst, values);
+        break;
+    }
+    return dst;
+}
+
+/**
+ * Encode an 8-bit selector followed by four signed fields of size 0, 4, 8 or 16 bits.
+ */
+uint8_t *blackboxEncodeTag8_4S16(uint8_t *dst, const int32_t *values)
+{
+    //Need to be enums rather than const ints if we want to switch on them (due to being C)
+    enum {
+        FIELD_ZERO  = 0,
+        FIELD_4BIT  = 1,
+        FIELD_8BIT  = 2,
+        FIELD_16BIT = 3
+    };
+
+    uint8_t selector = 0;
+    //Encode in reverse order so the first field is in the low bits:
+    for (int x = 3; x >= 0; x--) {
+        selector <<= 2;
+
+        if (values[x] == 0) {
+            selector |= FIELD_ZERO;
+        } else if (values[x] < 8 && values[x] >= -8) {
+            selector |= FIELD_4BIT;
+        } else if (values[x] < 128 && values[x] >= -128) {
+            selector |= FIELD_8BIT;
+        } else {
+            selector |= FIELD_16BIT;
         }
+    }
+
+    *dst++ = selector;
 
-        //Write the selectors
-        blackboxWrite((selector << 6) | selector2);
-
-        //And now the values according to the selectors we picked for them
-        for (int x = 0; x < NUM_FIELDS; x++, selector2 >>= 2) {
-            switch (selector2 & 0x03) {
-            case BYTES_1:
-                blackboxWrite(values[x]);
-                break;
-            case BYTES_2:
-                blackboxWrite(values[x]);
-                blackboxWrite(values[x] >> 8);
-                break;
-            case BYTES_3:
-                blackboxWrite(values[x]);
-                blackboxWrite(values[x] >> 8);
-                blackboxWrite(values[x] >> 16);
-                break;
-            case BYTES_4:
-                blackboxWrite(values[x]);
-                blackboxWrite(values[x] >> 8);
-                blackboxWrite(values[x] >> 16);
-                blackboxWrite(values[x] >> 24);
-                break;
-            }
+    /*
+     * Fields are packed as a stream of nibbles, high nibble first. Collect them into an accumulator and emit a byte
+     * whenever two nibbles are ready rather than tracking which half of the byte we're in for every field.
+     */
+    uint32_t nibbles = 0;
+    int nibbleCount = 0;
+    for (int x = 0; x < 4; x++, selector >>= 2) {
+        switch (selector & 0x03) {
+        case FIELD_ZERO:
+            //No-op
+            break;
+        case FIELD_4BIT:
+            nibbles = (nibbles << 4) | (values[x] & 0x0F);
+            nibbleCount += 1;
+            break;
+        case FIELD_8BIT:
+            nibbles = (nibbles << 8) | (values[x] & 0xFF);
+            nibbleCount += 2;
+            break;
+        case FIELD_16BIT:
+            nibbles = (nibbles << 16) | (values[x] & 0xFFFF);
+            nibbleCount += 4;
+            break;
+        }
+        while (nibbleCount >= 2) {
+            nibbleCount -= 2;
+            *dst++ = nibbles >> (nibbleCount * 4);
+        }
+    }
+    //Anything left over to write?
+    if (nibbleCount) {
+        *dst++ = nibbles << 4;
+    }
+    return dst;
+}
+
+/**
+ * Encode `valueCount` fields from `values` using signed variable byte encoding. A 1-byte header is written first
+ * which specifies which fields are non-zero (so this encoding is compact when most fields are zero).
+ *
+ * valueCount must be 8 or less.
+ */
+uint8_t *blackboxEncodeTag8_8SVB(uint8_t *dst, const int32_t *values, int valueCount)
+{
+    //If we're only writing one field then we can skip the header
+    if (valueCount == 1) {
+        return blackboxEncodeSignedVB(dst, values[0]);
+    }
+    if (valueCount <= 0) {
+        return dst;
+    }
+
+    //First write a one-byte header that marks which fields are non-zero, first field in the low bit
+    uint8_t *header = dst++;
+    *header = 0;
+
+    for (int i = 0; i < valueCount; i++) {
+        *header |= (values[i] != 0) << i;
+        if (values[i] != 0) {
+            dst = blackboxEncodeUnsignedVB(dst, zigzag(values[i]));
         }
-        break;
     }
+    return dst;
+}
+
+/**
+ * Write an unsigned integer to the blackbox serial port using variable byte encoding.
+ */
+void blackboxWriteUnsignedVB(uint32_t value)
+{
+    blackboxWriteEnd(blackboxEncodeUnsignedVB(blackboxWriteBegin(BLACKBOX_VB_SIZE_MAX), value));
+}
+
+/**
+ * Write a signed integer to the blackbox serial port using ZigZig and variable byte encoding.
+ */
+void blackboxWriteSignedVB(int32_t value)
+{
+    blackboxWriteEnd(blackboxEncodeSignedVB(blackboxWriteBegin(BLACKBOX_VB_SIZE_MAX), value));
+}
+
+void blackboxWriteSignedVBArray(int32_t *array, int count)
+{
+    blackboxWriteEnd(blackboxEncodeSignedVBArray(blackboxWriteBegin(count * BLACKBOX_VB_SIZE_MAX), array, count));
+}
+
+void blackboxWriteSigned16VBArray(int16_t *array, int count)
+{
+    blackboxWriteEnd(blackboxEncodeSigned16VBArray(blackboxWriteBegin(count * BLACKBOX_VB_SIZE_MAX), array, count));
+}
+
+void blackboxWriteS16(int16_t value)
+{
+    blackboxWrite(value & 0xFF);
+    blackboxWrite((value >> 8) & 0xFF);
+}
+
+/**
+ * Write a 2 bit tag followed by 3 signed fields of 2, 4, 6 or 32 bits
+ */
+void blackboxWriteTag2_3S32(int32_t *values)
+{
+    blackboxWriteEnd(blackboxEncodeTag2_3S32(blackboxWriteBegin(BLACKBOX_TAG2_3S32_SIZE_MAX), values));
 }
 
 /**
@@ -254,7 +387,6 @@ void blackboxWriteTag2_3S32(int32_t *values)
  */
 int blackboxWriteTag2_3SVariable(int32_t *values)
 {
-    static const int FIELD_COUNT = 3;
     enum {
         BITS_2  = 0,
         BITS_554  = 1,
@@ -262,13 +394,6 @@ int blackboxWriteTag2_3SVariable(int32_t *values)
         BITS_32 = 3
     };
 
-    enum {
-        BYTES_1  = 0,
-        BYTES_2  = 1,
-        BYTES_3  = 2,
-        BYTES_4  = 3
-    };
-
     /*
      * Find out how many bits the largest value requires to encode, and use it to choose one of the packing schemes
      * below:
@@ -281,7 +406,6 @@ int blackboxWriteTag2_3SVariable(int32_t *values)
      * 32 bits per field sstt tttt followed by fields of various byte counts
      */
     int selector = BITS_2;
-    int selector2 = 0;
     // Require more than 877 bits?
     if (values[0] >= 256 || values[0] < -256
             || values[1] >= 128 || values[1] < -128
@@ -299,75 +423,30 @@ int blackboxWriteTag2_3SVariable(int32_t *values)
         selector = BITS_554;
     }
 
+    uint8_t *dst = blackboxWriteBegin(BLACKBOX_TAG2_3S32_SIZE_MAX);
+
     switch (selector) {
     case BITS_2:
-        blackboxWrite((selector << 6) | ((values[0] & 0x03) << 4) | ((values[1] & 0x03) << 2) | (values[2] & 0x03));
+        *dst++ = (selector << 6) | ((values[0] & 0x03) << 4) | ((values[1] & 0x03) << 2) | (values[2] & 0x03);
         break;
     case BITS_554:
         // 554 bits per field  ss11 1112 2222 3333
-        blackboxWrite((selector << 6) | ((values[0] & 0x1F) << 1) | ((values[1] & 0x1F) >> 4));
-        blackboxWrite(((values[1] & 0x0F) << 4) | (values[2] & 0x0F));
+        *dst++ = (selector << 6) | ((values[0] & 0x1F) << 1) | ((values[1] & 0x1F) >> 4);
+        *dst++ = ((values[1] & 0x0F) << 4) | (values[2] & 0x0F);
         break;
     case BITS_877:
         // 877 bits per field  ss11 1111 1122 2222 2333 3333
-        blackboxWrite((selector << 6) | ((values[0] & 0xFF) >> 2));
-        blackboxWrite(((values[0] & 0x03) << 6) | ((values[1] & 0x7F) >> 1));
-        blackboxWrite(((values[1] & 0x01) << 7) | (values[2] & 0x7F));
+        *dst++ = (selector << 6) | ((values[0] & 0xFF) >> 2);
+        *dst++ = ((values[0] & 0x03) << 6) | ((values[1] & 0x7F) >> 1);
+        *dst++ = ((values[1] & 0x01) << 7) | (values[2] & 0x7F);
         break;
     case BITS_32:
-        /*
-         * Do another round to compute a selector for each field, assuming that they are at least 8 bits each
-         *
-         * Selector2 field possibilities
-         * 0 - 8 bits
-         * 1 - 16 bits
-         * 2 - 24 bits
-         * 3 - 32 bits
-         */
-        selector2 = 0;
-        //Encode in reverse order so the first field is in the low bits:
-        for (int x = FIELD_COUNT - 1; x >= 0; x--) {
-            selector2 <<= 2;
-
-            if (values[x] < 128 && values[x] >= -128) {
-                selector2 |= BYTES_1;
-            } else if (values[x] < 32768 && values[x] >= -32768) {
-                selector2 |= BYTES_2;
-            } else if (values[x] < 8388608 && values[x] >= -8388608) {
-                selector2 |= BYTES_3;
-            } else {
-                selector2 |= BYTES_4;
-            }
-        }
-
-        //Write the selectors
-        blackboxWrite((selector << 6) | selector2);
-
-        //And now the values according to the selectors we picked for them
-        for (int x = 0; x < FIELD_COUNT; x++, selector2 >>= 2) {
-            switch (selector2 & 0x03) {
-            case BYTES_1:
-                blackboxWrite(values[x]);
-                break;
-            case BYTES_2:
-                blackboxWrite(values[x]);
-                blackboxWrite(values[x] >> 8);
-                break;
-            case BYTES_3:
-                blackboxWrite(values[x]);
-                blackboxWrite(values[x] >> 8);
-                blackboxWrite(values[x] >> 16);
-                break;
-            case BYTES_4:
-                blackboxWrite(values[x]);
-                blackboxWrite(values[x] >> 8);
-                blackboxWrite(values[x] >> 16);
-                blackboxWrite(values[x] >> 24);
-                break;
-            }
-        }
-    break;
+        dst = encodeTag2_3Bytes(dst, values);
+        break;
     }
+
+    blackboxWriteEnd(dst);
+
     return selector;
 }
 
@@ -376,80 +455,7 @@ int blackboxWriteTag2_3SVariable(int32_t *values)
  */
 void blackboxWriteTag8_4S16(int32_t *values)
 {
-
-    //Need to be enums rather than const ints if we want to switch on them (due to being C)
-    enum {
-        FIELD_ZERO  = 0,
-        FIELD_4BIT  = 1,
-        FIELD_8BIT  = 2,
-        FIELD_16BIT = 3
-    };
-
-    uint8_t selector = 0;
-    //Encode in reverse order so the first field is in the low bits:
-    for (int x = 3; x >= 0; x--) {
-        selector <<= 2;
-
-        if (values[x] == 0) {
-            selector |= FIELD_ZERO;
-        } else if (values[x] < 8 && values[x] >= -8) {
-            selector |= FIELD_4BIT;
-        } else if (values[x] < 128 && values[x] >= -128) {
-            selector |= FIELD_8BIT;
-        } else {
-            selector |= FIELD_16BIT;
-        }
-    }
-
-    blackboxWrite(selector);
-
-    int nibbleIndex = 0;
-    uint8_t buffer = 0;
-    for (int x = 0; x < 4; x++, selector >>= 2) {
-        switch (selector & 0x03) {
-        case FIELD_ZERO:
-            //No-op
-            break;
-        case FIELD_4BIT:
-            if (nibbleIndex == 0) {
-                //We fill high-bits first
-                buffer = values[x] << 4;
-                nibbleIndex = 1;
-            } else {
-                blackboxWrite(buffer | (values[x] & 0x0F));
-                nibbleIndex = 0;
-            }
-            break;
-        case FIELD_8BIT:
-            if (nibbleIndex == 0) {
-                blackboxWrite(values[x]);
-            } else {
-                //Write the high bits of the value first (mask to avoid sign extension)
-                blackboxWrite(buffer | ((values[x] >> 4) & 0x0F));
-                //Now put the leftover low bits into the top of the next buffer entry
-                buffer = values[x] << 4;
-            }
-            break;
-        case FIELD_16BIT:
-            if (nibbleIndex == 0) {
-                //Write high byte first
-                blackboxWrite(values[x] >> 8);
-                blackboxWrite(values[x]);
-            } else {
-                //First write the highest 4 bits
-                blackboxWrite(buffer | ((values[x] >> 12) & 0x0F));
-                // Then the middle 8
-                blackboxWrite(values[x] >> 4);
-                //Only the smallest 4 bits are still left to write
-                buffer = values[x] << 4;
-            }
-            break;
-        }
-    }
-    //Anything left over to write?
-    if (nibbleIndex == 1) {
-        blackboxWrite(buffer);
-    }
+    blackboxWriteEnd(blackboxEncodeTag8_4S16(blackboxWriteBegin(BLACKBOX_TAG8_4S16_SIZE_MAX), values));
 }
 
 /**
@@ -460,43 +466,13 @@ void blackboxWriteTag8_4S16(int32_t *values)
  */
 void blackboxWriteTag8_8SVB(int32_t *values, int valueCount)
 {
-    uint8_t header;
-
-    if (valueCount > 0) {
-        //If we're only writing one field then we can skip the header
-        if (valueCount == 1) {
-            blackboxWriteSignedVB(values[0]);
-        } else {
-            //First write a one-byte header that marks which fields are non-zero
-            header = 0;
-
-            // First field should be in low bits of header
-            for (int i = valueCount - 1; i >= 0; i--) {
-                header <<= 1;
-
-                if (values[i] != 0) {
-                    header |= 0x01;
-                }
-            }
-
-            blackboxWrite(header);
-
-            for (int i = 0; i < valueCount; i++) {
-                if (values[i] != 0) {
-                    blackboxWriteSignedVB(values[i]);
-                }
-            }
-        }
-    }
+    blackboxWriteEnd(blackboxEncodeTag8_8SVB(blackboxWriteBegin(BLACKBOX_TAG8_8SVB_SIZE_MAX(valueCount)), values, valueCount));
 }
 
 /** Write unsigned integer **/
 void blackboxWriteU32(int32_t value)
 {
-    blackboxWrite(value & 0xFF);
-    blackboxWrite((value >> 8) & 0xFF);
-    blackboxWrite((value >> 16) & 0xFF);
-    blackboxWrite((value >> 24) & 0xFF);
+    blackboxWriteEnd(encodeFieldBytes(blackboxWriteBegin(sizeof(value)), value, sizeof(value)));
 }
 
 /** Write float value in the integer form **/
@@ -20,6 +20,12 @@
 
 #pragma once
 
+// Largest number of bytes each encoding can produce
+#define BLACKBOX_VB_SIZE_MAX                5
+#define BLACKBOX_TAG2_3S32_SIZE_MAX         13
+#define BLACKBOX_TAG8_4S16_SIZE_MAX         9
+#define BLACKBOX_TAG8_8SVB_SIZE_MAX(count)  (1 + (count) * BLACKBOX_VB_SIZE_MAX)
+
 int blackboxPrintf(const char *fmt, ...);
 void blackboxPrintfHeaderLine(const char *name, const char *fmt, ...);
 
@@ -34,3 +40,12 @@ void blackboxWriteTag8_4S16(int32_t *values);
 void blackboxWriteTag8_8SVB(int32_t *values, int valueCount);
 void blackboxWriteU32(int32_t value);
 void blackboxWriteFloat(float value);
+
+// Encode straight into a buffer, each returns the end of the bytes it encoded
+uint8_t *blackboxEncodeUnsignedVB(uint8_t *dst, uint32_t value);
+uint8_t *blackboxEncodeSignedVB(uint8_t *dst, int32_t value);
+uint8_t *blackboxEncodeSignedVBArray(uint8_t *dst, const int32_t *values, int count);
+uint8_t *blackboxEncodeSigned16VBArray(uint8_t *dst, const int16_t *values, int count);
+uint8_t *blackboxEncodeTag2_3S32(uint8_t *dst, const int32_t *values);
+uint8_t *blackboxEncodeTag8_4S16(uint8_t *dst, const int32_t *values);
+uint8_t *blackboxEncodeTag8_8SVB(uint8_t *dst, const int32_t *values, int valueCount);
@@ -45,6 +45,7 @@
 #include "blackbox.h"
 #include "blackbox_io.h"
 
+#include "common/huffman.h"
 #include "common/maths.h"
 
 #include "flight/pid.h"
@@ -110,51 +111,151 @@ static uint16_t bbRateMax;
 static uint32_t bbDrops;
 #endif
 
-void blackboxWrite(uint8_t value)
+// Returns the number of bytes the device accepted, the rest of the span was dropped
+typedef int blackboxWriteSpanFn(const uint8_t *data, int length);
+
+// Resolved by blackboxDeviceOpen() so that committing a span doesn't have to switch on the device again
+static blackboxWriteSpanFn *blackboxWriteSpan;
+
+static uint8_t blackboxFrameBuffer[BLACKBOX_FRAME_BUFFER_SIZE];
+static int blackboxFrameBufferPos;
+
+#ifdef USE_HUFFMAN
+static bool blackboxCompressing;
+static bool blackboxCompressedHeaderPending;
+static uint8_t blackboxCompressedBlock[BLACKBOX_COMPRESSED_HEADER_SIZE + sizeof(uint16_t) + BLACKBOX_FRAME_BUFFER_SIZE];
+// The tail of the last block that the device didn't accept yet
+static const uint8_t *blackboxCompressedPending;
+static int blackboxCompressedPendingLength;
+#endif
+
+static int blackboxSerialWriteSpan(const uint8_t *data, int length)
 {
+    const int txBytesFree = serialTxBytesFree(blackboxPort);
+    const int written = MIN(length, txBytesFree);
+
 #ifdef DEBUG_BB_OUTPUT
-    bbBits += 8;
+    bbBits += 2 * length;
+    DEBUG_SET(DEBUG_BLACKBOX_OUTPUT, 3, txBytesFree);
+
+    if (written < length) {
+        bbDrops += length - written;
+        DEBUG_SET(DEBUG_BLACKBOX_OUTPUT, 2, bbDrops);
+    }
 #endif
 
-    switch (blackboxConfig()->device) {
+    serialWriteBuf(blackboxPort, data, written);
+
+    return written;
+}
+
 #ifdef USE_FLASHFS
-    case BLACKBOX_DEVICE_FLASH:
-        flashfsWriteByte(value); // Write byte asynchronously
-        break;
+static int blackboxFlashWriteSpan(const uint8_t *data, int length)
+{
+    return flashfsWrite(data, length, false); // Write asynchronously
+}
 #endif
+
 #ifdef USE_SDCARD
-    case BLACKBOX_DEVICE_SDCARD:
-        afatfs_fputc(blackboxSDCard.logFile, value);
-        break;
+static int blackboxSDCardWriteSpan(const uint8_t *data, int length)
+{
+    return afatfs_fwrite(blackboxSDCard.logFile, data, length); // Short when the buffers fill up
+}
 #endif
+
 #ifdef USE_BLACKBOX_VIRTUAL
-    case BLACKBOX_DEVICE_VIRTUAL:
-        blackboxVirtualPutChar(value);
-        break;
+static int blackboxVirtualWriteSpan(const uint8_t *data, int length)
+{
+    blackboxVirtualWrite(data, length);
+    return length;
+}
 #endif
-    case BLACKBOX_DEVICE_SERIAL:
-    default:
-        {
-            int txBytesFree = serialTxBytesFree(blackboxPort);
 
-#ifdef DEBUG_BB_OUTPUT
-            bbBits += 2;
-            DEBUG_SET(DEBUG_BLACKBOX_OUTPUT, 3, txBytesFree);
+#ifdef USE_HUFFMAN
+// Returns true once the device has taken all of the last block
+static bool blackboxWriteCompressedPending(void)
+{
+    if (blackboxCompressedPendingLength > 0) {
+        const int written = blackboxWriteSpan(blackboxCompressedPending, blackboxCompressedPendingLength);
+        blackboxCompressedPending += written;
+        blackboxCompressedPendingLength -= written;
+    }
+    return blackboxCompressedPendingLength == 0;
+}
+
+// Returns false if the span was left staged because the device hasn't taken all of the last block yet
+static bool blackboxWriteCompressedSpan(const uint8_t *data, int length)
+{
+    /*
+     * A decoder can't find the start of the next block once part of one is missing, so the rest of a block the device
+     * was too busy for is written before anything else, and the span waits in the staging buffer in the meantime.
+     */
+    if (!blackboxWriteCompressedPending()) {
+        return false;
+    }
+
+    int blockStart = 0;
+    if (blackboxCompressedHeaderPending) {
+        static const uint8_t header[BLACKBOX_COMPRESSED_HEADER_SIZE] = {
+            BLACKBOX_COMPRESSED_MAGIC[0], BLACKBOX_COMPRESSED_MAGIC[1], BLACKBOX_COMPRESSED_MAGIC[2], BLACKBOX_COMPRESSED_MAGIC[3],
+            BLACKBOX_COMPRESSED_VERSION, BLACKBOX_COMPRESSION_HUFFMAN
+        };
+        memcpy(blackboxCompressedBlock, header, sizeof(header));
+        blockStart = sizeof(header);
+        blackboxCompressedHeaderPending = false;
+    }
+
+    uint16_t blockHeader = length;
+    uint8_t *payload = &blackboxCompressedBlock[blockStart + sizeof(blockHeader)];
+
+    // Store the block as it is unless coding actually makes it smaller
+    int payloadLength = huffmanEncodeBlock(payload, length - 1, data, length, huffmanTable);
+    if (payloadLength < 0) {
+        memcpy(payload, data, length);
+        payloadLength = length;
+        blockHeader |= BLACKBOX_COMPRESSED_BLOCK_STORED;
+    }
+
+    blackboxCompressedBlock[blockStart] = blockHeader & 0xFF;
+    blackboxCompressedBlock[blockStart + 1] = blockHeader >> 8;
+
+    blackboxCompressedPending = blackboxCompressedBlock;
+    blackboxCompressedPendingLength = blockStart + sizeof(blockHeader) + payloadLength;
+    blackboxWriteCompressedPending();
+    return true;
+}
 #endif
 
-            if (txBytesFree == 0) {
-#ifdef DEBUG_BB_OUTPUT
-                ++bbDrops;
-                DEBUG_SET(DEBUG_BLACKBOX_OUTPUT, 2, bbDrops);
+/**
+ * Hand everything staged by blackboxWrite() to the device in a single write.
+ */
+void blackboxDeviceCommit(void)
+{
+    if (blackboxFrameBufferPos == 0) {
+#ifdef USE_HUFFMAN
+        if (blackboxCompressing && blackboxWriteSpan) {
+            blackboxWriteCompressedPending();
+        }
 #endif
+        return;
+    }
+
+    if (blackboxWriteSpan) {
+#ifdef USE_HUFFMAN
+        if (blackboxCompressing) {
+            if (!blackboxWriteCompressedSpan(blackboxFrameBuffer, blackboxFrameBufferPos)) {
                 return;
             }
-            serialWrite(blackboxPort, value);
+        } else
+#endif
+        {
+            blackboxWriteSpan(blackboxFrameBuffer, blackboxFrameBufferPos);
         }
-        break;
     }
 
 #ifdef DEBUG_BB_OUTPUT
+    bbBits += 8 * blackboxFrameBufferPos;
+
     timeMs_t now = millis();
 
     if (now > bbLastclearMs + 100) {  // Debug log every 100[msec]
@@ -168,47 +269,60 @@ void blackboxWrite(uint8_t value)
         bbBits = 0;
     }
 #endif
+
+    blackboxFrameBufferPos = 0;
 }
 
-// Print the null-terminated string 's' to the blackbox device and return the number of bytes written
-int blackboxWriteString(const char *s)
+/**
+ * Commit the staged span if there isn't room for `length` more bytes. A span the device can't take yet stays staged,
+ * it is only dropped when it leaves no room at all.
+ */
+static void blackboxMakeRoom(int length)
 {
-    int length;
-    const uint8_t *pos;
-
-    switch (blackboxConfig()->device) {
-
-#ifdef USE_FLASHFS
-    case BLACKBOX_DEVICE_FLASH:
-        length = strlen(s);
-        flashfsWrite((const uint8_t*) s, length, false); // Write asynchronously
-        break;
-#endif // USE_FLASHFS
+    if (blackboxFrameBufferPos + length > BLACKBOX_FRAME_BUFFER_SIZE) {
+        blackboxDeviceCommit();
+    }
+    if (blackboxFrameBufferPos + length > BLACKBOX_FRAME_BUFFER_SIZE) {
+#ifdef DEBUG_BB_OUTPUT
+        bbDrops += blackboxFrameBufferPos;
+        DEBUG_SET(DEBUG_BLACKBOX_OUTPUT, 2, bbDrops);
+#endif
+        blackboxFrameBufferPos = 0;
+    }
+}
 
-#ifdef USE_SDCARD
-    case BLACKBOX_DEVICE_SDCARD:
-        length = strlen(s);
-        afatfs_fwrite(blackboxSDCard.logFile, (const uint8_t*) s, length); // Ignore failures due to buffers filling up
-        break;
-#endif // USE_SDCARD
+void blackboxWrite(uint8_t value)
+{
+    blackboxMakeRoom(1);
+    blackboxFrameBuffer[blackboxFrameBufferPos++] = value;
+}
 
-#ifdef USE_BLACKBOX_VIRTUAL
-    case BLACKBOX_DEVICE_VIRTUAL:
-        length = strlen(s);
-        blackboxVirtualWrite((const uint8_t*) s, length);
-        break;
-#endif
+/**
+ * Returns room for at least `length` contiguous bytes in the staging buffer to encode into, pass the end of what was
+ * actually encoded to blackboxWriteEnd(). `length` must not exceed BLACKBOX_FRAME_BUFFER_SIZE.
+ */
+uint8_t *blackboxWriteBegin(int length)
+{
+    blackboxMakeRoom(length);
+    return &blackboxFrameBuffer[blackboxFrameBufferPos];
+}
 
-    case BLACKBOX_DEVICE_SERIAL:
-    default:
-        pos = (uint8_t*) s;
-        while (*pos) {
-            blackboxWrite(*pos);
-            pos++;
-        }
+void blackboxWriteEnd(const uint8_t *end)
+{
+    blackboxFrameBufferPos = end - blackboxFrameBuffer;
+}
 
-        length = pos - (uint8_t*) s;
-        break;
+// Print the null-terminated string 's' to the blackbox device and return the number of bytes written
+int blackboxWriteString(const char *s)
+{
+    const int length = strlen(s);
+
+    for (int pos = 0; pos < length; ) {
+        blackboxMakeRoom(1);
+        const int count = MIN(length - pos, BLACKBOX_FRAME_BUFFER_SIZE - blackboxFrameBufferPos);
+        memcpy(&blackboxFrameBuffer[blackboxFrameBufferPos], s + pos, count);
+        blackboxFrameBufferPos += count;
+        pos += count;
     }
 
     return length;
@@ -221,6 +335,8 @@ int blackboxWriteString(const char *s)
  */
 void blackboxDeviceFlush(void)
 {
+    blackboxDeviceCommit();
+
     switch (blackboxConfig()->device) {
 #ifdef USE_FLASHFS
         /*
@@ -249,6 +365,16 @@ void blackboxDeviceFlush(void)
  */
 bool blackboxDeviceFlushForce(void)
 {
+    blackboxDeviceCommit();
+
+#ifdef USE_HUFFMAN
+    if (blackboxCompressedPendingLength > 0) {
+        // Make room for the rest of the block, it goes out on the next commit
+        blackboxDeviceFlush();
+        return false;
+    }
+#endif
+
     switch (blackboxConfig()->device) {
     case BLACKBOX_DEVICE_SERIAL:
         // Nothing to speed up flushing on serial, as serial is continuously being drained out of its buffer
@@ -282,6 +408,8 @@ bool blackboxDeviceFlushForce(void)
 // Primarily to ensure the async operations of SD card sector writes complete thus freeing the cache entries.
 bool blackboxDeviceFlushForceComplete(void)
 {
+    blackboxDeviceCommit();
+
     switch (blackboxConfig()->device) {
 #ifdef USE_SDCARD
     case BLACKBOX_DEVICE_SDCARD:
@@ -308,6 +436,16 @@ bool blackboxDeviceFlushForceComplete(void)
  */
 bool blackboxDeviceOpen(void)
 {
+    // Anything staged while no device was open belongs to no log
+    blackboxFrameBufferPos = 0;
+
+#ifdef USE_HUFFMAN
+    blackboxCompressing = blackboxConfig()->compression == BLACKBOX_COMPRESSION_HUFFMAN
+        && blackboxConfig()->device != BLACKBOX_DEVICE_SERIAL;
+    blackboxCompressedHeaderPending = true;
+    blackboxCompressedPendingLength = 0;
+#endif
+
     switch (blackboxConfig()->device) {
     case BLACKBOX_DEVICE_SERIAL:
         {
@@ -334,6 +472,7 @@ bool blackboxDeviceOpen(void)
 
             blackboxPort = openSerialPort(portConfig->identifier, FUNCTION_BLACKBOX, NULL, NULL, baudRates[baudRateIndex],
                 BLACKBOX_SERIAL_PORT_MODE, portOptions);
+            blackboxWriteSpan = blackboxSerialWriteSpan;
 
             /*
              * The slowest MicroSD cards have a write latency approaching 400ms. The OpenLog's buffer is about 900
@@ -373,6 +512,7 @@ bool blackboxDeviceOpen(void)
         }
 
         blackboxMaxHeaderBytesPerIteration = BLACKBOX_TARGET_HEADER_BUDGET_PER_ITERATION;
+        blackboxWriteSpan = blackboxFlashWriteSpan;
 
         return true;
         break;
@@ -384,12 +524,14 @@ bool blackboxDeviceOpen(void)
         }
 
         blackboxMaxHeaderBytesPerIteration = BLACKBOX_TARGET_HEADER_BUDGET_PER_ITERATION;
+        blackboxWriteSpan = blackboxSDCardWriteSpan;
 
         return true;
         break;
 #endif // USE_SDCARD
 #ifdef USE_BLACKBOX_VIRTUAL
     case BLACKBOX_DEVICE_VIRTUAL:
+        blackboxWriteSpan = blackboxVirtualWriteSpan;
         return blackboxVirtualOpen();
 
 #endif
@@ -441,6 +583,9 @@ bool isBlackboxErased(void)
  */
 void blackboxDeviceClose(void)
 {
+    blackboxDeviceCommit();
+    blackboxWriteSpan = NULL;
+
     switch (blackboxConfig()->device) {
     case BLACKBOX_DEVICE_SERIAL:
         // Can immediately close without attempting to flush any remaining data.
@@ -515,7 +660,7 @@ static void blackboxCreateLogFile(void)
 
     blackboxSDCard.state = BLACKBOX_SDCARD_WAITING;
 
-    afatfs_fopen(filename, "as", blackboxLogFileCreated);
+    afatfs_fopen(filename, "al", blackboxLogFileCreated);
 }
 
 /**
@@ -602,6 +747,11 @@ bool blackboxDeviceBeginLog(void)
     case BLACKBOX_DEVICE_SDCARD:
         return blackboxSDCardBeginLog();
 #endif // USE_SDCARD
+#ifdef USE_FLASHFS
+    case BLACKBOX_DEVICE_FLASH:
+        flashfsBeginLog();
+        return true;
+#endif // USE_FLASHFS
 #ifdef USE_BLACKBOX_VIRTUAL
     case BLACKBOX_DEVICE_VIRTUAL:
         return blackboxVirtualBeginLog();
@@ -625,6 +775,8 @@ bool blackboxDeviceEndLog(bool retainLog)
     UNUSED(retainLog);
 #endif
 
+    blackboxDeviceCommit();
+
     switch (blackboxConfig()->device) {
 #ifdef USE_SDCARD
     case BLACKBOX_DEVICE_SDCARD:
@@ -641,6 +793,11 @@ bool blackboxDeviceEndLog(bool retainLog)
         return false;
 #endif // USE_SDCARD
 
+#ifdef USE_FLASHFS
+    case BLACKBOX_DEVICE_FLASH:
+        return flashfsEndLog();
+#endif // USE_FLASHFS
+
 #ifdef USE_BLACKBOX_VIRTUAL
     case BLACKBOX_DEVICE_VIRTUAL:
         blackboxVirtualEndLog();
@@ -726,6 +883,8 @@ void blackboxReplenishHeaderBudget(void)
 {
     int32_t freeSpace;
 
+    blackboxDeviceCommit();
+
     switch (blackboxConfig()->device) {
     case BLACKBOX_DEVICE_SERIAL:
         freeSpace = serialTxBytesFree(blackboxPort);
@@ -748,6 +907,10 @@ void blackboxReplenishHeaderBudget(void)
     default:
         freeSpace = 0;
     }
+#ifdef USE_HUFFMAN
+    // Whatever is still waiting for the device comes out of the same space
+    freeSpace -= blackboxCompressedPendingLength + blackboxFrameBufferPos;
+#endif
     blackboxHeaderBudget = MIN(MIN(freeSpace, blackboxHeaderBudget + blackboxMaxHeaderBytesPerIteration), BLACKBOX_MAX_ACCUMULATED_HEADER_BUDGET);
 }
 
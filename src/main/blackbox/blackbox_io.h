@@ -38,11 +38,39 @@ typedef enum {
  */
 #define BLACKBOX_TARGET_HEADER_BUDGET_PER_ITERATION 64
 
+/*
+ * Encoded bytes are staged here and handed to the device as a single span by blackboxDeviceCommit(), large enough
+ * to hold the largest possible frame so that it can be encoded straight into the buffer:
+ */
+#define BLACKBOX_FRAME_BUFFER_SIZE 512
+
+/*
+ * With blackbox_compression enabled a log on flash, SD card or the virtual device is stored as the uncompressed header
+ *
+ *     "BFLZ", u8 format version, u8 BlackboxCompression_e method
+ *
+ * followed by one block for each span handed to the device:
+ *
+ *     u16 little endian: bits 0-14 uncompressed length, bit 15 set if the block is stored uncompressed
+ *     the huffman coded bytes (common/huffman_table.c), zero padded to a whole byte, or the stored bytes
+ *
+ * A block is never split by a busy device: whatever the device didn't accept is written ahead of the next span, and
+ * spans committed until then are dropped whole. Serial devices always log uncompressed, since the logger at the other
+ * end can still lose bytes.
+ */
+#define BLACKBOX_COMPRESSED_MAGIC           "BFLZ"
+#define BLACKBOX_COMPRESSED_HEADER_SIZE     6
+#define BLACKBOX_COMPRESSED_VERSION         1
+#define BLACKBOX_COMPRESSED_BLOCK_STORED    0x8000
+
 extern int32_t blackboxHeaderBudget;
 
 void blackboxOpen(void);
 void blackboxWrite(uint8_t value);
+uint8_t *blackboxWriteBegin(int length);
+void blackboxWriteEnd(const uint8_t *end);
 int blackboxWriteString(const char *s);
+void blackboxDeviceCommit(void);
 
 void blackboxDeviceFlush(void);
 bool blackboxDeviceFlushForce(void);
@@ -0,0 +1,146 @@
+/*
+ * This file is part of Cleanflight and Betaflight.
+ *
+ * Cleanflight and Betaflight are free software. You can redistribute
+ * this software and/or modify this software under the terms of the
+ * GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Cleanflight and Betaflight are distributed in the hope that they
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_TRACE
+
+#include "common/maths.h"
+#include "common/streambuf.h"
+
+#include "drivers/time.h"
+
+#include "fc/tasks.h"
+
+#include "scheduler/scheduler.h"
+
+#include "trace.h"
+
+traceEvent_t traceBuffer[TRACE_BUFFER_SIZE];
+uint32_t traceHead;
+bool traceRunning = true;
+
+// Events held when the current dump started, capture is paused until the last of them has been read
+// or no page has been requested for TRACE_DUMP_TIMEOUT_MS
+static uint32_t dumpHead;
+static uint16_t dumpCount;
+static uint32_t dumpPageCycles;
+
+static const char * const traceNames[TRACE_ID_COUNT] = {
+    [TRACE_ID_GYRO_UPDATE] = "gyroUpdate",
+    [TRACE_ID_FILTERING] = "taskFiltering",
+    [TRACE_ID_PID_CONTROLLER] = "pidController",
+    [TRACE_ID_MIX_TABLE] = "mixTable",
+    [TRACE_ID_RX_FRAME_CHECK] = "rxFrameCheck",
+};
+
+static const char *traceName(unsigned id)
+{
+    if (id < TRACE_ID_COUNT) {
+        return traceNames[id];
+    }
+    if (id >= TRACE_ID_TASK_BASE && id < TRACE_ID_TASK_BASE + TASK_COUNT) {
+        return getTask(id - TRACE_ID_TASK_BASE)->attribute->taskName;
+    }
+    return NULL;
+}
+
+static void traceDumpEvents(sbuf_t *dst, uint16_t offset)
+{
+    if (offset == 0 || traceRunning) {
+        // Freeze a consistent window for the host to page through, a host resuming after a
+        // timeout gets the new window from its offset on
+        traceRunning = false;
+        dumpHead = traceHead;
+        dumpCount = MIN(traceHead, (uint32_t)TRACE_BUFFER_SIZE);
+    }
+    dumpPageCycles = getCycleCounter();
+
+    const uint8_t count = offset < dumpCount ? MIN(dumpCount - offset, TRACE_PAGE_EVENT_COUNT) : 0;
+
+    sbufWriteU16(dst, clockMicrosToCycles(1));
+    sbufWriteU32(dst, dumpHead);
+    sbufWriteU16(dst, dumpCount);
+    sbufWriteU16(dst, offset);
+    sbufWriteU8(dst, count);
+
+    const uint32_t first = dumpHead - dumpCount + offset;
+    for (unsigned i = 0; i < count; i++) {
+        const traceEvent_t *event = &traceBuffer[(first + i) & (TRACE_BUFFER_SIZE - 1)];
+        sbufWriteU32(dst, event->cycles);
+        sbufWriteU8(dst, event->id);
+        sbufWriteU8(dst, event->phase);
+    }
+
+    if (offset + count >= dumpCount) {
+        traceRunning = true;
+    }
+}
+
+// Called by the markers while capture is paused
+void traceCheckDumpTimeout(void)
+{
+    if (getCycleCounter() - dumpPageCycles > clockMicrosToCycles(TRACE_DUMP_TIMEOUT_MS * 1000)) {
+        traceRunning = true;
+    }
+}
+
+static void traceDumpNames(sbuf_t *dst, uint8_t firstId)
+{
+    // Leave room for the MSP framing
+    const int spaceMin = 2 + 16 + 8;
+    uint8_t *countPtr = sbufPtr(dst);
+    uint8_t count = 0;
+
+    sbufWriteU8(dst, 0);
+    for (unsigned id = firstId; id < TRACE_ID_TASK_BASE + TASK_COUNT; id++) {
+        const char *name = traceName(id);
+        if (!name) {
+            continue;
+        }
+        if (sbufBytesRemaining(dst) < (int)strlen(name) + spaceMin) {
+            break;
+        }
+        sbufWriteU8(dst, id);
+        sbufWritePString(dst, name);
+        count++;
+    }
+    *countPtr = count;
+}
+
+bool traceDump(sbuf_t *dst, sbuf_t *src)
+{
+    const uint8_t type = sbufBytesRemaining(src) ? sbufReadU8(src) : TRACE_DUMP_EVENTS;
+
+    switch (type) {
+    case TRACE_DUMP_EVENTS:
+        traceDumpEvents(dst, sbufBytesRemaining(src) >= 2 ? sbufReadU16(src) : 0);
+        return true;
+    case TRACE_DUMP_NAMES:
+        traceDumpNames(dst, sbufBytesRemaining(src) ? sbufReadU8(src) : 0);
+        return true;
+    default:
+        return false;
+    }
+}
+
+#endif
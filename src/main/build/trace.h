@@ -0,0 +1,94 @@
+/*
+ * This file is part of Cleanflight and Betaflight.
+ *
+ * Cleanflight and Betaflight are free software. You can redistribute
+ * this software and/or modify this software under the terms of the
+ * GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Cleanflight and Betaflight are distributed in the hope that they
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "drivers/system.h"
+
+// Cycle counter timestamped begin/end markers in a ring buffer, enabled at compile time with USE_TRACE.
+// Dumped with MSP2_TRACE_DUMP, src/utils/trace2chrome.py turns a dump into a Chrome trace/Perfetto timeline.
+
+#define TRACE_BUFFER_SIZE       1024    // events, must be a power of 2
+#define TRACE_PAGE_EVENT_COUNT  48      // events per MSP2_TRACE_DUMP reply
+#define TRACE_DUMP_TIMEOUT_MS   1000    // capture resumes if the host stops paging through a dump
+
+typedef enum {
+    TRACE_ID_GYRO_UPDATE = 0,
+    TRACE_ID_FILTERING,
+    TRACE_ID_PID_CONTROLLER,
+    TRACE_ID_MIX_TABLE,
+    TRACE_ID_RX_FRAME_CHECK,
+    TRACE_ID_COUNT,
+    TRACE_ID_TASK_BASE = 32,    // + taskId_e, around every scheduled task
+} traceId_e;
+
+typedef enum {
+    TRACE_PHASE_BEGIN = 0,
+    TRACE_PHASE_END,
+} tracePhase_e;
+
+typedef struct traceEvent_s {
+    uint32_t cycles;
+    uint8_t id;                 // traceId_e
+    uint8_t phase;              // tracePhase_e
+    uint16_t reserved;
+} traceEvent_t;
+
+// MSP2_TRACE_DUMP request types
+typedef enum {
+    TRACE_DUMP_EVENTS = 0,      // in: u16 offset, out: u16 cycles per us, u32 events recorded, u16 events held, u16 offset, u8 count, events
+    TRACE_DUMP_NAMES,           // in: u8 first id, out: u8 count, { u8 id, pstring name }
+} traceDumpType_e;
+
+#ifdef USE_TRACE
+
+extern traceEvent_t traceBuffer[TRACE_BUFFER_SIZE];
+extern uint32_t traceHead;
+extern bool traceRunning;
+
+void traceCheckDumpTimeout(void);
+
+static inline void traceMark(uint8_t id, uint8_t phase)
+{
+    if (traceRunning) {
+        traceEvent_t *event = &traceBuffer[traceHead++ & (TRACE_BUFFER_SIZE - 1)];
+        event->cycles = getCycleCounter();
+        event->id = id;
+        event->phase = phase;
+    } else {
+        traceCheckDumpTimeout();
+    }
+}
+
+#define TRACE_BEGIN(id) traceMark((id), TRACE_PHASE_BEGIN)
+#define TRACE_END(id) traceMark((id), TRACE_PHASE_END)
+
+struct sbuf_s;
+bool traceDump(struct sbuf_s *dst, struct sbuf_s *src);
+
+#else
+
+#define TRACE_BEGIN(id) do {} while (0)
+#define TRACE_END(id) do {} while (0)
+
+#endif
@@ -185,11 +185,14 @@ static bufWriter_t cliWriterDesc;
 static bufWriter_t *cliWriter = NULL;
 static bufWriter_t *cliErrorWriter = NULL;
 static uint8_t cliWriteBuffer[CLI_OUT_BUFFER_SIZE];
+// while set, output is only written out when the buffer fills rather than after every print
+static bool cliOutputBuffered = false;
 
 static char cliBuffer[CLI_IN_BUFFER_SIZE];
 static uint32_t bufferIndex = 0;
 
 static bool configIsInCopy = false;
+static bool settingNamesSorted = false;
 
 #define CURRENT_PROFILE_INDEX -1
 static int8_t pidProfileIndexToUse = CURRENT_PROFILE_INDEX;
@@ -332,7 +335,9 @@ static void cliPrintInternal(bufWriter_t *writer, const char *str)
         while (*str) {
             bufWriterAppend(writer, *str++);
         }
-        cliWriterFlushInternal(writer);
+        if (!cliOutputBuffered) {
+            cliWriterFlushInternal(writer);
+        }
     }
 }
 
@@ -382,7 +387,9 @@ static void cliPrintfva(const char *format, va_list va)
 {
     if (cliWriter) {
         tfp_format(cliWriter, cliPutp, format, va);
-        cliWriterFlush();
+        if (!cliOutputBuffered) {
+            cliWriterFlush();
+        }
     }
 }
 
@@ -798,14 +805,48 @@ static const char *dumpPgValue(const char *cmdName, const clivalue_t *value, dum
     return headingStr;
 }
 
+// True if the part of the PG holding values of the section, e.g. the profile being dumped, is all at its defaults
+static bool pgSectionEqualsDefault(const pgRegistry_t *pg, uint16_t valueSection)
+{
+    size_t offset = 0;
+    size_t size = pgSize(pg);
+
+    switch (valueSection) {
+    case PROFILE_VALUE:
+        offset = sizeof(pidProfile_t) * getPidProfileIndexToUse();
+        size = sizeof(pidProfile_t);
+        break;
+    case PROFILE_RATE_VALUE:
+        offset = sizeof(controlRateConfig_t) * getRateProfileIndexToUse();
+        size = sizeof(controlRateConfig_t);
+        break;
+    }
+
+    return memcmp(pg->copy + offset, pg->address + offset, size) == 0;
+}
+
 static void dumpAllValues(const char *cmdName, uint16_t valueSection, dumpFlags_t dumpMask, const char *headingStr)
 {
     headingStr = cliPrintSectionHeading(dumpMask, false, headingStr);
 
+    // the values of a PG are mostly listed together, so in a diff each PG is compared against its defaults once
+    // and the values of an unchanged PG skipped
+    pgn_t pgn = 0; // not a PG
+    bool pgEqualsDefault = false;
+
     for (uint32_t i = 0; i < valueTableEntryCount; i++) {
         const clivalue_t *value = &valueTable[i];
-        cliWriterFlush();
         if ((value->type & VALUE_SECTION_MASK) == valueSection || ((valueSection == MASTER_VALUE) && (value->type & VALUE_SECTION_MASK) == HARDWARE_VALUE)) {
+            if (dumpMask & DO_DIFF) {
+                if (value->pgn != pgn) {
+                    const pgRegistry_t *pg = pgFind(value->pgn);
+                    pgn = value->pgn;
+                    pgEqualsDefault = pg && pgSectionEqualsDefault(pg, valueSection);
+                }
+                if (pgEqualsDefault) {
+                    continue;
+                }
+            }
             headingStr = dumpPgValue(cmdName, value, dumpMask, headingStr);
         }
     }
@@ -2523,6 +2564,18 @@ static void cliSdInfo(const char *cmdName, char *cmdline)
         break;
     }
     cliPrintLinefeed();
+
+    // Write amplification is the data written to the card (including the FAT and directories) over the file data
+    const afatfsStatistics_t *statistics = afatfs_getStatistics();
+    const uint32_t amplification = statistics->bytesWritten ? (uint64_t)statistics->sectorsWritten * 512 * 100 / statistics->bytesWritten : 0;
+
+    cliPrintLinef("Files wrote %u bytes as %u sectors in %u bursts (write amplification %u.%02u), read %u sectors",
+        statistics->bytesWritten,
+        statistics->sectorsWritten,
+        statistics->writeBursts,
+        amplification / 100, amplification % 100,
+        statistics->sectorsRead
+    );
 }
 
 #endif
@@ -2556,6 +2609,13 @@ static void cliFlashInfo(const char *cmdName, char *cmdline)
             FLASH_PARTITION_SECTOR_COUNT(flashPartition) * layout->sectorSize,
             flashfsGetOffset()
     );
+
+    for (int i = 0; i < flashfsGetLogCount(); i++) {
+        flashfsLog_t log;
+        if (flashfsGetLog(i, &log)) {
+            cliPrintLinef("  log %d: start=%u, size=%u", i + 1, log.start, log.end - log.start);
+        }
+    }
 #endif
 }
 #endif // USE_FLASH_CHIP
@@ -4463,14 +4523,63 @@ static uint8_t getWordLength(const char *bufBegin, const char *bufEnd)
     return bufEnd - bufBegin;
 }
 
-STATIC_UNIT_TESTED uint16_t cliGetSettingIndex(const char *name, size_t length)
+// Orders a name of the given length, which need not be terminated, against a setting name in strcasecmp() order
+static int compareSettingName(const char *name, size_t length, const char *settingName)
+{
+    const int result = strncasecmp(name, settingName, length);
+    if (result != 0) {
+        return result;
+    }
+    // a name that is a prefix of the setting name sorts before it
+    return settingName[length] ? -1 : 0;
+}
+
+// Shell sort, called once, so that set can binary search for names rather than compare against every setting
+static void sortSettingNames(void)
 {
+    static const uint16_t gaps[] = { 701, 301, 132, 57, 23, 10, 4, 1 };
+
     for (uint32_t i = 0; i < valueTableEntryCount; i++) {
-        const char *settingName = valueTable[i].name;
+        valueTableNameIndex[i] = i;
+    }
+
+    for (unsigned g = 0; g < ARRAYLEN(gaps); g++) {
+        const uint32_t gap = gaps[g];
+        for (uint32_t i = gap; i < valueTableEntryCount; i++) {
+            const uint16_t index = valueTableNameIndex[i];
+            const char *name = valueTable[index].name;
+            uint32_t j = i;
+            while (j >= gap && strcasecmp(valueTable[valueTableNameIndex[j - gap]].name, name) > 0) {
+                valueTableNameIndex[j] = valueTableNameIndex[j - gap];
+                j -= gap;
+            }
+            valueTableNameIndex[j] = index;
+        }
+    }
+
+    settingNamesSorted = true;
+}
+
+STATIC_UNIT_TESTED uint16_t cliGetSettingIndex(const char *name, size_t length)
+{
+    if (!settingNamesSorted) {
+        sortSettingNames();
+    }
+
+    uint32_t low = 0;
+    uint32_t high = valueTableEntryCount;
+    while (low < high) {
+        const uint32_t mid = (low + high) / 2;
+        const uint16_t index = valueTableNameIndex[mid];
 
         // ensure exact match when setting to prevent setting variables with longer names
-        if (strncasecmp(name, settingName, length) == 0 && length == strlen(settingName)) {
-            return i;
+        const int result = compareSettingName(name, length, valueTable[index].name);
+        if (result == 0) {
+            return index;
+        } else if (result < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
         }
     }
     return valueTableEntryCount;
@@ -4484,12 +4593,15 @@ STATIC_UNIT_TESTED void cliSet(const char *cmdName, char *cmdline)
     if (len == 0 || (len == 1 && cmdline[0] == '*')) {
         cliPrintLine("Current settings: ");
 
+        cliOutputBuffered = true;
         for (uint32_t i = 0; i < valueTableEntryCount; i++) {
             const clivalue_t *val = &valueTable[i];
             cliPrintf("%s = ", valueTable[i].name);
             cliPrintVar(cmdName, val, len); // when len is 1 (when * is passed as argument), it will print min/max values as well, for gui
             cliPrintLinefeed();
         }
+        cliWriterFlush();
+        cliOutputBuffered = false;
     } else if ((eqptr = strstr(cmdline, "=")) != NULL) {
         // has equals
 
@@ -4912,12 +5024,50 @@ static void cliStatus(const char *cmdName, char *cmdline)
     cliPrintLinefeed();
 }
 
+#if defined(USE_LATE_TASK_STATISTICS)
+static void cliPrintTaskHistogramPercentiles(const taskHistogram_t *histogram)
+{
+    static const uint16_t percentilesPermille[] = { 500, 990, 999 };
+
+    for (unsigned i = 0; i < ARRAYLEN(percentilesPermille); i++) {
+        const uint32_t value10thUs = taskHistogramPercentile(histogram, percentilesPermille[i]);
+        cliPrintf(" %6d.%1d", value10thUs / 10, value10thUs % 10);
+    }
+}
+
+static void cliTaskHistograms(void)
+{
+    // Percentiles are bucket upper bounds, histograms are cleared once printed
+    cliPrintLine("Task histograms/us      exec p50     p99   p99.9    late p50     p99   p99.9");
+    for (taskId_e taskId = 0; taskId < TASK_COUNT; taskId++) {
+        taskInfo_t taskInfo;
+        getTaskInfo(taskId, &taskInfo);
+        if (taskInfo.isEnabled) {
+            cliPrintf("%02d - (%15s)  ", taskId, taskInfo.taskName);
+            cliPrintTaskHistogramPercentiles(&taskInfo.histogram[TASK_HISTOGRAM_EXEC_TIME]);
+            cliPrintf("  ");
+            cliPrintTaskHistogramPercentiles(&taskInfo.histogram[TASK_HISTOGRAM_START_LATENCY]);
+            cliPrintLinefeed();
+        }
+    }
+    schedulerResetTaskHistograms();
+}
+#endif
+
 static void cliTasks(const char *cmdName, char *cmdline)
 {
     UNUSED(cmdName);
-    UNUSED(cmdline);
     int averageLoadSum = 0;
 
+#if defined(USE_LATE_TASK_STATISTICS)
+    if (strcasecmp(cmdline, "hist") == 0) {
+        cliTaskHistograms();
+        return;
+    }
+#else
+    UNUSED(cmdline);
+#endif
+
 #ifndef MINIMAL_CLI
     if (systemConfig()->task_statistics) {
 #if defined(USE_LATE_TASK_STATISTICS)
@@ -6317,6 +6467,9 @@ static void printConfig(const char *cmdName, char *cmdline, bool doDiff)
 
     backupAndResetConfigs();
 
+    // stream the output through the write buffer, a full dump is too long to write out one print at a time
+    cliOutputBuffered = true;
+
 #ifdef USE_CLI_BATCH
     bool batchModeEnabled = false;
 #endif
@@ -6487,6 +6640,9 @@ static void printConfig(const char *cmdName, char *cmdline, bool doDiff)
     }
 #endif
 
+    cliWriterFlush();
+    cliOutputBuffered = false;
+
     // restore configs from copies
     restoreConfigs(0);
 }
@@ -6701,7 +6857,11 @@ const clicmd_t cmdTable[] = {
         "\treverse <servo> <source> r|n", cliServoMix),
 #endif
     CLI_COMMAND_DEF("status", "show status", NULL, cliStatus),
+#if defined(USE_LATE_TASK_STATISTICS)
+    CLI_COMMAND_DEF("tasks", "show task stats", "[hist]", cliTasks),
+#else
     CLI_COMMAND_DEF("tasks", "show task stats", NULL, cliTasks),
+#endif
 #ifdef USE_TIMER_MGMT
     CLI_COMMAND_DEF("timer", "show/set timers", "<> | <pin> list | <pin> [af<alternate function>|none|<option(deprecated)>] | list | show", cliTimer),
 #endif
@@ -6881,24 +7041,54 @@ static void processCharacterInteractive(const char c)
     }
 }
 
+static bool cliIsCommandCharacter(uint8_t c)
+{
+    return c == '\n' || c == '\r' || c == 0x3 || c == 4;
+}
+
+// Returns false if the CLI was exited
+static bool cliProcessCharacter(uint8_t c)
+{
+    if (cliInteractive) {
+        processCharacterInteractive(c);
+    } else {
+        // handle terminating flow control character
+        if (c == 0x3 || (cmp32(millis(), cliEntryTime) > 2000)) { // CTRL-C (ETX) or 2 seconds timeout
+            cliWrite(0x3); // send end of text, terminating flow control
+            cliExit(false);
+            return false;
+        }
+        processCharacter(c);
+    }
+    return true;
+}
+
 bool cliProcess(void)
 {
     if (!cliWriter || !cliMode) {
         return false;
     }
 
-    while (serialRxBytesWaiting(cliPort)) {
-        uint8_t c = serialRead(cliPort);
-        if (cliInteractive) {
-            processCharacterInteractive(c);
-        } else {
-            // handle terminating flow control character
-            if (c == 0x3 || (cmp32(millis(), cliEntryTime) > 2000)) { // CTRL-C (ETX) or 2 seconds timeout
-                cliWrite(0x3); // send end of text, terminating flow control
-                cliExit(false);
+    const uint8_t *data;
+    uint32_t count;
+    while (cliMode && (count = serialReadSpan(cliPort, &data))) {
+        // Characters are processed in place up to a line end or exit, which is consumed before it is processed
+        // as the command it runs may read from or close the port
+        uint32_t used = 0;
+        while (used < count && !cliIsCommandCharacter(data[used])) {
+            if (!cliProcessCharacter(data[used++])) {
+                serialConsume(cliPort, used);
                 return cliMode;
             }
-            processCharacter(c);
+        }
+        if (used < count) {
+            const uint8_t c = data[used++];
+            serialConsume(cliPort, used);
+            if (!cliProcessCharacter(c)) {
+                return cliMode;
+            }
+        } else {
+            serialConsume(cliPort, used);
         }
     }
     cliWriterFlush();
@@ -328,6 +328,10 @@ static const char * const lookupTableBlackboxMode[] = {
 static const char * const lookupTableBlackboxSampleRate[] = {
     "1/1", "1/2", "1/4", "1/8", "1/16"
 };
+
+static const char * const lookupTableBlackboxCompression[] = {
+    "OFF", "HUFFMAN"
+};
 #endif
 
 #ifdef USE_SERIALRX
@@ -521,7 +525,10 @@ static const char * const lookupTableVtxLowPowerDisarm[] = {
 
 #ifdef USE_SDCARD
 static const char * const lookupTableSdcardMode[] = {
-    "OFF", "SPI", "SDIO"
+    "OFF", "SPI", "SDIO",
+#ifdef USE_SDCARD_FILE
+    "FILE",
+#endif
 };
 #endif
 
@@ -644,6 +651,10 @@ const char* const lookupTableYawType[] = {
 };
 #endif // USE_WING
 
+static const char* const lookupTableSchedulerMode[] = {
+    "PRIORITY", "DEADLINE",
+};
+
 #define LOOKUP_TABLE_ENTRY(name) { name, ARRAYLEN(name) }
 
 const lookupTableEntry_t lookupTables[] = {
@@ -664,6 +675,7 @@ const lookupTableEntry_t lookupTables[] = {
     LOOKUP_TABLE_ENTRY(lookupTableBlackboxDevice),
     LOOKUP_TABLE_ENTRY(lookupTableBlackboxMode),
     LOOKUP_TABLE_ENTRY(lookupTableBlackboxSampleRate),
+    LOOKUP_TABLE_ENTRY(lookupTableBlackboxCompression),
 #endif
     LOOKUP_TABLE_ENTRY(currentMeterSourceNames),
     LOOKUP_TABLE_ENTRY(voltageMeterSourceNames),
@@ -777,6 +789,7 @@ const lookupTableEntry_t lookupTables[] = {
     LOOKUP_TABLE_ENTRY(lookupTableTpaSpeedType),
     LOOKUP_TABLE_ENTRY(lookupTableYawType),
 #endif // USE_WING
+    LOOKUP_TABLE_ENTRY(lookupTableSchedulerMode),
 };
 
 #undef LOOKUP_TABLE_ENTRY
@@ -990,6 +1003,7 @@ const clivalue_t valueTable[] = {
 #endif
     { "blackbox_mode",              VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_BLACKBOX_MODE }, PG_BLACKBOX_CONFIG, offsetof(blackboxConfig_t, mode) },
     { "blackbox_high_resolution",   VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_OFF_ON }, PG_BLACKBOX_CONFIG, offsetof(blackboxConfig_t, high_resolution) },
+    { "blackbox_compression",       VAR_UINT8  | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_BLACKBOX_COMPRESSION }, PG_BLACKBOX_CONFIG, offsetof(blackboxConfig_t, compression) },
 #endif
 
 // PG_MOTOR_CONFIG
@@ -1814,6 +1828,9 @@ const clivalue_t valueTable[] = {
     { "displayport_msp_row_adjust", VAR_INT8    | MASTER_VALUE, .config.minmax = { -3, 0 }, PG_DISPLAY_PORT_MSP_CONFIG, offsetof(displayPortProfile_t, rowAdjust) },
     { "displayport_msp_fonts",      VAR_UINT8   | MASTER_VALUE | MODE_ARRAY, .config.array.length = 4, PG_DISPLAY_PORT_MSP_CONFIG, offsetof(displayPortProfile_t, fontSelection) },
     { "displayport_msp_use_device_blink",   VAR_UINT8   | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_OFF_ON }, PG_DISPLAY_PORT_MSP_CONFIG, offsetof(displayPortProfile_t, useDeviceBlink) },
+#ifdef USE_MSP_DISPLAYPORT_BATCH
+    { "displayport_msp_batch_writes",       VAR_UINT8   | MASTER_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_OFF_ON }, PG_DISPLAY_PORT_MSP_CONFIG, offsetof(displayPortProfile_t, batchWrites) },
+#endif
 #endif
 
 // PG_DISPLAY_PORT_MSP_CONFIG
@@ -1978,6 +1995,7 @@ const clivalue_t valueTable[] = {
     { "scheduler_relax_osd", VAR_UINT16  | HARDWARE_VALUE, .config.minmaxUnsigned = { 0, 500 }, PG_SCHEDULER_CONFIG, PG_ARRAY_ELEMENT_OFFSET(schedulerConfig_t, 0, osdRelaxDeterminism) },
 
     { "scheduler_debug_task", VAR_UINT16  | HARDWARE_VALUE, .config.minmaxUnsigned = { 0, TASK_COUNT }, PG_SCHEDULER_CONFIG, PG_ARRAY_ELEMENT_OFFSET(schedulerConfig_t, 0, debugTask) },
+    { "scheduler_mode",      VAR_UINT8   | HARDWARE_VALUE | MODE_LOOKUP, .config.lookup = { TABLE_SCHEDULER_MODE }, PG_SCHEDULER_CONFIG, offsetof(schedulerConfig_t, mode) },
 
 #ifdef USE_LATE_TASK_STATISTICS
     { "cpu_late_limit_permille", VAR_UINT8 | MASTER_VALUE, .config.minmaxUnsigned = { 0, 100 }, PG_SCHEDULER_CONFIG, offsetof(schedulerConfig_t, cpuLatePercentageLimit) },
@@ -1997,6 +2015,7 @@ const clivalue_t valueTable[] = {
     { PARAM_NAME_RPM_FILTER_MIN_HZ,        VAR_UINT8 | MASTER_VALUE, .config.minmaxUnsigned = { 30, 200 }, PG_RPM_FILTER_CONFIG, offsetof(rpmFilterConfig_t, rpm_filter_min_hz) },
     { PARAM_NAME_RPM_FILTER_FADE_RANGE_HZ, VAR_UINT16 | MASTER_VALUE, .config.minmaxUnsigned = { 0, 1000 }, PG_RPM_FILTER_CONFIG, offsetof(rpmFilterConfig_t, rpm_filter_fade_range_hz) },
     { PARAM_NAME_RPM_FILTER_LPF_HZ,        VAR_UINT16 | MASTER_VALUE, .config.minmaxUnsigned = { 100, 500 }, PG_RPM_FILTER_CONFIG, offsetof(rpmFilterConfig_t, rpm_filter_lpf_hz) },
+    { PARAM_NAME_RPM_FILTER_UPDATE_HZ,     VAR_UINT8 | MASTER_VALUE, .config.minmaxUnsigned = { 0, 20 }, PG_RPM_FILTER_CONFIG, offsetof(rpmFilterConfig_t, rpm_filter_update_hz) },
 #endif
 
 #ifdef USE_RX_FLYSKY
@@ -2077,4 +2096,7 @@ const clivalue_t valueTable[] = {
 
 const uint16_t valueTableEntryCount = ARRAYLEN(valueTable);
 
+// valueTable positions in order of setting name, sorted by the CLI the first time a setting is looked up by name
+uint16_t valueTableNameIndex[ARRAYLEN(valueTable)];
+
 STATIC_ASSERT(LOOKUP_TABLE_COUNT == ARRAYLEN(lookupTables), LOOKUP_TABLE_COUNT_incorrect);
@@ -42,6 +42,7 @@ typedef enum {
     TABLE_BLACKBOX_DEVICE,
     TABLE_BLACKBOX_MODE,
     TABLE_BLACKBOX_SAMPLE_RATE,
+    TABLE_BLACKBOX_COMPRESSION,
 #endif
     TABLE_CURRENT_METER,
     TABLE_VOLTAGE_METER,
@@ -152,6 +153,7 @@ typedef enum {
     TABLE_TPA_SPEED_TYPE,
     TABLE_YAW_TYPE,
 #endif // USE_WING
+    TABLE_SCHEDULER_MODE,
     LOOKUP_TABLE_COUNT
 } lookupTableIndex_e;
 
@@ -248,6 +250,7 @@ extern const lookupTableEntry_t lookupTables[];
 extern const uint16_t valueTableEntryCount;
 
 extern const clivalue_t valueTable[];
+extern uint16_t valueTableNameIndex[];
 //extern const uint8_t lookupTablesEntryCount;
 
 extern const char * const lookupTableGyroHardware[];
@@ -273,6 +273,120 @@ FAST_CODE float biquadFilterApply(biquadFilter_t *filter, float input)
     return result;
 }
 
+// Biquad filter bank
+
+void biquadFilterBankInit(biquadFilterBank_t *bank, biquadBankSection_t *sections, int count)
+{
+    bank->count = count;
+    bank->sections = sections;
+
+    memset(sections, 0, count * sizeof(*sections));
+}
+
+FAST_CODE void biquadFilterBankUpdate(biquadFilterBank_t *bank, int section, float filterFreq, uint32_t refreshRate, float Q, biquadFilterType_e filterType, float weight)
+{
+    // reuse the single biquad coefficient calculation, state is kept in the bank
+    biquadFilter_t coeffs;
+    biquadFilterUpdate(&coeffs, filterFreq, refreshRate, Q, filterType, weight);
+
+    biquadBankSection_t *dest = &bank->sections[section];
+    dest->b0 = coeffs.b0;
+    dest->b1 = coeffs.b1;
+    dest->b2 = coeffs.b2;
+    dest->a1 = coeffs.a1;
+    dest->a2 = coeffs.a2;
+    dest->weight = coeffs.weight;
+}
+
+/* Applies all sections of the bank in df1 with crossfading (see biquadFilterApplyDF1Weighted) to BIQUAD_BANK_LANES values in place */
+FAST_CODE void biquadFilterBankApplyDF1Weighted(const biquadFilterBank_t *bank, float *values)
+{
+    // work on a local copy so the compiler knows it can't alias the filter state
+    float value[BIQUAD_BANK_LANES];
+    for (int lane = 0; lane < BIQUAD_BANK_LANES; lane++) {
+        value[lane] = values[lane];
+    }
+
+    for (int i = 0; i < bank->count; i++) {
+        biquadBankSection_t *section = &bank->sections[i];
+
+        // load coefficients once per section instead of once per axis
+        const float b0 = section->b0;
+        const float b1 = section->b1;
+        const float b2 = section->b2;
+        const float a1 = section->a1;
+        const float a2 = section->a2;
+        const float weight = section->weight;
+
+        // fixed trip count and unit stride so the lanes can be kept in vector registers
+        for (int lane = 0; lane < BIQUAD_BANK_LANES; lane++) {
+            const float input = value[lane];
+            const float result = b0 * input + b1 * section->x1[lane] + b2 * section->x2[lane] - a1 * section->y1[lane] - a2 * section->y2[lane];
+
+            section->x2[lane] = section->x1[lane];
+            section->x1[lane] = input;
+
+            section->y2[lane] = section->y1[lane];
+            section->y1[lane] = result;
+
+            value[lane] = weight * result + (1 - weight) * input;
+        }
+    }
+
+    for (int lane = 0; lane < BIQUAD_BANK_LANES; lane++) {
+        values[lane] = value[lane];
+    }
+}
+
+void biquadNotchTableInit(biquadNotchTable_t *table, float (*coeffs)[2], int size, float minHz, float maxHz, uint32_t refreshRate, float Q)
+{
+    table->coeffs = coeffs;
+    table->minHz = minHz;
+    table->maxHz = maxHz;
+
+    if (size < 2 || maxHz <= minHz) {
+        table->size = 0; // empty table, every lookup misses
+        table->hzToIndex = 0.0f;
+        return;
+    }
+
+    table->size = size;
+    table->hzToIndex = (size - 1) / (maxHz - minHz);
+
+    for (int i = 0; i < size; i++) {
+        biquadFilter_t notch;
+        biquadFilterUpdate(&notch, minHz + i / table->hzToIndex, refreshRate, Q, FILTER_NOTCH, 1.0f);
+        coeffs[i][0] = notch.b0;
+        coeffs[i][1] = notch.b1;
+    }
+}
+
+/* Updates a notch section from the table, returns false if filterFreq is outside of the table so the caller can fall back to biquadFilterBankUpdate() */
+FAST_CODE bool biquadFilterBankUpdateNotchFromTable(biquadFilterBank_t *bank, int section, const biquadNotchTable_t *table, float filterFreq, float weight)
+{
+    if (filterFreq < table->minHz || filterFreq > table->maxHz || table->size == 0) {
+        return false;
+    }
+
+    const float position = (filterFreq - table->minHz) * table->hzToIndex;
+    const int index = MIN((int)position, table->size - 2);
+    const float fraction = position - index;
+
+    const float b0 = table->coeffs[index][0] + fraction * (table->coeffs[index + 1][0] - table->coeffs[index][0]);
+    const float b1 = table->coeffs[index][1] + fraction * (table->coeffs[index + 1][1] - table->coeffs[index][1]);
+
+    // normalised notch: b2 = b0, a1 = b1 and a2 = (1 - alpha) / (1 + alpha) = 2 * b0 - 1
+    biquadBankSection_t *dest = &bank->sections[section];
+    dest->b0 = b0;
+    dest->b1 = b1;
+    dest->b2 = b0;
+    dest->a1 = b1;
+    dest->a2 = 2.0f * b0 - 1.0f;
+    dest->weight = weight;
+
+    return true;
+}
+
 // Phase Compensator (Lead-Lag-Compensator)
 
 void phaseCompInit(phaseComp_t *filter, const float centerFreqHz, const float centerPhaseDeg, const uint32_t looptimeUs)
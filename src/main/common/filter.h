@@ -65,6 +65,35 @@ typedef struct biquadFilter_s {
     float weight;
 } biquadFilter_t;
 
+// Bank of cascaded biquad sections applied to several independent signals (e.g. the gyro axes) per call.
+// Coefficients are shared by all lanes of a section, state is kept per lane so every section
+// is processed for all lanes in one pass with contiguous, fixed-width (SIMD friendly) accesses.
+#define BIQUAD_BANK_LANES 4 // XYZ axes padded to a power of two
+
+typedef struct biquadBankSection_s {
+    float b0, b1, b2, a1, a2;
+    float weight;
+    float x1[BIQUAD_BANK_LANES];
+    float x2[BIQUAD_BANK_LANES];
+    float y1[BIQUAD_BANK_LANES];
+    float y2[BIQUAD_BANK_LANES];
+} biquadBankSection_t;
+
+typedef struct biquadFilterBank_s {
+    int count;
+    biquadBankSection_t *sections;
+} biquadFilterBank_t;
+
+// Precomputed notch coefficients over a frequency range for a fixed Q and refresh rate.
+// Entries are linearly interpolated, which avoids the sin/cos/division of biquadFilterUpdate().
+typedef struct biquadNotchTable_s {
+    int size;
+    float minHz;
+    float maxHz;
+    float hzToIndex;
+    float (*coeffs)[2]; // b0 and b1 per entry, the other notch coefficients are derived from these
+} biquadNotchTable_t;
+
 typedef struct phaseComp_s {
     float b0, b1, a1;
     float x1, y1;
@@ -125,6 +154,13 @@ float biquadFilterApplyDF1(biquadFilter_t *filter, float input);
 float biquadFilterApplyDF1Weighted(biquadFilter_t *filter, float input);
 float biquadFilterApply(biquadFilter_t *filter, float input);
 
+void biquadFilterBankInit(biquadFilterBank_t *bank, biquadBankSection_t *sections, int count);
+void biquadFilterBankUpdate(biquadFilterBank_t *bank, int section, float filterFreq, uint32_t refreshRate, float Q, biquadFilterType_e filterType, float weight);
+void biquadFilterBankApplyDF1Weighted(const biquadFilterBank_t *bank, float *values);
+
+void biquadNotchTableInit(biquadNotchTable_t *table, float (*coeffs)[2], int size, float minHz, float maxHz, uint32_t refreshRate, float Q);
+bool biquadFilterBankUpdateNotchFromTable(biquadFilterBank_t *bank, int section, const biquadNotchTable_t *table, float filterFreq, float weight);
+
 void phaseCompInit(phaseComp_t *filter, const float centerFreq, const float centerPhase, const uint32_t looptimeUs);
 void phaseCompUpdate(phaseComp_t *filter, const float centerFreq, const float centerPhase, const uint32_t looptimeUs);
 float phaseCompApply(phaseComp_t *filter, const float input);
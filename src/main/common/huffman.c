@@ -100,4 +100,41 @@ int huffmanEncodeBufStreaming(huffmanState_t *state, const uint8_t *inBuf, int i
     return 0;
 }
 
+/*
+ * Produces the same output as huffmanEncodeBuf(), but collects codes in a bit accumulator so each input byte costs a
+ * table lookup and a shift instead of a loop over the bits of its code.
+ * Returns the number of bytes written, or -1 if the encoded data would not fit in outBufLen.
+ */
+int huffmanEncodeBlock(uint8_t *outBuf, int outBufLen, const uint8_t *inBuf, int inLen, const huffmanTable_t *huffmanTable)
+{
+    uint8_t *outByte = outBuf;
+    const uint8_t *outEnd = outBuf + outBufLen;
+    uint32_t bits = 0;
+    int bitCount = 0;
+
+    for (const uint8_t *pos = inBuf, *end = inBuf + inLen; pos < end; ++pos) {
+        const int huffCodeLen = huffmanTable[*pos].codeLen;
+        // codes are stored left aligned in 12 bits
+        bits = (bits << huffCodeLen) | (huffmanTable[*pos].code >> (12 - huffCodeLen));
+        bitCount += huffCodeLen;
+
+        while (bitCount >= 8) {
+            if (outByte == outEnd) {
+                return -1;
+            }
+            bitCount -= 8;
+            *outByte++ = bits >> bitCount;
+        }
+    }
+
+    if (bitCount) {
+        if (outByte == outEnd) {
+            return -1;
+        }
+        *outByte++ = bits << (8 - bitCount);
+    }
+
+    return outByte - outBuf;
+}
+
 #endif
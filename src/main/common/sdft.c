@@ -32,10 +32,9 @@ static FAST_DATA_ZERO_INIT float     rPowerN;  // SDFT_R to the power of SDFT_SA
 static FAST_DATA_ZERO_INIT bool      isInitialized;
 static FAST_DATA_ZERO_INIT complex_t twiddle[SDFT_BIN_COUNT];
 
-static void applySqrt(const sdft_t *sdft, float *data);
-static void updateEdges(sdft_t *sdft, const float value, const int batchIdx);
+static void updateAxesBins(sdftAxes_t *sdft, const float *delta, const int startBin, const int endBin);
 
-void sdftInit(sdft_t *sdft, const int startBin, const int endBin, const int numBatches)
+static void initTwiddles(void)
 {
     if (!isInitialized) {
         rPowerN = powf(SDFT_R, SDFT_SAMPLE_SIZE);
@@ -46,6 +45,11 @@ void sdftInit(sdft_t *sdft, const int startBin, const int endBin, const int numB
         }
         isInitialized = true;
     }
+}
+
+void sdftAxesInit(sdftAxes_t *sdft, const int startBin, const int endBin, const int numBatches)
+{
+    initTwiddles();
 
     sdft->idx = 0;
 
@@ -56,135 +60,106 @@ void sdftInit(sdft_t *sdft, const int startBin, const int endBin, const int numB
     sdft->batchSize = (sdft->endBin - sdft->startBin + 1) / sdft->numBatches;
 
     for (int i = 0; i < SDFT_SAMPLE_SIZE; i++) {
-        sdft->samples[i] = 0.0f;
+        for (int lane = 0; lane < SDFT_AXIS_LANES; lane++) {
+            sdft->samples[i][lane] = 0.0f;
+        }
     }
 
     for (int i = 0; i < SDFT_BIN_COUNT; i++) {
-        sdft->data[i] = 0.0f;
+        for (int lane = 0; lane < SDFT_AXIS_LANES; lane++) {
+            sdft->data[i].re[lane] = 0.0f;
+            sdft->data[i].im[lane] = 0.0f;
+        }
     }
 }
 
-// Add new sample to frequency spectrum
-FAST_CODE void sdftPush(sdft_t *sdft, const float sample)
-{
-    const float delta = sample - rPowerN * sdft->samples[sdft->idx];
-
-    sdft->samples[sdft->idx] = sample;
-    sdft->idx = (sdft->idx + 1) % SDFT_SAMPLE_SIZE;
-
-    for (int i = sdft->startBin; i <= sdft->endBin; i++) {
-        sdft->data[i] = twiddle[i] * (sdft->data[i] + delta);
-    }
-
-    updateEdges(sdft, delta, 0);
-}
-
-// Add new sample to frequency spectrum in parts
-FAST_CODE void sdftPushBatch(sdft_t *sdft, const float sample, const int batchIdx)
+// Add new sample of every axis to their frequency spectra in parts
+FAST_CODE void sdftAxesPushBatch(sdftAxes_t *sdft, const float samples[XYZ_AXIS_COUNT], const int batchIdx)
 {
     const int batchStart = sdft->batchSize * batchIdx + sdft->startBin;
     int batchEnd = batchStart;
 
-    const float delta = sample - rPowerN * sdft->samples[sdft->idx];
+    // padding lanes are fed with zeros and stay zero
+    float delta[SDFT_AXIS_LANES] = { 0 };
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        delta[axis] = samples[axis] - rPowerN * sdft->samples[sdft->idx][axis];
+    }
 
     if (batchIdx == sdft->numBatches - 1) {
-        sdft->samples[sdft->idx] = sample;
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            sdft->samples[sdft->idx][axis] = samples[axis];
+        }
         sdft->idx = (sdft->idx + 1) % SDFT_SAMPLE_SIZE;
         batchEnd += sdft->endBin - batchStart + 1;
     } else {
         batchEnd += sdft->batchSize;
     }
 
-    for (int i = batchStart; i < batchEnd; i++) {
-        sdft->data[i] = twiddle[i] * (sdft->data[i] + delta);
-    }
-
-    updateEdges(sdft, delta, batchIdx);
-}
-
-// Get squared magnitude of frequency spectrum
-FAST_CODE void sdftMagSq(const sdft_t *sdft, float *output)
-{
-    float re;
-    float im;
+    updateAxesBins(sdft, delta, batchStart, batchEnd);
 
-    for (int i = sdft->startBin; i <= sdft->endBin; i++) {
-        re = crealf(sdft->data[i]);
-        im = cimagf(sdft->data[i]);
-        output[i] = re * re + im * im;
+    // First bin outside of lower range, needed for proper windowing at the edges of active range
+    if (sdft->startBin > 0 && batchIdx == 0) {
+        updateAxesBins(sdft, delta, sdft->startBin - 1, sdft->startBin);
     }
-}
 
-// Get magnitude of frequency spectrum (slower)
-FAST_CODE void sdftMagnitude(const sdft_t *sdft, float *output)
-{
-    sdftMagSq(sdft, output);
-    applySqrt(sdft, output);
+    // First bin outside of upper range
+    if (sdft->endBin < SDFT_BIN_COUNT - 1 && batchIdx == sdft->numBatches - 1) {
+        updateAxesBins(sdft, delta, sdft->endBin + 1, sdft->endBin + 2);
+    }
 }
 
-// Get squared magnitude of frequency spectrum with Hann window applied
+// Get squared magnitude of frequency spectrum of one axis with Hann window applied
 // Hann window in frequency domain: X[k] = -0.25 * X[k-1] +0.5 * X[k] -0.25 * X[k+1]
-FAST_CODE void sdftWinSq(const sdft_t *sdft, float *output)
+FAST_CODE void sdftAxesWinSq(const sdftAxes_t *sdft, const int axis, float *output)
 {
-    complex_t val;
+    const sdftAxesBin_t *data = sdft->data;
+    const int startBin = sdft->startBin;
+    const int endBin = sdft->endBin;
     float re;
     float im;
 
     // Apply window at the lower edge of active range
-    if (sdft->startBin == 0) {
-        val = sdft->data[sdft->startBin] - sdft->data[sdft->startBin + 1];
+    if (startBin == 0) {
+        re = data[startBin].re[axis] - data[startBin + 1].re[axis];
+        im = data[startBin].im[axis] - data[startBin + 1].im[axis];
     } else {
-        val = sdft->data[sdft->startBin] - 0.5f * (sdft->data[sdft->startBin - 1] + sdft->data[sdft->startBin + 1]);
+        re = data[startBin].re[axis] - 0.5f * (data[startBin - 1].re[axis] + data[startBin + 1].re[axis]);
+        im = data[startBin].im[axis] - 0.5f * (data[startBin - 1].im[axis] + data[startBin + 1].im[axis]);
     }
-    re = crealf(val);
-    im = cimagf(val);
-    output[sdft->startBin] = re * re + im * im;
-
-    for (int i = (sdft->startBin + 1); i < sdft->endBin; i++) {
-        val = sdft->data[i] - 0.5f * (sdft->data[i - 1] + sdft->data[i + 1]); // multiply by 2 to save one multiplication
-        re = crealf(val);
-        im = cimagf(val);
+    output[startBin] = re * re + im * im;
+
+    for (int i = (startBin + 1); i < endBin; i++) {
+        re = data[i].re[axis] - 0.5f * (data[i - 1].re[axis] + data[i + 1].re[axis]); // multiply by 2 to save one multiplication
+        im = data[i].im[axis] - 0.5f * (data[i - 1].im[axis] + data[i + 1].im[axis]);
         output[i] = re * re + im * im;
     }
 
     // Apply window at the upper edge of active range
-    if (sdft->endBin == SDFT_BIN_COUNT - 1) {
-        val = sdft->data[sdft->endBin] - sdft->data[sdft->endBin - 1];
+    if (endBin == SDFT_BIN_COUNT - 1) {
+        re = data[endBin].re[axis] - data[endBin - 1].re[axis];
+        im = data[endBin].im[axis] - data[endBin - 1].im[axis];
     } else {
-        val = sdft->data[sdft->endBin] - 0.5f * (sdft->data[sdft->endBin - 1] + sdft->data[sdft->endBin + 1]);
+        re = data[endBin].re[axis] - 0.5f * (data[endBin - 1].re[axis] + data[endBin + 1].re[axis]);
+        im = data[endBin].im[axis] - 0.5f * (data[endBin - 1].im[axis] + data[endBin + 1].im[axis]);
     }
-    re = crealf(val);
-    im = cimagf(val);
-    output[sdft->endBin] = re * re + im * im;
-}
-
-// Get magnitude of frequency spectrum with Hann window applied (slower)
-FAST_CODE void sdftWindow(const sdft_t *sdft, float *output)
-{
-    sdftWinSq(sdft, output);
-    applySqrt(sdft, output);
+    output[endBin] = re * re + im * im;
 }
 
-// Apply square root to the whole sdft range
-static FAST_CODE void applySqrt(const sdft_t *sdft, float *data)
+// Complex multiply of bins [startBin, endBin) of all axes with their twiddle factor
+static FAST_CODE void updateAxesBins(sdftAxes_t *sdft, const float *delta, const int startBin, const int endBin)
 {
-    for (int i = sdft->startBin; i <= sdft->endBin; i++) {
-        data[i] = sqrtf(data[i]);
-    }
-}
-
-// Needed for proper windowing at the edges of active range
-static FAST_CODE void updateEdges(sdft_t *sdft, const float value, const int batchIdx)
-{
-    // First bin outside of lower range
-    if (sdft->startBin > 0 && batchIdx == 0) {
-        const unsigned idx = sdft->startBin - 1;
-        sdft->data[idx] = twiddle[idx] * (sdft->data[idx] + value);
-    }
-
-    // First bin outside of upper range
-    if (sdft->endBin < SDFT_BIN_COUNT - 1 && batchIdx == sdft->numBatches - 1) {
-        const unsigned idx = sdft->endBin + 1;
-        sdft->data[idx] = twiddle[idx] * (sdft->data[idx] + value);
+    for (int i = startBin; i < endBin; i++) {
+        // load twiddle once per bin instead of once per axis
+        const float twRe = crealf(twiddle[i]);
+        const float twIm = cimagf(twiddle[i]);
+        sdftAxesBin_t *bin = &sdft->data[i];
+
+        // fixed trip count and unit stride so the axes can be kept in vector registers
+        for (int lane = 0; lane < SDFT_AXIS_LANES; lane++) {
+            const float re = bin->re[lane] + delta[lane];
+            const float im = bin->im[lane];
+            bin->re[lane] = twRe * re - twIm * im;
+            bin->im[lane] = twRe * im + twIm * re;
+        }
     }
 }
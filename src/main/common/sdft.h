@@ -27,28 +27,35 @@
 #undef I  // avoid collision of imaginary unit I with variable I in pid.h
 typedef float complex complex_t; // Better readability for type "float complex"
 
+#include "common/axis.h"
 #include "common/utils.h"
 
-#define SDFT_SAMPLE_SIZE 72
+#ifndef SDFT_SAMPLE_SIZE
+#define SDFT_SAMPLE_SIZE 72 // targets may use a larger size for finer frequency resolution
+#endif
 #define SDFT_BIN_COUNT   (SDFT_SAMPLE_SIZE / 2)
+#define SDFT_AXIS_LANES  4  // XYZ axes padded to a power of two
 
-typedef struct sdft_s {
-    int idx;                           // circular buffer index
+typedef struct sdftAxesBin_s {
+    float re[SDFT_AXIS_LANES];
+    float im[SDFT_AXIS_LANES];
+} sdftAxesBin_t;
+
+// SDFT of all axes at once. Samples and spectra of the axes are interleaved per bin,
+// so every bin is updated for all axes in one pass with fixed-width (SIMD friendly) accesses.
+typedef struct sdftAxes_s {
+    int idx;                                              // circular buffer index
     int startBin;
     int endBin;
     int batchSize;
     int numBatches;
-    float samples[SDFT_SAMPLE_SIZE];   // circular buffer
-    complex_t data[SDFT_BIN_COUNT];    // complex frequency spectrum
-} sdft_t;
+    float samples[SDFT_SAMPLE_SIZE][SDFT_AXIS_LANES];     // circular buffer
+    sdftAxesBin_t data[SDFT_BIN_COUNT];                   // complex frequency spectrum
+} sdftAxes_t;
 
 STATIC_ASSERT(SDFT_SAMPLE_SIZE % 2 == 0, sdft_sample_size_not_even);
 STATIC_ASSERT(SDFT_BIN_COUNT >= 2, sdft_bin_count_too_small);
 
-void sdftInit(sdft_t *sdft, const int startBin, const int endBin, const int numBatches);
-void sdftPush(sdft_t *sdft, const float sample);
-void sdftPushBatch(sdft_t *sdft, const float sample, const int batchIdx);
-void sdftMagSq(const sdft_t *sdft, float *output);
-void sdftMagnitude(const sdft_t *sdft, float *output);
-void sdftWinSq(const sdft_t *sdft, float *output);
-void sdftWindow(const sdft_t *sdft, float *output);
+void sdftAxesInit(sdftAxes_t *sdft, const int startBin, const int endBin, const int numBatches);
+void sdftAxesPushBatch(sdftAxes_t *sdft, const float samples[XYZ_AXIS_COUNT], const int batchIdx);
+void sdftAxesWinSq(const sdftAxes_t *sdft, const int axis, float *output);
@@ -26,7 +26,9 @@
 
 #include "build/build_config.h"
 
+#include "common/bitarray.h"
 #include "common/crc.h"
+#include "common/maths.h"
 #include "common/utils.h"
 
 #include "config/config_eeprom.h"
@@ -46,9 +48,25 @@
 
 static uint16_t eepromConfigSize;
 
+/*
+ * Where the config storage can be programmed without an erase up to the next page boundary, a save that changes only
+ * some PGs appends a log block holding just their records to the saved copy. Each block has its own CRC and carries
+ * the generation of the saved copy, which goes up every time the whole copy is rewritten (when the log is full), so
+ * blocks left over from an older copy are never applied.
+ */
+#if (defined(CONFIG_IN_FLASH) || defined(CONFIG_IN_FILE)) && defined(FLASH_PAGE_SIZE)
+#define CONFIG_LOG
+
+// Programming the first word of an erase unit erases the whole unit first
+#ifndef FLASH_CONFIG_ERASE_SIZE
+#define FLASH_CONFIG_ERASE_SIZE FLASH_PAGE_SIZE
+#endif
+#endif
+
 typedef enum {
     CR_CLASSICATION_SYSTEM   = 0,
     CR_CLASSICATION_PROFILE_LAST = CR_CLASSICATION_SYSTEM,
+    CR_CLASSICATION_LOG_GENERATION = 3, // record holds the uint32_t generation of the saved copy, not a PG
 } configRecordFlags_e;
 
 #define CR_CLASSIFICATION_MASK  (0x3)
@@ -80,6 +98,22 @@ typedef struct {
 } PG_PACKED configFooter_t;
 // checksum is appended just after footer. It is not included in footer to make checksum calculation consistent
 
+#ifdef CONFIG_LOG
+#define CONFIG_LOG_MAGIC        0xC10C
+
+// Header for a log block appended to the saved copy, followed by records and the CRC.
+typedef struct {
+    uint16_t magic;
+    uint16_t size;              // header, records and CRC, without the padding to the next write
+    uint32_t generation;
+} PG_PACKED configLogHeader_t;
+
+static bool configLogValid;     // saved copy has a generation, so log blocks can be added to it
+static uint32_t configLogGeneration;
+static uint16_t configLogStart; // offset of the first log block
+static uint16_t configLogEnd;   // offset after the last valid log block, where the next one goes
+#endif
+
 // Used to check the compiler packing at build time.
 typedef struct {
     uint8_t byte;
@@ -329,6 +363,79 @@ bool isEEPROMVersionValid(void)
     return true;
 }
 
+#ifdef CONFIG_LOG
+static uint16_t configLogAlign(uint16_t offset)
+{
+    return (offset + CONFIG_STREAMER_BUFFER_SIZE - 1) / CONFIG_STREAMER_BUFFER_SIZE * CONFIG_STREAMER_BUFFER_SIZE;
+}
+
+// Get the complete log block of any generation at the offset, or NULL
+static const configLogHeader_t *configLogBlockAt(size_t offset)
+{
+    const size_t storageSize = (const uint8_t*)&__config_end - (const uint8_t*)&__config_start;
+    if (offset + sizeof(configLogHeader_t) > storageSize) {
+        return NULL;
+    }
+
+    const configLogHeader_t *block = (const configLogHeader_t *)((const uint8_t*)&__config_start + offset);
+    if (block->magic != CONFIG_LOG_MAGIC
+        || block->size < sizeof(*block) + sizeof(uint16_t)
+        || offset + block->size > storageSize
+        || crc16_ccitt_update(CRC_START_VALUE, block, block->size) != CRC_CHECK_VALUE) {
+        return NULL;
+    }
+
+    return block;
+}
+
+// Is there a complete log block for the current generation at the offset
+static bool configLogBlockValid(uint16_t offset)
+{
+    const configLogHeader_t *block = configLogBlockAt(offset);
+
+    return block && block->generation == configLogGeneration;
+}
+
+/*
+ * Get the generation for a new saved copy. Rewriting the copy only erases the pages it is written to, so complete
+ * blocks of older copies can be left further on in the storage, where the log of the new copy may later reach them.
+ * The new generation is past every one of them, whatever the generation of the copy being replaced was (it is unknown
+ * if that copy is not valid).
+ */
+static uint32_t configLogNextGeneration(void)
+{
+    const size_t storageSize = (const uint8_t*)&__config_end - (const uint8_t*)&__config_start;
+    uint32_t generation = 0;
+
+    for (size_t offset = 0; offset < storageSize; offset += CONFIG_STREAMER_BUFFER_SIZE) {
+        const configLogHeader_t *block = configLogBlockAt(offset);
+        if (block) {
+            generation = MAX(generation, block->generation);
+        }
+    }
+
+    return generation + 1;
+}
+
+// Can [start, end) be programmed: every byte must be erased, apart from those in erase units the block starts itself
+static bool configLogErased(uint16_t start, uint16_t end)
+{
+    const uint8_t *p = (const uint8_t*)&__config_start;
+
+    for (uint16_t offset = start; offset < end; offset++) {
+        if (offset % FLASH_CONFIG_ERASE_SIZE == 0) {
+            // Writing here erases this unit, and each of the following ones when the block reaches it
+            break;
+        }
+        if (p[offset] != 0xFF) {
+            return false;
+        }
+    }
+
+    return true;
+}
+#endif
+
 // Scan the EEPROM config. Returns true if the config is valid.
 bool isEEPROMStructureValid(void)
 {
@@ -343,6 +450,10 @@ bool isEEPROMStructureValid(void)
     crc = crc16_ccitt_update(crc, header, sizeof(*header));
     p += sizeof(*header);
 
+#ifdef CONFIG_LOG
+    configLogValid = false;
+#endif
+
     for (;;) {
         const configRecord_t *record = (const configRecord_t *)p;
 
@@ -356,6 +467,14 @@ bool isEEPROMStructureValid(void)
             return false;
         }
 
+#ifdef CONFIG_LOG
+        if ((record->flags & CR_CLASSIFICATION_MASK) == CR_CLASSICATION_LOG_GENERATION
+            && record->size == sizeof(*record) + sizeof(configLogGeneration)) {
+            memcpy(&configLogGeneration, record->pg, sizeof(configLogGeneration));
+            configLogValid = true;
+        }
+#endif
+
         crc = crc16_ccitt_update(crc, p, record->size);
 
         p += record->size;
@@ -372,6 +491,19 @@ bool isEEPROMStructureValid(void)
 
     eepromConfigSize = p - (const uint8_t*)&__config_start;
 
+#ifdef CONFIG_LOG
+    configLogStart = configLogAlign((const uint8_t *)(storedCrc + 1) - (const uint8_t*)&__config_start);
+    configLogEnd = configLogStart;
+    configLogValid = configLogValid && crc == CRC_CHECK_VALUE;
+    if (configLogValid) {
+        while (configLogBlockValid(configLogEnd)) {
+            const configLogHeader_t *block = (const configLogHeader_t *)((const uint8_t*)&__config_start + configLogEnd);
+            configLogEnd = configLogAlign(configLogEnd + block->size);
+        }
+        eepromConfigSize = MAX(eepromConfigSize, configLogEnd);
+    }
+#endif
+
     // CRC has the property that if the CRC itself is included in the calculation the resulting CRC will have constant value
     return crc == CRC_CHECK_VALUE;
 }
@@ -417,21 +549,83 @@ static const configRecord_t *findEEPROM(const pgRegistry_t *reg, configRecordFla
     return NULL;
 }
 
+// Load the PG records in [p, end) into their PGs, until a record with size 0 (the footer of the saved copy)
+static bool loadEEPROMRecords(const uint8_t *p, const uint8_t *end, uint32_t *loaded)
+{
+    bool success = true;
+
+    while (true) {
+        const configRecord_t *rec = (const configRecord_t *)p;
+        if (p + sizeof(*rec) > end
+            || rec->size == 0
+            || p + rec->size > end
+            || rec->size < sizeof(*rec))
+            break;
+        p += rec->size;
+
+        if ((rec->flags & CR_CLASSIFICATION_MASK) != CR_CLASSICATION_SYSTEM) {
+            continue;
+        }
+        const pgRegistry_t *reg = pgFind(rec->pgn);
+        if (!reg) {
+            // PG is not in this build
+            continue;
+        }
+        const unsigned position = reg - __pg_registry_start;
+        if (position >= PG_REGISTRY_INDEXED_MAX) {
+            // loaded by findEEPROM()
+            continue;
+        }
+        bitArraySet(loaded, position);
+
+        // config from EEPROM is available, use it to initialize PG. pgLoad will handle version mismatch
+        if (!pgLoad(reg, rec->pg, rec->size - offsetof(configRecord_t, pg), rec->version)) {
+            success = false;
+        }
+    }
+
+    return success;
+}
+
 // Initialize all PG records from EEPROM.
-// This functions processes all PGs sequentially, scanning EEPROM for each one. This is suboptimal,
-//   but each PG is loaded/initialized exactly once and in defined order.
+// The EEPROM is parsed once and each record is loaded into the PG that pgFind() indexes for it. Records are stored in
+//   registry order, so PGs are still loaded in a defined order. Records in log blocks replace those before them.
+//   PGs without a record are then reset to defaults.
 bool loadEEPROM(void)
 {
-    bool success = true;
+    uint32_t loaded[(PG_REGISTRY_INDEXED_MAX + 31) / 32] = { 0 };
+
+    const uint8_t *p = (const uint8_t*)&__config_start;
+    p += sizeof(configHeader_t);             // skip header
+    bool success = loadEEPROMRecords(p, (const uint8_t*)&__config_end - sizeof(configFooter_t), loaded);
+
+#ifdef CONFIG_LOG
+    if (configLogValid) {
+        for (uint16_t offset = configLogStart; offset < configLogEnd; ) {
+            const configLogHeader_t *block = (const configLogHeader_t *)((const uint8_t*)&__config_start + offset);
+            p = (const uint8_t *)(block + 1);
+            if (!loadEEPROMRecords(p, (const uint8_t *)block + block->size - sizeof(uint16_t), loaded)) {
+                success = false;
+            }
+            offset = configLogAlign(offset + block->size);
+        }
+    }
+#endif
 
     PG_FOREACH(reg) {
-        const configRecord_t *rec = findEEPROM(reg, CR_CLASSICATION_SYSTEM);
-        if (rec) {
-            // config from EEPROM is available, use it to initialize PG. pgLoad will handle version mismatch
-            if (!pgLoad(reg, rec->pg, rec->size - offsetof(configRecord_t, pg), rec->version)) {
+        const unsigned position = reg - __pg_registry_start;
+        if (position >= PG_REGISTRY_INDEXED_MAX) {
+            const configRecord_t *rec = findEEPROM(reg, CR_CLASSICATION_SYSTEM);
+            if (rec) {
+                if (!pgLoad(reg, rec->pg, rec->size - offsetof(configRecord_t, pg), rec->version)) {
+                    success = false;
+                }
+            } else {
+                pgReset(reg);
+
                 success = false;
             }
-        } else {
+        } else if (!bitArrayGet(loaded, position)) {
             pgReset(reg);
 
             success = false;
@@ -442,9 +636,94 @@ bool loadEEPROM(void)
     return success;
 }
 
+static bool isPGDirty(const pgRegistry_t *reg)
+{
+    return *reg->fnv_hash != fnv_update(FNV_OFFSET_BASIS, reg->address, pgSize(reg));
+}
+
+static void writeRecord(config_streamer_t *streamer, uint16_t *crc, const pgRegistry_t *reg)
+{
+    const uint16_t regSize = pgSize(reg);
+    configRecord_t record = {
+        .size = sizeof(configRecord_t) + regSize,
+        .pgn = pgN(reg),
+        .version = pgVersion(reg),
+        .flags = 0,
+    };
+
+    record.flags |= CR_CLASSICATION_SYSTEM;
+    config_streamer_write(streamer, (uint8_t *)&record, sizeof(record));
+    *crc = crc16_ccitt_update(*crc, (uint8_t *)&record, sizeof(record));
+    config_streamer_write(streamer, reg->address, regSize);
+    *crc = crc16_ccitt_update(*crc, reg->address, regSize);
+}
+
+static void writeCrc(config_streamer_t *streamer, uint16_t crc)
+{
+    // include inverted CRC in big endian format in the CRC
+    const uint16_t invertedBigEndianCrc = ~(((crc & 0xFF) << 8) | (crc >> 8));
+    config_streamer_write(streamer, (uint8_t *)&invertedBigEndianCrc, sizeof(crc));
+}
+
+#ifdef CONFIG_LOG
+// Append a log block with the records of the changed PGs, returns false if the saved copy must be rewritten instead
+static bool appendSettingsToEEPROM(void)
+{
+    if (!configLogValid) {
+        return false;
+    }
+
+    configLogHeader_t header = {
+        .magic = CONFIG_LOG_MAGIC,
+        .size = sizeof(configLogHeader_t) + sizeof(uint16_t),
+        .generation = configLogGeneration,
+    };
+    PG_FOREACH(reg) {
+        if (isPGDirty(reg)) {
+            header.size += sizeof(configRecord_t) + pgSize(reg);
+        }
+    }
+
+    const size_t storageSize = (const uint8_t*)&__config_end - (const uint8_t*)&__config_start;
+    const uint16_t blockStart = configLogEnd;
+    const uint16_t blockEnd = configLogAlign(blockStart + header.size);
+    if (blockEnd > storageSize) {
+        return false;
+    }
+
+    if (!configLogErased(blockStart, blockEnd)) {
+        return false;
+    }
+    const uint8_t *p = (const uint8_t*)&__config_start + blockStart;
+
+    config_streamer_t streamer;
+    config_streamer_init(&streamer);
+
+    config_streamer_start(&streamer, (uintptr_t)p, blockEnd - blockStart);
+
+    config_streamer_write(&streamer, (uint8_t *)&header, sizeof(header));
+    uint16_t crc = CRC_START_VALUE;
+    crc = crc16_ccitt_update(crc, (uint8_t *)&header, sizeof(header));
+    PG_FOREACH(reg) {
+        if (isPGDirty(reg)) {
+            writeRecord(&streamer, &crc, reg);
+        }
+    }
+    writeCrc(&streamer, crc);
+
+    config_streamer_flush(&streamer);
+
+    // The block only counts if it reads back complete, otherwise the whole copy is rewritten
+    return config_streamer_finish(&streamer) == 0
+        && isEEPROMVersionValid() && isEEPROMStructureValid()
+        && configLogEnd == blockEnd;
+}
+#endif
+
 static bool writeSettingsToEEPROM(void)
 {
-    bool dirtyConfig = !isEEPROMVersionValid() || !isEEPROMStructureValid();
+    const bool validConfig = isEEPROMVersionValid() && isEEPROMStructureValid();
+    bool dirtyConfig = !validConfig;
 
     configHeader_t header = {
         .eepromConfigVersion =  EEPROM_CONF_VERSION,
@@ -452,13 +731,23 @@ static bool writeSettingsToEEPROM(void)
     };
 
     PG_FOREACH(reg) {
-        if (*reg->fnv_hash != fnv_update(FNV_OFFSET_BASIS, reg->address, pgSize(reg))) {
+        if (isPGDirty(reg)) {
             dirtyConfig = true;
         }
     }
 
     // Only write the config if it has changed
-    if (dirtyConfig) {
+    if (!dirtyConfig) {
+        return true;
+    }
+
+    bool success;
+#ifdef CONFIG_LOG
+    if (validConfig && appendSettingsToEEPROM()) {
+        success = true;
+    } else
+#endif
+    {
         config_streamer_t streamer;
         config_streamer_init(&streamer);
 
@@ -467,20 +756,24 @@ static bool writeSettingsToEEPROM(void)
         config_streamer_write(&streamer, (uint8_t *)&header, sizeof(header));
         uint16_t crc = CRC_START_VALUE;
         crc = crc16_ccitt_update(crc, (uint8_t *)&header, sizeof(header));
+
+#ifdef CONFIG_LOG
+        // A new generation, so that log blocks of previous copies left in the storage are not applied to this one
+        const uint32_t generation = configLogNextGeneration();
+        const configRecord_t generationRecord = {
+            .size = sizeof(configRecord_t) + sizeof(generation),
+            .pgn = 0,
+            .version = 0,
+            .flags = CR_CLASSICATION_LOG_GENERATION,
+        };
+        config_streamer_write(&streamer, (uint8_t *)&generationRecord, sizeof(generationRecord));
+        crc = crc16_ccitt_update(crc, (uint8_t *)&generationRecord, sizeof(generationRecord));
+        config_streamer_write(&streamer, (uint8_t *)&generation, sizeof(generation));
+        crc = crc16_ccitt_update(crc, (uint8_t *)&generation, sizeof(generation));
+#endif
+
         PG_FOREACH(reg) {
-            const uint16_t regSize = pgSize(reg);
-            configRecord_t record = {
-                .size = sizeof(configRecord_t) + regSize,
-                .pgn = pgN(reg),
-                .version = pgVersion(reg),
-                .flags = 0,
-            };
-
-            record.flags |= CR_CLASSICATION_SYSTEM;
-            config_streamer_write(&streamer, (uint8_t *)&record, sizeof(record));
-            crc = crc16_ccitt_update(crc, (uint8_t *)&record, sizeof(record));
-            config_streamer_write(&streamer, reg->address, regSize);
-            crc = crc16_ccitt_update(crc, reg->address, regSize);
+            writeRecord(&streamer, &crc, reg);
         }
 
         configFooter_t footer = {
@@ -490,16 +783,21 @@ static bool writeSettingsToEEPROM(void)
         config_streamer_write(&streamer, (uint8_t *)&footer, sizeof(footer));
         crc = crc16_ccitt_update(crc, (uint8_t *)&footer, sizeof(footer));
 
-        // include inverted CRC in big endian format in the CRC
-        const uint16_t invertedBigEndianCrc = ~(((crc & 0xFF) << 8) | (crc >> 8));
-        config_streamer_write(&streamer, (uint8_t *)&invertedBigEndianCrc, sizeof(crc));
+        writeCrc(&streamer, crc);
 
         config_streamer_flush(&streamer);
 
-        return (config_streamer_finish(&streamer) == 0);
-    } else {
-        return true;
+        success = (config_streamer_finish(&streamer) == 0);
+    }
+
+    if (success) {
+        // The saved copy matches the PGs now, so the next save only writes what changes after this one
+        PG_FOREACH(reg) {
+            *reg->fnv_hash = fnv_update(FNV_OFFSET_BASIS, reg->address, pgSize(reg));
+        }
     }
+
+    return success;
 }
 
 void writeConfigToEEPROM(void)
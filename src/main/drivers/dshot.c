@@ -147,6 +147,7 @@ FAST_DATA_ZERO_INIT dshotTelemetryState_t dshotTelemetryState;
 FAST_DATA_ZERO_INIT static pt1Filter_t motorFreqLpf[MAX_SUPPORTED_MOTORS];
 FAST_DATA_ZERO_INIT static float motorFrequencyHz[MAX_SUPPORTED_MOTORS];
 FAST_DATA_ZERO_INIT static float minMotorFrequencyHz;
+FAST_DATA_ZERO_INIT static uint32_t motorFrequencyUpdateCount;
 FAST_DATA_ZERO_INIT static float erpmToHz;
 FAST_DATA_ZERO_INIT static float dshotRpmAverage;
 FAST_DATA_ZERO_INIT static float dshotRpm[MAX_SUPPORTED_MOTORS];
@@ -292,11 +293,17 @@ FAST_CODE_NOINLINE void updateDshotTelemetry(void)
     }
 
     // update filtered rotation speed of motors for features (e.g. "RPM filter")
+    bool motorFrequencyChanged = false;
     minMotorFrequencyHz = FLT_MAX;
     for (unsigned motor = 0; motor < dshotMotorCount; motor++) {
-        motorFrequencyHz[motor] = pt1FilterApply(&motorFreqLpf[motor], erpmToHz * getDshotErpm(motor));
+        const float frequencyHz = pt1FilterApply(&motorFreqLpf[motor], erpmToHz * getDshotErpm(motor));
+        motorFrequencyChanged |= frequencyHz != motorFrequencyHz[motor];
+        motorFrequencyHz[motor] = frequencyHz;
         minMotorFrequencyHz = MIN(minMotorFrequencyHz, motorFrequencyHz[motor]);
     }
+    if (motorFrequencyChanged) {
+        motorFrequencyUpdateCount++;
+    }
 
     // Set state to processed
     dshotTelemetryState.rawValueState = DSHOT_RAW_VALUE_STATE_PROCESSED;
@@ -327,6 +334,12 @@ float getMinMotorFrequencyHz(void)
     return minMotorFrequencyHz;
 }
 
+// Changes whenever RPM telemetry moves any motor frequency
+uint32_t getMotorFrequencyUpdateCount(void)
+{
+    return motorFrequencyUpdateCount;
+}
+
 bool isDshotMotorTelemetryActive(uint8_t motorIndex)
 {
     return (dshotTelemetryState.motorState[motorIndex].telemetryTypes & (1 << DSHOT_TELEMETRY_TYPE_eRPM)) != 0;
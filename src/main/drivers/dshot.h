@@ -144,6 +144,7 @@ float getDshotRpm(uint8_t motorIndex);
 float getDshotRpmAverage(void);
 float getMotorFrequencyHz(uint8_t motorIndex);
 float getMinMotorFrequencyHz(void);
+uint32_t getMotorFrequencyUpdateCount(void);
 
 bool isDshotMotorTelemetryActive(uint8_t motorIndex);
 bool isDshotTelemetryActive(void);
@@ -34,6 +34,7 @@
 #include "drivers/flash/flash_w25n.h"
 #include "drivers/flash/flash_w25q128fv.h"
 #include "drivers/flash/flash_w25m.h"
+#include "drivers/flash/flash_ram.h"
 #include "drivers/bus_spi.h"
 #include "drivers/bus_quadspi.h"
 #include "drivers/bus_octospi.h"
@@ -413,6 +414,13 @@ static bool flashDeviceInit(const flashConfig_t *flashConfig)
     }
 #endif
 
+#ifdef USE_FLASH_RAM
+    // Simulated chip for targets without a real one, e.g. SITL
+    if (!haveFlash) {
+        haveFlash = flashRamIdentify(&flashDevice);
+    }
+#endif
+
     if (haveFlash && flashDevice.vTable->configure) {
         uint32_t configurationFlags = 0;
 
@@ -0,0 +1,188 @@
+/*
+ * This file is part of Cleanflight and Betaflight.
+ *
+ * Cleanflight and Betaflight are free software. You can redistribute
+ * this software and/or modify this software under the terms of the
+ * GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Cleanflight and Betaflight are distributed in the hope that they
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A NOR flash chip simulated in RAM, for SITL and unit tests where there is no SPI flash to log to.
+ *
+ * Programming can only clear bits, like real NOR flash, so that code which relies on writing over erased (0xFF)
+ * bytes behaves the same as on hardware. The contents survive flashInit() so that a reboot can be simulated by
+ * initialising flashfs again.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_FLASH_RAM
+
+#include "common/maths.h"
+
+#include "drivers/flash/flash.h"
+#include "drivers/flash/flash_impl.h"
+#include "drivers/flash/flash_ram.h"
+
+#ifndef FLASH_RAM_PAGE_SIZE
+#define FLASH_RAM_PAGE_SIZE     256
+#endif
+
+#ifndef FLASH_RAM_SECTOR_SIZE
+#define FLASH_RAM_SECTOR_SIZE   (64 * 1024)
+#endif
+
+#ifndef FLASH_RAM_SECTORS
+#define FLASH_RAM_SECTORS       64
+#endif
+
+#define FLASH_RAM_SIZE (FLASH_RAM_SECTORS * FLASH_RAM_SECTOR_SIZE)
+
+STATIC_ASSERT(FLASH_RAM_SECTOR_SIZE % FLASH_RAM_PAGE_SIZE == 0, FLASH_RAM_SECTOR_SIZE_not_a_multiple_of_page_size);
+
+static uint8_t flashRamData[FLASH_RAM_SIZE];
+static bool flashRamPoweredOn = false;
+
+const flashVTable_t flashRam_vTable;
+
+static bool flashRamIsReady(flashDevice_t *fdevice)
+{
+    UNUSED(fdevice);
+
+    return true;
+}
+
+static bool flashRamWaitForReady(flashDevice_t *fdevice)
+{
+    UNUSED(fdevice);
+
+    return true;
+}
+
+static void flashRamEraseSector(flashDevice_t *fdevice, uint32_t address)
+{
+    UNUSED(fdevice);
+
+    address -= address % FLASH_RAM_SECTOR_SIZE;
+    if (address < FLASH_RAM_SIZE) {
+        memset(&flashRamData[address], 0xFF, FLASH_RAM_SECTOR_SIZE);
+    }
+}
+
+static void flashRamEraseCompletely(flashDevice_t *fdevice)
+{
+    UNUSED(fdevice);
+
+    memset(flashRamData, 0xFF, sizeof(flashRamData));
+}
+
+static void flashRamPageProgramBegin(flashDevice_t *fdevice, uint32_t address, void (*callback)(uintptr_t arg))
+{
+    fdevice->callback = callback;
+    fdevice->currentWriteAddress = address;
+}
+
+static uint32_t flashRamPageProgramContinue(flashDevice_t *fdevice, uint8_t const **buffers, const uint32_t *bufferSizes, uint32_t bufferCount)
+{
+    uint32_t bytesWritten = 0;
+
+    for (uint32_t i = 0; i < bufferCount; i++) {
+        for (uint32_t j = 0; j < bufferSizes[i] && fdevice->currentWriteAddress < FLASH_RAM_SIZE; j++) {
+            // Like NOR flash, programming can only clear bits
+            flashRamData[fdevice->currentWriteAddress++] &= buffers[i][j];
+            bytesWritten++;
+        }
+    }
+
+    if (fdevice->callback) {
+        fdevice->callback(bytesWritten);
+    }
+
+    return bytesWritten;
+}
+
+static void flashRamPageProgramFinish(flashDevice_t *fdevice)
+{
+    UNUSED(fdevice);
+}
+
+static void flashRamPageProgram(flashDevice_t *fdevice, uint32_t address, const uint8_t *data, uint32_t length, void (*callback)(uintptr_t arg))
+{
+    flashRamPageProgramBegin(fdevice, address, callback);
+    flashRamPageProgramContinue(fdevice, &data, &length, 1);
+    flashRamPageProgramFinish(fdevice);
+}
+
+static int flashRamReadBytes(flashDevice_t *fdevice, uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    UNUSED(fdevice);
+
+    if (address >= FLASH_RAM_SIZE) {
+        return 0;
+    }
+
+    length = MIN(length, FLASH_RAM_SIZE - address);
+    memcpy(buffer, &flashRamData[address], length);
+
+    return length;
+}
+
+static const flashGeometry_t *flashRamGetGeometry(flashDevice_t *fdevice)
+{
+    return &fdevice->geometry;
+}
+
+bool flashRamIdentify(flashDevice_t *fdevice)
+{
+    flashGeometry_t *geometry = &fdevice->geometry;
+
+    geometry->flashType = FLASH_TYPE_NOR;
+    geometry->jedecId = 0;
+    geometry->sectors = FLASH_RAM_SECTORS;
+    geometry->pageSize = FLASH_RAM_PAGE_SIZE;
+    geometry->sectorSize = FLASH_RAM_SECTOR_SIZE;
+    geometry->pagesPerSector = FLASH_RAM_SECTOR_SIZE / FLASH_RAM_PAGE_SIZE;
+    geometry->totalSize = FLASH_RAM_SIZE;
+
+    fdevice->couldBeBusy = false;
+    fdevice->vTable = &flashRam_vTable;
+
+    // A new chip comes erased, but keep what was written before if we are just being initialised again
+    if (!flashRamPoweredOn) {
+        flashRamEraseCompletely(fdevice);
+        flashRamPoweredOn = true;
+    }
+
+    return true;
+}
+
+const flashVTable_t flashRam_vTable = {
+    .isReady = flashRamIsReady,
+    .waitForReady = flashRamWaitForReady,
+    .eraseSector = flashRamEraseSector,
+    .eraseCompletely = flashRamEraseCompletely,
+    .pageProgramBegin = flashRamPageProgramBegin,
+    .pageProgramContinue = flashRamPageProgramContinue,
+    .pageProgramFinish = flashRamPageProgramFinish,
+    .pageProgram = flashRamPageProgram,
+    .readBytes = flashRamReadBytes,
+    .getGeometry = flashRamGetGeometry,
+};
+
+#endif // USE_FLASH_RAM
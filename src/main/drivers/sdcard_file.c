@@ -0,0 +1,199 @@
+/*
+ * This file is part of Cleanflight and Betaflight.
+ *
+ * Cleanflight and Betaflight are free software. You can redistribute
+ * this software and/or modify this software under the terms of the
+ * GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Cleanflight and Betaflight are distributed in the hope that they
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * An SD card stand-in for the simulator, backed by an image file holding an MBR partitioned FAT16/FAT32 volume (see
+ * src/utils/mksdimg.py). Each operation is performed and completed on the next sdcard_poll(), so asyncfatfs sees a card
+ * that is busy for one poll per block, much like a real one.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "platform.h"
+
+#ifdef USE_SDCARD_FILE
+
+#include "pg/bus_spi.h"
+
+#include "sdcard.h"
+#include "sdcard_impl.h"
+
+#ifndef SDCARD_FILENAME
+#define SDCARD_FILENAME "sdcard.img"
+#endif
+
+typedef enum {
+    SDCARD_FILE_IDLE,
+    SDCARD_FILE_READING,
+    SDCARD_FILE_WRITING
+} sdcardFileOperation_e;
+
+static struct {
+    int fd;
+    sdcardMetadata_t metadata;
+
+    sdcardFileOperation_e operation;
+    uint32_t blockIndex;
+    uint8_t *buffer;
+    sdcard_operationCompleteCallback_c callback;
+    uint32_t callbackData;
+} sdcardFile = { .fd = -1 };
+
+static void sdcardFile_init(const sdcardConfig_t *config, const spiPinConfig_t *spiConfig)
+{
+    UNUSED(config);
+    UNUSED(spiConfig);
+
+    struct stat info;
+
+    sdcardFile.fd = open(SDCARD_FILENAME, O_RDWR);
+    if (sdcardFile.fd < 0 || fstat(sdcardFile.fd, &info) != 0) {
+        fprintf(stderr, "[SDCARD] failed to open '%s'\n", SDCARD_FILENAME);
+        return;
+    }
+
+    memset(&sdcardFile.metadata, 0, sizeof(sdcardFile.metadata));
+    sdcardFile.metadata.numBlocks = info.st_size / SDCARD_BLOCK_SIZE;
+    memcpy(sdcardFile.metadata.productName, "IMAGE", sizeof(sdcardFile.metadata.productName));
+
+    printf("[SDCARD] loaded '%s', %u blocks\n", SDCARD_FILENAME, sdcardFile.metadata.numBlocks);
+}
+
+static bool sdcardFile_isFunctional(void)
+{
+    return sdcardFile.fd >= 0;
+}
+
+static bool sdcardFile_queue(sdcardFileOperation_e operation, uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    if (!sdcardFile_isFunctional() || sdcardFile.operation != SDCARD_FILE_IDLE) {
+        return false;
+    }
+
+    sdcardFile.operation = operation;
+    sdcardFile.blockIndex = blockIndex;
+    sdcardFile.buffer = buffer;
+    sdcardFile.callback = callback;
+    sdcardFile.callbackData = callbackData;
+
+    return true;
+}
+
+static bool sdcardFile_readBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    return sdcardFile_queue(SDCARD_FILE_READING, blockIndex, buffer, callback, callbackData);
+}
+
+// Blocks are written one at a time anyway, so there's nothing to prepare
+static sdcardOperationStatus_e sdcardFile_beginWriteBlocks(uint32_t blockIndex, uint32_t blockCount)
+{
+    UNUSED(blockIndex);
+    UNUSED(blockCount);
+
+    return sdcardFile.operation == SDCARD_FILE_IDLE ? SDCARD_OPERATION_SUCCESS : SDCARD_OPERATION_BUSY;
+}
+
+static sdcardOperationStatus_e sdcardFile_writeBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    if (!sdcardFile_isFunctional()) {
+        return SDCARD_OPERATION_FAILURE;
+    }
+
+    if (!sdcardFile_queue(SDCARD_FILE_WRITING, blockIndex, buffer, callback, callbackData)) {
+        return SDCARD_OPERATION_BUSY;
+    }
+
+    return SDCARD_OPERATION_IN_PROGRESS;
+}
+
+/**
+ * Perform the queued operation and report its completion. Returns true when the card is ready for another.
+ */
+static bool sdcardFile_poll(void)
+{
+    if (!sdcardFile_isFunctional()) {
+        return false;
+    }
+
+    if (sdcardFile.operation != SDCARD_FILE_IDLE) {
+        const off_t offset = (off_t)sdcardFile.blockIndex * SDCARD_BLOCK_SIZE;
+        sdcardBlockOperation_e blockOperation;
+        bool success = sdcardFile.blockIndex < sdcardFile.metadata.numBlocks;
+
+        if (sdcardFile.operation == SDCARD_FILE_READING) {
+            blockOperation = SDCARD_BLOCK_OPERATION_READ;
+            success = success && pread(sdcardFile.fd, sdcardFile.buffer, SDCARD_BLOCK_SIZE, offset) == SDCARD_BLOCK_SIZE;
+        } else {
+            blockOperation = SDCARD_BLOCK_OPERATION_WRITE;
+            success = success && pwrite(sdcardFile.fd, sdcardFile.buffer, SDCARD_BLOCK_SIZE, offset) == SDCARD_BLOCK_SIZE;
+        }
+
+        sdcardFile.operation = SDCARD_FILE_IDLE;
+
+        if (sdcardFile.callback) {
+            sdcardFile.callback(blockOperation, sdcardFile.blockIndex, success ? sdcardFile.buffer : NULL, sdcardFile.callbackData);
+        }
+    }
+
+    return true;
+}
+
+static bool sdcardFile_isInitialized(void)
+{
+    return sdcardFile_isFunctional();
+}
+
+static const sdcardMetadata_t* sdcardFile_getMetadata(void)
+{
+    return &sdcardFile.metadata;
+}
+
+#ifdef SDCARD_PROFILING
+
+static void sdcardFile_setProfilerCallback(sdcard_profilerCallback_c callback)
+{
+    UNUSED(callback);
+}
+
+#endif
+
+sdcardVTable_t sdcardFileVTable = {
+    NULL,
+    sdcardFile_init,
+    sdcardFile_readBlock,
+    sdcardFile_beginWriteBlocks,
+    sdcardFile_writeBlock,
+    sdcardFile_poll,
+    sdcardFile_isFunctional,
+    sdcardFile_isInitialized,
+    sdcardFile_getMetadata,
+#ifdef SDCARD_PROFILING
+    sdcardFile_setProfilerCallback,
+#endif
+};
+
+#endif
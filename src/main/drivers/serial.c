@@ -61,7 +61,7 @@ void serialWriteBufNoFlush(serialPort_t *instance, const uint8_t *data, int coun
 
 uint32_t serialRxBytesWaiting(const serialPort_t *instance)
 {
-    return instance->vTable->serialTotalRxWaiting(instance);
+    return instance->vTable->serialTotalRxWaiting(instance) + instance->rxPeeked;
 }
 
 uint32_t serialTxBytesFree(const serialPort_t *instance)
@@ -71,9 +71,66 @@ uint32_t serialTxBytesFree(const serialPort_t *instance)
 
 uint8_t serialRead(serialPort_t *instance)
 {
+    if (instance->rxPeeked) {
+        instance->rxPeeked = false;
+        return instance->rxPeekByte;
+    }
+
     return instance->vTable->serialRead(instance);
 }
 
+/*
+ * Returns the number of received bytes available at *data without copying them, 0 if none have been received.
+ * These stay in the receive buffer until serialConsume() is called, which may consume fewer than returned.
+ * More bytes than returned may be waiting, call again after consuming them all.
+ */
+uint32_t serialReadSpan(serialPort_t *instance, const uint8_t **data)
+{
+    if (instance->vTable->readSpan) {
+        return instance->vTable->readSpan(instance, data);
+    }
+
+    // Without driver support the span is a single byte read ahead
+    if (!instance->rxPeeked) {
+        if (instance->vTable->serialTotalRxWaiting(instance) == 0) {
+            return 0;
+        }
+        instance->rxPeekByte = instance->vTable->serialRead(instance);
+        instance->rxPeeked = true;
+    }
+
+    *data = &instance->rxPeekByte;
+    return 1;
+}
+
+void serialConsume(serialPort_t *instance, uint32_t count)
+{
+    if (instance->vTable->consume) {
+        instance->vTable->consume(instance, count);
+    } else if (count) {
+        instance->rxPeeked = false;
+    }
+}
+
+uint32_t serialRxBufferSpan(const serialPort_t *instance, const uint8_t **data)
+{
+    const uint32_t head = instance->rxBufferHead;
+    const uint32_t tail = instance->rxBufferTail;
+
+    *data = (const uint8_t *)&instance->rxBuffer[tail];
+
+    return head >= tail ? head - tail : instance->rxBufferSize - tail;
+}
+
+void serialRxBufferConsume(serialPort_t *instance, uint32_t count)
+{
+    uint32_t tail = instance->rxBufferTail + count;
+    if (tail >= instance->rxBufferSize) {
+        tail -= instance->rxBufferSize;
+    }
+    instance->rxBufferTail = tail;
+}
+
 void serialSetBaudRate(serialPort_t *instance, uint32_t baudRate)
 {
     //vTable->serialSetBaudRate is NULL for SIMULATOR_BUILD, because the TCP port is used
@@ -98,6 +98,10 @@ typedef struct serialPort_s {
 
     serialIdleCallbackPtr idleCallback;
 
+    // Byte read ahead by serialReadSpan() for drivers without zero copy reads
+    bool rxPeeked;
+    uint8_t rxPeekByte;
+
     int8_t identifier;  // actually serialPortIdentifier_e; avoid circular header dependency
 } serialPort_t;
 
@@ -132,6 +136,11 @@ struct serialPortVTable {
     // Optional functions used to buffer large writes.
     void (*beginWrite)(serialPort_t *instance);
     void (*endWrite)(serialPort_t *instance);
+
+    // Optional functions for zero copy reads, returning the received bytes that are contiguous in the receive buffer
+    // and removing bytes from the start of them.
+    uint32_t (*readSpan)(serialPort_t *instance, const uint8_t **data);
+    void (*consume)(serialPort_t *instance, uint32_t count);
 };
 
 void serialWrite(serialPort_t *instance, uint8_t ch);
@@ -140,6 +149,8 @@ uint32_t serialTxBytesFree(const serialPort_t *instance);
 void serialWriteBuf(serialPort_t *instance, const uint8_t *data, int count);
 void serialWriteBufNoFlush(serialPort_t *instance, const uint8_t *data, int count);
 uint8_t serialRead(serialPort_t *instance);
+uint32_t serialReadSpan(serialPort_t *instance, const uint8_t **data);
+void serialConsume(serialPort_t *instance, uint32_t count);
 void serialSetBaudRate(serialPort_t *instance, uint32_t baudRate);
 void serialSetMode(serialPort_t *instance, portMode_e mode);
 void serialSetCtrlLineStateCb(serialPort_t *instance, void (*cb)(void *context, uint16_t ctrlLineState), void *context);
@@ -153,3 +164,7 @@ void serialWriteBufShim(void *instance, const uint8_t *data, int count);
 void serialWriteBufBlockingShim(void *instance, const uint8_t *data, int count);
 void serialBeginWrite(serialPort_t *instance);
 void serialEndWrite(serialPort_t *instance);
+
+// Zero copy reads for drivers that receive into the rxBuffer ring
+uint32_t serialRxBufferSpan(const serialPort_t *instance, const uint8_t **data);
+void serialRxBufferConsume(serialPort_t *instance, uint32_t count);
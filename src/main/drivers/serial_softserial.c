@@ -574,6 +574,20 @@ uint8_t softSerialReadByte(serialPort_t *instance)
     return ch;
 }
 
+static uint32_t softSerialReadSpan(serialPort_t *instance, const uint8_t **data)
+{
+    if ((instance->mode & MODE_RX) == 0) {
+        return 0;
+    }
+
+    return serialRxBufferSpan(instance, data);
+}
+
+static void softSerialConsume(serialPort_t *instance, uint32_t count)
+{
+    serialRxBufferConsume(instance, count);
+}
+
 void softSerialWriteByte(serialPort_t *s, uint8_t ch)
 {
     if ((s->mode & MODE_TX) == 0) {
@@ -615,7 +629,9 @@ static const struct serialPortVTable softSerialVTable = {
     .setBaudRateCb = NULL,
     .writeBuf = NULL,
     .beginWrite = NULL,
-    .endWrite = NULL
+    .endWrite = NULL,
+    .readSpan = softSerialReadSpan,
+    .consume = softSerialConsume,
 };
 
 #endif
@@ -44,12 +44,19 @@ static const struct serialPortVTable tcpVTable; // Forward
 static tcpPort_t tcpSerialPorts[SERIAL_PORT_COUNT];
 static bool tcpPortInitialized[SERIAL_PORT_COUNT];
 static bool tcpStart = false;
+static bool tcpListenEnabled = true;
 
 bool tcpIsStart(void)
 {
     return tcpStart;
 }
 
+// Ports opened from now on have no socket, they work as if no client ever connects
+void tcpDisableListen(void)
+{
+    tcpListenEnabled = false;
+}
+
 static void onData(dyad_Event *e)
 {
     tcpPort_t* s = (tcpPort_t*)(e->udata);
@@ -112,6 +119,12 @@ static tcpPort_t* tcpReconfigure(tcpPort_t *s, int id)
     s->clientCount = 0;
     s->id = id;
     s->conn = NULL;
+    s->serv = NULL;
+
+    if (!tcpListenEnabled) {
+        return s;
+    }
+
     s->serv = dyad_newStream();
     dyad_setNoDelay(s->serv, 1);
     dyad_addListener(s->serv, DYAD_EVENT_ACCEPT, onAccept, s);
@@ -216,6 +229,24 @@ static uint8_t tcpRead(serialPort_t *instance)
     return ch;
 }
 
+static uint32_t tcpReadSpan(serialPort_t *instance, const uint8_t **data)
+{
+    tcpPort_t *s = (tcpPort_t *)instance;
+    pthread_mutex_lock(&s->rxLock);
+    uint32_t count = serialRxBufferSpan(instance, data);
+    pthread_mutex_unlock(&s->rxLock);
+
+    return count;
+}
+
+static void tcpConsume(serialPort_t *instance, uint32_t count)
+{
+    tcpPort_t *s = (tcpPort_t *)instance;
+    pthread_mutex_lock(&s->rxLock);
+    serialRxBufferConsume(instance, count);
+    pthread_mutex_unlock(&s->rxLock);
+}
+
 static void tcpWrite(serialPort_t *instance, uint8_t ch)
 {
     tcpPort_t *s = (tcpPort_t *)instance;
@@ -283,4 +314,6 @@ static const struct serialPortVTable tcpVTable = {
         .writeBuf = NULL,
         .beginWrite = NULL,
         .endWrite = NULL,
+        .readSpan = tcpReadSpan,
+        .consume = tcpConsume,
 };
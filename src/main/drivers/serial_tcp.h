@@ -49,5 +49,6 @@ void tcpDataIn(tcpPort_t *instance, uint8_t* ch, int size);
 void tcpDataOut(tcpPort_t *instance);
 
 bool tcpIsStart(void);
+void tcpDisableListen(void);
 bool* tcpGetUsed(void);
 tcpPort_t* tcpGetPool(void);
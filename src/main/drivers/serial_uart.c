@@ -403,6 +403,38 @@ static uint8_t uartRead(serialPort_t *instance)
     return ch;
 }
 
+static uint32_t uartReadSpan(serialPort_t *instance, const uint8_t **data)
+{
+    uartPort_t *uartPort = (uartPort_t *)instance;
+
+#ifdef USE_DMA
+    if (uartPort->rxDMAResource) {
+        // The received bytes run to the end of the buffer at most, rxDMAPos bytes from the next to be read
+        *data = (const uint8_t *)&uartPort->port.rxBuffer[uartPort->port.rxBufferSize - uartPort->rxDMAPos];
+        return MIN(uartTotalRxBytesWaiting(instance), uartPort->rxDMAPos);
+    }
+#endif
+
+    return serialRxBufferSpan(instance, data);
+}
+
+static void uartConsume(serialPort_t *instance, uint32_t count)
+{
+    uartPort_t *uartPort = (uartPort_t *)instance;
+
+#ifdef USE_DMA
+    if (uartPort->rxDMAResource) {
+        uartPort->rxDMAPos -= count;
+        if (uartPort->rxDMAPos == 0) {
+            uartPort->rxDMAPos = uartPort->port.rxBufferSize;
+        }
+        return;
+    }
+#endif
+
+    serialRxBufferConsume(instance, count);
+}
+
 static void uartWrite(serialPort_t *instance, uint8_t ch)
 {
     uartPort_t *uartPort = (uartPort_t *)instance;
@@ -504,6 +536,8 @@ const struct serialPortVTable uartVTable[] = {
         .writeBuf = uartWriteBuf,
         .beginWrite = uartBeginWrite,
         .endWrite = uartEndWrite,
+        .readSpan = uartReadSpan,
+        .consume = uartConsume,
     }
 };
 
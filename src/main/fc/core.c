@@ -30,6 +30,7 @@
 #include "blackbox/blackbox_fielddefs.h"
 
 #include "build/debug.h"
+#include "build/trace.h"
 
 #include "cli/cli.h"
 
@@ -1197,7 +1198,9 @@ static FAST_CODE_NOINLINE void subTaskPidController(timeUs_t currentTimeUs)
     uint32_t startTime = 0;
     if (debugMode == DEBUG_PIDLOOP) {startTime = micros();}
     // PID - note this is function pointer set by setPIDController()
+    TRACE_BEGIN(TRACE_ID_PID_CONTROLLER);
     pidController(currentPidProfile, currentTimeUs);
+    TRACE_END(TRACE_ID_PID_CONTROLLER);
     DEBUG_SET(DEBUG_PIDLOOP, 1, micros() - startTime);
 
 #ifdef USE_RUNAWAY_TAKEOFF
@@ -1298,7 +1301,9 @@ static FAST_CODE void subTaskMotorUpdate(timeUs_t currentTimeUs)
         startTime = micros();
     }
 
+    TRACE_BEGIN(TRACE_ID_MIX_TABLE);
     mixTable(currentTimeUs);
+    TRACE_END(TRACE_ID_MIX_TABLE);
 
 #ifdef USE_SERVOS
     // motor outputs are used as sources for servo mixing, so motors must be calculated using mixTable() before servos.
@@ -1347,7 +1352,9 @@ static FAST_CODE_NOINLINE void subTaskRcCommand(timeUs_t currentTimeUs)
 FAST_CODE void taskGyroSample(timeUs_t currentTimeUs)
 {
     UNUSED(currentTimeUs);
+    TRACE_BEGIN(TRACE_ID_GYRO_UPDATE);
     gyroUpdate();
+    TRACE_END(TRACE_ID_GYRO_UPDATE);
     if (pidUpdateCounter % activePidLoopDenom == 0) {
         pidUpdateCounter = 0;
     }
@@ -1373,10 +1380,12 @@ FAST_CODE bool pidLoopReady(void)
 
 FAST_CODE void taskFiltering(timeUs_t currentTimeUs)
 {
+    TRACE_BEGIN(TRACE_ID_FILTERING);
 #ifdef USE_DSHOT_TELEMETRY
     updateDshotTelemetry();  // decode and update Dshot telemetry
 #endif
     gyroFiltering(currentTimeUs);
+    TRACE_END(TRACE_ID_FILTERING);
 }
 
 // Function for loop trigger
@@ -53,6 +53,7 @@
 #include "drivers/buttons.h"
 #include "drivers/camera_control.h"
 #include "drivers/compass/compass.h"
+#include "drivers/crc_hardware.h"
 #include "drivers/dma.h"
 #include "drivers/dshot.h"
 #include "drivers/exti.h"
@@ -278,6 +279,11 @@ void initPhase1(void)
     // initialize IO (needed for all IO operations)
     IOInitGlobal();
 
+#ifdef USE_CRC_HARDWARE
+    // before the config is read, so its CRC can be checked in hardware
+    crcHardwareInit();
+#endif
+
 #if defined(USE_TARGET_CONFIG)
     // Call once before the config is loaded for any target specific configuration required to support loading the config
     targetConfiguration();
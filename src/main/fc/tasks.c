@@ -145,6 +145,13 @@ static void taskHandleSerial(timeUs_t currentTimeUs)
     mspSerialProcess(evaluateMspData, mspFcProcessCommand, mspFcProcessReply);
 }
 
+#ifdef USE_MSP_STREAM
+static void taskMspStream(timeUs_t currentTimeUs)
+{
+    mspSerialStreamProcess(currentTimeUs, mspFcProcessStreamCommand);
+}
+#endif
+
 static void taskBatteryAlerts(timeUs_t currentTimeUs)
 {
     if (!ARMING_FLAG(ARMED)) {
@@ -425,6 +432,10 @@ task_attribute_t task_attributes[TASK_COUNT] = {
     [TASK_TELEMETRY] = DEFINE_TASK("TELEMETRY", NULL, NULL, taskTelemetry, TASK_PERIOD_HZ(250), TASK_PRIORITY_LOW),
 #endif
 
+#ifdef USE_MSP_STREAM
+    [TASK_MSP_STREAM] = DEFINE_TASK("MSP_STREAM", NULL, NULL, taskMspStream, TASK_PERIOD_HZ(1000 / MSP_STREAM_PERIOD_MIN_MS), TASK_PRIORITY_LOW),
+#endif
+
 #ifdef USE_LED_STRIP
     [TASK_LEDSTRIP] = DEFINE_TASK("LEDSTRIP", NULL, NULL, ledStripUpdate, TASK_PERIOD_HZ(TASK_LEDSTRIP_RATE_HZ), TASK_PRIORITY_LOW),
 #endif
@@ -143,7 +143,7 @@ static FAST_DATA_ZERO_INIT float sampleAvg[XYZ_AXIS_COUNT];
 
 // parameters for peak detection and frequency analysis
 static FAST_DATA_ZERO_INIT state_t state;
-static FAST_DATA_ZERO_INIT sdft_t  sdft[XYZ_AXIS_COUNT];
+static FAST_DATA_ZERO_INIT sdftAxes_t sdft;
 static FAST_DATA_ZERO_INIT peak_t  peaks[DYN_NOTCH_COUNT_MAX];
 static FAST_DATA_ZERO_INIT float   sdftData[SDFT_BIN_COUNT];
 static FAST_DATA_ZERO_INIT float   sdftSampleRateHz;
@@ -190,9 +190,7 @@ void dynNotchInit(const dynNotchConfig_t *config, const timeUs_t targetLooptimeU
     sdftEndBin = MIN(SDFT_BIN_COUNT - 1, lrintf(dynNotch.maxHz / sdftResolutionHz)); // can't use more than SDFT_BIN_COUNT bins.
     pt1LooptimeS = DYN_NOTCH_CALC_TICKS / looprateHz;
 
-    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
-        sdftInit(&sdft[axis], sdftStartBin, sdftEndBin, sampleCount);
-    }
+    sdftAxesInit(&sdft, sdftStartBin, sdftEndBin, sampleCount);
 
     for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
         for (int p = 0; p < dynNotch.count; p++) {
@@ -223,7 +221,7 @@ FAST_CODE void dynNotchUpdate(void)
         for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
             sampleAvg[axis] = sampleAccumulator[axis] * sampleCountRcp;
             sampleAccumulator[axis] = 0;
-            if (axis == gyro.gyroDebugAxis) {
+            if (axis == (int)gyro.gyroDebugAxis) {
                 DEBUG_SET(DEBUG_FFT, 2, lrintf(sampleAvg[axis]));
             }
         }
@@ -236,10 +234,8 @@ FAST_CODE void dynNotchUpdate(void)
     }
 
     // 2us @ F722
-    // SDFT processing in batches to synchronize with incoming downsampled data
-    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
-        sdftPushBatch(&sdft[axis], sampleAvg[axis], sampleIndex);
-    }
+    // SDFT processing of all axes in batches to synchronize with incoming downsampled data
+    sdftAxesPushBatch(&sdft, sampleAvg, sampleIndex);
     sampleIndex++;
 
     // Find frequency peaks and update filters
@@ -263,7 +259,7 @@ static FAST_CODE_NOINLINE void dynNotchProcess(void)
 
         case STEP_WINDOW: // 4.1us (3-6us) @ F722
         {
-            sdftWinSq(&sdft[state.axis], sdftData);
+            sdftAxesWinSq(&sdft, state.axis, sdftData);
 
             // Get total vibrational power in dyn notch range for noise floor estimate in STEP_CALC_FREQUENCIES
             sdftNoiseThreshold = 0.0f;
@@ -373,7 +369,7 @@ static FAST_CODE_NOINLINE void dynNotchProcess(void)
                 }
             }
 
-            if (state.axis == gyro.gyroDebugAxis) {
+            if (state.axis == (int)gyro.gyroDebugAxis) {
                 for (int p = 0; p < dynNotch.count && p < DYN_NOTCH_COUNT_MAX; p++) {
                     // debug channel 0 is reserved for pre DN gyro
                     DEBUG_SET(DEBUG_FFT_FREQ, p + 1, lrintf(dynNotch.centerFreq[state.axis][p]));
@@ -43,6 +43,8 @@
 #include "rpm_filter.h"
 
 #define RPM_FILTER_DURATION_S    0.001f  // Maximum duration allowed to update all RPM notches once
+#define RPM_FILTER_TABLE_SIZE    256     // Number of precomputed notch coefficient sets
+#define RPM_FILTER_TABLE_MAX_HZ  3000.0f // Notches above this are calculated directly, keeps the table resolution fine at low frequencies
 
 typedef struct rpmFilter_s {
 
@@ -52,25 +54,38 @@ typedef struct rpmFilter_s {
     float maxHz;
     float fadeRangeHz;
     float q;
+    float updateHz;
 
     timeUs_t looptimeUs;
-    biquadFilter_t notch[XYZ_AXIS_COUNT][MAX_SUPPORTED_MOTORS][RPM_FILTER_HARMONICS_MAX];
+
+    // all notches of all axes in one bank, ordered by [active harmonic][motor]
+    int harmonicSection[RPM_FILTER_HARMONICS_MAX]; // index of the first bank section of a harmonic, -1 if disabled
+    biquadFilterBank_t notchBank;
+    biquadBankSection_t notch[MAX_SUPPORTED_MOTORS * RPM_FILTER_HARMONICS_MAX];
+    float notchHz[MAX_SUPPORTED_MOTORS * RPM_FILTER_HARMONICS_MAX]; // dt compensated frequency each notch was last calculated for
+    int numNotches;
+
+    biquadNotchTable_t notchTable;
 
 } rpmFilter_t;
 
 // Singleton
 FAST_DATA_ZERO_INIT static rpmFilter_t rpmFilter;
+FAST_DATA_ZERO_INIT static float notchTableCoeffs[RPM_FILTER_TABLE_SIZE][2];
 
 // batch processing of RPM notches
 FAST_DATA_ZERO_INIT static int notchUpdatesPerIteration;
 FAST_DATA_ZERO_INIT static int motorIndex;
 FAST_DATA_ZERO_INIT static int harmonicIndex;
+FAST_DATA_ZERO_INIT static int notchesToScan;
+FAST_DATA_ZERO_INIT static uint32_t motorFrequencyUpdateCount; // RPM telemetry update the notches were last scanned for
 
 void rpmFilterInit(const rpmFilterConfig_t *config, const timeUs_t looptimeUs)
 {
     motorIndex = 0;
     harmonicIndex = 0;
     rpmFilter.numHarmonics = 0; // disable RPM Filtering
+    rpmFilter.notchBank.count = 0;
 
     // if bidirectional DShot is not available
     if (!useDshotTelemetry) {
@@ -88,23 +103,47 @@ void rpmFilterInit(const rpmFilterConfig_t *config, const timeUs_t looptimeUs)
     rpmFilter.maxHz = 0.48f * 1e6f / looptimeUs; // don't go quite to nyquist to avoid oscillations
     rpmFilter.fadeRangeHz = config->rpm_filter_fade_range_hz;
     rpmFilter.q = config->rpm_filter_q / 100.0f;
+    rpmFilter.updateHz = config->rpm_filter_update_hz;
     rpmFilter.looptimeUs = looptimeUs;
 
     for (int n = 0; n < RPM_FILTER_HARMONICS_MAX; n++) {
         rpmFilter.weights[n] = constrainf(config->rpm_filter_weights[n] / 100.0f, 0.0f, 1.0f);
     }
 
-    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+    // Only harmonics which have an effect on filtered output get notches in the bank
+    int sectionCount = 0;
+    for (int i = 0; i < RPM_FILTER_HARMONICS_MAX; i++) {
+        if (i < rpmFilter.numHarmonics && rpmFilter.weights[i] > 0.0f) {
+            rpmFilter.harmonicSection[i] = sectionCount;
+            sectionCount += getMotorCount();
+        } else {
+            rpmFilter.harmonicSection[i] = -1;
+        }
+    }
+
+    biquadFilterBankInit(&rpmFilter.notchBank, rpmFilter.notch, sectionCount);
+    rpmFilter.numNotches = getMotorCount() * rpmFilter.numHarmonics;
+    notchesToScan = rpmFilter.numNotches;
+    motorFrequencyUpdateCount = getMotorFrequencyUpdateCount();
+
+    // 0 Hz is further from any notch frequency than the update threshold, so every notch is calculated on its first visit
+    for (int i = 0; i < sectionCount; i++) {
+        rpmFilter.notchHz[i] = 0.0f;
+    }
+
+    biquadNotchTableInit(&rpmFilter.notchTable, notchTableCoeffs, RPM_FILTER_TABLE_SIZE, rpmFilter.minHz, MIN(rpmFilter.maxHz, RPM_FILTER_TABLE_MAX_HZ), rpmFilter.looptimeUs, rpmFilter.q);
+
+    for (int i = 0; i < rpmFilter.numHarmonics; i++) {
+        if (rpmFilter.harmonicSection[i] < 0) {
+            continue;
+        }
         for (int motor = 0; motor < getMotorCount(); motor++) {
-            for (int i = 0; i < rpmFilter.numHarmonics; i++) {
-                biquadFilterInit(&rpmFilter.notch[axis][motor][i], rpmFilter.minHz * i, rpmFilter.looptimeUs, rpmFilter.q, FILTER_NOTCH, 0.0f);
-            }
+            biquadFilterBankUpdate(&rpmFilter.notchBank, rpmFilter.harmonicSection[i] + motor, rpmFilter.minHz * i, rpmFilter.looptimeUs, rpmFilter.q, FILTER_NOTCH, 0.0f);
         }
     }
 
     const float loopIterationsPerUpdate = RPM_FILTER_DURATION_S / (looptimeUs * 1e-6f);
-    const float numNotchesPerAxis = getMotorCount() * rpmFilter.numHarmonics;
-    notchUpdatesPerIteration = ceilf(numNotchesPerAxis / loopIterationsPerUpdate); // round to ceiling
+    notchUpdatesPerIteration = ceilf(rpmFilter.numNotches / loopIterationsPerUpdate); // round to ceiling
 }
 
 FAST_CODE_NOINLINE void rpmFilterUpdate(void)
@@ -121,46 +160,59 @@ FAST_CODE_NOINLINE void rpmFilterUpdate(void)
         return;
     }
 
+    // Motor frequencies only change with new RPM telemetry, all notches are scanned once after each update
+    const uint32_t updateCount = getMotorFrequencyUpdateCount();
+    if (updateCount != motorFrequencyUpdateCount) {
+        motorFrequencyUpdateCount = updateCount;
+        notchesToScan = rpmFilter.numNotches;
+    }
+
+    if (notchesToScan == 0) {
+        return;
+    }
+
     const float dtCompensation = schedulerGetCycleTimeMultiplier();
     const float correctedLooptime = rpmFilter.looptimeUs * dtCompensation;
 
     // update RPM notches
-    for (int i = 0; i < notchUpdatesPerIteration; i++) {
+    // Notches whose frequency moved less than updateHz keep their coefficients and don't count against
+    // the update budget, so notches of motors that do change speed are reached sooner.
+    int numUpdates = 0;
+    for (; notchesToScan > 0 && numUpdates < notchUpdatesPerIteration; notchesToScan--) {
 
         // Only bother updating notches which have an effect on filtered output
-        if (rpmFilter.weights[harmonicIndex] > 0.0f) {
-
-            // select current notch on ROLL
-            biquadFilter_t *template = &rpmFilter.notch[0][motorIndex][harmonicIndex];
+        const int harmonicSection = rpmFilter.harmonicSection[harmonicIndex];
+        if (harmonicSection >= 0) {
 
+            const int section = harmonicSection + motorIndex;
             const float frequencyHz = constrainf((harmonicIndex + 1) * getMotorFrequencyHz(motorIndex), rpmFilter.minHz, rpmFilter.maxHz);
-            const float marginHz = frequencyHz - rpmFilter.minHz;
-            float weight = 1.0f;
 
-            // fade out notch when approaching minHz (turn it off)
-            if (marginHz < rpmFilter.fadeRangeHz) {
-                weight *= marginHz / rpmFilter.fadeRangeHz;
-            }
+            // frequency the notch is calculated for at the nominal looptime
+            const float notchHz = frequencyHz * dtCompensation;
+
+            if (fabsf(notchHz - rpmFilter.notchHz[section]) >= rpmFilter.updateHz) {
+                const float marginHz = frequencyHz - rpmFilter.minHz;
+                float weight = 1.0f;
+
+                // fade out notch when approaching minHz (turn it off)
+                if (marginHz < rpmFilter.fadeRangeHz) {
+                    weight *= marginHz / rpmFilter.fadeRangeHz;
+                }
+
+                // attenuate notches per harmonics group
+                weight *= rpmFilter.weights[harmonicIndex];
+
+                // update notch, coefficients are shared by all axes
+                if (!biquadFilterBankUpdateNotchFromTable(&rpmFilter.notchBank, section, &rpmFilter.notchTable, notchHz, weight)) {
+                    biquadFilterBankUpdate(&rpmFilter.notchBank, section, frequencyHz, correctedLooptime, rpmFilter.q, FILTER_NOTCH, weight);
+                }
 
-            // attenuate notches per harmonics group
-            weight *= rpmFilter.weights[harmonicIndex];
-
-            // update notch
-            biquadFilterUpdate(template, frequencyHz, correctedLooptime, rpmFilter.q, FILTER_NOTCH, weight);
-
-            // copy notch properties to corresponding notches on PITCH and YAW
-            for (int axis = 1; axis < XYZ_AXIS_COUNT; axis++) {
-                biquadFilter_t *dest = &rpmFilter.notch[axis][motorIndex][harmonicIndex];
-                dest->b0 = template->b0;
-                dest->b1 = template->b1;
-                dest->b2 = template->b2;
-                dest->a1 = template->a1;
-                dest->a2 = template->a2;
-                dest->weight = template->weight;
+                rpmFilter.notchHz[section] = notchHz;
+                numUpdates++;
             }
         }
 
-        // cycle through all notches on ROLL (takes RPM_FILTER_DURATION_S at max.)
+        // cycle through all notches (takes RPM_FILTER_DURATION_S at max.)
         harmonicIndex = (harmonicIndex + 1) % rpmFilter.numHarmonics;
         if (harmonicIndex == 0) {
             motorIndex = (motorIndex + 1) % getMotorCount();
@@ -168,22 +220,20 @@ FAST_CODE_NOINLINE void rpmFilterUpdate(void)
     }
 }
 
-FAST_CODE float rpmFilterApply(const int axis, float value)
+FAST_CODE void rpmFilterApply(float values[XYZ_AXIS_COUNT])
 {
-    // Iterate over all notches on axis and apply each one to value.
+    // Apply all notches to all axes in one pass.
     // Order of application doesn't matter because biquads are linear time-invariant filters.
-    for (int i = 0; i < rpmFilter.numHarmonics; i++) {
+    float lanes[BIQUAD_BANK_LANES] = { 0 };
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        lanes[axis] = values[axis];
+    }
 
-        if (rpmFilter.weights[i] <= 0.0f) {
-            continue;  // skip harmonics which have no effect on filtered output
-        }
+    biquadFilterBankApplyDF1Weighted(&rpmFilter.notchBank, lanes);
 
-        for (int motor = 0; motor < getMotorCount(); motor++) {
-            value = biquadFilterApplyDF1Weighted(&rpmFilter.notch[axis][motor][i], value);
-        }
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        values[axis] = lanes[axis];
     }
-
-    return value;
 }
 
 bool isRpmFilterEnabled(void)
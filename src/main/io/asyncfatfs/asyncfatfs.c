@@ -49,6 +49,7 @@
 #include "common/utils.h"
 
 #include "drivers/sdcard.h"
+#include "drivers/time.h"
 
 #include "fat_standard.h"
 
@@ -60,7 +61,34 @@
     #define ONLY_EXPOSE_FOR_TESTING static
 #endif
 
+// Targets with RAM to spare can enlarge the sector cache, up to 127 sectors
+#ifndef AFATFS_NUM_CACHE_SECTORS
 #define AFATFS_NUM_CACHE_SECTORS 11
+#endif
+
+// Cached sectors are found by hashing their sector index into this many buckets (a power of two)
+#if AFATFS_NUM_CACHE_SECTORS <= 16
+#define AFATFS_CACHE_HASH_SIZE 16
+#elif AFATFS_NUM_CACHE_SECTORS <= 32
+#define AFATFS_CACHE_HASH_SIZE 32
+#elif AFATFS_NUM_CACHE_SECTORS <= 64
+#define AFATFS_CACHE_HASH_SIZE 64
+#else
+#define AFATFS_CACHE_HASH_SIZE 128
+#endif
+
+/*
+ * Dirty sectors are held back in the cache until this many have accumulated (or AFATFS_WRITE_BEHIND_MAX_AGE_MS has
+ * passed since the last batch), so that runs of consecutive sectors reach the card as one multiple-block write.
+ * At 1 every dirty sector is flushed as soon as the card is free.
+ */
+#ifndef AFATFS_WRITE_BEHIND_SECTORS
+#define AFATFS_WRITE_BEHIND_SECTORS 1
+#endif
+
+#ifndef AFATFS_WRITE_BEHIND_MAX_AGE_MS
+#define AFATFS_WRITE_BEHIND_MAX_AGE_MS 100
+#endif
 
 // FAT filesystems are allowed to differ from these parameters, but we choose not to support those weird filesystems:
 #define AFATFS_SECTOR_SIZE  512
@@ -94,6 +122,8 @@
 #define AFATFS_FILE_MODE_CREATE           16
 // The file's directory entry should be locked in cache so we can read it with no latency:
 #define AFATFS_FILE_MODE_RETAIN_DIRECTORY 32
+// Contiguous file grows by a whole extent of superclusters at a time, the unused part is given back on close:
+#define AFATFS_FILE_MODE_PREALLOCATE      64
 
 // Open the cache sector for read access (it will be read from disk)
 #define AFATFS_CACHE_READ         1
@@ -105,6 +135,8 @@
 #define AFATFS_CACHE_DISCARDABLE  8
 // Increase the retain counter of the cache sector to prevent it from being discarded when in the in-sync state
 #define AFATFS_CACHE_RETAIN       16
+// The sector holds file contents rather than filesystem metadata, so it may be flushed out of write order
+#define AFATFS_CACHE_FILE_DATA    32
 
 // Turn the largest free block on the disk into one contiguous file for efficient fragment-free allocation
 #define AFATFS_USE_FREEFILE
@@ -112,6 +144,18 @@
 // When allocating a freefile, leave this many clusters un-allocated for regular files to use
 #define AFATFS_FREEFILE_LEAVE_CLUSTERS 100
 
+/*
+ * Files opened in preallocate mode ("al") take this many bytes (rounded down to whole superclusters) from the freefile at
+ * once, but no more than 1/AFATFS_PREALLOCATE_FREE_SHARE of what is left in it. If we lose power before the file is
+ * closed, the unused end of its extent stays linked to the file until it is deleted, so this bounds what a crash costs.
+ */
+#ifndef AFATFS_PREALLOCATE_SIZE
+#define AFATFS_PREALLOCATE_SIZE (16 * 1024 * 1024)
+#endif
+#ifndef AFATFS_PREALLOCATE_FREE_SHARE
+#define AFATFS_PREALLOCATE_FREE_SHARE 32
+#endif
+
 // Filename in 8.3 format:
 #define AFATFS_FREESPACE_FILENAME "FREESPAC.E"
 
@@ -178,8 +222,10 @@ typedef struct afatfsCacheBlockDescriptor_t {
     // This is the timestamp that this sector was first marked dirty at (so we can flush sectors in write-order).
     uint32_t writeTimestamp;
 
-    // This is the last time the sector was accessed
-    uint32_t accessTimestamp;
+    // The next entry in this sector's hash bucket, and our neighbours in the least-recently-used list (-1 for none)
+    int8_t hashNext;
+    int8_t lruPrev;
+    int8_t lruNext;
 
     /* This is set to non-zero when we expect to write a consecutive series of this many blocks (including this block),
      * so we will tell the SD-card to pre-erase those blocks.
@@ -213,6 +259,12 @@ typedef struct afatfsCacheBlockDescriptor_t {
      * is overridden by the locked and retainCount flags.
      */
     unsigned discardable:1;
+
+    // Set while the entry is linked into the hash bucket for its sectorIndex
+    unsigned hashed:1;
+
+    // Set if the sector was last marked dirty with AFATFS_CACHE_FILE_DATA
+    unsigned fileData:1;
 } afatfsCacheBlockDescriptor_t;
 
 typedef enum {
@@ -256,6 +308,7 @@ typedef enum {
     AFATFS_APPEND_SUPERCLUSTER_PHASE_INIT = 0,
     AFATFS_APPEND_SUPERCLUSTER_PHASE_UPDATE_FREEFILE_DIRECTORY,
     AFATFS_APPEND_SUPERCLUSTER_PHASE_UPDATE_FAT,
+    AFATFS_APPEND_SUPERCLUSTER_PHASE_UPDATE_PREVIOUS_FAT,
     AFATFS_APPEND_SUPERCLUSTER_PHASE_UPDATE_FILE_DIRECTORY
 } afatfsAppendSuperclusterPhase_e;
 
@@ -329,7 +382,22 @@ typedef struct afatfsDeleteFile_t {
     afatfsCallback_t callback;
 } afatfsUnlinkFile_t;
 
+typedef enum {
+    AFATFS_CLOSE_FILE_PHASE_INITIAL = 0,
+#ifdef AFATFS_USE_FREEFILE
+    AFATFS_CLOSE_FILE_PHASE_TERMINATE_FILE,
+    AFATFS_CLOSE_FILE_PHASE_UNTERMINATE_EXTENT,
+    AFATFS_CLOSE_FILE_PHASE_PREPEND_TO_FREEFILE,
+    AFATFS_CLOSE_FILE_PHASE_FREE_EXTENT,
+#endif
+    AFATFS_CLOSE_FILE_PHASE_SAVE_DIRECTORY
+} afatfsCloseFilePhase_e;
+
 typedef struct afatfsCloseFile_t {
+    uint32_t fileEndCluster; // For preallocated files, 1 past the last cluster that the file keeps
+    uint32_t extentEndCluster; // 1 past the last cluster of the preallocated extent
+    uint32_t fatRewriteCluster; // Used to mark progress
+    afatfsCloseFilePhase_e phase;
     afatfsCallback_t callback;
 } afatfsCloseFile_t;
 
@@ -420,6 +488,11 @@ typedef struct afatfsFile_t {
     // The first cluster number of the file, or 0 if this file is empty
     uint32_t firstCluster;
 
+#ifdef AFATFS_USE_FREEFILE
+    // For preallocated files, 1 past the last cluster of the extent taken from the freefile, or 0 if none was taken
+    uint32_t extentEndCluster;
+#endif
+
     // State for a queued operation on the file
     struct afatfsFileOperation_t operation;
 } afatfsFile_t;
@@ -465,10 +538,19 @@ typedef struct afatfs_t {
     uint8_t cache[AFATFS_SECTOR_SIZE * AFATFS_NUM_CACHE_SECTORS];
 #endif
     afatfsCacheBlockDescriptor_t cacheDescriptor[AFATFS_NUM_CACHE_SECTORS];
+    int8_t cacheHash[AFATFS_CACHE_HASH_SIZE]; // The first cache entry in each hash bucket, or -1
+    int8_t cacheMostRecent, cacheLeastRecent; // The ends of the least-recently-used list
     uint32_t cacheTimer;
 
     int cacheDirtyEntries; // The number of cache entries in the AFATFS_CACHE_STATE_DIRTY state
     bool cacheFlushInProgress;
+    uint32_t cacheFlushNextSector; // The sector that would continue the last write to the card
+#if AFATFS_WRITE_BEHIND_SECTORS > 1
+    bool writeBehindFlushing;    // Set while we write out a batch of held back sectors
+    timeMs_t writeBehindDueMs;   // When sectors dirtied since the last batch must be written regardless
+#endif
+
+    afatfsStatistics_t statistics;
 
     afatfsFile_t openFiles[AFATFS_MAX_OPEN_FILES];
 
@@ -519,6 +601,9 @@ static DMA_DATA_ZERO_INIT uint8_t afatfs_cache[AFATFS_SECTOR_SIZE * AFATFS_NUM_C
 
 static afatfs_t afatfs;
 
+STATIC_ASSERT(AFATFS_NUM_CACHE_SECTORS <= 127, afatfs_cache_indexes_must_fit_int8);
+STATIC_ASSERT(AFATFS_WRITE_BEHIND_SECTORS >= 1 && AFATFS_WRITE_BEHIND_SECTORS <= AFATFS_NUM_CACHE_SECTORS / 2, afatfs_write_behind_must_leave_cache_free);
+
 static void afatfs_fileOperationContinue(afatfsFile_t *file);
 static uint8_t* afatfs_fileLockCursorSectorForWrite(afatfsFilePtr_t file);
 static uint8_t* afatfs_fileRetainCursorSectorForRead(afatfsFilePtr_t file);
@@ -632,11 +717,123 @@ static void afatfs_cacheSectorMarkDirty(afatfsCacheBlockDescriptor_t *descriptor
     }
 }
 
-static void afatfs_cacheSectorInit(afatfsCacheBlockDescriptor_t *descriptor, uint32_t sectorIndex, bool locked)
+static int afatfs_cacheHashBucket(uint32_t sectorIndex)
+{
+    return sectorIndex & (AFATFS_CACHE_HASH_SIZE - 1);
+}
+
+/**
+ * Find the index of the cache entry assigned to the given physical sector index, or -1 if the sector isn't cached.
+ * Note that the cached sector could be in any state including completely empty.
+ */
+static int afatfs_cacheLookup(uint32_t sectorIndex)
+{
+    for (int i = afatfs.cacheHash[afatfs_cacheHashBucket(sectorIndex)]; i != -1; i = afatfs.cacheDescriptor[i].hashNext) {
+        if (afatfs.cacheDescriptor[i].sectorIndex == sectorIndex) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void afatfs_cacheHashRemove(int cacheIndex)
+{
+    afatfsCacheBlockDescriptor_t *descriptor = &afatfs.cacheDescriptor[cacheIndex];
+
+    if (descriptor->hashed) {
+        int8_t *link = &afatfs.cacheHash[afatfs_cacheHashBucket(descriptor->sectorIndex)];
+
+        while (*link != cacheIndex) {
+            link = &afatfs.cacheDescriptor[*link].hashNext;
+        }
+        *link = descriptor->hashNext;
+
+        descriptor->hashed = 0;
+    }
+}
+
+static void afatfs_cacheHashInsert(int cacheIndex)
 {
+    afatfsCacheBlockDescriptor_t *descriptor = &afatfs.cacheDescriptor[cacheIndex];
+    int8_t *bucket = &afatfs.cacheHash[afatfs_cacheHashBucket(descriptor->sectorIndex)];
+
+    descriptor->hashNext = *bucket;
+    *bucket = cacheIndex;
+    descriptor->hashed = 1;
+}
+
+static void afatfs_cacheLruUnlink(int cacheIndex)
+{
+    afatfsCacheBlockDescriptor_t *descriptor = &afatfs.cacheDescriptor[cacheIndex];
+
+    if (descriptor->lruPrev == -1) {
+        afatfs.cacheMostRecent = descriptor->lruNext;
+    } else {
+        afatfs.cacheDescriptor[descriptor->lruPrev].lruNext = descriptor->lruNext;
+    }
+
+    if (descriptor->lruNext == -1) {
+        afatfs.cacheLeastRecent = descriptor->lruPrev;
+    } else {
+        afatfs.cacheDescriptor[descriptor->lruNext].lruPrev = descriptor->lruPrev;
+    }
+}
+
+// Move the cache entry to the most recently used end of the LRU list
+static void afatfs_cacheTouch(int cacheIndex)
+{
+    if (afatfs.cacheMostRecent != cacheIndex) {
+        afatfs_cacheLruUnlink(cacheIndex);
+
+        afatfs.cacheDescriptor[cacheIndex].lruPrev = -1;
+        afatfs.cacheDescriptor[cacheIndex].lruNext = afatfs.cacheMostRecent;
+        afatfs.cacheDescriptor[afatfs.cacheMostRecent].lruPrev = cacheIndex;
+        afatfs.cacheMostRecent = cacheIndex;
+    }
+}
+
+// Move the cache entry to the least recently used end of the LRU list, so it is the first to be reused
+static void afatfs_cacheRetire(int cacheIndex)
+{
+    if (afatfs.cacheLeastRecent != cacheIndex) {
+        afatfs_cacheLruUnlink(cacheIndex);
+
+        afatfs.cacheDescriptor[cacheIndex].lruNext = -1;
+        afatfs.cacheDescriptor[cacheIndex].lruPrev = afatfs.cacheLeastRecent;
+        afatfs.cacheDescriptor[afatfs.cacheLeastRecent].lruNext = cacheIndex;
+        afatfs.cacheLeastRecent = cacheIndex;
+    }
+}
+
+// Empty the hash table and put every cache entry on the LRU list
+static void afatfs_cacheInit(void)
+{
+    for (int i = 0; i < AFATFS_CACHE_HASH_SIZE; i++) {
+        afatfs.cacheHash[i] = -1;
+    }
+
+    for (int i = 0; i < AFATFS_NUM_CACHE_SECTORS; i++) {
+        afatfs.cacheDescriptor[i].hashed = 0;
+        afatfs.cacheDescriptor[i].lruPrev = i - 1;
+        afatfs.cacheDescriptor[i].lruNext = i + 1 < AFATFS_NUM_CACHE_SECTORS ? i + 1 : -1;
+    }
+
+    afatfs.cacheMostRecent = 0;
+    afatfs.cacheLeastRecent = AFATFS_NUM_CACHE_SECTORS - 1;
+}
+
+static void afatfs_cacheSectorInit(int cacheIndex, uint32_t sectorIndex, bool locked)
+{
+    afatfsCacheBlockDescriptor_t *descriptor = &afatfs.cacheDescriptor[cacheIndex];
+
+    afatfs_cacheHashRemove(cacheIndex);
     descriptor->sectorIndex = sectorIndex;
+    afatfs_cacheHashInsert(cacheIndex);
 
-    descriptor->accessTimestamp = descriptor->writeTimestamp = ++afatfs.cacheTimer;
+    afatfs_cacheTouch(cacheIndex);
+
+    descriptor->writeTimestamp = ++afatfs.cacheTimer;
 
     descriptor->consecutiveEraseBlockCount = 0;
 
@@ -655,20 +852,18 @@ static void afatfs_sdcardReadComplete(sdcardBlockOperation_e operation, uint32_t
     (void) operation;
     (void) callbackData;
 
-    for (int i = 0; i < AFATFS_NUM_CACHE_SECTORS; i++) {
-        if (afatfs.cacheDescriptor[i].state != AFATFS_CACHE_STATE_EMPTY
-            && afatfs.cacheDescriptor[i].sectorIndex == sectorIndex
-        ) {
-            if (buffer == NULL) {
-                // Read failed, mark the sector as empty and whoever asked for it will ask for it again later to retry
-                afatfs.cacheDescriptor[i].state = AFATFS_CACHE_STATE_EMPTY;
-            } else {
-                afatfs_assert(afatfs_cacheSectorGetMemory(i) == buffer && afatfs.cacheDescriptor[i].state == AFATFS_CACHE_STATE_READING);
+    const int i = afatfs_cacheLookup(sectorIndex);
 
-                afatfs.cacheDescriptor[i].state = AFATFS_CACHE_STATE_IN_SYNC;
-            }
+    if (i != -1 && afatfs.cacheDescriptor[i].state != AFATFS_CACHE_STATE_EMPTY) {
+        if (buffer == NULL) {
+            // Read failed, mark the sector as empty and whoever asked for it will ask for it again later to retry
+            afatfs.cacheDescriptor[i].state = AFATFS_CACHE_STATE_EMPTY;
+            afatfs_cacheRetire(i);
+        } else {
+            afatfs_assert(afatfs_cacheSectorGetMemory(i) == buffer && afatfs.cacheDescriptor[i].state == AFATFS_CACHE_STATE_READING);
 
-            break;
+            afatfs.cacheDescriptor[i].state = AFATFS_CACHE_STATE_IN_SYNC;
+            afatfs.statistics.sectorsRead++;
         }
     }
 }
@@ -683,51 +878,65 @@ static void afatfs_sdcardWriteComplete(sdcardBlockOperation_e operation, uint32_
 
     afatfs.cacheFlushInProgress = false;
 
-    for (int i = 0; i < AFATFS_NUM_CACHE_SECTORS; i++) {
-        /* Keep in mind that someone may have marked the sector as dirty after writing had already begun. In this case we must leave
-         * it marked as dirty because those modifications may have been made too late to make it to the disk!
-         */
-        if (afatfs.cacheDescriptor[i].sectorIndex == sectorIndex
-            && afatfs.cacheDescriptor[i].state == AFATFS_CACHE_STATE_WRITING
-        ) {
-            if (buffer == NULL) {
-                // Write failed, remark the sector as dirty
-                afatfs.cacheDescriptor[i].state = AFATFS_CACHE_STATE_DIRTY;
-                afatfs.cacheDirtyEntries++;
-            } else {
-                afatfs_assert(afatfs_cacheSectorGetMemory(i) == buffer);
+    const int i = afatfs_cacheLookup(sectorIndex);
 
-                afatfs.cacheDescriptor[i].state = AFATFS_CACHE_STATE_IN_SYNC;
-            }
-            break;
+    /* Keep in mind that someone may have marked the sector as dirty after writing had already begun. In this case we must leave
+     * it marked as dirty because those modifications may have been made too late to make it to the disk!
+     */
+    if (i != -1 && afatfs.cacheDescriptor[i].state == AFATFS_CACHE_STATE_WRITING) {
+        if (buffer == NULL) {
+            // Write failed, remark the sector as dirty
+            afatfs.cacheDescriptor[i].state = AFATFS_CACHE_STATE_DIRTY;
+            afatfs.cacheDirtyEntries++;
+        } else {
+            afatfs_assert(afatfs_cacheSectorGetMemory(i) == buffer);
+
+            afatfs.cacheDescriptor[i].state = AFATFS_CACHE_STATE_IN_SYNC;
         }
     }
 }
 
+static void afatfs_cacheSectorWritten(afatfsCacheBlockDescriptor_t *cacheDescriptor)
+{
+    if (cacheDescriptor->sectorIndex != afatfs.cacheFlushNextSector) {
+        afatfs.statistics.writeBursts++;
+    }
+    afatfs.statistics.sectorsWritten++;
+
+    afatfs.cacheFlushNextSector = cacheDescriptor->sectorIndex + 1;
+    afatfs.cacheDirtyEntries--;
+}
+
 /**
- * Attempt to flush the dirty cache entry with the given index to the SDcard.
+ * Attempt to flush the dirty cache entry with the given index to the SDcard. runLength is the number of consecutive
+ * dirty sectors beginning with this one that we're about to write.
  */
-static void afatfs_cacheFlushSector(int cacheIndex)
+static void afatfs_cacheFlushSector(int cacheIndex, uint32_t runLength)
 {
     afatfsCacheBlockDescriptor_t *cacheDescriptor = &afatfs.cacheDescriptor[cacheIndex];
 
 #ifdef AFATFS_MIN_MULTIPLE_BLOCK_WRITE_COUNT
-    if (cacheDescriptor->consecutiveEraseBlockCount) {
-        sdcard_beginWriteBlocks(cacheDescriptor->sectorIndex, cacheDescriptor->consecutiveEraseBlockCount);
+    // Pre-erase the longer of the run we have in the cache and the run the file told us to expect
+    const uint32_t blockCount = MAX((uint32_t)cacheDescriptor->consecutiveEraseBlockCount, runLength);
+
+    if (blockCount >= AFATFS_MIN_MULTIPLE_BLOCK_WRITE_COUNT) {
+        sdcard_beginWriteBlocks(cacheDescriptor->sectorIndex, blockCount);
     }
+#else
+    UNUSED(runLength);
 #endif
 
     switch (sdcard_writeBlock(cacheDescriptor->sectorIndex, afatfs_cacheSectorGetMemory(cacheIndex), afatfs_sdcardWriteComplete, 0)) {
         case SDCARD_OPERATION_IN_PROGRESS:
             // The card will call us back later when the buffer transmission finishes
-            afatfs.cacheDirtyEntries--;
+            afatfs_cacheSectorWritten(cacheDescriptor);
             cacheDescriptor->state = AFATFS_CACHE_STATE_WRITING;
             afatfs.cacheFlushInProgress = true;
             break;
 
         case SDCARD_OPERATION_SUCCESS:
             // Buffer is already transmitted
-            afatfs.cacheDirtyEntries--;
+            afatfs_cacheSectorWritten(cacheDescriptor);
             cacheDescriptor->state = AFATFS_CACHE_STATE_IN_SYNC;
             break;
 
@@ -756,13 +965,9 @@ bool afatfs_sectorCacheInSync(void)
  */
 static afatfsCacheBlockDescriptor_t* afatfs_findCacheSector(uint32_t sectorIndex)
 {
-    for (int i = 0; i < AFATFS_NUM_CACHE_SECTORS; i++) {
-        if (afatfs.cacheDescriptor[i].sectorIndex == sectorIndex) {
-            return &afatfs.cacheDescriptor[i];
-        }
-    }
+    const int i = afatfs_cacheLookup(sectorIndex);
 
-    return NULL;
+    return i == -1 ? NULL : &afatfs.cacheDescriptor[i];
 }
 
 /**
@@ -775,15 +980,12 @@ static afatfsCacheBlockDescriptor_t* afatfs_findCacheSector(uint32_t sectorIndex
  * - The index of the oldest synced sector
  *
  * Otherwise it returns -1 to signal failure (cache is full!)
+ *
+ * Candidates for eviction are searched from the least recently used end of the LRU list. Empty sectors are kept at
+ * that end, so the search normally stops at the first entry it looks at.
  */
 static int afatfs_allocateCacheSector(uint32_t sectorIndex)
 {
-    int allocateIndex;
-    int emptyIndex = -1, discardableIndex = -1;
-
-    uint32_t oldestSyncedSectorLastUse = 0xFFFFFFFF;
-    int oldestSyncedSectorIndex = -1;
-
     if (
         !afatfs_assert(
             afatfs.numClusters == 0 // We're unable to check sector bounds during startup since we haven't read volume label yet
@@ -793,81 +995,120 @@ static int afatfs_allocateCacheSector(uint32_t sectorIndex)
         return -1;
     }
 
-    for (int i = 0; i < AFATFS_NUM_CACHE_SECTORS; i++) {
-        if (afatfs.cacheDescriptor[i].sectorIndex == sectorIndex) {
-            /*
-             * If the sector is actually empty then do a complete re-init of it just like the standard
-             * empty case. (Sectors marked as empty should be treated as if they don't have a block index assigned)
-             */
-            if (afatfs.cacheDescriptor[i].state == AFATFS_CACHE_STATE_EMPTY) {
-                emptyIndex = i;
-                break;
-            }
+    int allocateIndex = afatfs_cacheLookup(sectorIndex);
 
-            // Bump the last access time
-            afatfs.cacheDescriptor[i].accessTimestamp = ++afatfs.cacheTimer;
-            return i;
+    if (allocateIndex != -1) {
+        /*
+         * If the sector is actually empty then do a complete re-init of it just like the standard
+         * empty case. (Sectors marked as empty should be treated as if they don't have a block index assigned)
+         */
+        if (afatfs.cacheDescriptor[allocateIndex].state != AFATFS_CACHE_STATE_EMPTY) {
+            afatfs_cacheTouch(allocateIndex);
+            return allocateIndex;
         }
+    } else {
+        int oldestSyncedSectorIndex = -1;
 
-        switch (afatfs.cacheDescriptor[i].state) {
-            case AFATFS_CACHE_STATE_EMPTY:
-                emptyIndex = i;
-            break;
-            case AFATFS_CACHE_STATE_IN_SYNC:
-                // Is this a synced sector that we could evict from the cache?
-                if (!afatfs.cacheDescriptor[i].locked && afatfs.cacheDescriptor[i].retainCount == 0) {
-                    if (afatfs.cacheDescriptor[i].discardable) {
-                        discardableIndex = i;
-                    } else if (afatfs.cacheDescriptor[i].accessTimestamp < oldestSyncedSectorLastUse) {
-                        // This is older than last block we decided to evict, so evict this one in preference
-                        oldestSyncedSectorLastUse = afatfs.cacheDescriptor[i].accessTimestamp;
-                        oldestSyncedSectorIndex = i;
-                    }
+        for (int i = afatfs.cacheLeastRecent; i != -1; i = afatfs.cacheDescriptor[i].lruPrev) {
+            const afatfsCacheBlockDescriptor_t *descriptor = &afatfs.cacheDescriptor[i];
+
+            if (descriptor->state == AFATFS_CACHE_STATE_EMPTY) {
+                allocateIndex = i;
+                break;
+            }
+
+            // Is this a synced sector that we could evict from the cache?
+            if (descriptor->state == AFATFS_CACHE_STATE_IN_SYNC && !descriptor->locked && descriptor->retainCount == 0) {
+                if (descriptor->discardable) {
+                    allocateIndex = i;
+                    break;
+                } else if (oldestSyncedSectorIndex == -1) {
+                    oldestSyncedSectorIndex = i;
                 }
-            break;
-            default:
-                ;
+            }
         }
-    }
 
-    if (emptyIndex > -1) {
-        allocateIndex = emptyIndex;
-    } else if (discardableIndex > -1) {
-        allocateIndex = discardableIndex;
-    } else if (oldestSyncedSectorIndex > -1) {
-        allocateIndex = oldestSyncedSectorIndex;
-    } else {
-        allocateIndex = -1;
+        if (allocateIndex == -1) {
+            allocateIndex = oldestSyncedSectorIndex;
+        }
     }
 
     if (allocateIndex > -1) {
-        afatfs_cacheSectorInit(&afatfs.cacheDescriptor[allocateIndex], sectorIndex, false);
+        afatfs_cacheSectorInit(allocateIndex, sectorIndex, false);
     }
 
     return allocateIndex;
 }
 
+/**
+ * Get the index of the cache entry for this sector if it holds file data that was marked dirty before `before` and is
+ * free to be written out, otherwise -1.
+ */
+static int afatfs_cacheFindFlushableData(uint32_t sectorIndex, uint32_t before)
+{
+    const int i = afatfs_cacheLookup(sectorIndex);
+
+    if (i != -1) {
+        const afatfsCacheBlockDescriptor_t *descriptor = &afatfs.cacheDescriptor[i];
+
+        if (descriptor->state == AFATFS_CACHE_STATE_DIRTY && !descriptor->locked && descriptor->fileData && descriptor->writeTimestamp < before) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
 /**
  * Attempt to flush dirty cache pages out to the sdcard, returning true if all flushable data has been flushed.
+ *
+ * Sectors are flushed oldest first, so that the card never holds metadata (FAT, directory entries) describing file
+ * contents which haven't reached it yet. The one exception is file data: while the oldest dirty sector is file data, we
+ * write the whole run of consecutive file data sectors around it in ascending order so that the card can accept them
+ * as a single multiple-block write. Every sector of that run was marked dirty before the oldest dirty metadata sector,
+ * so this only reorders file contents that no metadata on the card refers to yet.
  */
 bool afatfs_flush(void)
 {
     if (afatfs.cacheDirtyEntries > 0) {
-        // Flush the oldest flushable sector
-        uint32_t earliestSectorTime = 0xFFFFFFFF;
-        int earliestSectorIndex = -1;
+        int flushIndex = -1;
+        uint32_t metadataTimestamp = UINT32_MAX;
 
         for (int i = 0; i < AFATFS_NUM_CACHE_SECTORS; i++) {
-            if (afatfs.cacheDescriptor[i].state == AFATFS_CACHE_STATE_DIRTY && !afatfs.cacheDescriptor[i].locked
-                && (earliestSectorIndex == -1 || afatfs.cacheDescriptor[i].writeTimestamp < earliestSectorTime)
-            ) {
-                earliestSectorIndex = i;
-                earliestSectorTime = afatfs.cacheDescriptor[i].writeTimestamp;
+            const afatfsCacheBlockDescriptor_t *descriptor = &afatfs.cacheDescriptor[i];
+
+            if (descriptor->state == AFATFS_CACHE_STATE_DIRTY && !descriptor->locked) {
+                if (flushIndex == -1 || descriptor->writeTimestamp < afatfs.cacheDescriptor[flushIndex].writeTimestamp) {
+                    flushIndex = i;
+                }
+                if (!descriptor->fileData) {
+                    metadataTimestamp = MIN(metadataTimestamp, descriptor->writeTimestamp);
+                }
             }
         }
 
-        if (earliestSectorIndex > -1) {
-            afatfs_cacheFlushSector(earliestSectorIndex);
+        if (flushIndex > -1) {
+            uint32_t runLength = 1;
+
+            if (afatfs.cacheDescriptor[flushIndex].fileData) {
+                // Carry on with the run we were writing if we can, otherwise start from the beginning of this one
+                const int nextIndex = afatfs_cacheFindFlushableData(afatfs.cacheFlushNextSector, metadataTimestamp);
+                if (nextIndex != -1) {
+                    flushIndex = nextIndex;
+                } else {
+                    int previousIndex;
+                    while ((previousIndex = afatfs_cacheFindFlushableData(afatfs.cacheDescriptor[flushIndex].sectorIndex - 1, metadataTimestamp)) != -1) {
+                        flushIndex = previousIndex;
+                    }
+                }
+
+                const uint32_t sectorIndex = afatfs.cacheDescriptor[flushIndex].sectorIndex;
+                while (runLength < AFATFS_NUM_CACHE_SECTORS && afatfs_cacheFindFlushableData(sectorIndex + runLength, metadataTimestamp) != -1) {
+                    runLength++;
+                }
+            }
+
+            afatfs_cacheFlushSector(flushIndex, runLength);
 
             // That flush will take time to complete so we may as well tell caller to come back later
             return false;
@@ -984,10 +1225,19 @@ static afatfsOperationStatus_e afatfs_cacheSector(uint32_t physicalSectorIndex,
         case AFATFS_CACHE_STATE_IN_SYNC:
             if ((sectorFlags & AFATFS_CACHE_WRITE) != 0) {
                 afatfs_cacheSectorMarkDirty(&afatfs.cacheDescriptor[cacheSectorIndex]);
+                afatfs.cacheDescriptor[cacheSectorIndex].fileData = (sectorFlags & AFATFS_CACHE_FILE_DATA) != 0;
             }
             FALLTHROUGH;
 
         case AFATFS_CACHE_STATE_DIRTY:
+            /*
+             * Metadata written again may now describe file data that was dirtied after it was, so it has to be ordered
+             * behind that data (file data keeps its original timestamp so that write-behind can't starve it).
+             */
+            if ((sectorFlags & (AFATFS_CACHE_WRITE | AFATFS_CACHE_FILE_DATA)) == AFATFS_CACHE_WRITE
+                && !afatfs.cacheDescriptor[cacheSectorIndex].fileData) {
+                afatfs.cacheDescriptor[cacheSectorIndex].writeTimestamp = ++afatfs.cacheTimer;
+            }
             if ((sectorFlags & AFATFS_CACHE_LOCK) != 0) {
                 afatfs.cacheDescriptor[cacheSectorIndex].locked = 1;
             }
@@ -1667,9 +1917,29 @@ uint32_t afatfs_superClusterSize(void)
     return afatfs_fatEntriesPerSector() * afatfs_clusterSize();
 }
 
+/**
+ * Get the number of superclusters that the given contiguous file should take from the freefile when it next grows.
+ * The freefile must have at least one supercluster available.
+ */
+static uint32_t afatfs_appendSuperclusterCount(afatfsFilePtr_t file)
+{
+    if ((file->mode & AFATFS_FILE_MODE_PREALLOCATE) != 0) {
+        const uint32_t superClusterSize = afatfs_superClusterSize();
+        const uint32_t freeSuperclusters = afatfs.freeFile.logicalSize / superClusterSize;
+
+        return MAX(MIN(AFATFS_PREALLOCATE_SIZE / superClusterSize, freeSuperclusters / AFATFS_PREALLOCATE_FREE_SHARE), 1U);
+    }
+
+    return 1;
+}
+
 /**
  * Continue to attempt to add a supercluster to the end of the given file.
  *
+ * Files in preallocate mode take several superclusters at once. The freefile's clusters are already chained in linear
+ * sequence, so only the FAT sector for the final supercluster taken (to terminate it) and the one for the supercluster
+ * that used to end the file (to unterminate it) need to be rewritten.
+ *
  * If the file operation was set to AFATFS_FILE_OPERATION_APPEND_SUPERCLUSTER and the operation completes, the file's
  * operation is cleared.
  *
@@ -1686,13 +1956,15 @@ static afatfsOperationStatus_e afatfs_appendSuperclusterContinue(afatfsFile_t *f
     doMore:
     switch (opState->phase) {
         case AFATFS_APPEND_SUPERCLUSTER_PHASE_INIT:
-            // Our file steals the first cluster of the freefile
+        {
+            // Our file steals the first superclusters of the freefile
+            const uint32_t superclusterCount = afatfs_appendSuperclusterCount(file);
 
             // We can go ahead and write to that space before the FAT and directory are updated
             file->cursorCluster = afatfs.freeFile.firstCluster;
-            file->physicalSize += afatfs_superClusterSize();
+            file->physicalSize += superclusterCount * afatfs_superClusterSize();
 
-            /* Remove the first supercluster from the freefile
+            /* Remove the first superclusters from the freefile
              *
              * Even if the freefile becomes empty, we still don't set its first cluster to zero. This is so that
              * afatfs_fileGetNextCluster() can tell where a contiguous file ends (at the start of the freefile).
@@ -1700,27 +1972,24 @@ static afatfsOperationStatus_e afatfs_appendSuperclusterContinue(afatfsFile_t *f
              * Note that normally the freefile can't become empty because it is allocated as a non-integer number
              * of superclusters to avoid precisely this situation.
              */
-            afatfs.freeFile.firstCluster += afatfs_fatEntriesPerSector();
-            afatfs.freeFile.logicalSize -= afatfs_superClusterSize();
-            afatfs.freeFile.physicalSize -= afatfs_superClusterSize();
+            afatfs.freeFile.firstCluster += superclusterCount * afatfs_fatEntriesPerSector();
+            afatfs.freeFile.logicalSize -= superclusterCount * afatfs_superClusterSize();
+            afatfs.freeFile.physicalSize -= superclusterCount * afatfs_superClusterSize();
 
-            // The new supercluster needs to have its clusters chained contiguously and marked with a terminator at the end
-            opState->fatRewriteStartCluster = file->cursorCluster;
-            opState->fatRewriteEndCluster = opState->fatRewriteStartCluster + afatfs_fatEntriesPerSector();
+            // The clusters are already chained contiguously, the last supercluster needs a terminator at the end
+            opState->fatRewriteEndCluster = afatfs.freeFile.firstCluster;
+            opState->fatRewriteStartCluster = opState->fatRewriteEndCluster - afatfs_fatEntriesPerSector();
 
             if (opState->previousCluster == 0) {
                 // This is the new first cluster in the file so we need to update the directory entry
                 file->firstCluster = file->cursorCluster;
-            } else {
-                /*
-                 * We also need to update the FAT of the supercluster that used to end the file so that it no longer
-                 * terminates there
-                 */
-                opState->fatRewriteStartCluster -= afatfs_fatEntriesPerSector();
             }
 
+            file->extentEndCluster = afatfs.freeFile.firstCluster;
+
             opState->phase = AFATFS_APPEND_SUPERCLUSTER_PHASE_UPDATE_FREEFILE_DIRECTORY;
             goto doMore;
+        }
         break;
         case AFATFS_APPEND_SUPERCLUSTER_PHASE_UPDATE_FREEFILE_DIRECTORY:
             // First update the freefile's directory entry to remove the first supercluster so we don't risk cross-linking the file
@@ -1734,6 +2003,22 @@ static afatfsOperationStatus_e afatfs_appendSuperclusterContinue(afatfsFile_t *f
         case AFATFS_APPEND_SUPERCLUSTER_PHASE_UPDATE_FAT:
             status = afatfs_FATFillWithPattern(AFATFS_FAT_PATTERN_TERMINATED_CHAIN, &opState->fatRewriteStartCluster, opState->fatRewriteEndCluster);
 
+            if (status == AFATFS_OPERATION_SUCCESS) {
+                if (opState->previousCluster == 0) {
+                    opState->phase = AFATFS_APPEND_SUPERCLUSTER_PHASE_UPDATE_FILE_DIRECTORY;
+                } else {
+                    // The supercluster that used to end the file must chain on to the new ones instead of terminating
+                    opState->fatRewriteEndCluster = opState->previousCluster + 1;
+                    opState->fatRewriteStartCluster = opState->fatRewriteEndCluster - afatfs_fatEntriesPerSector();
+
+                    opState->phase = AFATFS_APPEND_SUPERCLUSTER_PHASE_UPDATE_PREVIOUS_FAT;
+                }
+                goto doMore;
+            }
+        break;
+        case AFATFS_APPEND_SUPERCLUSTER_PHASE_UPDATE_PREVIOUS_FAT:
+            status = afatfs_FATFillWithPattern(AFATFS_FAT_PATTERN_UNTERMINATED_CHAIN, &opState->fatRewriteStartCluster, opState->fatRewriteEndCluster);
+
             if (status == AFATFS_OPERATION_SUCCESS) {
                 opState->phase = AFATFS_APPEND_SUPERCLUSTER_PHASE_UPDATE_FILE_DIRECTORY;
                 goto doMore;
@@ -1765,7 +2050,8 @@ static afatfsOperationStatus_e afatfs_appendSuperclusterContinue(afatfsFile_t *f
  *     AFATFS_OPERATION_FAILURE     - Operation could not be queued (file was busy) or append failed (filesystem is full).
  *                                    Check afatfs.fileSystemFull
  */
-static afatfsOperationStatus_e afatfs_appendSupercluster(afatfsFilePtr_t file)
+ONLY_EXPOSE_FOR_TESTING
+afatfsOperationStatus_e afatfs_appendSupercluster(afatfsFilePtr_t file)
 {
     uint32_t superClusterSize = afatfs_superClusterSize();
 
@@ -1902,7 +2188,7 @@ static uint8_t* afatfs_fileLockCursorSectorForWrite(afatfsFilePtr_t file)
         }
 
         uint32_t physicalSector = afatfs_fileGetCursorPhysicalSector(file);
-        uint8_t cacheFlags = AFATFS_CACHE_WRITE | AFATFS_CACHE_LOCK;
+        uint8_t cacheFlags = AFATFS_CACHE_WRITE | AFATFS_CACHE_LOCK | AFATFS_CACHE_FILE_DATA;
         uint32_t cursorOffsetInSector = file->cursorOffset % AFATFS_SECTOR_SIZE;
         uint32_t offsetOfStartOfSector = file->cursorOffset & ~((uint32_t) AFATFS_SECTOR_SIZE - 1);
         uint32_t offsetOfEndOfSector = offsetOfStartOfSector + AFATFS_SECTOR_SIZE;
@@ -2560,6 +2846,9 @@ bool afatfs_ftruncate(afatfsFilePtr_t file, afatfsFileCallback_t callback)
 
     // We'll drop the cluster chain from the directory entry immediately
     file->firstCluster = 0;
+#ifdef AFATFS_USE_FREEFILE
+    file->extentEndCluster = 0;
+#endif
     file->logicalSize = 0;
     file->physicalSize = 0;
 
@@ -2724,7 +3013,7 @@ static void afatfs_createFileContinue(afatfsFile_t *file)
 #endif
             } else {
                 // We can't guarantee that the existing file contents are contiguous
-                file->mode &= ~AFATFS_FILE_MODE_CONTIGUOUS;
+                file->mode &= ~(AFATFS_FILE_MODE_CONTIGUOUS | AFATFS_FILE_MODE_PREALLOCATE);
 
                 // Seek to the end of the file if it is in append mode
                 if ((file->mode & AFATFS_FILE_MODE_APPEND) != 0) {
@@ -2868,19 +3157,104 @@ static void afatfs_fcloseContinue(afatfsFilePtr_t file)
 {
     afatfsCacheBlockDescriptor_t *descriptor;
     afatfsCloseFile_t *opState = &file->operation.state.closeFile;
+#ifdef AFATFS_USE_FREEFILE
+    uint32_t fileSuperclusters, freeFileGrow;
+#endif
 
-    /*
-     * Directories don't update their parent directory entries over time, because their fileSize field in the directory
-     * never changes (when we add the first cluster to the directory we save the directory entry at that point and it
-     * doesn't change afterwards). So don't bother trying to save their directory entries during fclose().
-     *
-     * Also if we only opened the file for read then we didn't change the directory entry either.
-     */
-    if (file->type != AFATFS_FILE_TYPE_DIRECTORY && file->type != AFATFS_FILE_TYPE_FAT16_ROOT_DIRECTORY
-            && (file->mode & (AFATFS_FILE_MODE_APPEND | AFATFS_FILE_MODE_WRITE)) != 0) {
-        if (afatfs_saveDirectoryEntry(file, AFATFS_SAVE_DIRECTORY_FOR_CLOSE) != AFATFS_OPERATION_SUCCESS) {
-            return;
-        }
+    doMore:
+    switch (opState->phase) {
+        case AFATFS_CLOSE_FILE_PHASE_INITIAL:
+#ifdef AFATFS_USE_FREEFILE
+            /*
+             * A preallocated file keeps the superclusters that hold its content (at least one) and gives the rest of its
+             * extent back to the start of the freefile. If the extent no longer borders the freefile, its spare clusters
+             * are marked free instead.
+             */
+            if ((file->mode & AFATFS_FILE_MODE_PREALLOCATE) != 0 && (file->mode & AFATFS_FILE_MODE_CONTIGUOUS) != 0
+                    && file->firstCluster != 0 && file->extentEndCluster != 0) {
+                fileSuperclusters = file->logicalSize == 0 ? 1 : (file->logicalSize - 1) / afatfs_superClusterSize() + 1;
+
+                opState->fileEndCluster = file->firstCluster + fileSuperclusters * afatfs_fatEntriesPerSector();
+                opState->extentEndCluster = file->extentEndCluster;
+
+                if (opState->fileEndCluster < opState->extentEndCluster) {
+                    opState->fatRewriteCluster = opState->fileEndCluster - afatfs_fatEntriesPerSector();
+                    opState->phase = AFATFS_CLOSE_FILE_PHASE_TERMINATE_FILE;
+                    goto doMore;
+                }
+            }
+#endif
+            opState->phase = AFATFS_CLOSE_FILE_PHASE_SAVE_DIRECTORY;
+            goto doMore;
+        break;
+#ifdef AFATFS_USE_FREEFILE
+        case AFATFS_CLOSE_FILE_PHASE_TERMINATE_FILE:
+            if (afatfs_FATFillWithPattern(AFATFS_FAT_PATTERN_TERMINATED_CHAIN, &opState->fatRewriteCluster, opState->fileEndCluster) != AFATFS_OPERATION_SUCCESS) {
+                return;
+            }
+
+            if (opState->extentEndCluster == afatfs.freeFile.firstCluster) {
+                // The end of the extent must chain on to the freefile instead of terminating
+                opState->fatRewriteCluster = opState->extentEndCluster - afatfs_fatEntriesPerSector();
+                opState->phase = AFATFS_CLOSE_FILE_PHASE_UNTERMINATE_EXTENT;
+            } else {
+                opState->fatRewriteCluster = opState->fileEndCluster;
+                opState->phase = AFATFS_CLOSE_FILE_PHASE_FREE_EXTENT;
+            }
+            goto doMore;
+        break;
+        case AFATFS_CLOSE_FILE_PHASE_UNTERMINATE_EXTENT:
+            if (afatfs_FATFillWithPattern(AFATFS_FAT_PATTERN_UNTERMINATED_CHAIN, &opState->fatRewriteCluster, opState->extentEndCluster) != AFATFS_OPERATION_SUCCESS) {
+                return;
+            }
+
+            opState->phase = AFATFS_CLOSE_FILE_PHASE_PREPEND_TO_FREEFILE;
+            goto doMore;
+        break;
+        case AFATFS_CLOSE_FILE_PHASE_PREPEND_TO_FREEFILE:
+            // Note, it's okay to run this code several times:
+            freeFileGrow = (afatfs.freeFile.firstCluster - opState->fileEndCluster) * afatfs_clusterSize();
+
+            afatfs.freeFile.firstCluster = opState->fileEndCluster;
+            afatfs.freeFile.logicalSize += freeFileGrow;
+            afatfs.freeFile.physicalSize += freeFileGrow;
+
+            file->physicalSize -= freeFileGrow;
+
+            if (afatfs_saveDirectoryEntry(&afatfs.freeFile, AFATFS_SAVE_DIRECTORY_NORMAL) != AFATFS_OPERATION_SUCCESS) {
+                return;
+            }
+
+            opState->phase = AFATFS_CLOSE_FILE_PHASE_SAVE_DIRECTORY;
+            goto doMore;
+        break;
+        case AFATFS_CLOSE_FILE_PHASE_FREE_EXTENT:
+            if (afatfs_FATFillWithPattern(AFATFS_FAT_PATTERN_FREE, &opState->fatRewriteCluster, opState->extentEndCluster) != AFATFS_OPERATION_SUCCESS) {
+                return;
+            }
+
+            file->physicalSize -= (opState->extentEndCluster - opState->fileEndCluster) * afatfs_clusterSize();
+
+            opState->phase = AFATFS_CLOSE_FILE_PHASE_SAVE_DIRECTORY;
+            goto doMore;
+        break;
+#endif
+        case AFATFS_CLOSE_FILE_PHASE_SAVE_DIRECTORY:
+            /*
+             * Directories don't update their parent directory entries over time, because their fileSize field in the
+             * directory never changes (when we add the first cluster to the directory we save the directory entry at
+             * that point and it doesn't change afterwards). So don't bother trying to save their directory entries
+             * during fclose().
+             *
+             * Also if we only opened the file for read then we didn't change the directory entry either.
+             */
+            if (file->type != AFATFS_FILE_TYPE_DIRECTORY && file->type != AFATFS_FILE_TYPE_FAT16_ROOT_DIRECTORY
+                    && (file->mode & (AFATFS_FILE_MODE_APPEND | AFATFS_FILE_MODE_WRITE)) != 0) {
+                if (afatfs_saveDirectoryEntry(file, AFATFS_SAVE_DIRECTORY_FOR_CLOSE) != AFATFS_OPERATION_SUCCESS) {
+                    return;
+                }
+            }
+        break;
     }
 
     // Release our reservation on the directory cache if needed
@@ -2930,6 +3304,7 @@ bool afatfs_fclose(afatfsFilePtr_t file, afatfsCallback_t callback)
         afatfs_fileUpdateFilesize(file);
 
         file->operation.operation = AFATFS_FILE_OPERATION_CLOSE;
+        file->operation.state.closeFile.phase = AFATFS_CLOSE_FILE_PHASE_INITIAL;
         file->operation.state.closeFile.callback = callback;
         afatfs_fcloseContinue(file);
         return true;
@@ -3020,6 +3395,11 @@ bool afatfs_chdir(afatfsFilePtr_t directory)
  * ws   If the file is already non-empty or freefile support is not compiled in then it will fall back to non-contiguous
  *      operation.
  *
+ * al - Like "as", but the file takes an extent of AFATFS_PREALLOCATE_SIZE bytes from the freefile whenever it grows, so
+ *      appends only compute sector addresses and the FAT and directory are almost never touched while logging. The
+ *      unused end of the extent is given back to the freefile when the file is closed (a crash before then leaves it
+ *      allocated to the file, so the extent is also capped to a small share of the free space).
+ *
  * All other mode strings are illegal. In particular, don't add "b" to the end of the mode string.
  *
  * Returns false if the the open failed really early (out of file handles).
@@ -3052,6 +3432,11 @@ bool afatfs_fopen(const char *filename, const char *mode, afatfsFileCallback_t c
         case 's':
 #ifdef AFATFS_USE_FREEFILE
             fileMode |= AFATFS_FILE_MODE_CONTIGUOUS | AFATFS_FILE_MODE_RETAIN_DIRECTORY;
+#endif
+        break;
+        case 'l':
+#ifdef AFATFS_USE_FREEFILE
+            fileMode |= AFATFS_FILE_MODE_CONTIGUOUS | AFATFS_FILE_MODE_PREALLOCATE | AFATFS_FILE_MODE_RETAIN_DIRECTORY;
 #endif
         break;
     }
@@ -3153,6 +3538,8 @@ uint32_t afatfs_fwrite(afatfsFilePtr_t file, const uint8_t *buffer, uint32_t len
         cursorOffsetInSector = 0;
     }
 
+    afatfs.statistics.bytesWritten += writtenBytes;
+
     return writtenBytes;
 }
 
@@ -3565,7 +3952,19 @@ void afatfs_poll(void)
 {
     // Only attempt to continue FS operations if the card is present & ready, otherwise we would just be wasting time
     if (sdcard_poll()) {
+#if AFATFS_WRITE_BEHIND_SECTORS > 1
+        // Let dirty sectors build up into a batch, then write out the whole batch
+        if (!afatfs.writeBehindFlushing) {
+            afatfs.writeBehindFlushing = afatfs.cacheDirtyEntries >= AFATFS_WRITE_BEHIND_SECTORS
+                || cmp32(millis(), afatfs.writeBehindDueMs) >= 0;
+        }
+        if (afatfs.writeBehindFlushing && afatfs_flush()) {
+            afatfs.writeBehindFlushing = false;
+            afatfs.writeBehindDueMs = millis() + AFATFS_WRITE_BEHIND_MAX_AGE_MS;
+        }
+#else
         afatfs_flush();
+#endif
 
         switch (afatfs.filesystemState) {
             case AFATFS_FILESYSTEM_STATE_INITIALIZATION:
@@ -3634,6 +4033,14 @@ afatfsError_e afatfs_getLastError(void)
     return afatfs.lastError;
 }
 
+/**
+ * Get counts of the file data written and of the sectors read and written on the card, to judge write amplification.
+ */
+const afatfsStatistics_t *afatfs_getStatistics(void)
+{
+    return &afatfs.statistics;
+}
+
 void afatfs_init(void)
 {
 #ifdef STM32H7
@@ -3643,6 +4050,8 @@ void afatfs_init(void)
     afatfs.initPhase = AFATFS_INITIALIZATION_READ_MBR;
     afatfs.lastClusterAllocated = FAT_SMALLEST_LEGAL_CLUSTER_NUMBER;
 
+    afatfs_cacheInit();
+
 #ifdef AFATFS_USE_INTROSPECTIVE_LOGGING
     sdcard_setProfilerCallback(afatfs_sdcardProfilerCallback);
 #endif
@@ -60,6 +60,13 @@ typedef enum {
     AFATFS_SEEK_END
 } afatfsSeek_e;
 
+typedef struct afatfsStatistics_s {
+    uint32_t bytesWritten;   // File data accepted by afatfs_fwrite()
+    uint32_t sectorsWritten; // Sectors written to the card
+    uint32_t writeBursts;    // Runs of consecutive sectors written to the card
+    uint32_t sectorsRead;    // Sectors read from the card
+} afatfsStatistics_t;
+
 typedef void (*afatfsFileCallback_t)(afatfsFilePtr_t file);
 typedef void (*afatfsCallback_t)(void);
 
@@ -94,3 +101,4 @@ bool afatfs_isFull(void);
 afatfsFilesystemState_e afatfs_getFilesystemState(void);
 afatfsError_e afatfs_getLastError(void);
 bool afatfs_sectorCacheInSync(void);
+const afatfsStatistics_t *afatfs_getStatistics(void);
@@ -29,6 +29,7 @@
 
 #include "cli/cli.h"
 
+#include "common/maths.h"
 #include "common/utils.h"
 
 #include "drivers/display.h"
@@ -47,6 +48,30 @@
 static displayPort_t mspDisplayPort;
 static serialPortIdentifier_e displayPortSerial;
 
+#ifdef USE_MSP_DISPLAYPORT_BATCH
+// Largest display the batched writes can hold, a bigger canvas is written directly
+#define BATCH_CELL_COUNT (OSD_HD_ROWS * OSD_HD_COLS)
+#define BATCH_BLANK_CELL ' '
+// Room in the transmit buffer for an MSP frame of the given payload length
+#define BATCH_FRAME_SPACE(length) ((length) + MSP_MAX_HEADER_SIZE + 1)
+
+/*
+ * Like the max7456 shadow buffer: the OSD clears and draws the canvas for every refresh, while shown holds what the
+ * display has been sent. Drawing the screen sends only the cells where the two differ. Each cell holds the MSP
+ * attribute in the upper byte and the character in the lower byte.
+ */
+typedef struct displayPortMspBatch_s {
+    bool enabled;
+    bool clearPending;      // what the display shows isn't known, so clear it before sending the next runs
+    uint8_t refreshRow;     // the cells of this row that aren't blank are sent even when unchanged
+    uint16_t resumeCell;    // the transmit buffer filled up at this cell during the last draw
+    uint16_t canvas[BATCH_CELL_COUNT];
+    uint16_t shown[BATCH_CELL_COUNT];
+} displayPortMspBatch_t;
+
+static displayPortMspBatch_t batch;
+#endif
+
 typedef struct displayPortMspCommand_s {
     uint8_t command;
     uint8_t row;
@@ -86,20 +111,134 @@ static int release(displayPort_t *displayPort)
     return output(displayPort, MSP_DISPLAYPORT, subcmd, sizeof(subcmd));
 }
 
+#ifdef USE_MSP_DISPLAYPORT_BATCH
+static void batchBlank(uint16_t *cells)
+{
+    for (unsigned cell = 0; cell < BATCH_CELL_COUNT; cell++) {
+        cells[cell] = BATCH_BLANK_CELL;
+    }
+}
+
+static bool batchCellChanged(const displayPort_t *displayPort, unsigned cell)
+{
+    return batch.canvas[cell] != batch.shown[cell]
+        || (cell / displayPort->cols == batch.refreshRow && batch.canvas[cell] != BATCH_BLANK_CELL);
+}
+
+static unsigned batchNextChangedCell(const displayPort_t *displayPort, unsigned cell, unsigned cellCount)
+{
+    while (cell < cellCount && !batchCellChanged(displayPort, cell)) {
+        cell++;
+    }
+    return cell;
+}
+#endif
+
 static int clearScreen(displayPort_t *displayPort, displayClearOption_e options)
 {
     UNUSED(options);
 
+#ifdef USE_MSP_DISPLAYPORT_BATCH
+    if (batch.enabled) {
+        // only the canvas, cells that stay blank aren't sent when the screen is drawn
+        batchBlank(batch.canvas);
+        return 0;
+    }
+#endif
+
     uint8_t subcmd[] = { MSP_DP_CLEAR_SCREEN };
 
     return output(displayPort, MSP_DISPLAYPORT, subcmd, sizeof(subcmd));
 }
 
+#ifdef USE_MSP_DISPLAYPORT_BATCH
+// Send the changed cells as runs of cells with the same attribute, returns true if the transmit buffer filled before
+// they were all sent and it should be called again
+static bool batchSendRuns(displayPort_t *displayPort)
+{
+    const unsigned cellCount = displayPort->rows * displayPort->cols;
+    uint8_t frame[DISPLAYPORT_MSP_BATCH_FRAME_SIZE];
+    unsigned frameLength = 0;
+
+    for (unsigned cell = batchNextChangedCell(displayPort, batch.resumeCell, cellCount); cell < cellCount; cell = batchNextChangedCell(displayPort, cell, cellCount)) {
+        if (frameLength == 0) {
+            // leave room for the draw screen that follows
+            if (mspSerialTxBytesFree() < BATCH_FRAME_SPACE(sizeof(frame)) + BATCH_FRAME_SPACE(1)) {
+                batch.resumeCell = cell;
+                return true;
+            }
+            frame[frameLength++] = MSP_DP_WRITE_RUNS;
+        }
+
+        const uint8_t col = cell % displayPort->cols;
+        const uint8_t attr = batch.canvas[cell] >> 8;
+        const unsigned maxLength = MIN((unsigned)(displayPort->cols - col), sizeof(frame) - frameLength - DISPLAYPORT_MSP_BATCH_RUN_HEADER_SIZE);
+
+        // Unchanged cells between changed ones are sent along while that is shorter than starting another run
+        unsigned length = 1;
+        unsigned changedLength = 1;
+        while (length < maxLength && (batch.canvas[cell + length] >> 8) == attr && length - changedLength < DISPLAYPORT_MSP_BATCH_RUN_HEADER_SIZE) {
+            if (batchCellChanged(displayPort, cell + length)) {
+                changedLength = length + 1;
+            }
+            length++;
+        }
+
+        frame[frameLength++] = cell / displayPort->cols;
+        frame[frameLength++] = col;
+        frame[frameLength++] = attr;
+        frame[frameLength++] = changedLength;
+        for (unsigned i = 0; i < changedLength; i++, cell++) {
+            frame[frameLength++] = batch.canvas[cell] & 0xff;
+            batch.shown[cell] = batch.canvas[cell];
+        }
+
+        if (frameLength + DISPLAYPORT_MSP_BATCH_RUN_HEADER_SIZE >= sizeof(frame)) {
+            output(displayPort, MSP_DISPLAYPORT, frame, frameLength);
+            frameLength = 0;
+        }
+    }
+
+    if (frameLength) {
+        output(displayPort, MSP_DISPLAYPORT, frame, frameLength);
+    }
+    batch.resumeCell = 0;
+
+    return false;
+}
+#endif
+
 static bool drawScreen(displayPort_t *displayPort)
 {
+#ifdef USE_MSP_DISPLAYPORT_BATCH
+    if (batch.enabled) {
+        if (batch.clearPending) {
+            if (mspSerialTxBytesFree() < BATCH_FRAME_SPACE(1)) {
+                return true;
+            }
+            uint8_t subcmd[] = { MSP_DP_CLEAR_SCREEN };
+            output(displayPort, MSP_DISPLAYPORT, subcmd, sizeof(subcmd));
+            batchBlank(batch.shown);
+            batch.resumeCell = 0;
+            batch.clearPending = false;
+        }
+
+        if (batchSendRuns(displayPort)) {
+            return true;
+        }
+    }
+#endif
+
     uint8_t subcmd[] = { MSP_DP_DRAW_SCREEN };
     output(displayPort, MSP_DISPLAYPORT, subcmd, sizeof(subcmd));
 
+#ifdef USE_MSP_DISPLAYPORT_BATCH
+    if (batch.enabled) {
+        // A row is sent again with each frame, so a display that lost its contents is repainted within a few seconds
+        batch.refreshRow = (batch.refreshRow + 1) % displayPort->rows;
+    }
+#endif
+
     return 0;
 }
 
@@ -108,8 +247,34 @@ static int screenSize(const displayPort_t *displayPort)
     return displayPort->rows * displayPort->cols;
 }
 
+static uint8_t mspAttribute(uint8_t attr)
+{
+    uint8_t mspAttr = displayPortProfileMsp()->fontSelection[attr & (DISPLAYPORT_SEVERITY_COUNT - 1)] & DISPLAYPORT_MSP_ATTR_FONT;
+
+    if (attr & DISPLAYPORT_BLINK) {
+        mspAttr |= DISPLAYPORT_MSP_ATTR_BLINK;
+    }
+
+    return mspAttr;
+}
+
 static int writeString(displayPort_t *displayPort, uint8_t col, uint8_t row, uint8_t attr, const char *string)
 {
+#ifdef USE_MSP_DISPLAYPORT_BATCH
+    if (batch.enabled) {
+        if (row >= displayPort->rows) {
+            return 0;
+        }
+
+        const uint16_t attrBits = mspAttribute(attr) << 8;
+        for (unsigned cell = row * displayPort->cols + col; col < displayPort->cols && *string; col++, cell++) {
+            batch.canvas[cell] = attrBits | (uint8_t)*string++;
+        }
+
+        return 0;
+    }
+#endif
+
 #define MSP_OSD_MAX_STRING_LENGTH 30 // FIXME move this
     uint8_t buf[MSP_OSD_MAX_STRING_LENGTH + 4];
 
@@ -121,11 +286,7 @@ static int writeString(displayPort_t *displayPort, uint8_t col, uint8_t row, uin
     buf[0] = MSP_DP_WRITE_STRING;
     buf[1] = row;
     buf[2] = col;
-    buf[3] = displayPortProfileMsp()->fontSelection[attr & (DISPLAYPORT_SEVERITY_COUNT - 1)] & DISPLAYPORT_MSP_ATTR_FONT;
-
-    if (attr & DISPLAYPORT_BLINK) {
-        buf[3] |= DISPLAYPORT_MSP_ATTR_BLINK;
-    }
+    buf[3] = mspAttribute(attr);
 
     memcpy(&buf[4], string, len);
 
@@ -167,6 +328,13 @@ static bool isSynced(const displayPort_t *displayPort)
 
 static void redraw(displayPort_t *displayPort)
 {
+#ifdef USE_MSP_DISPLAYPORT_BATCH
+    if (batch.enabled) {
+        // the display's contents aren't known, so clear it and send everything again
+        batch.clearPending = true;
+    }
+#endif
+
     drawScreen(displayPort);
 }
 
@@ -265,6 +433,15 @@ displayPort_t *displayPortMspInit(void)
         mspDisplayPort.cols = OSD_SD_COLS + displayPortProfileMsp()->colAdjust;
     }
 
+#ifdef USE_MSP_DISPLAYPORT_BATCH
+    const unsigned cellCount = mspDisplayPort.rows * mspDisplayPort.cols;
+    batch.enabled = displayPortProfileMsp()->batchWrites && cellCount > 0 && cellCount <= BATCH_CELL_COUNT;
+    if (batch.enabled) {
+        batchBlank(batch.canvas);
+        batch.refreshRow = 0;
+    }
+#endif
+
     redraw(&mspDisplayPort);
 
     return &mspDisplayPort;
@@ -38,6 +38,7 @@ typedef enum {
 #ifdef USE_MSP_DISPLAYPORT_FONT
     MSP_DP_FONTCHAR_WRITE = 7,  // New OSD chip works over MSP, enables font write over MSP
 #endif
+    MSP_DP_WRITE_RUNS = 8,      // Write runs of characters, each as row, col, attribute, length and the characters
     MSP_DP_COUNT,
 } displayportMspCommand_e;
 
@@ -47,6 +48,11 @@ typedef enum {
 #define DISPLAYPORT_MSP_ATTR_FONT    (BIT(0) | BIT(1)) // Select bank of 256 characters as per displayPortSeverity_e
 #define DISPLAYPORT_MSP_ATTR_MASK    (DISPLAYPORT_MSP_ATTR_VERSION | DISPLAYPORT_MSP_ATTR_BLINK | DISPLAYPORT_MSP_ATTR_FONT)
 
+// With displayport_msp_batch_writes on, writes are kept in a canvas mirroring the display and only the cells that
+// changed are sent when the screen is drawn, packed into MSP_DP_WRITE_RUNS frames of up to this many bytes
+#define DISPLAYPORT_MSP_BATCH_FRAME_SIZE 128
+#define DISPLAYPORT_MSP_BATCH_RUN_HEADER_SIZE 4
+
 struct displayPort_s *displayPortMspInit(void);
 void displayPortMspSetSerial(serialPortIdentifier_e serialPort);
 serialPortIdentifier_e displayPortMspGetSerial(void);
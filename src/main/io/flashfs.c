@@ -28,10 +28,13 @@
  * Note that bits can only be set to 0 when writing, not back to 1 from 0. You must erase sectors in order
  * to bring bits back to 1 again.
  *
+ * The last sector of the partition is kept back for an index of the logs on the volume, see "The log index" below.
+ *
  * In future, we can add support for multiple different flash chips by adding a flash device driver vtable
  * and make calls through that, at the moment flashfs just calls m25p16_* routines explicitly.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
@@ -41,6 +44,7 @@
 #if defined(USE_FLASHFS)
 
 #include "build/debug.h"
+#include "common/crc.h"
 #include "common/maths.h"
 #include "common/printf.h"
 #include "drivers/flash/flash.h"
@@ -86,6 +90,9 @@ static volatile bool dataWritten = true;
 // The position of the buffer's tail in the overall flash address space:
 static uint32_t tailAddress = 0;
 
+static void flashfsIndexReset(void);
+static bool flashfsIndexFlush(bool sync);
+
 #ifdef USE_FLASH_TEST_PRBS
 // Write an incrementing sequence of bytes instead of the requested data and verify
 static DMA_DATA uint8_t checkFlashBuffer[FLASHFS_WRITE_BUFFER_SIZE];
@@ -179,6 +186,8 @@ void flashfsEraseCompletely(void)
     flashfsClearBuffer();
 
     flashfsSetTailAddress(0);
+
+    flashfsIndexReset();
 }
 
 /**
@@ -306,6 +315,11 @@ static uint32_t flashfsWriteBuffers(uint8_t const **buffers, uint32_t *bufferSiz
 
     // It's OK to overwrite the buffer addresses/lengths being passed in
 
+    // Any queued index records are programmed first, a NAND page that is being loaded can't be left for another
+    if (!flashfsIndexFlush(sync)) {
+        return 0;
+    }
+
     // If sync is true, block until the FLASH device is ready, otherwise return 0 if the device isn't ready
     if (sync) {
         while (!flashIsReady());
@@ -397,6 +411,10 @@ bool flashfsFlushAsync(bool force)
     uint32_t bufferSizes[2];
     int bufCount;
 
+    if (!flashfsIndexFlush(false)) {
+        return false;
+    }
+
     if (flashfsBufferIsEmpty()) {
         return true; // Nothing to flush
     }
@@ -428,6 +446,8 @@ void flashfsFlushSync(void)
     uint32_t bufferSizes[2];
     int bufCount;
 
+    flashfsIndexFlush(true);
+
     if (flashfsBufferIsEmpty()) {
         return; // Nothing to flush
     }
@@ -496,23 +516,72 @@ void flashfsWriteByte(uint8_t byte)
     }
 }
 
+/**
+ * Copy as much of the given data into the buffer as it has room for, in at most two copies either side of the
+ * end of the circular buffer. Returns the number of bytes buffered.
+ */
+static uint32_t flashfsBufferData(const uint8_t *data, uint32_t len)
+{
+    const uint32_t count = MIN(len, flashfsGetWriteBufferFreeSpace());
+    const uint32_t toEnd = FLASHFS_WRITE_BUFFER_SIZE - bufferHead;
+
+    if (count <= toEnd) {
+        memcpy(&flashWriteBuffer[bufferHead], data, count);
+    } else {
+        memcpy(&flashWriteBuffer[bufferHead], data, toEnd);
+        memcpy(flashWriteBuffer, data + toEnd, count - toEnd);
+    }
+    bufferHead = (bufferHead + count) % FLASHFS_WRITE_BUFFER_SIZE;
+
+    return count;
+}
+
 /**
  * Write the given buffer to the flash either synchronously or asynchronously depending on the 'sync' parameter.
  *
  * If writing asynchronously, data will be silently discarded if the buffer overflows.
  * If writing synchronously, the routine will block waiting for the flash to become ready so will never drop data.
+ *
+ * Returns the number of bytes accepted, which is only less than `len` if the end was discarded.
  */
-void flashfsWrite(const uint8_t *data, unsigned int len, bool sync)
+uint32_t flashfsWrite(const uint8_t *data, unsigned int len, bool sync)
 {
+    const unsigned int requested = len;
     uint8_t const * buffers[2];
     uint32_t bufferSizes[2];
     int bufCount;
     uint32_t totalBufSize;
 
+#ifdef USE_FLASH_TEST_PRBS
+    if (debugMode == DEBUG_FLASH_TEST_PRBS || checkFlashActive) {
+        // The test pattern replaces the data byte by byte
+        for (unsigned int i = 0; i < len; i++) {
+            flashfsWriteByte(data[i]);
+        }
+        len = 0;
+    }
+#endif
+
     // Buffer up the data the user supplied instead of writing it right away
-    for (unsigned int i = 0; i < len; i++) {
-        flashfsWriteByte(data[i]);
+    while (len > 0) {
+        const uint32_t buffered = flashfsBufferData(data, len);
+        data += buffered;
+        len -= buffered;
+
+        if (flashfsTransmitBufferUsed() >= FLASHFS_WRITE_BUFFER_AUTO_FLUSH_LEN) {
+            flashfsFlushAsync(false);
+        }
+
+        if (len > 0 && flashfsGetWriteBufferFreeSpace() == 0) {
+            if (sync) {
+                flashfsFlushSync();
+            }
+            if (flashfsGetWriteBufferFreeSpace() == 0) {
+                break; // dropped, or the volume is full
+            }
+        }
     }
+    const uint32_t accepted = requested - len;
 
     // There could be two dirty buffers to write out already:
     bufCount = flashfsGetDirtyDataBuffers(buffers, bufferSizes);
@@ -525,6 +594,8 @@ void flashfsWrite(const uint8_t *data, unsigned int len, bool sync)
     if (bufCount && (totalBufSize >= FLASHFS_WRITE_BUFFER_AUTO_FLUSH_LEN)) {
         flashfsWriteBuffers(buffers, bufferSizes, bufCount, sync);
     }
+
+    return accepted;
 }
 
 /**
@@ -551,17 +622,17 @@ int flashfsReadAbs(uint32_t address, uint8_t *buffer, unsigned int len)
 }
 
 /**
- * Find the offset of the start of the free space on the device (or the size of the device if it is full).
+ * Find the offset of the start of the free space on the device (or the size of the device if it is full), assuming
+ * that everything before `start` is in use.
  */
-int flashfsIdentifyStartOfFreeSpace(void)
+static uint32_t flashfsSearchStartOfFreeSpace(uint32_t start)
 {
     /* Find the start of the free space on the device by examining the beginning of blocks with a binary search,
      * looking for ones that appear to be erased. We can achieve this with good accuracy because an erased block
      * is all bits set to 1, which pretty much never appears in reasonable size substrings of blackbox logs.
      *
-     * To do better we might write a volume header instead, which would mark how much free space remains. But keeping
-     * a header up to date while logging would incur more writes to the flash, which would consume precious write
-     * bandwidth and block more often.
+     * The log index makes this unnecessary except for volumes written without one, and for recovering the end of a
+     * log which was cut short by a power loss.
      */
 
     enum {
@@ -582,7 +653,7 @@ int flashfsIdentifyStartOfFreeSpace(void)
         uint32_t ints[FREE_BLOCK_TEST_SIZE_INTS];
     } testBuffer;
 
-    int left = 0; // Smallest block index in the search region
+    int left = start / FREE_BLOCK_SIZE; // Smallest block index in the search region
     int right = flashfsSize / FREE_BLOCK_SIZE; // One past the largest block index in the search region
     int mid;
     int result = right;
@@ -618,7 +689,434 @@ int flashfsIdentifyStartOfFreeSpace(void)
         }
     }
 
-    return result * FREE_BLOCK_SIZE;
+    return MIN((uint32_t)result * FREE_BLOCK_SIZE, flashfsSize);
+}
+
+/*
+ * The log index
+ *
+ * The last sector of the partition holds a journal of where each log begins and ends, so that the start of the free
+ * space is known at boot without searching the volume and the logs can be listed without parsing them. Records are
+ * only ever appended to the erased sector, which is erased along with the rest of the volume:
+ *
+ *     slot 0:        header
+ *     slot 2n + 1:   FLASHFS_INDEX_RECORD_BEGIN of log n, written by flashfsBeginLog()
+ *     slot 2n + 2:   FLASHFS_INDEX_RECORD_END of log n, written by flashfsEndLog()
+ *
+ * A slot is one record on NOR flash, and a whole page on NAND flash since a NAND page may only be programmed once. On
+ * NAND the record sits at the end of its page, so loading it has the chip program the page without a separate flush.
+ *
+ * Records are queued and programmed by the normal asynchronous flush ahead of any buffered log data, so beginning and
+ * ending a log doesn't wait for the flash.
+ *
+ * If the power is lost while logging, the end of the log is found by searching for free space from its start at the
+ * next boot and its end record is written then. Once the index is full, the logs that follow are found by searching
+ * from the end of the last indexed log as before.
+ */
+
+#define FLASHFS_INDEX_SECTORS   1
+#define FLASHFS_INDEX_MAGIC     0x58494642 // "BFIX"
+#define FLASHFS_INDEX_VERSION   1
+#define FLASHFS_INDEX_QUEUE_SIZE 3 // The records indexing a volume written without one
+
+typedef enum {
+    FLASHFS_INDEX_RECORD_HEADER = 1,
+    FLASHFS_INDEX_RECORD_BEGIN,
+    FLASHFS_INDEX_RECORD_END,
+} flashfsIndexRecordType_e;
+
+typedef struct flashfsIndexRecord_s {
+    uint8_t type;       // flashfsIndexRecordType_e
+    uint8_t crc;        // crc8_dvb_s2 of the record without this field
+    uint16_t number;    // log number, or FLASHFS_INDEX_VERSION in the header
+    uint32_t address;   // offset in the volume, or FLASHFS_INDEX_MAGIC in the header
+} flashfsIndexRecord_t;
+
+typedef enum {
+    FLASHFS_INDEX_SLOT_ERASED,
+    FLASHFS_INDEX_SLOT_VALID,
+    FLASHFS_INDEX_SLOT_CORRUPT,
+} flashfsIndexSlot_e;
+
+typedef enum {
+    FLASHFS_INDEX_NONE,     // no room for an index, or its sector holds logs written without one
+    FLASHFS_INDEX_EMPTY,    // erased, the header is written along with the first log
+    FLASHFS_INDEX_READY,
+} flashfsIndexState_e;
+
+static flashfsIndexState_e indexState = FLASHFS_INDEX_NONE;
+static uint32_t indexAddress = 0;
+static uint32_t indexSlotSize = 0;
+static uint16_t indexSlotCount = 0;
+static uint16_t indexSlotNext = 0; // The first erased slot
+static uint32_t indexEndAddress = 0; // Where the last indexed log ended
+static bool logOpen = false;
+
+typedef struct flashfsIndexQueued_s {
+    uint16_t slot;
+    flashfsIndexRecord_t record;
+} flashfsIndexQueued_t;
+
+// Records waiting to be programmed, the first is advanced by the write callback
+static flashfsIndexQueued_t indexQueue[FLASHFS_INDEX_QUEUE_SIZE];
+static volatile uint8_t indexQueueFirst = 0;
+static uint8_t indexQueueEnd = 0;
+
+static uint8_t flashfsIndexRecordCrc(const flashfsIndexRecord_t *record)
+{
+    const uint8_t crc = crc8_dvb_s2(0, record->type);
+
+    return crc8_dvb_s2_update(crc, &record->number, sizeof(*record) - offsetof(flashfsIndexRecord_t, number));
+}
+
+static uint32_t flashfsIndexSlotAddress(uint16_t slot)
+{
+    return indexAddress + (slot + 1) * indexSlotSize - sizeof(flashfsIndexRecord_t);
+}
+
+static flashfsIndexSlot_e flashfsIndexRead(uint16_t slot, flashfsIndexRecord_t *record)
+{
+    for (unsigned i = indexQueueFirst; i < indexQueueEnd; i++) {
+        if (indexQueue[i].slot == slot) {
+            *record = indexQueue[i].record;
+            return FLASHFS_INDEX_SLOT_VALID;
+        }
+    }
+
+    if (flashReadBytes(flashfsIndexSlotAddress(slot), (uint8_t *)record, sizeof(*record)) < (int)sizeof(*record)) {
+        // Treat an unreadable slot as used so that it is never programmed again
+        return FLASHFS_INDEX_SLOT_CORRUPT;
+    }
+
+    const uint8_t *bytes = (const uint8_t *)record;
+    bool erased = true;
+    for (unsigned i = 0; i < sizeof(*record); i++) {
+        if (bytes[i] != 0xFF) {
+            erased = false;
+            break;
+        }
+    }
+
+    if (erased) {
+        return FLASHFS_INDEX_SLOT_ERASED;
+    }
+
+    return record->crc == flashfsIndexRecordCrc(record) ? FLASHFS_INDEX_SLOT_VALID : FLASHFS_INDEX_SLOT_CORRUPT;
+}
+
+/**
+ * Returns the address held by the record in the given slot if it is intact and of the given type, otherwise `fallback`.
+ */
+static uint32_t flashfsIndexReadAddress(uint16_t slot, flashfsIndexRecordType_e type, uint32_t fallback)
+{
+    flashfsIndexRecord_t record;
+
+    if (flashfsIndexRead(slot, &record) == FLASHFS_INDEX_SLOT_VALID && record.type == type) {
+        return record.address;
+    }
+
+    return fallback;
+}
+
+static void flashfsIndexWriteCallback(uintptr_t arg)
+{
+    UNUSED(arg);
+
+    indexQueueFirst++;
+
+    // Log data may follow now
+    dataWritten = true;
+}
+
+/**
+ * Program the queued index records. Unless `sync`, this only starts programming the next record if the flash is idle.
+ *
+ * Returns true once every queued record has been programmed.
+ */
+static bool flashfsIndexFlush(bool sync)
+{
+    while (indexQueueFirst < indexQueueEnd) {
+        // A previous write, of a record or of log data, has to have completed
+        if (!flashfsNewData() || !flashIsReady()) {
+            if (sync) {
+                continue;
+            }
+            return false;
+        }
+
+        const flashfsIndexQueued_t *queued = &indexQueue[indexQueueFirst];
+
+        dataWritten = false;
+        flashPageProgram(flashfsIndexSlotAddress(queued->slot), (const uint8_t *)&queued->record, sizeof(queued->record), flashfsIndexWriteCallback);
+
+        if (!sync) {
+            break;
+        }
+    }
+
+    return indexQueueFirst == indexQueueEnd;
+}
+
+static void flashfsIndexWrite(flashfsIndexRecordType_e type, uint16_t number, uint32_t address)
+{
+    if (indexQueueFirst == indexQueueEnd) {
+        indexQueueFirst = indexQueueEnd = 0;
+    }
+
+    if (indexQueueEnd == FLASHFS_INDEX_QUEUE_SIZE) {
+        // Not expected, a log queues at most two records at a time
+        flashfsIndexFlush(true);
+        indexQueueFirst = indexQueueEnd = 0;
+    }
+
+    flashfsIndexQueued_t *queued = &indexQueue[indexQueueEnd];
+
+    queued->slot = indexSlotNext++;
+    queued->record = (flashfsIndexRecord_t) {
+        .type = type,
+        .number = number,
+        .address = address,
+    };
+    queued->record.crc = flashfsIndexRecordCrc(&queued->record);
+
+    indexQueueEnd++;
+}
+
+static bool flashfsIndexHasRoomForLog(void)
+{
+    // A begin and an end record, after the header if that hasn't been written yet
+    const int slotsNeeded = (indexState == FLASHFS_INDEX_EMPTY) ? 3 : 2;
+
+    return indexState != FLASHFS_INDEX_NONE && indexSlotNext + slotsNeeded <= indexSlotCount;
+}
+
+static uint16_t flashfsIndexFindNextSlot(void)
+{
+    flashfsIndexRecord_t record;
+
+    // Slots are programmed in order, so the ones in use are followed by the erased ones
+    uint16_t left = 1;
+    uint16_t right = indexSlotCount;
+
+    while (left < right) {
+        const uint16_t mid = (left + right) / 2;
+
+        if (flashfsIndexRead(mid, &record) == FLASHFS_INDEX_SLOT_ERASED) {
+            right = mid;
+        } else {
+            left = mid + 1;
+        }
+    }
+
+    return left;
+}
+
+static uint32_t flashfsIndexLogStart(int index)
+{
+    // Logs follow one another, so if the begin record was lost the log started where the previous one ended
+    const uint32_t previousEnd = index > 0 ? flashfsIndexReadAddress(2 * index, FLASHFS_INDEX_RECORD_END, 0) : 0;
+
+    return flashfsIndexReadAddress(2 * index + 1, FLASHFS_INDEX_RECORD_BEGIN, previousEnd);
+}
+
+static void flashfsIndexBeginLog(void)
+{
+    if (!flashfsIndexHasRoomForLog()) {
+        return;
+    }
+
+    if (indexState == FLASHFS_INDEX_EMPTY) {
+        flashfsIndexWrite(FLASHFS_INDEX_RECORD_HEADER, FLASHFS_INDEX_VERSION, FLASHFS_INDEX_MAGIC);
+        indexState = FLASHFS_INDEX_READY;
+    }
+
+    flashfsIndexWrite(FLASHFS_INDEX_RECORD_BEGIN, indexSlotNext / 2, flashfsGetOffset());
+}
+
+static void flashfsIndexEndLog(uint32_t address)
+{
+    // Only if the begin record of this log was written, leaving its end record slot next
+    if (indexState == FLASHFS_INDEX_READY && (indexSlotNext % 2) == 0) {
+        flashfsIndexWrite(FLASHFS_INDEX_RECORD_END, indexSlotNext / 2 - 1, address);
+        indexEndAddress = address;
+    }
+}
+
+static void flashfsIndexReset(void)
+{
+    // Let a record being programmed complete, the ones still queued belonged to the erased logs
+    while (!flashfsNewData());
+    indexQueueFirst = indexQueueEnd = 0;
+
+    indexState = indexSlotCount > 0 ? FLASHFS_INDEX_EMPTY : FLASHFS_INDEX_NONE;
+    indexSlotNext = 0;
+    indexEndAddress = 0;
+    logOpen = false;
+}
+
+/**
+ * Set aside the index sector at the end of the partition and find out where the last indexed log ended.
+ */
+static void flashfsIndexInit(void)
+{
+    const uint32_t indexSize = FLASHFS_INDEX_SECTORS * flashGeometry->sectorSize;
+
+    indexSlotCount = 0;
+    if (flashfsSize > indexSize) {
+        flashfsSize -= indexSize;
+
+        indexAddress = flashPartition->startSector * flashGeometry->sectorSize + flashfsSize;
+        indexSlotSize = (flashGeometry->flashType == FLASH_TYPE_NAND) ? flashGeometry->pageSize : sizeof(flashfsIndexRecord_t);
+        indexSlotCount = MIN(indexSize / indexSlotSize, (uint32_t)UINT16_MAX);
+    }
+
+    flashfsIndexReset();
+
+    if (indexState == FLASHFS_INDEX_NONE) {
+        return;
+    }
+
+    flashfsIndexRecord_t header;
+
+    switch (flashfsIndexRead(0, &header)) {
+    case FLASHFS_INDEX_SLOT_ERASED: {
+        // Either a freshly erased volume or one written by firmware without the index
+        const uint32_t end = flashfsSearchStartOfFreeSpace(0);
+
+        if (end >= flashfsSize) {
+            // The logs may well have run on into the index sector, so it can't be used until the next erase
+            indexState = FLASHFS_INDEX_NONE;
+        } else if (end > 0) {
+            // Index what is already there as a single log
+            flashfsIndexWrite(FLASHFS_INDEX_RECORD_HEADER, FLASHFS_INDEX_VERSION, FLASHFS_INDEX_MAGIC);
+            flashfsIndexWrite(FLASHFS_INDEX_RECORD_BEGIN, 0, 0);
+            flashfsIndexWrite(FLASHFS_INDEX_RECORD_END, 0, end);
+            indexState = FLASHFS_INDEX_READY;
+            indexEndAddress = end;
+        }
+        break;
+    }
+
+    case FLASHFS_INDEX_SLOT_VALID:
+        if (header.type != FLASHFS_INDEX_RECORD_HEADER || header.address != FLASHFS_INDEX_MAGIC || header.number != FLASHFS_INDEX_VERSION) {
+            indexState = FLASHFS_INDEX_NONE;
+            break;
+        }
+
+        indexState = FLASHFS_INDEX_READY;
+        indexSlotNext = flashfsIndexFindNextSlot();
+
+        const int logCount = flashfsGetLogCount();
+        if (logCount > 0) {
+            const uint32_t lastLogStart = flashfsIndexLogStart(logCount - 1);
+
+            if ((indexSlotNext % 2) == 0) {
+                // The power was lost before the last log was ended
+                flashfsIndexEndLog(flashfsSearchStartOfFreeSpace(lastLogStart));
+            } else {
+                indexEndAddress = flashfsIndexReadAddress(indexSlotNext - 1, FLASHFS_INDEX_RECORD_END, UINT32_MAX);
+                if (indexEndAddress == UINT32_MAX) {
+                    indexEndAddress = flashfsSearchStartOfFreeSpace(lastLogStart);
+                }
+            }
+        }
+        break;
+
+    default:
+        indexState = FLASHFS_INDEX_NONE;
+        break;
+    }
+
+    // Nothing is logged yet at boot, so get any records written to the index straight away
+    flashfsIndexFlush(true);
+}
+
+/**
+ * Find the offset of the start of the free space on the device (or the size of the device if it is full).
+ */
+int flashfsIdentifyStartOfFreeSpace(void)
+{
+    switch (indexState) {
+    case FLASHFS_INDEX_EMPTY:
+        return 0;
+
+    case FLASHFS_INDEX_READY:
+        // Logs that didn't fit in the index follow the last one that did
+        return flashfsIndexHasRoomForLog() ? indexEndAddress : flashfsSearchStartOfFreeSpace(indexEndAddress);
+
+    default:
+        return flashfsSearchStartOfFreeSpace(0);
+    }
+}
+
+/**
+ * Returns the number of logs in the index, including the one being written.
+ */
+int flashfsGetLogCount(void)
+{
+    return indexState == FLASHFS_INDEX_READY ? indexSlotNext / 2 : 0;
+}
+
+/**
+ * Get the extent of the log with the given index, from the oldest at 0 to flashfsGetLogCount() - 1.
+ */
+bool flashfsGetLog(int index, flashfsLog_t *log)
+{
+    const int logCount = flashfsGetLogCount();
+
+    if (index < 0 || index >= logCount) {
+        return false;
+    }
+
+    log->start = flashfsIndexLogStart(index);
+
+    if (index == logCount - 1) {
+        // Still being written if it hasn't got an end record yet
+        log->end = (indexSlotNext % 2) == 0 ? flashfsGetOffset() : indexEndAddress;
+    } else {
+        const uint32_t nextStart = flashfsIndexReadAddress(2 * index + 3, FLASHFS_INDEX_RECORD_BEGIN, indexEndAddress);
+        log->end = flashfsIndexReadAddress(2 * index + 2, FLASHFS_INDEX_RECORD_END, nextStart);
+    }
+
+    return true;
+}
+
+/**
+ * Call before writing a log, to record where it begins.
+ */
+void flashfsBeginLog(void)
+{
+    if (logOpen) {
+        return;
+    }
+
+    logOpen = true;
+
+    flashfsIndexBeginLog();
+}
+
+/**
+ * Flush and close the log being written and queue the record of where it ends, which the following calls of
+ * flashfsFlushAsync() write. Keep calling until this returns true, which it also does once the log is closed.
+ */
+bool flashfsEndLog(void)
+{
+    if (!logOpen) {
+        return true;
+    }
+
+    // Whatever is still buffered once the volume is full is lost
+    if (!flashfsFlushAsync(true) && !flashfsIsEOF()) {
+        return false;
+    }
+
+    logOpen = false;
+
+    flashfsClose();
+
+    flashfsIndexEndLog(tailAddress);
+
+    return true;
 }
 
 /**
@@ -665,6 +1163,8 @@ void flashfsInit(void)
 
     flashfsSize = FLASH_PARTITION_SECTOR_COUNT(flashPartition) * flashGeometry->sectorSize;
 
+    flashfsIndexInit();
+
     // Start the file pointer off at the beginning of free space so caller can start writing immediately
     flashfsSeekAbs(flashfsIdentifyStartOfFreeSpace());
 }
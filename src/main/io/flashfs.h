@@ -26,6 +26,11 @@
 // Automatically trigger a flush when this much data is in the buffer
 #define FLASHFS_WRITE_BUFFER_AUTO_FLUSH_LEN 64
 
+typedef struct flashfsLog_s {
+    uint32_t start;
+    uint32_t end;
+} flashfsLog_t;
+
 void flashfsEraseCompletely(void);
 void flashfsEraseRange(uint32_t start, uint32_t end);
 
@@ -40,7 +45,7 @@ const struct flashGeometry_s* flashfsGetGeometry(void);
 void flashfsSeekAbs(uint32_t offset);
 
 void flashfsWriteByte(uint8_t byte);
-void flashfsWrite(const uint8_t *data, unsigned int len, bool sync);
+uint32_t flashfsWrite(const uint8_t *data, unsigned int len, bool sync);
 
 int flashfsReadAbs(uint32_t offset, uint8_t *data, unsigned int len);
 
@@ -49,6 +54,10 @@ void flashfsFlushSync(void);
 void flashfsEraseAsync(void);
 
 void flashfsClose(void);
+void flashfsBeginLog(void);
+bool flashfsEndLog(void);
+int flashfsGetLogCount(void);
+bool flashfsGetLog(int index, flashfsLog_t *log);
 void flashfsInit(void);
 bool flashfsIsSupported(void);
 
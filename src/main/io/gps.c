@@ -32,6 +32,7 @@
 #include "build/debug.h"
 
 #include "common/axis.h"
+#include "common/crc.h"
 #include "common/gps_conversion.h"
 #include "common/maths.h"
 #include "common/utils.h"
@@ -373,11 +374,13 @@ static void logErrorToPacketLog(void)
 #endif  // USE_DASHBOARD
 
 static void gpsNewData(uint16_t c);
+static void gpsNewNavData(void);
 #ifdef USE_GPS_NMEA
 static bool gpsNewFrameNMEA(char c);
 #endif
 #ifdef USE_GPS_UBLOX
 static bool gpsNewFrameUBLOX(uint8_t data);
+static uint32_t gpsWholeFrameUBLOX(const uint8_t *data, uint32_t count, bool *newPositionDataReceived);
 #endif
 
 static void gpsSetState(gpsState_e state)
@@ -1392,7 +1395,10 @@ void gpsUpdate(timeUs_t currentTimeUs)
         DEBUG_SET(DEBUG_GPS_CONNECTION, 7, serialRxBytesWaiting(gpsPort));
         static uint8_t wait = 0;
         static bool isFast = false;
-        while (serialRxBytesWaiting(gpsPort)) {
+        const uint8_t *data;
+        uint32_t count;
+        // Parse the received bytes in place, a span at a time
+        while ((count = serialReadSpan(gpsPort, &data))) {
             wait = 0;
             if (!isFast) {
                 rescheduleTask(TASK_SELF, TASK_PERIOD_HZ(TASK_GPS_RATE_FAST));
@@ -1401,8 +1407,26 @@ void gpsUpdate(timeUs_t currentTimeUs)
             if (cmpTimeUs(micros(), currentTimeUs) > GPS_RECV_TIME_MAX) {
                 break;
             }
-            // Add every byte to _buffer, when enough bytes are received, convert data to values
-            gpsNewData(serialRead(gpsPort));
+            for (uint32_t i = 0; i < count;) {
+#ifdef USE_GPS_UBLOX
+                // Whole UBX frames are parsed in one pass, anything else a byte at a time
+                if (gpsConfig()->provider == GPS_UBLOX) {
+                    DEBUG_SET(DEBUG_GPS_CONNECTION, 1, gpsSol.navIntervalMs);
+                    bool newPositionDataReceived;
+                    const uint32_t frameLength = gpsWholeFrameUBLOX(data + i, count - i, &newPositionDataReceived);
+                    if (frameLength) {
+                        if (newPositionDataReceived) {
+                            gpsNewNavData();
+                        }
+                        i += frameLength;
+                        continue;
+                    }
+                }
+#endif
+                // Add every byte to _buffer, when enough bytes are received, convert data to values
+                gpsNewData(data[i++]);
+            }
+            serialConsume(gpsPort, count);
         }
         if (wait < 1) {
             wait++;
@@ -1524,13 +1548,8 @@ void gpsUpdate(timeUs_t currentTimeUs)
 //    DEBUG_SET(DEBUG_GPS_CONNECTION, 6, (gpsStateDurationFractionUs[gpsCurrentState] >> GPS_TASK_DECAY_SHIFT));
 }
 
-static void gpsNewData(uint16_t c)
+static void gpsNewNavData(void)
 {
-    DEBUG_SET(DEBUG_GPS_CONNECTION, 1, gpsSol.navIntervalMs);
-    if (!gpsNewFrame(c)) {
-        // no new nav solution data
-        return;
-    }
     if (gpsData.state == GPS_STATE_RECEIVING_DATA) {
         DEBUG_SET(DEBUG_GPS_CONNECTION, 3, gpsData.now - gpsData.lastNavMessage); // interval since last Nav data was received
         gpsData.lastNavMessage = gpsData.now;
@@ -1541,6 +1560,16 @@ static void gpsNewData(uint16_t c)
     onGpsNewData();
 }
 
+static void gpsNewData(uint16_t c)
+{
+    DEBUG_SET(DEBUG_GPS_CONNECTION, 1, gpsSol.navIntervalMs);
+    if (!gpsNewFrame(c)) {
+        // no new nav solution data
+        return;
+    }
+    gpsNewNavData();
+}
+
 #ifdef USE_GPS_UBLOX
 static ubloxVersion_e ubloxParseVersion(const uint32_t version)
 {
@@ -2637,6 +2666,43 @@ static bool gpsNewFrameUBLOX(uint8_t data)
     // Note this function returns if UBLOX_parse_gps() found new position data, NOT whether this function successfully parsed the frame or not.
     return newPositionDataReceived;
 }
+
+#define UBX_FRAME_HEADER_SIZE   6   // preamble, class, ID and payload length
+#define UBX_FRAME_OVERHEAD      (UBX_FRAME_HEADER_SIZE + 2)
+
+// Parses a UBX frame starting at data in one pass if it has been received in full, returning its length.
+// Returns 0 to leave the bytes to gpsNewFrameUBLOX() if it is part way through a frame, or the frame is incomplete or corrupt.
+static uint32_t gpsWholeFrameUBLOX(const uint8_t *data, uint32_t count, bool *newPositionDataReceived)
+{
+    if (ubxFrameParseState != UBX_PARSE_PREAMBLE_SYNC_1 || count < UBX_FRAME_OVERHEAD
+        || data[0] != PREAMBLE1 || data[1] != PREAMBLE2) {
+        return 0;
+    }
+
+    const uint16_t payloadLength = data[4] | data[5] << 8;
+    const uint32_t frameLength = UBX_FRAME_OVERHEAD + payloadLength;
+    if (payloadLength > UBLOX_MAX_PAYLOAD_SANITY_SIZE || count < frameLength) {
+        return 0;
+    }
+
+    // The checksum covers the class, ID, payload length and payload
+    const uint16_t checksum = fletcher8_update(0, &data[2], UBX_FRAME_HEADER_SIZE - 2 + payloadLength);
+    if (checksum != (data[frameLength - 2] | data[frameLength - 1] << 8)) {
+        return 0;
+    }
+
+    ubxRcvMsgClass = data[2];
+    ubxRcvMsgID = data[3];
+    ubxRcvMsgPayloadLength = payloadLength;
+    memcpy(ubxRcvMsgPayload.rawBytes, &data[UBX_FRAME_HEADER_SIZE], MIN(payloadLength, UBLOX_PAYLOAD_SIZE));
+#ifdef USE_DASHBOARD
+    dashboardGpsPacketCount++;
+    shiftPacketLog();
+#endif
+    *newPositionDataReceived = UBLOX_parse_gps();
+
+    return frameLength;
+}
 #endif // USE_GPS_UBLOX
 
 static void gpsHandlePassthrough(uint8_t data)
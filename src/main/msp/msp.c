@@ -33,6 +33,7 @@
 
 #include "build/build_config.h"
 #include "build/debug.h"
+#include "build/trace.h"
 #include "build/version.h"
 
 #include "cli/cli.h"
@@ -106,6 +107,7 @@
 #include "io/vtx.h"
 #include "io/vtx_msp.h"
 
+#include "msp/msp_batch.h"
 #include "msp/msp_box.h"
 #include "msp/msp_build_info.h"
 #include "msp/msp_protocol.h"
@@ -2627,6 +2629,60 @@ static mspResult_e mspFcProcessOutCommandWithArg(mspDescriptor_t srcDesc, int16_
             sbufWritePString(dst, textVar);
         }
         break;
+#if defined(USE_LATE_TASK_STATISTICS)
+    case MSP2_TASK_HISTOGRAM:
+        {
+            const taskId_e taskId = sbufBytesRemaining(src) ? sbufReadU8(src) : TASK_GYRO;
+            if (taskId >= TASK_COUNT) {
+                return MSP_RESULT_ERROR;
+            }
+
+            taskInfo_t taskInfo;
+            getTaskInfo(taskId, &taskInfo);
+
+            // task id, histogram count, bucket count then the counts of each histogram, see taskHistogram_e
+            sbufWriteU8(dst, taskId);
+            sbufWriteU8(dst, TASK_HISTOGRAM_COUNT);
+            sbufWriteU8(dst, TASK_HISTOGRAM_BUCKET_COUNT);
+            for (int i = 0; i < TASK_HISTOGRAM_COUNT; i++) {
+                for (int j = 0; j < TASK_HISTOGRAM_BUCKET_COUNT; j++) {
+                    sbufWriteU32(dst, taskInfo.histogram[i].count[j]);
+                }
+            }
+        }
+        break;
+#endif
+
+#ifdef USE_TRACE
+    case MSP2_TRACE_DUMP:
+        if (!traceDump(dst, src)) {
+            return MSP_RESULT_ERROR;
+        }
+        break;
+#endif
+
+#ifdef USE_FLASHFS
+    case MSP2_DATAFLASH_LOG_LIST:
+        {
+            const int logCount = flashfsGetLogCount();
+            const int firstLog = sbufBytesRemaining(src) >= 2 ? sbufReadU16(src) : 0;
+            const int maxLogs = (sbufBytesRemaining(dst) - 5) / 8;
+            const int count = constrain(logCount - firstLog, 0, MIN(maxLogs, UINT8_MAX));
+
+            // log count, first log index, number of logs in this reply then the start and end offset of each
+            sbufWriteU16(dst, logCount);
+            sbufWriteU16(dst, firstLog);
+            sbufWriteU8(dst, count);
+            for (int i = firstLog; i < firstLog + count; i++) {
+                flashfsLog_t log;
+                flashfsGetLog(i, &log);
+                sbufWriteU32(dst, log.start);
+                sbufWriteU32(dst, log.end);
+            }
+        }
+        break;
+#endif
+
 #ifdef USE_LED_STRIP
     case MSP2_GET_LED_STRIP_CONFIG_VALUES:
         sbufWriteU8(dst, ledStripConfig()->ledstrip_brightness);
@@ -4473,6 +4529,12 @@ mspResult_e mspFcProcessCommand(mspDescriptor_t srcDesc, mspPacket_t *cmd, mspPa
     } else if (cmdMSP == MSP_SET_PASSTHROUGH) {
         mspFcSetPassthroughCommand(dst, src, mspPostProcessFn);
         ret = MSP_RESULT_ACK;
+    } else if (cmdMSP == MSP2_BATCH) {
+        ret = mspBatchProcessCommand(srcDesc, src, dst, mspFcProcessCommand);
+#ifdef USE_MSP_STREAM
+    } else if (cmdMSP == MSP2_STREAM_SUBSCRIBE) {
+        ret = mspSerialStreamSubscribeCommand(srcDesc, src, dst);
+#endif
 #ifdef USE_FLASHFS
     } else if (cmdMSP == MSP_DATAFLASH_READ) {
         mspFcDataFlashReadCommand(dst, src);
@@ -4501,6 +4563,14 @@ static mspResult_e mspFcProcessOutCommand(mspDescriptor_t srcDesc, int16_t cmdMS
     return ret;
 }
 
+#ifdef USE_MSP_STREAM
+// Only the commands that report state without a payload can be streamed
+mspResult_e mspFcProcessStreamCommand(mspDescriptor_t srcDesc, mspPacket_t *cmd, mspPacket_t *reply, mspPostProcessFnPtr *mspPostProcessFn)
+{
+    return mspFcProcessOutCommand(srcDesc, cmd->cmd, reply, mspPostProcessFn);
+}
+#endif
+
 void mspFcProcessReply(mspPacket_t *reply)
 {
     sbuf_t *src = &reply->buf;
@@ -64,5 +64,8 @@ typedef void (*mspProcessReplyFnPtr)(mspPacket_t *cmd);
 void mspInit(void);
 mspResult_e mspFcProcessCommand(mspDescriptor_t srcDesc, mspPacket_t *cmd, mspPacket_t *reply, mspPostProcessFnPtr *mspPostProcessFn);
 void mspFcProcessReply(mspPacket_t *reply);
+#ifdef USE_MSP_STREAM
+mspResult_e mspFcProcessStreamCommand(mspDescriptor_t srcDesc, mspPacket_t *cmd, mspPacket_t *reply, mspPostProcessFnPtr *mspPostProcessFn);
+#endif
 
 mspDescriptor_t mspDescriptorAlloc(void);
@@ -0,0 +1,101 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+#include "common/streambuf.h"
+#include "common/utils.h"
+
+#include "msp/msp.h"
+#include "msp/msp_protocol.h"
+#include "msp/msp_protocol_v2_betaflight.h"
+#include "msp/msp_serial.h"
+
+#include "msp_batch.h"
+
+#define MSP_BATCH_REQUEST_HEADER_SIZE   4   // command, payload size
+#define MSP_BATCH_REPLY_HEADER_SIZE     5   // command, result, reply size
+
+// Commands which act after their reply is sent can't be run from a batch
+static bool mspBatchCommandAllowed(int16_t cmdMSP)
+{
+    switch (cmdMSP) {
+    case MSP_REBOOT:
+    case MSP_RESET_CONF:
+    case MSP_SET_PASSTHROUGH:
+    case MSP_MULTIPLE_MSP:
+    case MSP2_BATCH:
+        return false;
+    default:
+        return true;
+    }
+}
+
+/*
+ * MSP2_BATCH runs each command of the request in turn, the request being the command, payload size and payload of each.
+ * The reply has the command, result and reply size then the reply of each command run, ending early once the reply buffer is full.
+ * A command whose reply did not fit has still been run, it is the last one in the reply with MSP_RESULT_NO_REPLY and no data.
+ */
+mspResult_e mspBatchProcessCommand(mspDescriptor_t srcDesc, sbuf_t *src, sbuf_t *dst, mspProcessCommandFnPtr mspProcessCommandFn)
+{
+    static uint8_t replyBuf[MSP_PORT_OUTBUF_SIZE_MIN];
+
+    while (sbufBytesRemaining(src) >= MSP_BATCH_REQUEST_HEADER_SIZE && sbufBytesRemaining(dst) >= MSP_BATCH_REPLY_HEADER_SIZE) {
+        const int16_t cmdMSP = sbufReadU16(src);
+        const int payloadSize = sbufReadU16(src);
+        if (payloadSize > sbufBytesRemaining(src)) {
+            return MSP_RESULT_ERROR;
+        }
+
+        mspPacket_t cmd = {
+            .buf = { .ptr = sbufPtr(src), .end = sbufPtr(src) + payloadSize, },
+            .cmd = cmdMSP,
+            .direction = MSP_DIRECTION_REQUEST,
+        };
+        mspPacket_t reply = {
+            .buf = { .ptr = replyBuf, .end = ARRAYEND(replyBuf), },
+            .cmd = -1,
+            .direction = MSP_DIRECTION_REPLY,
+        };
+        sbufAdvance(src, payloadSize);
+
+        mspResult_e result = mspBatchCommandAllowed(cmdMSP) ? mspProcessCommandFn(srcDesc, &cmd, &reply, NULL) : MSP_RESULT_ERROR;
+        int replySize = sbufPtr(&reply.buf) - replyBuf;
+        const bool replyFits = MSP_BATCH_REPLY_HEADER_SIZE + replySize <= sbufBytesRemaining(dst);
+        if (!replyFits) {
+            result = MSP_RESULT_NO_REPLY;
+            replySize = 0;
+        }
+
+        sbufWriteU16(dst, cmdMSP);
+        sbufWriteU8(dst, result);
+        sbufWriteU16(dst, replySize);
+        sbufWriteData(dst, replyBuf, replySize);
+
+        if (!replyFits) {
+            break;
+        }
+    }
+    return MSP_RESULT_ACK;
+}
@@ -32,6 +32,11 @@
 #define MSP2_SENSOR_OPTICALFLOW             0x300B
 #define MSP2_MCU_INFO                       0x300C
 #define MSP2_GYRO_SENSOR_ACTIVE             0x300D
+#define MSP2_TASK_HISTOGRAM                 0x300E  // in: task id, out: task latency histograms
+#define MSP2_TRACE_DUMP                     0x300F  // in: traceDumpType_e and its argument, out: trace events or marker names
+#define MSP2_DATAFLASH_LOG_LIST             0x3010  // in: first log index, out: log count and the extents of the logs that fit
+#define MSP2_BATCH                          0x3011  // in: commands with their payloads, out: the result and reply of each that fits
+#define MSP2_STREAM_SUBSCRIBE               0x3012  // in: commands with the period to push each at, out: number of streams
 
 // MSP2_SET_TEXT and MSP2_GET_TEXT variable types
 #define MSP2TEXT_PILOT_NAME                      1
@@ -31,6 +31,7 @@
 #include "common/streambuf.h"
 #include "common/utils.h"
 #include "common/crc.h"
+#include "common/maths.h"
 
 #include "drivers/system.h"
 
@@ -42,8 +43,12 @@
 
 #include "pg/msp.h"
 
+#include "scheduler/scheduler.h"
+
 static mspPort_t mspPorts[MAX_MSP_PORT_COUNT];
 
+static uint8_t mspSerialOutBuf[MSP_PORT_OUTBUF_SIZE];
+
 static void resetMspPort(mspPort_t *mspPortToReset, serialPort_t *serialPort, bool sharedWithTelemetry)
 {
     memset(mspPortToReset, 0, sizeof(mspPort_t));
@@ -293,6 +298,69 @@ static void mspSerialProcessReceivedPacketData(mspPort_t *mspPort, uint8_t c)
     }
 }
 
+// Copies as much of the payload as is in data into inBuf, returning the number of bytes used
+static uint32_t mspSerialProcessReceivedPayload(mspPort_t *mspPort, const uint8_t *data, uint32_t count)
+{
+    const uint32_t len = MIN(count, (uint32_t)(mspPort->dataSize - mspPort->offset));
+
+    memcpy(&mspPort->inBuf[mspPort->offset], data, len);
+    mspPort->offset += len;
+
+    switch (mspPort->packetState) {
+    case MSP_PAYLOAD_V1:
+        mspPort->checksum1 = crc8_xor_update(mspPort->checksum1, data, len);
+        if (mspPort->offset == mspPort->dataSize) {
+            mspPort->packetState = MSP_CHECKSUM_V1;
+        }
+        break;
+
+    case MSP_PAYLOAD_V2_OVER_V1:
+        mspPort->checksum1 = crc8_xor_update(mspPort->checksum1, data, len);
+        mspPort->checksum2 = crc8_dvb_s2_update(mspPort->checksum2, data, len);
+        if (mspPort->offset == mspPort->dataSize) {
+            mspPort->packetState = MSP_CHECKSUM_V2_OVER_V1;
+        }
+        break;
+
+    case MSP_PAYLOAD_V2_NATIVE:
+        mspPort->checksum2 = crc8_dvb_s2_update(mspPort->checksum2, data, len);
+        if (mspPort->offset == mspPort->dataSize) {
+            mspPort->packetState = MSP_CHECKSUM_V2_NATIVE;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return len;
+}
+
+// Parses received bytes, returning the number used which stops short of count once a packet is received or rejected
+static uint32_t mspSerialProcessReceivedBytes(mspPort_t *mspPort, const uint8_t *data, uint32_t count)
+{
+    uint32_t used = 0;
+
+    while (used < count) {
+        switch (mspPort->packetState) {
+        case MSP_PAYLOAD_V1:
+        case MSP_PAYLOAD_V2_OVER_V1:
+        case MSP_PAYLOAD_V2_NATIVE:
+            used += mspSerialProcessReceivedPayload(mspPort, data + used, count - used);
+            break;
+
+        default:
+            mspSerialProcessReceivedPacketData(mspPort, data[used++]);
+            if (mspPort->packetState == MSP_COMMAND_RECEIVED || mspPort->packetState == MSP_IDLE) {
+                return used;
+            }
+            break;
+        }
+    }
+
+    return used;
+}
+
 static uint8_t mspSerialChecksumBuf(uint8_t checksum, const uint8_t *data, int len)
 {
     while (len-- > 0) {
@@ -411,12 +479,29 @@ static int mspSerialEncode(mspPort_t *msp, mspPacket_t *packet, mspVersion_e msp
     return mspSerialSendFrame(msp, hdrBuf, hdrLen, sbufPtr(&packet->buf), dataLen, crcBuf, crcLen);
 }
 
-static mspPostProcessFnPtr mspSerialProcessReceivedCommand(mspPort_t *msp, mspProcessCommandFnPtr mspProcessCommandFn)
+// Replies are sized to fit the TX buffer, as one bigger than it would be written over itself. Ports without a TX
+// buffer of their own (VCP) take a reply of any size.
+static uint32_t mspSerialReplySize(const mspPort_t *msp)
+{
+    const uint32_t txBufferSize = msp->port->txBufferSize;
+
+    if (txBufferSize == 0) {
+        return MSP_PORT_OUTBUF_SIZE;
+    }
+    return MIN(txBufferSize - 1 - MSP_MAX_HEADER_SIZE - MSP_MAX_CHECKSUM_SIZE, (uint32_t)MSP_PORT_OUTBUF_SIZE);
+}
+
+// A reply of any size can be queued behind those already in the TX buffer
+static bool mspSerialTxRoomForReply(const mspPort_t *msp)
 {
-    static uint8_t mspSerialOutBuf[MSP_PORT_OUTBUF_SIZE];
+    return isSerialTransmitBufferEmpty(msp->port)
+        || serialTxBytesFree(msp->port) >= MSP_MAX_HEADER_SIZE + mspSerialReplySize(msp) + MSP_MAX_CHECKSUM_SIZE;
+}
 
+static mspPostProcessFnPtr mspSerialProcessReceivedCommand(mspPort_t *msp, mspProcessCommandFnPtr mspProcessCommandFn)
+{
     mspPacket_t reply = {
-        .buf = { .ptr = mspSerialOutBuf, .end = ARRAYEND(mspSerialOutBuf), },
+        .buf = { .ptr = mspSerialOutBuf, .end = mspSerialOutBuf + mspSerialReplySize(msp), },
         .cmd = -1,
         .flags = 0,
         .result = 0,
@@ -489,14 +574,34 @@ static void mspSerialProcessReceivedReply(mspPort_t *msp, mspProcessReplyFnPtr m
     mspProcessReplyFn(&reply);
 }
 
+// Starts on the next packet if it has already arrived and the TX buffer has room to queue its reply behind those already sent
+static bool mspSerialPipelineNextPacket(mspPort_t *mspPort, unsigned packetCount)
+{
+    const uint8_t *data;
+
+    if (packetCount >= MSP_SERIAL_PIPELINE_DEPTH
+        || !mspSerialTxRoomForReply(mspPort)
+        || !serialReadSpan(mspPort->port, &data) || data[0] != '$') {
+        return false;
+    }
+
+    serialConsume(mspPort->port, 1);
+    mspPort->lastActivityMs = millis();
+    mspPort->packetState = MSP_HEADER_START;
+    return true;
+}
+
 static void mspProcessPacket(mspPort_t *mspPort, mspProcessCommandFnPtr mspProcessCommandFn, mspProcessReplyFnPtr mspProcessReplyFn)
 {
     mspPostProcessFnPtr mspPostProcessFn = NULL;
+    unsigned packetCount = 0;
 
-    while (serialRxBytesWaiting(mspPort->port)) {
-        const uint8_t c = serialRead(mspPort->port);
+    const uint8_t *data;
+    uint32_t count;
 
-        mspSerialProcessReceivedPacketData(mspPort, c);
+    while ((count = serialReadSpan(mspPort->port, &data))) {
+        // Parse in place, leaving any bytes after the packet for the next call
+        serialConsume(mspPort->port, mspSerialProcessReceivedBytes(mspPort, data, count));
 
         if (mspPort->packetState == MSP_COMMAND_RECEIVED) {
             if (mspPort->packetType == MSP_PACKET_COMMAND) {
@@ -505,8 +610,13 @@ static void mspProcessPacket(mspPort_t *mspPort, mspProcessCommandFnPtr mspProce
                 mspSerialProcessReceivedReply(mspPort, mspProcessReplyFn);
             }
 
-            // process one command at a time so as not to block
             mspPort->packetState = MSP_IDLE;
+            packetCount++;
+
+            // Requests sent back to back are all answered in this call, up to a limit so as not to block
+            if (!mspPostProcessFn && mspSerialPipelineNextPacket(mspPort, packetCount)) {
+                continue;
+            }
         }
 
         if (mspPort->packetState == MSP_IDLE) {
@@ -656,3 +766,172 @@ uint32_t mspSerialTxBytesFree(void)
 
     return ret;
 }
+
+#ifdef USE_MSP_STREAM
+static mspPort_t *mspSerialFindPort(mspDescriptor_t descriptor)
+{
+    for (mspPort_t *mspPort = mspPorts; mspPort < ARRAYEND(mspPorts); mspPort++) {
+        if (mspPort->port && mspPort->descriptor == descriptor) {
+            return mspPort;
+        }
+    }
+    return NULL;
+}
+
+// Adds, changes or with a period of 0 removes the stream of cmd pushed to the port the request came from
+static bool mspSerialStreamSubscribe(mspDescriptor_t descriptor, int16_t cmd, uint16_t periodMs)
+{
+    mspPort_t *mspPort = mspSerialFindPort(descriptor);
+
+    if (!mspPort) {
+        return false;
+    }
+
+    mspStream_t *stream = NULL;
+    for (mspStream_t *candidate = mspPort->streams; candidate < ARRAYEND(mspPort->streams); candidate++) {
+        if (candidate->periodMs && candidate->cmd == cmd) {
+            stream = candidate;
+            break;
+        }
+        if (!candidate->periodMs && !stream) {
+            stream = candidate;
+        }
+    }
+
+    if (periodMs == 0) {
+        if (stream && stream->cmd == cmd) {
+            stream->periodMs = 0;
+        }
+        return true;
+    }
+
+    if (!stream) {
+        return false;
+    }
+
+    stream->cmd = cmd;
+    stream->periodMs = MAX(periodMs, MSP_STREAM_PERIOD_MIN_MS);
+    // pushed with the MSP version of the subscribe request, which is MSPv2 native or over MSPv1
+    stream->mspVersion = mspPort->mspVersion;
+    stream->dueUs = micros();
+
+    return true;
+}
+
+static void mspSerialStreamUnsubscribeAll(mspDescriptor_t descriptor)
+{
+    mspPort_t *mspPort = mspSerialFindPort(descriptor);
+
+    if (mspPort) {
+        memset(mspPort->streams, 0, sizeof(mspPort->streams));
+    }
+}
+
+static int mspSerialStreamCount(mspDescriptor_t descriptor)
+{
+    const mspPort_t *mspPort = mspSerialFindPort(descriptor);
+    int count = 0;
+
+    if (mspPort) {
+        for (const mspStream_t *stream = mspPort->streams; stream < ARRAYEND(mspPort->streams); stream++) {
+            if (stream->periodMs) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+static bool mspSerialStreaming(void)
+{
+    for (mspPort_t *mspPort = mspPorts; mspPort < ARRAYEND(mspPorts); mspPort++) {
+        if (mspPort->port && mspSerialStreamCount(mspPort->descriptor)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * MSP2_STREAM_SUBSCRIBE has the command and period in ms of each reply to push to the port without it being requested,
+ * a period of 0 stops that push and no commands at all stop every push. The reply is the number of streams on the port.
+ * A command which can't be streamed is dropped when it is first due.
+ */
+mspResult_e mspSerialStreamSubscribeCommand(mspDescriptor_t srcDesc, sbuf_t *src, sbuf_t *dst)
+{
+    mspResult_e result = MSP_RESULT_ACK;
+
+    if (sbufBytesRemaining(src) == 0) {
+        mspSerialStreamUnsubscribeAll(srcDesc);
+    }
+    while (sbufBytesRemaining(src) >= 4) {
+        const int16_t cmdMSP = sbufReadU16(src);
+        const uint16_t periodMs = sbufReadU16(src);
+        if (!mspSerialStreamSubscribe(srcDesc, cmdMSP, periodMs)) {
+            result = MSP_RESULT_ERROR;
+        }
+    }
+
+    setTaskEnabled(TASK_MSP_STREAM, mspSerialStreaming());
+    sbufWriteU8(dst, mspSerialStreamCount(srcDesc));
+
+    return result;
+}
+
+/*
+ * Push the replies of the streams that are due, as though the host had sent the request.
+ *
+ * Called periodically by the scheduler, which stops calling it once there are no streams left. That includes streams
+ * dropped here and those of ports that have since been released.
+ */
+void mspSerialStreamProcess(timeUs_t currentTimeUs, mspProcessCommandFnPtr mspProcessCommandFn)
+{
+    for (mspPort_t *mspPort = mspPorts; mspPort < ARRAYEND(mspPorts); mspPort++) {
+        if (!mspPort->port || mspPort->portState == PORT_CLI_CMD || mspPort->portState == PORT_CLI_ACTIVE) {
+            continue;
+        }
+
+        for (mspStream_t *stream = mspPort->streams; stream < ARRAYEND(mspPort->streams); stream++) {
+            if (!stream->periodMs || cmpTimeUs(currentTimeUs, stream->dueUs) < 0) {
+                continue;
+            }
+
+            // A stream that is due waits for room rather than having its reply dropped
+            if (!mspSerialTxRoomForReply(mspPort)) {
+                break;
+            }
+
+            mspPacket_t command = {
+                .buf = { .ptr = NULL, .end = NULL, },
+                .cmd = stream->cmd,
+                .direction = MSP_DIRECTION_REQUEST,
+            };
+            mspPacket_t reply = {
+                .buf = { .ptr = mspSerialOutBuf, .end = mspSerialOutBuf + mspSerialReplySize(mspPort), },
+                .cmd = -1,
+                .direction = MSP_DIRECTION_REPLY,
+            };
+            uint8_t *outBufHead = reply.buf.ptr;
+
+            if (mspProcessCommandFn(mspPort->descriptor, &command, &reply, NULL) != MSP_RESULT_ACK) {
+                // Not a command that can be streamed
+                stream->periodMs = 0;
+                continue;
+            }
+
+            sbufSwitchToReader(&reply.buf, outBufHead);
+            mspSerialEncode(mspPort, &reply, stream->mspVersion);
+
+            // Keep to the period, but don't catch up with pushes missed while waiting for room
+            stream->dueUs += stream->periodMs * 1000;
+            if (cmpTimeUs(currentTimeUs, stream->dueUs) >= 0) {
+                stream->dueUs = currentTimeUs + stream->periodMs * 1000;
+            }
+        }
+    }
+
+    if (!mspSerialStreaming()) {
+        setTaskEnabled(TASK_MSP_STREAM, false);
+    }
+}
+#endif
@@ -87,6 +87,11 @@ typedef enum {
 #define MSP_PORT_OUTBUF_SIZE MSP_PORT_OUTBUF_SIZE_MIN // As of 2021/08/10 MSP_BOXNAMES generates a 307 byte response for page 1.
 #endif
 
+// Requests already received are answered in the same call while the TX buffer has room for another reply
+#ifndef MSP_SERIAL_PIPELINE_DEPTH
+#define MSP_SERIAL_PIPELINE_DEPTH 16
+#endif
+
 typedef struct __attribute__((packed)) {
     uint8_t size;
     uint8_t cmd;
@@ -103,6 +108,19 @@ typedef struct __attribute__((packed)) {
 } mspHeaderV2_t;
 
 #define MSP_MAX_HEADER_SIZE     9
+#define MSP_MAX_CHECKSUM_SIZE   2   // MSPv2 over MSPv1 has both checksums
+
+#ifdef USE_MSP_STREAM
+#define MSP_STREAM_COUNT            8   // replies each port can have pushed to it without being requested
+#define MSP_STREAM_PERIOD_MIN_MS    10  // period of the task pushing them
+
+typedef struct mspStream_s {
+    int16_t cmd;
+    uint16_t periodMs;                  // 0 when unused
+    mspVersion_e mspVersion;
+    timeUs_t dueUs;
+} mspStream_t;
+#endif
 
 struct serialPort_s;
 typedef struct mspPort_s {
@@ -122,6 +140,9 @@ typedef struct mspPort_s {
     uint8_t checksum2;
     bool sharedWithTelemetry;
     mspDescriptor_t descriptor;
+#ifdef USE_MSP_STREAM
+    mspStream_t streams[MSP_STREAM_COUNT];
+#endif
 } mspPort_t;
 
 void mspSerialInit(void);
@@ -133,3 +154,7 @@ void mspSerialReleaseSharedTelemetryPorts(void);
 mspDescriptor_t getMspSerialPortDescriptor(const serialPortIdentifier_e portIdentifier);
 int mspSerialPush(serialPortIdentifier_e port, uint8_t cmd, uint8_t *data, int datalen, mspDirection_e direction, mspVersion_e mspVersion);
 uint32_t mspSerialTxBytesFree(void);
+#ifdef USE_MSP_STREAM
+mspResult_e mspSerialStreamSubscribeCommand(mspDescriptor_t descriptor, sbuf_t *src, sbuf_t *dst);
+void mspSerialStreamProcess(timeUs_t currentTimeUs, mspProcessCommandFnPtr mspProcessCommandFn);
+#endif
@@ -34,6 +34,7 @@ typedef struct displayPortProfile_s {
 
     uint8_t fontSelection[DISPLAYPORT_SEVERITY_COUNT];
     uint8_t useDeviceBlink;    // Use device local blink capability
+    uint8_t batchWrites;       // Send only the changed cells, as MSP_DP_WRITE_RUNS, when the screen is drawn
 } displayPortProfile_t;
 
 PG_DECLARE(displayPortProfile_t, displayPortProfileMsp);
@@ -26,11 +26,65 @@
 
 #include "common/crc.h"
 #include "common/maths.h"
+#include "common/utils.h"
 
 #include "pg.h"
 
+// Open addressed hash of registry positions by PGN, each slot holds the position plus one so that zero marks an empty slot
+#define PG_INDEX_SIZE 256
+
+STATIC_ASSERT(PG_REGISTRY_INDEXED_MAX < PG_INDEX_SIZE, pg_index_too_small);
+
+typedef enum {
+    PG_INDEX_NOT_BUILT = 0,
+    PG_INDEX_BUILT,
+    PG_INDEX_UNAVAILABLE,
+} pgIndexState_e;
+
+static uint8_t pgIndex[PG_INDEX_SIZE];
+static pgIndexState_e pgIndexState = PG_INDEX_NOT_BUILT;
+
+static unsigned pgIndexSlot(pgn_t pgn)
+{
+    // Fibonacci hashing, the top 8 bits of the product
+    return ((uint32_t)pgn * 2654435769u) >> 24;
+}
+
+static void pgIndexBuild(void)
+{
+    if (PG_REGISTRY_SIZE > PG_REGISTRY_INDEXED_MAX) {
+        pgIndexState = PG_INDEX_UNAVAILABLE;
+        return;
+    }
+
+    memset(pgIndex, 0, sizeof(pgIndex));
+    PG_FOREACH(reg) {
+        unsigned slot = pgIndexSlot(pgN(reg));
+        while (pgIndex[slot]) {
+            slot = (slot + 1) % PG_INDEX_SIZE;
+        }
+        pgIndex[slot] = reg - __pg_registry_start + 1;
+    }
+    pgIndexState = PG_INDEX_BUILT;
+}
+
 const pgRegistry_t* pgFind(pgn_t pgn)
 {
+    if (pgIndexState == PG_INDEX_NOT_BUILT) {
+        // The registry is fixed at link time, so the index is built once on first use
+        pgIndexBuild();
+    }
+
+    if (pgIndexState == PG_INDEX_BUILT) {
+        for (unsigned slot = pgIndexSlot(pgn); pgIndex[slot]; slot = (slot + 1) % PG_INDEX_SIZE) {
+            const pgRegistry_t *reg = &__pg_registry_start[pgIndex[slot] - 1];
+            if (pgN(reg) == pgn) {
+                return reg;
+            }
+        }
+        return NULL;
+    }
+
     PG_FOREACH(reg) {
         if (pgN(reg) == pgn) {
             return reg;
@@ -84,6 +84,9 @@ extern const uint8_t __pg_resetdata_end[];
 
 #define PG_REGISTRY_SIZE (__pg_registry_end - __pg_registry_start)
 
+// Largest registry that pgFind() indexes and that loadEEPROM() loads in a single pass, well above the number of PGNs in pg_ids.h
+#define PG_REGISTRY_INDEXED_MAX 255
+
 // Helper to iterate over the PG register.  Cheaper than a visitor style callback.
 #define PG_FOREACH(_name) \
     for (const pgRegistry_t *(_name) = __pg_registry_start; (_name) < __pg_registry_end; _name++)
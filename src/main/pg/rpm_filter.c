@@ -27,7 +27,7 @@
 
 #include "rpm_filter.h"
 
-PG_REGISTER_WITH_RESET_TEMPLATE(rpmFilterConfig_t, rpmFilterConfig, PG_RPM_FILTER_CONFIG, 6);
+PG_REGISTER_WITH_RESET_TEMPLATE(rpmFilterConfig_t, rpmFilterConfig, PG_RPM_FILTER_CONFIG, 7);
 
 PG_RESET_TEMPLATE(rpmFilterConfig_t, rpmFilterConfig,
     .rpm_filter_harmonics = 3,
@@ -35,6 +35,7 @@ PG_RESET_TEMPLATE(rpmFilterConfig_t, rpmFilterConfig,
     .rpm_filter_fade_range_hz = 50,
     .rpm_filter_q = 500,
     .rpm_filter_lpf_hz = 150,
+    .rpm_filter_update_hz = 1,
     .rpm_filter_weights = { 100, 100, 100 },
 );
 
@@ -35,6 +35,7 @@ typedef struct rpmFilterConfig_s
     uint16_t rpm_filter_q;             // q of the notches
 
     uint16_t rpm_filter_lpf_hz;        // the cutoff of the lpf on reported motor rpm
+    uint8_t  rpm_filter_update_hz;     // minimum change of a notch frequency before it is recalculated, 0 recalculates all notches continuously
 
 } rpmFilterConfig_t;
 
@@ -23,10 +23,11 @@
 #include "pg/pg_ids.h"
 #include "pg/scheduler.h"
 
-PG_REGISTER_WITH_RESET_TEMPLATE(schedulerConfig_t, schedulerConfig, PG_SCHEDULER_CONFIG, 2);
+PG_REGISTER_WITH_RESET_TEMPLATE(schedulerConfig_t, schedulerConfig, PG_SCHEDULER_CONFIG, 3);
 
 PG_RESET_TEMPLATE(schedulerConfig_t, schedulerConfig,
     .rxRelaxDeterminism = SCHEDULER_RELAX_RX,
     .osdRelaxDeterminism = SCHEDULER_RELAX_OSD,
-    .cpuLatePercentageLimit = CPU_LOAD_LATE_LIMIT
+    .cpuLatePercentageLimit = CPU_LOAD_LATE_LIMIT,
+    .mode = SCHEDULER_MODE_PRIORITY,
 );
@@ -34,11 +34,17 @@
 // Tenths of a % of tasks late
 #define CPU_LOAD_LATE_LIMIT 10
 
+typedef enum {
+    SCHEDULER_MODE_PRIORITY = 0,    // Dynamic priority, all tasks are aged and checked on every pass
+    SCHEDULER_MODE_DEADLINE,        // Earliest deadline first with per task time budgets
+} schedulerMode_e;
+
 typedef struct schedulerConfig_s {
     uint16_t rxRelaxDeterminism;
     uint16_t osdRelaxDeterminism;
     uint16_t cpuLatePercentageLimit;
     uint8_t debugTask;
+    uint8_t mode;                   // see schedulerMode_e
 } schedulerConfig_t;
 
 PG_DECLARE(schedulerConfig_t, schedulerConfig);
@@ -26,7 +26,8 @@
 typedef enum {
     SDCARD_MODE_NONE = 0,
     SDCARD_MODE_SPI,
-    SDCARD_MODE_SDIO
+    SDCARD_MODE_SDIO,
+    SDCARD_MODE_FILE
 } sdcardMode_e;
 
 typedef struct sdcardConfig_s {
@@ -32,6 +32,7 @@
 
 #include "build/build_config.h"
 #include "build/debug.h"
+#include "build/trace.h"
 
 #include "common/maths.h"
 #include "common/time.h"
@@ -74,6 +75,11 @@
 // 4 - 10ths % of tasks late in last second
 // 7 - Standard deviation of gyro cycle time in 100th of a us
 
+// Task histograms, require USE_LATE_TASK_STATISTICS to be defined
+// TASK_HISTOGRAM_EXEC_TIME - execution time of every run that isn't ignored for exec time
+// TASK_HISTOGRAM_START_LATENCY - time driven tasks: start past the desired period, event driven tasks: start past the check function firing
+//                                TASK_GYRO: gyro task start past its target cycle (gyro cycle jitter)
+
 // DEBUG_TASK, requires USE_LATE_TASK_STATISTICS to be defined
 // 0 - Value of scheduler_debug_task setting
 // 1 - rate (Hz)
@@ -128,6 +134,121 @@ static int32_t gyroCyclesNow;
 
 static timeMs_t lastFailsafeCheckMs = 0;
 
+// Deadline mode (SCHEDULER_MODE_DEADLINE)
+// Time driven tasks wait in releaseHeap keyed by their release time, a period after they last ran, and then move
+// to readyHeap keyed by their deadline, a period after release. Event driven tasks are polled one per scheduler
+// pass rather than all on every pass, and join readyHeap once their check function fires. Both heaps are binary
+// min heaps so the earliest deadline is always at the root and selection doesn't depend on the number of tasks.
+typedef struct taskHeap_s {
+    int size;
+    task_t *task[TASK_COUNT];
+} taskHeap_t;
+
+static FAST_DATA_ZERO_INIT bool deadlineMode;
+static FAST_DATA_ZERO_INIT taskHeap_t releaseHeap;
+static FAST_DATA_ZERO_INIT taskHeap_t readyHeap;
+static FAST_DATA_ZERO_INIT task_t *pollRing[TASK_COUNT];
+static FAST_DATA_ZERO_INIT int pollRingSize;
+static FAST_DATA_ZERO_INIT int pollRingPos;
+static FAST_DATA_ZERO_INIT int selectedHeapPos;
+
+static FAST_CODE bool heapBefore(const task_t *a, const task_t *b)
+{
+    return cmpTimeUs(a->deadlineKeyUs, b->deadlineKeyUs) < 0;
+}
+
+static FAST_CODE void heapSiftUp(taskHeap_t *heap, int pos)
+{
+    task_t *task = heap->task[pos];
+    while (pos > 0) {
+        const int parent = (pos - 1) / 2;
+        if (!heapBefore(task, heap->task[parent])) {
+            break;
+        }
+        heap->task[pos] = heap->task[parent];
+        pos = parent;
+    }
+    heap->task[pos] = task;
+}
+
+static FAST_CODE void heapSiftDown(taskHeap_t *heap, int pos)
+{
+    task_t *task = heap->task[pos];
+    while (2 * pos + 1 < heap->size) {
+        int child = 2 * pos + 1;
+        if ((child + 1 < heap->size) && heapBefore(heap->task[child + 1], heap->task[child])) {
+            child++;
+        }
+        if (!heapBefore(heap->task[child], task)) {
+            break;
+        }
+        heap->task[pos] = heap->task[child];
+        pos = child;
+    }
+    heap->task[pos] = task;
+}
+
+static FAST_CODE void heapPush(taskHeap_t *heap, task_t *task, timeUs_t keyUs)
+{
+    task->deadlineKeyUs = keyUs;
+    heap->task[heap->size] = task;
+    heapSiftUp(heap, heap->size++);
+}
+
+static FAST_CODE void heapRemoveAt(taskHeap_t *heap, int pos)
+{
+    heap->size--;
+    if (pos < heap->size) {
+        heap->task[pos] = heap->task[heap->size];
+        heapSiftDown(heap, pos);
+        heapSiftUp(heap, pos);
+    }
+}
+
+static int heapFind(const taskHeap_t *heap, const task_t *task)
+{
+    for (int ii = 0; ii < heap->size; ++ii) {
+        if (heap->task[ii] == task) {
+            return ii;
+        }
+    }
+    return -1;
+}
+
+static void deadlineAdd(task_t *task)
+{
+    if (task->attribute->staticPriority == TASK_PRIORITY_REALTIME) {
+        return; // Run in lock with the gyro
+    }
+
+    task->dynamicPriority = 0;
+    if (task->attribute->checkFunc) {
+        pollRing[pollRingSize++] = task;
+    } else {
+        heapPush(&releaseHeap, task, task->lastExecutedAtUs + task->attribute->desiredPeriodUs);
+    }
+}
+
+static void deadlineRemove(task_t *task)
+{
+    int pos;
+
+    if ((pos = heapFind(&releaseHeap, task)) >= 0) {
+        heapRemoveAt(&releaseHeap, pos);
+    }
+    if ((pos = heapFind(&readyHeap, task)) >= 0) {
+        heapRemoveAt(&readyHeap, pos);
+    }
+    for (int ii = 0; ii < pollRingSize; ++ii) {
+        if (pollRing[ii] == task) {
+            memmove(&pollRing[ii], &pollRing[ii+1], sizeof(task) * (pollRingSize - ii - 1));
+            --pollRingSize;
+            pollRingPos = 0;
+            break;
+        }
+    }
+}
+
 // No need for a linked list for the queue, since items are only inserted at startup
 #ifdef UNIT_TEST
 #define TASK_QUEUE_RESERVE 1
@@ -141,6 +262,11 @@ STATIC_UNIT_TESTED void queueClear(void)
     memset(taskQueueArray, 0, sizeof(taskQueueArray));
     taskQueuePos = 0;
     taskQueueSize = 0;
+
+    releaseHeap.size = 0;
+    readyHeap.size = 0;
+    pollRingSize = 0;
+    pollRingPos = 0;
 }
 
 static bool queueContains(const task_t *task)
@@ -163,6 +289,9 @@ STATIC_UNIT_TESTED bool queueAdd(task_t *task)
             memmove(&taskQueueArray[ii+1], &taskQueueArray[ii], sizeof(task) * (taskQueueSize - ii));
             taskQueueArray[ii] = task;
             ++taskQueueSize;
+            if (deadlineMode) {
+                deadlineAdd(task);
+            }
             return true;
         }
     }
@@ -175,6 +304,9 @@ STATIC_UNIT_TESTED bool queueRemove(task_t *task)
         if (taskQueueArray[ii] == task) {
             memmove(&taskQueueArray[ii], &taskQueueArray[ii+1], sizeof(task) * (taskQueueSize - ii));
             --taskQueueSize;
+            if (deadlineMode) {
+                deadlineRemove(task);
+            }
             return true;
         }
     }
@@ -258,9 +390,45 @@ void getTaskInfo(taskId_e taskId, taskInfo_t * taskInfo)
     taskInfo->lateCount = getTask(taskId)->lateCount;
     taskInfo->runCount = getTask(taskId)->runCount;
     taskInfo->execTime = getTask(taskId)->execTime;
+    memcpy(taskInfo->histogram, getTask(taskId)->histogram, sizeof(taskInfo->histogram));
 #endif
 }
 
+#if defined(USE_LATE_TASK_STATISTICS)
+STATIC_UNIT_TESTED FAST_CODE void taskHistogramAdd(taskHistogram_t *histogram, uint32_t value10thUs)
+{
+    const unsigned bucket = value10thUs ? MIN(llog2(value10thUs) + 1, (unsigned)TASK_HISTOGRAM_BUCKET_COUNT - 1) : 0;
+
+    if (++histogram->count[bucket] == UINT32_MAX) {
+        // Keep the shape of the distribution rather than wrapping or sticking, rounding up so rare samples in the tail aren't lost
+        for (unsigned i = 0; i < TASK_HISTOGRAM_BUCKET_COUNT; i++) {
+            histogram->count[i] = (histogram->count[i] >> 1) + (histogram->count[i] & 1);
+        }
+    }
+}
+#endif
+
+// Returns the upper bound of the bucket holding the given percentile in 10ths of a us, 0 if nothing recorded
+uint32_t taskHistogramPercentile(const taskHistogram_t *histogram, uint16_t permille)
+{
+    uint64_t total = 0;
+    for (unsigned i = 0; i < TASK_HISTOGRAM_BUCKET_COUNT; i++) {
+        total += histogram->count[i];
+    }
+
+    // Smallest bucket that covers at least permille/1000 of the samples
+    const uint64_t threshold = (total * permille + 999) / 1000;
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < TASK_HISTOGRAM_BUCKET_COUNT; i++) {
+        sum += histogram->count[i];
+        if (sum && sum >= threshold) {
+            return i ? 1U << i : 0;
+        }
+    }
+
+    return 0;
+}
+
 void rescheduleTask(taskId_e taskId, timeDelta_t newPeriodUs)
 {
     task_t *task;
@@ -361,8 +529,19 @@ void schedulerResetCheckFunctionMaxExecutionTime(void)
     checkFuncMaxExecutionTimeUs = 0;
 }
 
+void schedulerResetTaskHistograms(void)
+{
+#if defined(USE_LATE_TASK_STATISTICS)
+    for (taskId_e taskId = 0; taskId < TASK_COUNT; taskId++) {
+        memset(getTask(taskId)->histogram, 0, sizeof(getTask(taskId)->histogram));
+    }
+#endif
+}
+
 void schedulerInit(void)
 {
+    deadlineMode = (schedulerConfig()->mode == SCHEDULER_MODE_DEADLINE);
+
     queueClear();
     queueAdd(getTask(TASK_SYSTEM));
 
@@ -422,7 +601,9 @@ FAST_CODE timeUs_t schedulerExecuteTask(task_t *selectedTask, timeUs_t currentTi
 #if defined(USE_LATE_TASK_STATISTICS)
         const timeUs_t estimatedExecutionUs = selectedTask->execTime;
 #endif
+        TRACE_BEGIN(TRACE_ID_TASK_BASE + (selectedTask - tasks));
         selectedTask->attribute->taskFunc(currentTimeBeforeTaskCallUs);
+        TRACE_END(TRACE_ID_TASK_BASE + (selectedTask - tasks));
         taskExecutionTimeUs = micros() - currentTimeBeforeTaskCallUs;
         taskTotalExecutionTime += taskExecutionTimeUs;
         selectedTask->movingSumExecutionTime10thUs += (taskExecutionTimeUs * 10) - selectedTask->movingSumExecutionTime10thUs / TASK_STATS_MOVING_SUM_COUNT;
@@ -431,6 +612,15 @@ FAST_CODE timeUs_t schedulerExecuteTask(task_t *selectedTask, timeUs_t currentTi
             selectedTask->taskLatestDeltaTimeUs = cmpTimeUs(currentTimeUs, selectedTask->lastStatsAtUs);
             selectedTask->movingSumDeltaTime10thUs += (selectedTask->taskLatestDeltaTimeUs * 10) - selectedTask->movingSumDeltaTime10thUs / TASK_STATS_MOVING_SUM_COUNT;
             selectedTask->lastStatsAtUs = currentTimeUs;
+#if defined(USE_LATE_TASK_STATISTICS)
+            // The realtime tasks are paced by the gyro, their lateness is recorded as gyro cycle jitter
+            if (selectedTask->attribute->staticPriority != TASK_PRIORITY_REALTIME) {
+                const timeDelta_t startLatencyUs = selectedTask->attribute->checkFunc ?
+                    cmpTimeUs(currentTimeUs, selectedTask->lastSignaledAtUs) :
+                    selectedTask->taskLatestDeltaTimeUs - selectedTask->attribute->desiredPeriodUs;
+                taskHistogramAdd(&selectedTask->histogram[TASK_HISTOGRAM_START_LATENCY], MAX(startLatencyUs, 0) * 10);
+            }
+#endif
         }
 
         // Update estimate of expected task duration
@@ -447,6 +637,9 @@ FAST_CODE timeUs_t schedulerExecuteTask(task_t *selectedTask, timeUs_t currentTi
 
         if (!ignoreCurrentTaskExecTime) {
             selectedTask->maxExecutionTimeUs = MAX(selectedTask->maxExecutionTimeUs, taskExecutionTimeUs);
+#if defined(USE_LATE_TASK_STATISTICS)
+            taskHistogramAdd(&selectedTask->histogram[TASK_HISTOGRAM_EXEC_TIME], taskExecutionTimeUs * 10);
+#endif
         }
 
         selectedTask->totalExecutionTimeUs += taskExecutionTimeUs;   // time consumed by scheduler + task
@@ -472,6 +665,81 @@ FAST_CODE timeUs_t schedulerExecuteTask(task_t *selectedTask, timeUs_t currentTi
     return taskExecutionTimeUs;
 }
 
+static FAST_CODE void checkFuncUpdateStatistics(const task_t *task, timeUs_t currentTimeUs)
+{
+    const uint32_t checkFuncExecutionTimeUs = cmpTimeUs(micros(), currentTimeUs);
+    checkFuncMovingSumExecutionTimeUs += checkFuncExecutionTimeUs - checkFuncMovingSumExecutionTimeUs / TASK_STATS_MOVING_SUM_COUNT;
+    checkFuncMovingSumDeltaTimeUs += task->taskLatestDeltaTimeUs - checkFuncMovingSumDeltaTimeUs / TASK_STATS_MOVING_SUM_COUNT;
+    checkFuncTotalExecutionTimeUs += checkFuncExecutionTimeUs;   // time consumed by scheduler + task
+    checkFuncMaxExecutionTimeUs = MAX(checkFuncMaxExecutionTimeUs, checkFuncExecutionTimeUs);
+}
+
+static FAST_CODE task_t *deadlineSelectTask(timeUs_t currentTimeUs, int32_t schedLoopRemainingCycles, bool runAnyTask)
+{
+    // Release the time driven tasks which are due
+    while (releaseHeap.size && (cmpTimeUs(currentTimeUs, releaseHeap.task[0]->deadlineKeyUs) >= 0)) {
+        task_t *task = releaseHeap.task[0];
+        const timeUs_t releaseAtUs = task->deadlineKeyUs;
+        heapRemoveAt(&releaseHeap, 0);
+        task->dynamicPriority = 1;
+        heapPush(&readyHeap, task, releaseAtUs + task->attribute->desiredPeriodUs);
+    }
+
+    // Poll one event driven task per pass, skipping those already waiting to run
+    if (pollRingSize) {
+        task_t *task = pollRing[pollRingPos];
+        if (++pollRingPos >= pollRingSize) {
+            pollRingPos = 0;
+        }
+        if ((task->dynamicPriority == 0) && task->attribute->checkFunc(currentTimeUs, cmpTimeUs(currentTimeUs, task->lastExecutedAtUs))) {
+            checkFuncUpdateStatistics(task, currentTimeUs);
+            task->lastSignaledAtUs = currentTimeUs;
+            task->dynamicPriority = 1;
+            heapPush(&readyHeap, task, currentTimeUs + task->attribute->desiredPeriodUs);
+        }
+    }
+
+    // Earliest deadline first. If that won't complete before the next gyro cycle, try the next earliest
+    // deadlines at the top of the heap to fill the remaining time. The root always runs at the first opportunity.
+    int candidates[] = { 0, 1, 2 };
+    if ((readyHeap.size > 2) && heapBefore(readyHeap.task[2], readyHeap.task[1])) {
+        candidates[1] = 2;
+        candidates[2] = 1;
+    }
+
+    for (unsigned ii = 0; (ii < ARRAYLEN(candidates)) && (candidates[ii] < readyHeap.size); ++ii) {
+        task_t *task = readyHeap.task[candidates[ii]];
+        const timeDelta_t taskRequiredTimeUs = task->anticipatedExecutionTime >> TASK_EXEC_TIME_SHIFT;
+        const int32_t taskRequiredTimeCycles = (int32_t)clockMicrosToCycles((uint32_t)taskRequiredTimeUs) + taskGuardCycles;
+
+        if (runAnyTask || (taskRequiredTimeCycles < schedLoopRemainingCycles)) {
+            selectedHeapPos = candidates[ii];
+            return task;
+        }
+    }
+
+    return NULL;
+}
+
+static FAST_CODE void deadlineTaskExecuted(task_t *task)
+{
+    int pos = selectedHeapPos;
+
+    if ((pos >= readyHeap.size) || (readyHeap.task[pos] != task)) {
+        // The task enabled or disabled tasks itself
+        pos = heapFind(&readyHeap, task);
+        if (pos < 0) {
+            return;
+        }
+    }
+
+    heapRemoveAt(&readyHeap, pos);
+
+    if (!task->attribute->checkFunc) {
+        heapPush(&releaseHeap, task, task->lastExecutedAtUs + task->attribute->desiredPeriodUs);
+    }
+}
+
 #if defined(UNIT_TEST)
 STATIC_UNIT_TESTED task_t *unittest_scheduler_selectedTask;
 STATIC_UNIT_TESTED uint8_t unittest_scheduler_selectedTaskDynamicPriority;
@@ -505,6 +773,9 @@ FAST_CODE void scheduler(void)
     uint32_t nextTargetCycles = 0;
     int32_t schedLoopRemainingCycles;
     bool firstSchedulingOpportunity = false;
+#if defined(SIMULATOR_BUILD)
+    bool taskExecuted = false;
+#endif
 
 #if defined(UNIT_TEST)
     if (nextTargetCycles == 0) {
@@ -563,7 +834,9 @@ FAST_CODE void scheduler(void)
             // Check for incoming RX data. Don't do this in the checker as that is called repeatedly within
             // a given gyro loop, and ELRS takes a long time to process this and so can only be safely processed
             // before the checkers
+            TRACE_BEGIN(TRACE_ID_RX_FRAME_CHECK);
             rxFrameCheck(currentTimeUs, cmpTimeUs(currentTimeUs, getTask(TASK_RX)->lastExecutedAtUs));
+            TRACE_END(TRACE_ID_RX_FRAME_CHECK);
 
             // Check for failsafe conditions without reliance on the RX task being well behaved
             if (cmp32(millis(), lastFailsafeCheckMs) > PERIOD_RXDATA_FAILURE) {
@@ -581,6 +854,7 @@ FAST_CODE void scheduler(void)
             gyroCyclesTotal += gyroCyclesNow;
             gyroCyclesCount++;
             DEBUG_SET(DEBUG_SCHEDULER_DETERMINISM, 0, clockCyclesTo10thMicros(gyroCyclesNow));
+            taskHistogramAdd(&gyroTask->histogram[TASK_HISTOGRAM_START_LATENCY], clockCyclesTo10thMicros(MAX(cmpTimeCycles(nowCycles, nextTargetCycles), 0)));
             int32_t deviationCycles = gyroCyclesNow - gyroCyclesMean;
             devSquared += deviationCycles * deviationCycles;
 
@@ -703,53 +977,52 @@ FAST_CODE void scheduler(void)
     if (!gyroEnabled || (schedLoopRemainingCycles > (int32_t)clockMicrosToCycles(CHECK_GUARD_MARGIN_US))) {
         currentTimeUs = micros();
 
-        // Update task dynamic priorities
-        for (task_t *task = queueFirst(); task != NULL; task = queueNext()) {
-            if (task->attribute->staticPriority != TASK_PRIORITY_REALTIME) {
-                // Task has checkFunc - event driven
-                if (task->attribute->checkFunc) {
-                    // Increase priority for event driven tasks
-                    if (task->dynamicPriority > 0) {
-                        task->taskAgePeriods = 1 + (cmpTimeUs(currentTimeUs, task->lastSignaledAtUs) / task->attribute->desiredPeriodUs);
-                        task->dynamicPriority = 1 + task->attribute->staticPriority * task->taskAgePeriods;
-                    } else if (task->attribute->checkFunc(currentTimeUs, cmpTimeUs(currentTimeUs, task->lastExecutedAtUs))) {
-                        const uint32_t checkFuncExecutionTimeUs = cmpTimeUs(micros(), currentTimeUs);
-                        checkFuncMovingSumExecutionTimeUs += checkFuncExecutionTimeUs - checkFuncMovingSumExecutionTimeUs / TASK_STATS_MOVING_SUM_COUNT;
-                        checkFuncMovingSumDeltaTimeUs += task->taskLatestDeltaTimeUs - checkFuncMovingSumDeltaTimeUs / TASK_STATS_MOVING_SUM_COUNT;
-                        checkFuncTotalExecutionTimeUs += checkFuncExecutionTimeUs;   // time consumed by scheduler + task
-                        checkFuncMaxExecutionTimeUs = MAX(checkFuncMaxExecutionTimeUs, checkFuncExecutionTimeUs);
-                        task->lastSignaledAtUs = currentTimeUs;
-                        task->taskAgePeriods = 1;
-                        task->dynamicPriority = 1 + task->attribute->staticPriority;
+        if (deadlineMode) {
+            selectedTask = deadlineSelectTask(currentTimeUs, schedLoopRemainingCycles, !gyroEnabled || firstSchedulingOpportunity);
+        } else {
+            // Update task dynamic priorities
+            for (task_t *task = queueFirst(); task != NULL; task = queueNext()) {
+                if (task->attribute->staticPriority != TASK_PRIORITY_REALTIME) {
+                    // Task has checkFunc - event driven
+                    if (task->attribute->checkFunc) {
+                        // Increase priority for event driven tasks
+                        if (task->dynamicPriority > 0) {
+                            task->taskAgePeriods = 1 + (cmpTimeUs(currentTimeUs, task->lastSignaledAtUs) / task->attribute->desiredPeriodUs);
+                            task->dynamicPriority = 1 + task->attribute->staticPriority * task->taskAgePeriods;
+                        } else if (task->attribute->checkFunc(currentTimeUs, cmpTimeUs(currentTimeUs, task->lastExecutedAtUs))) {
+                            checkFuncUpdateStatistics(task, currentTimeUs);
+                            task->lastSignaledAtUs = currentTimeUs;
+                            task->taskAgePeriods = 1;
+                            task->dynamicPriority = 1 + task->attribute->staticPriority;
+                        } else {
+                            task->taskAgePeriods = 0;
+                        }
                     } else {
-                        task->taskAgePeriods = 0;
+                        // Task is time-driven, dynamicPriority is last execution age (measured in desiredPeriods)
+                        // Task age is calculated from last execution
+                        task->taskAgePeriods = (cmpTimeUs(currentTimeUs, task->lastExecutedAtUs) / task->attribute->desiredPeriodUs);
+                        if (task->taskAgePeriods > 0) {
+                            task->dynamicPriority = 1 + task->attribute->staticPriority * task->taskAgePeriods;
+                        }
                     }
-                } else {
-                    // Task is time-driven, dynamicPriority is last execution age (measured in desiredPeriods)
-                    // Task age is calculated from last execution
-                    task->taskAgePeriods = (cmpTimeUs(currentTimeUs, task->lastExecutedAtUs) / task->attribute->desiredPeriodUs);
-                    if (task->taskAgePeriods > 0) {
-                        task->dynamicPriority = 1 + task->attribute->staticPriority * task->taskAgePeriods;
-                    }
-                }
 
-                if (task->dynamicPriority > selectedTaskDynamicPriority) {
-                    timeDelta_t taskRequiredTimeUs = task->anticipatedExecutionTime >> TASK_EXEC_TIME_SHIFT;
-                    int32_t taskRequiredTimeCycles = (int32_t)clockMicrosToCycles((uint32_t)taskRequiredTimeUs);
-                    // Allow a little extra time
-                    taskRequiredTimeCycles += checkCycles + taskGuardCycles;
-
-                    // If there's no time to run the task, discount it from prioritisation unless aged sufficiently
-                    // Don't block the SERIAL task.
-                    if ((taskRequiredTimeCycles < schedLoopRemainingCycles) ||
-                        ((scheduleCount & SCHED_TASK_DEFER_MASK) == 0) ||
-                        ((task - tasks) == TASK_SERIAL)) {
-                        selectedTaskDynamicPriority = task->dynamicPriority;
-                        selectedTask = task;
+                    if (task->dynamicPriority > selectedTaskDynamicPriority) {
+                        timeDelta_t taskRequiredTimeUs = task->anticipatedExecutionTime >> TASK_EXEC_TIME_SHIFT;
+                        int32_t taskRequiredTimeCycles = (int32_t)clockMicrosToCycles((uint32_t)taskRequiredTimeUs);
+                        // Allow a little extra time
+                        taskRequiredTimeCycles += checkCycles + taskGuardCycles;
+
+                        // If there's no time to run the task, discount it from prioritisation unless aged sufficiently
+                        // Don't block the SERIAL task.
+                        if ((taskRequiredTimeCycles < schedLoopRemainingCycles) ||
+                            ((scheduleCount & SCHED_TASK_DEFER_MASK) == 0) ||
+                            ((task - tasks) == TASK_SERIAL)) {
+                            selectedTaskDynamicPriority = task->dynamicPriority;
+                            selectedTask = task;
+                        }
                     }
                 }
             }
-
         }
 
         // The number of cycles taken to run the checkers is quite consistent with some higher spikes, but
@@ -773,6 +1046,12 @@ FAST_CODE void scheduler(void)
             if (!gyroEnabled || firstSchedulingOpportunity || (taskRequiredTimeCycles < schedLoopRemainingCycles)) {
                 uint32_t antipatedEndCycles = nowCycles + taskRequiredTimeCycles;
                 taskExecutionTimeUs += schedulerExecuteTask(selectedTask, currentTimeUs);
+                if (deadlineMode) {
+                    deadlineTaskExecuted(selectedTask);
+                }
+#if defined(SIMULATOR_BUILD)
+                taskExecuted = true;
+#endif
                 nowCycles = getCycleCounter();
                 int32_t cyclesOverdue = cmpTimeCycles(nowCycles, antipatedEndCycles);
 
@@ -819,6 +1098,13 @@ FAST_CODE void scheduler(void)
         }
     }
 
+#if defined(SIMULATOR_BUILD)
+    if (!firstSchedulingOpportunity && !taskExecuted) {
+        // Nothing left to do before the next gyro cycle, lets a lockstep simulator skip the idle time
+        simulatorIdle(gyroEnabled ? nextTargetCycles : getCycleCounter() + desiredPeriodCycles);
+    }
+#endif
+
 #if defined(UNIT_TEST)
     readSchedulerLocals(selectedTask, selectedTaskDynamicPriority);
     UNUSED(taskExecutionTimeUs);
@@ -59,6 +59,9 @@
 #define GYRO_RATE_COUNT 25000
 #define GYRO_LOCK_COUNT 50
 
+// Log2 latency histograms in 10ths of a us, bucket 0 counts zero, bucket n counts [2^(n-1), 2^n) and the last bucket everything above
+#define TASK_HISTOGRAM_BUCKET_COUNT     16
+
 typedef enum {
     TASK_PRIORITY_REALTIME = -1, // Task will be run outside the scheduler logic
     TASK_PRIORITY_LOWEST = 1,
@@ -76,6 +79,16 @@ typedef struct {
     timeUs_t     averageDeltaTimeUs;
 } cfCheckFuncInfo_t;
 
+typedef enum {
+    TASK_HISTOGRAM_EXEC_TIME = 0,       // Task execution time
+    TASK_HISTOGRAM_START_LATENCY,       // Start past due (time driven) or past signalled (event driven), gyro cycle jitter for TASK_GYRO
+    TASK_HISTOGRAM_COUNT
+} taskHistogram_e;
+
+typedef struct {
+    uint32_t     count[TASK_HISTOGRAM_BUCKET_COUNT];    // All buckets are halved, rounding up, when one saturates
+} taskHistogram_t;
+
 typedef struct {
     const char * taskName;
     const char * subTaskName;
@@ -92,6 +105,7 @@ typedef struct {
     uint32_t     runCount;
     uint32_t     lateCount;
     timeUs_t     execTime;
+    taskHistogram_t histogram[TASK_HISTOGRAM_COUNT];
 #endif
 } taskInfo_t;
 
@@ -146,6 +160,9 @@ typedef enum {
 #ifdef USE_TELEMETRY
     TASK_TELEMETRY,
 #endif
+#ifdef USE_MSP_STREAM
+    TASK_MSP_STREAM,
+#endif
 #ifdef USE_LED_STRIP
     TASK_LEDSTRIP,
 #endif
@@ -221,6 +238,7 @@ typedef struct {
     timeUs_t lastExecutedAtUs;          // last time of invocation
     timeUs_t lastSignaledAtUs;          // time of invocation event for event-driven tasks
     timeUs_t lastDesiredAt;             // time of last desired execution
+    timeUs_t deadlineKeyUs;             // deadline mode: release time while waiting, deadline once ready
 
     // Statistics
     float    movingAverageCycleTimeUs;
@@ -234,6 +252,7 @@ typedef struct {
     uint32_t runCount;
     uint32_t lateCount;
     timeUs_t execTime;
+    taskHistogram_t histogram[TASK_HISTOGRAM_COUNT];
 #endif
 } task_t;
 
@@ -249,6 +268,8 @@ bool schedulerGetIgnoreTaskExecTime(void);
 void schedulerResetTaskStatistics(taskId_e taskId);
 void schedulerResetTaskMaxExecutionTime(taskId_e taskId);
 void schedulerResetCheckFunctionMaxExecutionTime(void);
+void schedulerResetTaskHistograms(void);
+uint32_t taskHistogramPercentile(const taskHistogram_t *histogram, uint16_t permille);
 void schedulerSetNextStateTime(timeDelta_t nextStateTime);
 timeDelta_t schedulerGetNextStateTime(void);
 void schedulerInit(void);
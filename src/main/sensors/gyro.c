@@ -477,6 +477,45 @@ FAST_CODE void gyroUpdate(void)
 #endif
 }
 
+// Apply the enabled static notch and lowpass filters stage by stage to all axes
+STATIC_UNIT_TESTED FAST_CODE void gyroApplyFilterStages(float values[XYZ_AXIS_COUNT])
+{
+    for (int i = 0; i < gyro.filterStageCount; i++) {
+        const gyroFilterStage_t *stage = &gyro.filterStages[i];
+
+        switch (stage->type) {
+        case GYRO_FILTER_STAGE_PT1:
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                values[axis] = pt1FilterApply((pt1Filter_t *)stage->filter[axis], values[axis]);
+            }
+            break;
+        case GYRO_FILTER_STAGE_PT2:
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                values[axis] = pt2FilterApply((pt2Filter_t *)stage->filter[axis], values[axis]);
+            }
+            break;
+        case GYRO_FILTER_STAGE_PT3:
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                values[axis] = pt3FilterApply((pt3Filter_t *)stage->filter[axis], values[axis]);
+            }
+            break;
+        case GYRO_FILTER_STAGE_BIQUAD:
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                values[axis] = biquadFilterApply((biquadFilter_t *)stage->filter[axis], values[axis]);
+            }
+            break;
+        case GYRO_FILTER_STAGE_BIQUAD_DF1:
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                values[axis] = biquadFilterApplyDF1((biquadFilter_t *)stage->filter[axis], values[axis]);
+            }
+            break;
+        case GYRO_FILTER_STAGE_NONE:
+            // never added to the pipeline
+            break;
+        }
+    }
+}
+
 #define GYRO_FILTER_FUNCTION_NAME filterGyro
 #define GYRO_FILTER_DEBUG_SET(mode, index, value) do { UNUSED(mode); UNUSED(index); UNUSED(value); } while (0)
 #define GYRO_FILTER_AXIS_DEBUG_SET(axis, mode, index, value) do { UNUSED(axis); UNUSED(mode); UNUSED(index); UNUSED(value); } while (0)
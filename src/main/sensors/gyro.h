@@ -60,6 +60,25 @@ typedef union gyroLowpassFilter_u {
     pt3Filter_t pt3FilterState;
 } gyroLowpassFilter_t;
 
+// Static gyro filters (soft notches and lowpass 1) in order of application, compiled by gyroInitFilters().
+// Each filter's init sets the stage type it runs as, disabled filters are left out and the filters are called
+// directly instead of through filterApplyFnPtr.
+#define GYRO_FILTER_STAGE_COUNT 3
+
+typedef enum {
+    GYRO_FILTER_STAGE_NONE = 0,         // filter disabled
+    GYRO_FILTER_STAGE_PT1,
+    GYRO_FILTER_STAGE_PT2,
+    GYRO_FILTER_STAGE_PT3,
+    GYRO_FILTER_STAGE_BIQUAD,
+    GYRO_FILTER_STAGE_BIQUAD_DF1,
+} gyroFilterStageType_e;
+
+typedef struct gyroFilterStage_s {
+    gyroFilterStageType_e type;
+    filter_t *filter[XYZ_AXIS_COUNT];
+} gyroFilterStage_t;
+
 typedef struct gyroCalibration_s {
     float sum[XYZ_AXIS_COUNT];
     stdev_t var[XYZ_AXIS_COUNT];
@@ -88,19 +107,27 @@ typedef struct gyro_s {
 
     // lowpass gyro soft filter
     filterApplyFnPtr lowpassFilterApplyFn;
+    gyroFilterStageType_e lowpassFilterStageType;
     gyroLowpassFilter_t lowpassFilter[XYZ_AXIS_COUNT];
 
     // lowpass2 gyro soft filter
     filterApplyFnPtr lowpass2FilterApplyFn;
+    gyroFilterStageType_e lowpass2FilterStageType;
     gyroLowpassFilter_t lowpass2Filter[XYZ_AXIS_COUNT];
 
     // notch filters
     filterApplyFnPtr notchFilter1ApplyFn;
+    gyroFilterStageType_e notchFilter1StageType;
     biquadFilter_t notchFilter1[XYZ_AXIS_COUNT];
 
     filterApplyFnPtr notchFilter2ApplyFn;
+    gyroFilterStageType_e notchFilter2StageType;
     biquadFilter_t notchFilter2[XYZ_AXIS_COUNT];
 
+    // enabled notch and lowpass filters from above
+    int filterStageCount;
+    gyroFilterStage_t filterStages[GYRO_FILTER_STAGE_COUNT];
+
     uint16_t accSampleRateHz;
     uint8_t gyroEnabledBitmask;
     uint8_t gyroDebugMode;
@@ -59,6 +59,7 @@
 #include "drivers/accgyro/accgyro_spi_mpu9250.h"
 
 #include "drivers/accgyro/gyro_sync.h"
+#include "drivers/system.h"
 
 #include "fc/runtime_config.h"
 
@@ -97,11 +98,13 @@ static uint16_t calculateNyquistAdjustedNotchHz(uint16_t notchHz, uint16_t notch
 static void gyroInitFilterNotch1(uint16_t notchHz, uint16_t notchCutoffHz)
 {
     gyro.notchFilter1ApplyFn = nullFilterApply;
+    gyro.notchFilter1StageType = GYRO_FILTER_STAGE_NONE;
 
     notchHz = calculateNyquistAdjustedNotchHz(notchHz, notchCutoffHz);
 
     if (notchHz != 0 && notchCutoffHz != 0) {
         gyro.notchFilter1ApplyFn = (filterApplyFnPtr)biquadFilterApply;
+        gyro.notchFilter1StageType = GYRO_FILTER_STAGE_BIQUAD;
         const float notchQ = filterGetNotchQ(notchHz, notchCutoffHz);
         for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
             biquadFilterInit(&gyro.notchFilter1[axis], notchHz, gyro.targetLooptime, notchQ, FILTER_NOTCH, 1.0f);
@@ -112,11 +115,13 @@ static void gyroInitFilterNotch1(uint16_t notchHz, uint16_t notchCutoffHz)
 static void gyroInitFilterNotch2(uint16_t notchHz, uint16_t notchCutoffHz)
 {
     gyro.notchFilter2ApplyFn = nullFilterApply;
+    gyro.notchFilter2StageType = GYRO_FILTER_STAGE_NONE;
 
     notchHz = calculateNyquistAdjustedNotchHz(notchHz, notchCutoffHz);
 
     if (notchHz != 0 && notchCutoffHz != 0) {
         gyro.notchFilter2ApplyFn = (filterApplyFnPtr)biquadFilterApply;
+        gyro.notchFilter2StageType = GYRO_FILTER_STAGE_BIQUAD;
         const float notchQ = filterGetNotchQ(notchHz, notchCutoffHz);
         for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
             biquadFilterInit(&gyro.notchFilter2[axis], notchHz, gyro.targetLooptime, notchQ, FILTER_NOTCH, 1.0f);
@@ -127,16 +132,19 @@ static void gyroInitFilterNotch2(uint16_t notchHz, uint16_t notchCutoffHz)
 static bool gyroInitLowpassFilterLpf(int slot, int type, uint16_t lpfHz, uint32_t looptime)
 {
     filterApplyFnPtr *lowpassFilterApplyFn;
+    gyroFilterStageType_e *lowpassFilterStageType;
     gyroLowpassFilter_t *lowpassFilter = NULL;
 
     switch (slot) {
     case FILTER_LPF1:
         lowpassFilterApplyFn = &gyro.lowpassFilterApplyFn;
+        lowpassFilterStageType = &gyro.lowpassFilterStageType;
         lowpassFilter = gyro.lowpassFilter;
         break;
 
     case FILTER_LPF2:
         lowpassFilterApplyFn = &gyro.lowpass2FilterApplyFn;
+        lowpassFilterStageType = &gyro.lowpass2FilterStageType;
         lowpassFilter = gyro.lowpass2Filter;
         break;
 
@@ -153,12 +161,14 @@ static bool gyroInitLowpassFilterLpf(int slot, int type, uint16_t lpfHz, uint32_
     // Dereference the pointer to null before checking valid cutoff and filter
     // type. It will be overridden for positive cases.
     *lowpassFilterApplyFn = nullFilterApply;
+    *lowpassFilterStageType = GYRO_FILTER_STAGE_NONE;
 
     // If lowpass cutoff has been specified
     if (lpfHz) {
         switch (type) {
         case FILTER_PT1:
             *lowpassFilterApplyFn = (filterApplyFnPtr) pt1FilterApply;
+            *lowpassFilterStageType = GYRO_FILTER_STAGE_PT1;
             for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
                 pt1FilterInit(&lowpassFilter[axis].pt1FilterState, pt1FilterGain(lpfHz, gyroDt));
             }
@@ -168,8 +178,10 @@ static bool gyroInitLowpassFilterLpf(int slot, int type, uint16_t lpfHz, uint32_
             if (lpfHz <= gyroFrequencyNyquist) {
 #ifdef USE_DYN_LPF
                 *lowpassFilterApplyFn = (filterApplyFnPtr) biquadFilterApplyDF1;
+                *lowpassFilterStageType = GYRO_FILTER_STAGE_BIQUAD_DF1;
 #else
                 *lowpassFilterApplyFn = (filterApplyFnPtr) biquadFilterApply;
+                *lowpassFilterStageType = GYRO_FILTER_STAGE_BIQUAD;
 #endif
                 for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
                     biquadFilterInitLPF(&lowpassFilter[axis].biquadFilterState, lpfHz, looptime);
@@ -179,6 +191,7 @@ static bool gyroInitLowpassFilterLpf(int slot, int type, uint16_t lpfHz, uint32_
             break;
         case FILTER_PT2:
             *lowpassFilterApplyFn = (filterApplyFnPtr) pt2FilterApply;
+            *lowpassFilterStageType = GYRO_FILTER_STAGE_PT2;
             for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
                 pt2FilterInit(&lowpassFilter[axis].pt2FilterState, pt2FilterGain(lpfHz, gyroDt));
             }
@@ -186,6 +199,7 @@ static bool gyroInitLowpassFilterLpf(int slot, int type, uint16_t lpfHz, uint32_
             break;
         case FILTER_PT3:
             *lowpassFilterApplyFn = (filterApplyFnPtr) pt3FilterApply;
+            *lowpassFilterStageType = GYRO_FILTER_STAGE_PT3;
             for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
                 pt3FilterInit(&lowpassFilter[axis].pt3FilterState, pt3FilterGain(lpfHz, gyroDt));
             }
@@ -196,6 +210,46 @@ static bool gyroInitLowpassFilterLpf(int slot, int type, uint16_t lpfHz, uint32_
     return ret;
 }
 
+STATIC_UNIT_TESTED void gyroAddFilterStage(gyroFilterStageType_e type, void *filters, size_t filterSize)
+{
+    switch (type) {
+    case GYRO_FILTER_STAGE_NONE:
+        // disabled filters don't get a stage
+        return;
+    case GYRO_FILTER_STAGE_PT1:
+    case GYRO_FILTER_STAGE_PT2:
+    case GYRO_FILTER_STAGE_PT3:
+    case GYRO_FILTER_STAGE_BIQUAD:
+    case GYRO_FILTER_STAGE_BIQUAD_DF1:
+        break;
+    default:
+        // a filter that gyroApplyFilterStages() can't run must not be left out silently
+        failureMode(FAILURE_DEVELOPER);
+        return;
+    }
+
+    if (gyro.filterStageCount >= GYRO_FILTER_STAGE_COUNT) {
+        failureMode(FAILURE_DEVELOPER);
+        return;
+    }
+
+    gyroFilterStage_t *stage = &gyro.filterStages[gyro.filterStageCount++];
+    stage->type = type;
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        stage->filter[axis] = (filter_t *)((uint8_t *)filters + axis * filterSize);
+    }
+}
+
+// Stages are applied in the order they are added here, GYRO_FILTER_STAGE_COUNT must cover them all
+static void gyroInitFilterPipeline(void)
+{
+    gyro.filterStageCount = 0;
+
+    gyroAddFilterStage(gyro.notchFilter1StageType, gyro.notchFilter1, sizeof(gyro.notchFilter1[0]));
+    gyroAddFilterStage(gyro.notchFilter2StageType, gyro.notchFilter2, sizeof(gyro.notchFilter2[0]));
+    gyroAddFilterStage(gyro.lowpassFilterStageType, gyro.lowpassFilter, sizeof(gyro.lowpassFilter[0]));
+}
+
 #ifdef USE_DYN_LPF
 static void dynLpfFilterInit(void)
 {
@@ -252,6 +306,7 @@ void gyroInitFilters(void)
 
     gyroInitFilterNotch1(gyroConfig()->gyro_soft_notch_hz_1, gyroConfig()->gyro_soft_notch_cutoff_1);
     gyroInitFilterNotch2(gyroConfig()->gyro_soft_notch_hz_2, gyroConfig()->gyro_soft_notch_cutoff_2);
+    gyroInitFilterPipeline();
 #ifdef USE_DYN_LPF
     dynLpfFilterInit();
 #endif
@@ -425,7 +425,7 @@
 #define USE_FLASH_W25M
 #endif
 
-#if defined(USE_FLASH_M25P16) || defined(USE_FLASH_W25M) || defined(USE_FLASH_W25N) || defined(USE_FLASH_W25Q128FV)
+#if defined(USE_FLASH_M25P16) || defined(USE_FLASH_W25M) || defined(USE_FLASH_W25N) || defined(USE_FLASH_W25Q128FV) || defined(USE_FLASH_RAM)
 #if !defined(USE_FLASH_CHIP)
 #define USE_FLASH_CHIP
 #endif
@@ -461,6 +461,7 @@
 #if !defined(USE_SDCARD)
 #undef USE_SDCARD_SDIO
 #undef USE_SDCARD_SPI
+#undef USE_SDCARD_FILE
 #endif
 
 #if !defined(USE_VCP)
@@ -332,6 +332,13 @@
 
 #define USE_HUFFMAN
 
+// CRC lookup tables for long buffers, 3KB of flash for slice by 4 and 6KB for slice by 8
+#if TARGET_FLASH_SIZE >= 1024
+#define USE_CRC_SLICE_BY_8
+#elif TARGET_FLASH_SIZE > 512
+#define USE_CRC_SLICE_BY_4
+#endif
+
 #define PID_PROFILE_COUNT 4
 #ifndef CONTROL_RATE_PROFILE_COUNT
 #define CONTROL_RATE_PROFILE_COUNT 4 // or maybe 6
@@ -350,6 +357,7 @@
 #endif
 
 #define USE_MSP_OVER_TELEMETRY
+#define USE_MSP_STREAM
 
 #define USE_VIRTUAL_CURRENT_METER
 #define USE_ESC_SENSOR
@@ -455,6 +463,10 @@
 #define USE_CMS_FAILSAFE_MENU
 #define USE_EXTENDED_CMS_MENUS
 #define USE_MSP_DISPLAYPORT
+#if TARGET_FLASH_SIZE >= 1024
+// Only the larger targets have the RAM for the pair of HD canvases
+#define USE_MSP_DISPLAYPORT_BATCH
+#endif
 #define USE_OSD_OVER_MSP_DISPLAYPORT
 #define USE_OSD_ADJUSTMENTS
 #define USE_OSD_PROFILES
@@ -82,6 +82,8 @@
 // Pico flash writes are all aligned and in batches of FLASH_PAGE_SIZE (256)
 #define FLASH_CONFIG_STREAMER_BUFFER_SIZE   FLASH_PAGE_SIZE
 #define FLASH_CONFIG_BUFFER_TYPE            uint8_t
+// but are erased in whole sectors (FLASH_SECTOR_SIZE, 4K)
+#define FLASH_CONFIG_ERASE_SIZE             FLASH_SECTOR_SIZE
 
 /* DMA Settings */
 #define DMA_IRQ_CORE_NUM 1 // Use core 1 for DMA IRQs
@@ -12,6 +12,7 @@ INCLUDE_DIRS := \
 MCU_COMMON_SRC  := \
         $(LIB_MAIN_DIR)/dyad/dyad.c \
         SIMULATOR/sitl.c \
+        SIMULATOR/sitl_replay.c \
         SIMULATOR/udplink.c
 
 #Flags
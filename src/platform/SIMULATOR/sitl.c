@@ -50,6 +50,7 @@
 
 #include "drivers/accgyro/accgyro_virtual.h"
 #include "drivers/barometer/barometer_virtual.h"
+#include "drivers/serial_tcp.h"
 #include "flight/imu.h"
 
 #include "config/feature.h"
@@ -69,8 +70,11 @@
 #include "io/gps.h"
 #include "io/gps_virtual.h"
 
+#include "sensors/gyro.h"
+
 #include "dyad.h"
 #include "udplink.h"
+#include "sitl_replay.h"
 
 uint32_t SystemCoreClock;
 
@@ -91,6 +95,27 @@ static pthread_mutex_t updateLock;
 static pthread_mutex_t mainLoopLock;
 static char simulator_ip[32] = "127.0.0.1";
 
+// Lockstep mode: time only advances when the simulator sends the next FDM packet, see simulatorIdle()
+static bool lockstep = false;
+static uint64_t lockstepNowUs;          // virtual clock
+static uint64_t lockstepEndUs;          // virtual time at the end of the current simulation step
+static uint64_t lockstepStartUs;        // virtual time of the first FDM packet
+static double lockstepStartTimestamp;   // simulator time of the first FDM packet
+static double lockstepLastTimestamp;
+static bool lockstepStarted = false;
+// FDM packets are queued in order of arrival, so every packet is one step however early it arrives
+#define LOCKSTEP_QUEUE_SIZE 64
+static fdm_packet lockstepQueue[LOCKSTEP_QUEUE_SIZE];
+static unsigned lockstepQueueHead;
+static unsigned lockstepQueueCount;
+static pthread_mutex_t lockstepLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t lockstepCond = PTHREAD_COND_INITIALIZER;       // a packet was queued
+static pthread_cond_t lockstepSpaceCond = PTHREAD_COND_INITIALIZER;  // a packet was taken from the queue
+
+// Replay mode: headless lockstep run fed from a recorded sensor trace instead of a simulator
+static const char *replayTracePath = NULL;
+static const char *replayOutputPath = "replay_out.csv";
+
 #define PORT_PWM_RAW    9001    // Out
 #define PORT_PWM        9002    // Out
 #define PORT_STATE      9003    // In
@@ -98,13 +123,33 @@ static char simulator_ip[32] = "127.0.0.1";
 
 int targetParseArgs(int argc, char * argv[])
 {
-    //The first argument should be target IP.
-    if (argc > 1) {
-        strcpy(simulator_ip, argv[1]);
+    // Arguments are the target IP and optionally --lockstep or --replay <trace.csv> [--replay-out <file.csv>]
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--lockstep") == 0) {
+            lockstep = true;
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayTracePath = argv[++i];
+        } else if (strcmp(argv[i], "--replay-out") == 0 && i + 1 < argc) {
+            replayOutputPath = argv[++i];
+        } else {
+            strncpy(simulator_ip, argv[i], sizeof(simulator_ip) - 1);
+        }
+    }
+
+    if (replayTracePath) {
+        if (!replayOpen(replayTracePath, replayOutputPath)) {
+            exit(1);
+        }
+        lockstep = true;
+        printf("[SITL] replay mode, trace %s, output %s\n", replayTracePath, replayOutputPath);
+        return 0;
     }
 
     printf("[SITL] The SITL will output to IP %s:%d (Gazebo) and %s:%d (RealFlightBridge)\n",
            simulator_ip, PORT_PWM, simulator_ip, PORT_PWM_RAW);
+    if (lockstep) {
+        printf("[SITL] lockstep mode, time advances with FDM packets\n");
+    }
     return 0;
 }
 
@@ -124,28 +169,8 @@ static void sendMotorUpdate(void)
     udpSend(&pwmLink, &pwmPkt, sizeof(servo_packet));
 }
 
-static void updateState(const fdm_packet* pkt)
+static void updateSensors(const fdm_packet* pkt, const double deltaSim)
 {
-    static double last_timestamp = 0; // in seconds
-    static uint64_t last_realtime = 0; // in uS
-    static struct timespec last_ts; // last packet
-
-    struct timespec now_ts;
-    clock_gettime(CLOCK_MONOTONIC, &now_ts);
-
-    const uint64_t realtime_now = micros64_real();
-    if (realtime_now > last_realtime + 500*1e3) { // 500ms timeout
-        last_timestamp = pkt->timestamp;
-        last_realtime = realtime_now;
-        sendMotorUpdate();
-        return;
-    }
-
-    const double deltaSim = pkt->timestamp - last_timestamp;  // in seconds
-    if (deltaSim < 0) { // don't use old packet
-        return;
-    }
-
     int16_t x,y,z;
     x = constrain(-pkt->imu_linear_acceleration_xyz[0] * ACC_SCALE, -32767, 32767);
     y = constrain(-pkt->imu_linear_acceleration_xyz[1] * ACC_SCALE, -32767, 32767);
@@ -208,7 +233,34 @@ static void updateState(const fdm_packet* pkt)
 #if defined(SIMULATOR_IMU_SYNC)
     imuSetHasNewData(deltaSim*1e6);
     imuUpdateAttitude(micros());
+#else
+    UNUSED(deltaSim);
 #endif
+}
+
+static void updateState(const fdm_packet* pkt)
+{
+    static double last_timestamp = 0; // in seconds
+    static uint64_t last_realtime = 0; // in uS
+    static struct timespec last_ts; // last packet
+
+    struct timespec now_ts;
+    clock_gettime(CLOCK_MONOTONIC, &now_ts);
+
+    const uint64_t realtime_now = micros64_real();
+    if (realtime_now > last_realtime + 500*1e3) { // 500ms timeout
+        last_timestamp = pkt->timestamp;
+        last_realtime = realtime_now;
+        sendMotorUpdate();
+        return;
+    }
+
+    const double deltaSim = pkt->timestamp - last_timestamp;  // in seconds
+    if (deltaSim < 0) { // don't use old packet
+        return;
+    }
+
+    updateSensors(pkt, deltaSim);
 
     if (deltaSim < 0.02 && deltaSim > 0) { // simulator should run faster than 50Hz
 //        simRate = simRate * 0.5 + (1e6 * deltaSim / (realtime_now - last_realtime)) * 0.5;
@@ -243,7 +295,29 @@ static void* udpThread(void* data)
                 printf("[SITL] new fdm %d t:%f from %s:%d\n", n, fdmPkt.timestamp, inet_ntoa(stateLink.recv.sin_addr), stateLink.recv.sin_port);
                 fdm_received = true;
             }
-            updateState(&fdmPkt);
+            if (lockstep) {
+                // applied by the main loop at the end of the current step, a simulator running
+                // ahead is held back here rather than having its packets dropped
+                pthread_mutex_lock(&lockstepLock);
+                while (lockstepQueueCount == LOCKSTEP_QUEUE_SIZE && workerRunning) {
+                    struct timespec ts;
+                    clock_gettime(CLOCK_REALTIME, &ts);
+                    ts.tv_nsec += 100 * 1000 * 1000; // recheck workerRunning as often as udpRecv() does
+                    if (ts.tv_nsec >= 1000 * 1000 * 1000) {
+                        ts.tv_sec++;
+                        ts.tv_nsec -= 1000 * 1000 * 1000;
+                    }
+                    pthread_cond_timedwait(&lockstepSpaceCond, &lockstepLock, &ts);
+                }
+                if (lockstepQueueCount < LOCKSTEP_QUEUE_SIZE) {
+                    lockstepQueue[(lockstepQueueHead + lockstepQueueCount) % LOCKSTEP_QUEUE_SIZE] = fdmPkt;
+                    lockstepQueueCount++;
+                    pthread_cond_signal(&lockstepCond);
+                }
+                pthread_mutex_unlock(&lockstepLock);
+            } else {
+                updateState(&fdmPkt);
+            }
         }
     }
 
@@ -327,6 +401,12 @@ void systemInit(void)
         exit(1);
     }
 
+    if (replayTracePath) {
+        // no simulator and no configurator links, so parallel runs don't fight over ports
+        tcpDisableListen();
+        return;
+    }
+
     ret = pthread_create(&tcpWorker, NULL, tcpThread, NULL);
     if (ret != 0) {
         printf("Create tcpWorker error!\n");
@@ -362,8 +442,10 @@ void systemReset(void)
 {
     printf("[system]Reset!\n");
     workerRunning = false;
-    pthread_join(tcpWorker, NULL);
-    pthread_join(udpWorker, NULL);
+    if (!replayTracePath) {
+        pthread_join(tcpWorker, NULL);
+        pthread_join(udpWorker, NULL);
+    }
     exit(0);
 }
 void systemResetToBootloader(bootloaderRequestType_e requestType)
@@ -372,8 +454,10 @@ void systemResetToBootloader(bootloaderRequestType_e requestType)
 
     printf("[system]ResetToBootloader!\n");
     workerRunning = false;
-    pthread_join(tcpWorker, NULL);
-    pthread_join(udpWorker, NULL);
+    if (!replayTracePath) {
+        pthread_join(tcpWorker, NULL);
+        pthread_join(udpWorker, NULL);
+    }
     exit(0);
 }
 
@@ -417,8 +501,124 @@ uint64_t millis64_real(void)
     return 1.0e3*((ts.tv_sec + (ts.tv_nsec*1.0e-9)) - (start_time.tv_sec + (start_time.tv_nsec*1.0e-9)));
 }
 
+// Log the finished step and apply the next trace record, exits at the end of the trace
+static void replayNextStep(void)
+{
+    if (lockstepStarted) {
+        replayWrite(lockstepNowUs - lockstepStartUs, gyro.gyroADCf, pwmRawPkt.pwm_output_raw, pwmRawPkt.motorCount);
+    }
+
+    replayRecord_t record;
+    if (!replayRead(&record)) {
+        replayClose();
+        systemReset();
+    }
+
+    if (!lockstepStarted) {
+        lockstepStarted = true;
+        lockstepStartUs = lockstepNowUs;
+        lockstepStartTimestamp = record.timeUs;
+    }
+
+    const uint64_t endUs = lockstepStartUs + llrint(record.timeUs - lockstepStartTimestamp);
+    lockstepEndUs = MAX(lockstepEndUs, endUs);
+
+    virtualGyroSet(virtualGyroDev,
+        constrain((double)record.gyro[0] * GYRO_SCALE, -32767, 32767),
+        constrain((double)record.gyro[1] * GYRO_SCALE, -32767, 32767),
+        constrain((double)record.gyro[2] * GYRO_SCALE, -32767, 32767));
+    virtualAccSet(virtualAccDev,
+        constrain(record.acc[0] * 256.0f, -32767, 32767),
+        constrain(record.acc[1] * 256.0f, -32767, 32767),
+        constrain(record.acc[2] * 256.0f, -32767, 32767));
+    virtualBaroSet(record.pressurePa, 2500);
+
+    if (record.rcChannelCount > 0) {
+        for (int i = 0; i < SIMULATOR_MAX_RC_CHANNELS; i++) {
+            rcPkt.channels[i] = (i < record.rcChannelCount) ? record.rc[i] : 1500;
+        }
+        if (!rc_received) {
+            rxRuntimeState.channelCount = SIMULATOR_MAX_RC_CHANNELS;
+            rxRuntimeState.rcReadRawFn = readRCSITL;
+            rxRuntimeState.rcFrameStatusFn = rxRCFrameStatus;
+            rxRuntimeState.rxProvider = RX_PROVIDER_UDP;
+            rc_received = true;
+        }
+    }
+}
+
+// Motor outputs of the finished step go to the simulator, then wait for its next state.
+// The new sensor data is applied here in the main loop so runs are reproducible.
+static void lockstepNextStep(void)
+{
+    if (replayTracePath) {
+        replayNextStep();
+        return;
+    }
+
+    if (lockstepStarted) {
+        udpSend(&pwmLink, &pwmPkt, sizeof(servo_packet));
+        udpSend(&pwmRawLink, &pwmRawPkt, sizeof(servo_packet_raw));
+    }
+
+    pthread_mutex_lock(&lockstepLock);
+    while (lockstepQueueCount == 0) {
+        pthread_cond_wait(&lockstepCond, &lockstepLock);
+    }
+    const fdm_packet pkt = lockstepQueue[lockstepQueueHead];
+    lockstepQueueHead = (lockstepQueueHead + 1) % LOCKSTEP_QUEUE_SIZE;
+    lockstepQueueCount--;
+    pthread_cond_signal(&lockstepSpaceCond);
+    pthread_mutex_unlock(&lockstepLock);
+
+    if (!lockstepStarted) {
+        lockstepStarted = true;
+        lockstepStartUs = lockstepNowUs;
+        lockstepStartTimestamp = pkt.timestamp;
+        lockstepLastTimestamp = pkt.timestamp;
+    }
+
+    const double deltaSim = pkt.timestamp - lockstepLastTimestamp;
+    if (deltaSim < 0) { // don't use old packet
+        return;
+    }
+    lockstepLastTimestamp = pkt.timestamp;
+
+    // step end derived from the simulator time itself so rounding doesn't accumulate
+    const uint64_t endUs = lockstepStartUs + llrint((pkt.timestamp - lockstepStartTimestamp) * 1e6);
+    lockstepEndUs = MAX(lockstepEndUs, endUs);
+
+    updateSensors(&pkt, deltaSim);
+}
+
+// Called by the scheduler when nothing needs to run before untilCycles (= us in SITL).
+// In lockstep mode the virtual clock jumps there instead of spinning, waiting for the
+// simulator each time the end of the current step is reached. Nothing to do otherwise.
+void simulatorIdle(uint32_t untilCycles)
+{
+    if (!lockstep) {
+        return;
+    }
+
+    const int32_t idleUs = (int32_t)(untilCycles - (uint32_t)lockstepNowUs);
+    if (idleUs <= 0) {
+        return;
+    }
+
+    const uint64_t targetUs = lockstepNowUs + idleUs;
+    while (targetUs > lockstepEndUs) {
+        lockstepNowUs = MAX(lockstepNowUs, lockstepEndUs);
+        lockstepNextStep();
+    }
+    lockstepNowUs = targetUs;
+}
+
 uint64_t micros64(void)
 {
+    if (lockstep) {
+        return lockstepNowUs;
+    }
+
     static uint64_t last = 0;
     static uint64_t out = 0;
     uint64_t now = nanos64_real();
@@ -431,6 +631,10 @@ uint64_t micros64(void)
 
 uint64_t millis64(void)
 {
+    if (lockstep) {
+        return lockstepNowUs / 1000;
+    }
+
     static uint64_t last = 0;
     static uint64_t out = 0;
     uint64_t now = nanos64_real();
@@ -486,16 +690,30 @@ static void microsleep(uint32_t usec)
 
 void delayMicroseconds(uint32_t us)
 {
+    if (lockstep) {
+        lockstepNowUs += us;
+        return;
+    }
+
     microsleep(us / simRate);
 }
 
 void delayMicroseconds_real(uint32_t us)
 {
+    if (lockstep) {
+        return; // nothing is paced by the wall clock in lockstep mode
+    }
+
     microsleep(us);
 }
 
 void delay(uint32_t ms)
 {
+    if (lockstep) {
+        lockstepNowUs += ms * 1000ULL;
+        return;
+    }
+
     uint64_t start = millis64();
 
     while ((millis64() - start) < ms) {
@@ -565,7 +783,8 @@ static void pwmDisableMotors(void)
 
 static void pwmWriteMotor(uint8_t index, float value)
 {
-    if (pthread_mutex_trylock(&updateLock) != 0) return;
+    // in lockstep mode outputs are sent once per step by the main loop itself, see lockstepNextStep()
+    if (!lockstep && pthread_mutex_trylock(&updateLock) != 0) return;
 
     if (index < MAX_SUPPORTED_MOTORS) {
         motorsPwm[index] = value - idlePulse;
@@ -575,7 +794,9 @@ static void pwmWriteMotor(uint8_t index, float value)
         pwmRawPkt.pwm_output_raw[index] = value;
     }
 
-    pthread_mutex_unlock(&updateLock); // can send PWM output now
+    if (!lockstep) {
+        pthread_mutex_unlock(&updateLock); // can send PWM output now
+    }
 }
 
 static void pwmWriteMotorInt(uint8_t index, uint16_t value)
@@ -603,6 +824,10 @@ static void pwmCompleteMotorUpdate(void)
     pwmPkt.motor_speed[1] = motorsPwm[2] / outScale;
     pwmPkt.motor_speed[2] = motorsPwm[3] / outScale;
 
+    if (lockstep) {
+        return; // sent at the end of the step
+    }
+
     // get one "fdm_packet" can only send one "servo_packet"!!
     if (pthread_mutex_trylock(&updateLock) != 0) return;
     udpSend(&pwmLink, &pwmPkt, sizeof(servo_packet));
@@ -727,6 +952,11 @@ configStreamerResult_e configWriteWord(uintptr_t address, config_streamer_buffer
     STATIC_ASSERT(CONFIG_STREAMER_BUFFER_SIZE == sizeof(uint32_t), "CONFIG_STREAMER_BUFFER_SIZE does not match written size");
 
     if ((address >= (uintptr_t)eepromData) && (address + sizeof(uint32_t) <= (uintptr_t)ARRAYEND(eepromData))) {
+        // Like the MCU flash, a page is erased when the first word in it is written
+        const uintptr_t offset = address - (uintptr_t)eepromData;
+        if (offset % FLASH_PAGE_SIZE == 0) {
+            memset((void*)address, 0xFF, MIN((size_t)FLASH_PAGE_SIZE, sizeof(eepromData) - offset));
+        }
         memcpy((void*)address, buffer, sizeof(config_streamer_buffer_type_t));
         printf("[FLASH_ProgramWord]%p = %08x\n", (void*)address, *((uint32_t*)address));
     } else {
@@ -768,6 +998,12 @@ void IOLo(IO_t io)
     UNUSED(io);
 }
 
+bool IORead(IO_t io)
+{
+    UNUSED(io);
+    return false;
+}
+
 void IOInitGlobal(void)
 {
     // NOOP
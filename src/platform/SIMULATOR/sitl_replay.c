@@ -0,0 +1,152 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+
+#include "sitl_replay.h"
+
+#define REPLAY_LINE_LENGTH_MAX 1024
+#define REPLAY_COLUMN_COUNT_MIN 8 // time, gyro xyz, acc xyz, pressure
+
+static FILE *traceFile;
+static FILE *outputFile;
+static unsigned lineNumber;
+static unsigned recordCount;
+static unsigned outputCount;
+
+bool replayOpen(const char *tracePath, const char *outputPath)
+{
+    traceFile = fopen(tracePath, "r");
+    if (!traceFile) {
+        printf("[replay] can't open trace %s\n", tracePath);
+        return false;
+    }
+
+    outputFile = fopen(outputPath, "w");
+    if (!outputFile) {
+        printf("[replay] can't create output %s\n", outputPath);
+        fclose(traceFile);
+        traceFile = NULL;
+        return false;
+    }
+
+    lineNumber = 0;
+    recordCount = 0;
+    outputCount = 0;
+
+    return true;
+}
+
+// Returns false at the end of the trace
+bool replayRead(replayRecord_t *record)
+{
+    char line[REPLAY_LINE_LENGTH_MAX];
+
+    while (traceFile && fgets(line, sizeof(line), traceFile)) {
+        lineNumber++;
+
+        // every column after the time, extra rc channels are ignored
+        float values[REPLAY_COLUMN_COUNT_MIN - 1 + REPLAY_RC_CHANNEL_COUNT_MAX];
+        double timeUs = 0;
+        int count = 0;
+        char *pos = line;
+        char *end;
+
+        timeUs = strtod(pos, &end);
+        if (end == pos) {
+            continue; // header, comment or empty line
+        }
+        pos = end;
+
+        while (count < (int)(sizeof(values) / sizeof(values[0]))) {
+            while (*pos == ',' || *pos == ' ' || *pos == '\t') {
+                pos++;
+            }
+            const float value = strtof(pos, &end);
+            if (end == pos) {
+                break;
+            }
+            values[count++] = value;
+            pos = end;
+        }
+
+        if (count + 1 < REPLAY_COLUMN_COUNT_MIN) {
+            printf("[replay] line %u: expected at least %d columns, skipped\n", lineNumber, REPLAY_COLUMN_COUNT_MIN);
+            continue;
+        }
+
+        record->timeUs = timeUs;
+        for (int axis = 0; axis < 3; axis++) {
+            record->gyro[axis] = values[axis];
+            record->acc[axis] = values[3 + axis];
+        }
+        record->pressurePa = values[6];
+        record->rcChannelCount = count - (REPLAY_COLUMN_COUNT_MIN - 1);
+        for (int i = 0; i < record->rcChannelCount; i++) {
+            record->rc[i] = values[REPLAY_COLUMN_COUNT_MIN - 1 + i];
+        }
+
+        recordCount++;
+        return true;
+    }
+
+    return false;
+}
+
+void replayWrite(uint64_t timeUs, const float gyroFiltered[3], const float *motors, int motorCount)
+{
+    if (!outputFile) {
+        return;
+    }
+
+    // motors are only known once the firmware is up, so the header comes with the first row
+    if (outputCount++ == 0) {
+        fprintf(outputFile, "time_us,gyro_roll,gyro_pitch,gyro_yaw");
+        for (int i = 0; i < motorCount; i++) {
+            fprintf(outputFile, ",motor%d", i);
+        }
+        fprintf(outputFile, "\n");
+    }
+
+    fprintf(outputFile, "%llu,%.3f,%.3f,%.3f", (unsigned long long)timeUs, (double)gyroFiltered[0], (double)gyroFiltered[1], (double)gyroFiltered[2]);
+    for (int i = 0; i < motorCount; i++) {
+        fprintf(outputFile, ",%.1f", (double)motors[i]);
+    }
+    fprintf(outputFile, "\n");
+}
+
+void replayClose(void)
+{
+    printf("[replay] %u records replayed\n", recordCount);
+
+    if (traceFile) {
+        fclose(traceFile);
+        traceFile = NULL;
+    }
+    if (outputFile) {
+        fclose(outputFile);
+        outputFile = NULL;
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Sensor trace replay for the headless SITL runner (--replay).
+//
+// Trace: CSV, one record per line, '#' comments and a non-numeric header line are skipped.
+//   time (us), gyro roll/pitch/yaw (deg/s), acc x/y/z (g), pressure (Pa)[, rc channel 1..n (us)]
+// Output: CSV with the filtered gyro and the motor outputs at the end of every record.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define REPLAY_RC_CHANNEL_COUNT_MAX SIMULATOR_MAX_RC_CHANNELS
+
+typedef struct replayRecord_s {
+    double timeUs;
+    float gyro[3];          // deg/s, body frame
+    float acc[3];           // g, body frame
+    float pressurePa;
+    int rcChannelCount;
+    uint16_t rc[REPLAY_RC_CHANNEL_COUNT_MAX];
+} replayRecord_t;
+
+bool replayOpen(const char *tracePath, const char *outputPath);
+bool replayRead(replayRecord_t *record);
+void replayWrite(uint64_t timeUs, const float gyroFiltered[3], const float *motors, int motorCount);
+void replayClose(void);
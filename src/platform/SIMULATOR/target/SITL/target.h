@@ -109,6 +109,19 @@
 #define USE_BLACKBOX
 #define USE_BLACKBOX_VIRTUAL
 
+// Onboard flash for blackbox, simulated in RAM
+#define USE_FLASH
+#define USE_FLASH_RAM
+
+// SD card backed by an image file, with a larger cache than the flight controllers can afford
+#define USE_SDCARD
+#define USE_SDCARD_FILE
+#define AFATFS_NUM_CACHE_SECTORS 32
+#define AFATFS_WRITE_BEHIND_SECTORS 8
+
+// Trace markers for MSP2_TRACE_DUMP, SITL's cycle counter counts microseconds
+#define USE_TRACE
+
 #undef USE_STACK_CHECK // I think SITL don't need this
 #undef USE_DASHBOARD
 #undef USE_TELEMETRY_LTM
@@ -276,5 +289,6 @@ uint64_t micros64(void);
 uint64_t millis64(void);
 
 int lockMainPID(void);
+void simulatorIdle(uint32_t untilCycles);
 
 int targetParseArgs(int argc, char * argv[]);
@@ -7,6 +7,14 @@ TARGET_SRC = \
             drivers/barometer/barometer_virtual.c \
             drivers/compass/compass_virtual.c \
             drivers/serial_tcp.c \
+            drivers/flash/flash.c \
+            drivers/flash/flash_ram.c \
+            drivers/sdcard.c \
+            drivers/sdcard_file.c \
+            drivers/sdcard_standard.c \
+            io/asyncfatfs/asyncfatfs.c \
+            io/asyncfatfs/fat_standard.c \
+            io/flashfs.c \
             io/gps_virtual.c \
             blackbox/blackbox_virtual.c
 
@@ -0,0 +1,121 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform.h"
+
+#ifdef USE_CRC_HARDWARE
+
+#if defined(STM32F7)
+#include "stm32f7xx_ll_crc.h"
+#elif defined(STM32H7)
+#include "stm32h7xx_ll_crc.h"
+#elif defined(STM32G4)
+#include "stm32g4xx_ll_crc.h"
+#endif
+
+#include "common/crc.h"
+
+#include "drivers/crc_hardware.h"
+
+// Set whilst a CRC is being calculated, an interrupt finding it set uses the software CRC instead
+static volatile bool crcBusy;
+
+static bool crcStart(uint32_t polynomial, uint32_t polynomialSize, uint32_t initial)
+{
+    if (crcBusy) {
+        return false;
+    }
+    crcBusy = true;
+
+    LL_CRC_SetPolynomialCoef(CRC, polynomial);
+    LL_CRC_SetPolynomialSize(CRC, polynomialSize);
+    LL_CRC_SetInitialData(CRC, initial);
+    LL_CRC_ResetCRCCalculationUnit(CRC);
+
+    return true;
+}
+
+static void crcFeed(const void *data, uint32_t length)
+{
+    const uint8_t *p = data;
+
+    // Words are processed most significant byte first, so swap them to keep the bytes in memory order
+    for (; length >= sizeof(uint32_t); length -= sizeof(uint32_t), p += sizeof(uint32_t)) {
+        uint32_t word;
+        memcpy(&word, p, sizeof(word));
+        LL_CRC_FeedData32(CRC, __REV(word));
+    }
+
+    for (; length; length--) {
+        LL_CRC_FeedData8(CRC, *p++);
+    }
+}
+
+static bool crcHardwareCcittUpdate(uint16_t *crc, const void *data, uint32_t length)
+{
+    if (!crcStart(0x1021, LL_CRC_POLYLENGTH_16B, *crc)) {
+        return false;
+    }
+
+    crcFeed(data, length);
+    *crc = LL_CRC_ReadData16(CRC);
+
+    crcBusy = false;
+    return true;
+}
+
+static bool crcHardwareDvbS2Update(uint8_t *crc, const void *data, uint32_t length)
+{
+    if (!crcStart(CRC8_POLY_DVB_S2, LL_CRC_POLYLENGTH_8B, *crc)) {
+        return false;
+    }
+
+    crcFeed(data, length);
+    *crc = LL_CRC_ReadData8(CRC);
+
+    crcBusy = false;
+    return true;
+}
+
+static const crcEngine_t crcHardwareEngine = {
+    .crc16CcittUpdate = crcHardwareCcittUpdate,
+    .crc8DvbS2Update = crcHardwareDvbS2Update,
+};
+
+void crcHardwareInit(void)
+{
+#if defined(STM32H7)
+    LL_AHB4_GRP1_EnableClock(LL_AHB4_GRP1_PERIPH_CRC);
+#else
+    LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_CRC);
+#endif
+
+    LL_CRC_SetInputDataReverseMode(CRC, LL_CRC_INDATA_REVERSE_NONE);
+    LL_CRC_SetOutputDataReverseMode(CRC, LL_CRC_OUTDATA_REVERSE_NONE);
+
+    crcSetHardwareEngine(&crcHardwareEngine);
+}
+
+#endif // USE_CRC_HARDWARE
@@ -195,6 +195,11 @@
 #define USE_LATE_TASK_STATISTICS
 #endif
 
+#if defined(STM32F7) || defined(STM32H7) || defined(STM32G4)
+// The CRC peripheral has a programmable polynomial
+#define USE_CRC_HARDWARE
+#endif
+
 #if defined(STM32F4) || defined(STM32F7) || defined(STM32H7) || defined(STM32G4)
 #define TASK_GYROPID_DESIRED_PERIOD     125 // 125us = 8kHz
 #define SCHEDULER_DELAY_LIMIT           10
@@ -314,6 +314,7 @@ MCU_COMMON_SRC = \
             STM32/timer_stm32h7xx.c \
             STM32/transponder_ir_io_hal.c \
             STM32/camera_control_stm32.c \
+            STM32/crc_stm32.c \
             drivers/adc.c \
             drivers/serial_escserial.c \
             STM32/startup/system_stm32h7xx.c
@@ -406,6 +406,30 @@ uint32_t CDC_Receive_BytesAvailable(void)
     return rxAvailable;
 }
 
+// The rest of the received packet, left in place until consumed
+uint32_t CDC_Receive_Span(const uint8_t **data)
+{
+    if (rxBuffPtr == NULL) {
+        return 0;
+    }
+
+    *data = rxBuffPtr;
+    return rxAvailable;
+}
+
+void CDC_Receive_Consume(uint32_t count)
+{
+    if (count == 0) {
+        return;
+    }
+
+    rxBuffPtr += count;
+    rxAvailable -= count;
+    if (rxAvailable < 1) {
+        USBD_CDC_ReceivePacket(&USBD_Device);
+    }
+}
+
 uint32_t CDC_Send_FreeBytes(void)
 {
     /*
@@ -244,6 +244,26 @@ uint32_t CDC_Receive_BytesAvailable(void)
     return (APP_Tx_ptr_in + APP_TX_DATA_SIZE - APP_Tx_ptr_out) % APP_TX_DATA_SIZE;
 }
 
+/*******************************************************************************
+ * Function Name  : Receive Span.
+ * Description    : the received data up to the end of the circular buffer, left in place until consumed
+ * Input          : None.
+ * Output         : data: the first received byte.
+ * Return         : the number of bytes at data.
+ *******************************************************************************/
+uint32_t CDC_Receive_Span(const uint8_t **data)
+{
+    const uint32_t in = APP_Tx_ptr_in;
+
+    *data = &APP_Tx_Buffer[APP_Tx_ptr_out];
+    return (in >= APP_Tx_ptr_out ? in : APP_TX_DATA_SIZE) - APP_Tx_ptr_out;
+}
+
+void CDC_Receive_Consume(uint32_t count)
+{
+    APP_Tx_ptr_out = (APP_Tx_ptr_out + count) % APP_TX_DATA_SIZE;
+}
+
 /**
  * @brief  VCP_DataRx
  *         Data received over USB OUT endpoint are sent over CDC interface
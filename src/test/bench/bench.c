@@ -0,0 +1,240 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "bench.h"
+
+#define BENCH_ITERATIONS_DEFAULT 200000
+#define BENCH_OVERHEAD_SAMPLES   10000
+
+typedef enum {
+    COUNTER_CYCLES = 0,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CACHE_MISSES,
+    COUNTER_COUNT
+} counter_e;
+
+static uint32_t iterations = BENCH_ITERATIONS_DEFAULT;
+static uint64_t timerOverheadNs;
+static int counterFd[COUNTER_COUNT] = { -1, -1, -1 };
+static volatile float sink;
+
+#ifdef __linux__
+static int openCounter(uint64_t config, int groupFd)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = (groupFd == -1);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+#endif
+
+static void openCounters(void)
+{
+#ifdef __linux__
+    counterFd[COUNTER_CYCLES] = openCounter(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (counterFd[COUNTER_CYCLES] < 0) {
+        return; // no access to hardware counters (e.g. container or perf_event_paranoid), timing only
+    }
+    counterFd[COUNTER_INSTRUCTIONS] = openCounter(PERF_COUNT_HW_INSTRUCTIONS, counterFd[COUNTER_CYCLES]);
+    counterFd[COUNTER_CACHE_MISSES] = openCounter(PERF_COUNT_HW_CACHE_MISSES, counterFd[COUNTER_CYCLES]);
+#endif
+}
+
+static void calibrateTimerOverhead(void)
+{
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < BENCH_OVERHEAD_SAMPLES; i++) {
+        const uint64_t start = benchNowNs();
+        const uint64_t delta = benchNowNs() - start;
+        if (delta < best) {
+            best = delta;
+        }
+    }
+    timerOverheadNs = best;
+}
+
+void benchInit(int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+        case 'n':
+            iterations = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n iterations]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (iterations == 0) {
+        iterations = BENCH_ITERATIONS_DEFAULT;
+    }
+
+    calibrateTimerOverhead();
+    openCounters();
+}
+
+uint32_t benchIterations(void)
+{
+    return iterations;
+}
+
+uint64_t benchNowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void benchCountersStart(void)
+{
+#ifdef __linux__
+    if (counterFd[COUNTER_CYCLES] >= 0) {
+        ioctl(counterFd[COUNTER_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(counterFd[COUNTER_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+void benchCountersStop(benchCounters_t *counters)
+{
+    memset(counters, 0, sizeof(*counters));
+#ifdef __linux__
+    if (counterFd[COUNTER_CYCLES] < 0) {
+        return;
+    }
+
+    ioctl(counterFd[COUNTER_CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    uint64_t value[COUNTER_COUNT] = { 0 };
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (counterFd[i] < 0 || read(counterFd[i], &value[i], sizeof(value[i])) != sizeof(value[i])) {
+            return;
+        }
+    }
+
+    counters->cycles = value[COUNTER_CYCLES];
+    counters->instructions = value[COUNTER_INSTRUCTIONS];
+    counters->cacheMisses = value[COUNTER_CACHE_MISSES];
+    counters->valid = true;
+#endif
+}
+
+void benchResultInit(benchResult_t *result, const char *name, uint32_t looprateHz, uint32_t iterations)
+{
+    memset(result, 0, sizeof(*result));
+    result->name = name;
+    result->looprateHz = looprateHz;
+    result->iterations = iterations;
+}
+
+benchStage_t *benchResultAddStage(benchResult_t *result, const char *name)
+{
+    if (result->stageCount >= BENCH_STAGE_COUNT_MAX) {
+        fprintf(stderr, "too many benchmark stages\n");
+        exit(EXIT_FAILURE);
+    }
+
+    benchStage_t *stage = &result->stages[result->stageCount++];
+    stage->name = name;
+    stage->minNs = UINT64_MAX;
+    return stage;
+}
+
+void benchStageAdd(benchStage_t *stage, uint64_t ns)
+{
+    // remove the cost of reading the clock itself
+    ns = (ns > timerOverheadNs) ? ns - timerOverheadNs : 0;
+
+    stage->totalNs += ns;
+    stage->count++;
+    if (ns < stage->minNs) {
+        stage->minNs = ns;
+    }
+    if (ns > stage->maxNs) {
+        stage->maxNs = ns;
+    }
+}
+
+void benchReport(const benchResult_t *result)
+{
+    const double iterationNs = (double)result->totalNs / result->iterations;
+    const double budgetNs = 1e9 / result->looprateHz;
+
+    printf("\n%s @ %u Hz (%u iterations)\n", result->name, (unsigned)result->looprateHz, (unsigned)result->iterations);
+    printf("  total: %9.1f ns/iteration (%5.2f%% of %.0f ns loop budget)\n", iterationNs, 100.0 * iterationNs / budgetNs, budgetNs);
+
+    if (result->counters.valid) {
+        printf("  counters: %.1f cycles, %.1f instructions, %.3f cache misses per iteration\n",
+            (double)result->counters.cycles / result->iterations,
+            (double)result->counters.instructions / result->iterations,
+            (double)result->counters.cacheMisses / result->iterations);
+    } else {
+        printf("  counters: unavailable\n");
+    }
+
+    if (result->stageCount == 0) {
+        return;
+    }
+
+    uint64_t stagesNs = 0;
+    for (int i = 0; i < result->stageCount; i++) {
+        stagesNs += result->stages[i].totalNs;
+    }
+
+    printf("  %-32s %12s %10s %10s %8s\n", "stage", "ns/call", "min", "max", "share");
+    for (int i = 0; i < result->stageCount; i++) {
+        const benchStage_t *stage = &result->stages[i];
+        if (stage->count == 0) {
+            continue;
+        }
+        printf("  %-32s %12.1f %10llu %10llu %7.1f%%\n",
+            stage->name,
+            (double)stage->totalNs / stage->count,
+            (unsigned long long)stage->minNs,
+            (unsigned long long)stage->maxNs,
+            stagesNs ? 100.0 * stage->totalNs / stagesNs : 0.0);
+    }
+}
+
+void benchSink(float value)
+{
+    sink = value;
+}
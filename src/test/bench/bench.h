@@ -0,0 +1,80 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Minimal host-side microbenchmark harness.
+// Times real firmware functions compiled for the host and reports ns/iteration,
+// an optional per-stage breakdown and (on Linux, when permitted) hardware
+// counters such as cache misses via perf_event_open().
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BENCH_STAGE_COUNT_MAX 16
+
+typedef struct benchStage_s {
+    const char *name;
+    uint64_t totalNs;
+    uint64_t minNs;
+    uint64_t maxNs;
+    uint32_t count;
+} benchStage_t;
+
+typedef struct benchCounters_s {
+    bool valid;
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t cacheMisses;
+} benchCounters_t;
+
+typedef struct benchResult_s {
+    const char *name;
+    uint32_t looprateHz;
+    uint32_t iterations;
+    uint64_t totalNs;
+    benchCounters_t counters;
+    int stageCount;
+    benchStage_t stages[BENCH_STAGE_COUNT_MAX];
+} benchResult_t;
+
+void benchInit(int argc, char *argv[]);
+uint32_t benchIterations(void);
+uint64_t benchNowNs(void);
+
+void benchCountersStart(void);
+void benchCountersStop(benchCounters_t *counters);
+
+void benchResultInit(benchResult_t *result, const char *name, uint32_t looprateHz, uint32_t iterations);
+benchStage_t *benchResultAddStage(benchResult_t *result, const char *name);
+void benchStageAdd(benchStage_t *stage, uint64_t ns);
+void benchReport(const benchResult_t *result);
+
+// Prevent the compiler from optimising away results that are otherwise unused
+void benchSink(float value);
+
+// Time a single statement (or block) and accumulate it into a stage
+#define BENCH_STAGE(stage, code) \
+    do { \
+        const uint64_t benchStartNs_ = benchNowNs(); \
+        code; \
+        benchStageAdd((stage), benchNowNs() - benchStartNs_); \
+    } while (0)
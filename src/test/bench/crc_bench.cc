@@ -0,0 +1,234 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// CRC benchmark.
+// Checks crc16_ccitt_update() and crc8_dvb_s2_update() against the bit by bit
+// CRCs they replaced, and fletcher8_update() against the UBX byte loop, then
+// times them for buffers the size of a CRSF frame, an MSP frame and a
+// config/flash page.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/crc.h"
+    #include "common/maths.h"
+    #include "common/utils.h"
+
+    #include "bench.h"
+}
+
+#define BENCH_LOOPRATE_HZ   8000
+#define BENCH_BUFFER_SIZE   1024
+
+static const uint32_t lengths[] = { 16, 64, BENCH_BUFFER_SIZE };
+
+static uint8_t buffer[BENCH_BUFFER_SIZE];
+
+static uint16_t bitwiseCrc16Ccitt(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    while (length--) {
+        crc ^= (uint16_t)*data++ << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint8_t bitwiseCrc8DvbS2(uint8_t crc, const uint8_t *data, uint32_t length)
+{
+    while (length--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0xD5 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint16_t bytewiseCrc16Ccitt(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    while (length--) {
+        crc = crc16_ccitt(crc, *data++);
+    }
+    return crc;
+}
+
+static uint8_t bytewiseCrc8DvbS2(uint8_t crc, const uint8_t *data, uint32_t length)
+{
+    while (length--) {
+        crc = crc8_dvb_s2(crc, *data++);
+    }
+    return crc;
+}
+
+static uint16_t bytewiseFletcher8(uint16_t checksum, const uint8_t *data, uint32_t length)
+{
+    uint8_t a = checksum;
+    uint8_t b = checksum >> 8;
+    while (length--) {
+        a += *data++;
+        b += a;
+    }
+    return a | b << 8;
+}
+
+static void checkEquivalence(void)
+{
+    for (uint32_t offset = 0; offset < 8; offset++) {
+        for (uint32_t length = 0; length <= BENCH_BUFFER_SIZE - offset; length++) {
+            const uint8_t *data = buffer + offset;
+            const uint16_t crc16 = bitwiseCrc16Ccitt(0, data, length);
+            const uint8_t crc8 = bitwiseCrc8DvbS2(0, data, length);
+
+            if (crc16_ccitt_update(0, data, length) != crc16 || bytewiseCrc16Ccitt(0, data, length) != crc16
+                || crc8_dvb_s2_update(0, data, length) != crc8 || bytewiseCrc8DvbS2(0, data, length) != crc8
+                || fletcher8_update(0, data, length) != bytewiseFletcher8(0, data, length)) {
+                fprintf(stderr, "CRC mismatch at offset %u length %u\n", (unsigned)offset, (unsigned)length);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    printf("crc16_ccitt_update() and crc8_dvb_s2_update() match the bitwise CRCs, fletcher8_update() the byte loop\n");
+}
+
+// Fewer iterations for longer buffers so each result takes about as long
+static uint32_t iterationsFor(uint32_t length)
+{
+    return MAX(benchIterations() * lengths[0] / length, 1U);
+}
+
+static void benchCrc16(uint32_t length)
+{
+    const uint32_t iterations = iterationsFor(length);
+    char name[48];
+    benchResult_t result;
+    uint16_t crc = 0;
+
+    snprintf(name, sizeof(name), "crc16_ccitt_update, %u bytes", (unsigned)length);
+    benchResultInit(&result, name, BENCH_LOOPRATE_HZ, iterations);
+
+    benchCountersStart();
+    const uint64_t startNs = benchNowNs();
+    for (uint32_t i = 0; i < iterations; i++) {
+        crc = crc16_ccitt_update(crc, buffer, length);
+    }
+    result.totalNs = benchNowNs() - startNs;
+    benchCountersStop(&result.counters);
+
+    benchStage_t *stageBitwise = benchResultAddStage(&result, "bitwise");
+    benchStage_t *stageBytewise = benchResultAddStage(&result, "crc16_ccitt() per byte");
+    benchStage_t *stageUpdate = benchResultAddStage(&result, "crc16_ccitt_update()");
+    for (uint32_t i = 0; i < iterations; i++) {
+        BENCH_STAGE(stageBitwise, crc = bitwiseCrc16Ccitt(crc, buffer, length));
+        BENCH_STAGE(stageBytewise, crc = bytewiseCrc16Ccitt(crc, buffer, length));
+        BENCH_STAGE(stageUpdate, crc = crc16_ccitt_update(crc, buffer, length));
+    }
+
+    benchSink(crc);
+    benchReport(&result);
+}
+
+static void benchCrc8(uint32_t length)
+{
+    const uint32_t iterations = iterationsFor(length);
+    char name[48];
+    benchResult_t result;
+    uint8_t crc = 0;
+
+    snprintf(name, sizeof(name), "crc8_dvb_s2_update, %u bytes", (unsigned)length);
+    benchResultInit(&result, name, BENCH_LOOPRATE_HZ, iterations);
+
+    benchCountersStart();
+    const uint64_t startNs = benchNowNs();
+    for (uint32_t i = 0; i < iterations; i++) {
+        crc = crc8_dvb_s2_update(crc, buffer, length);
+    }
+    result.totalNs = benchNowNs() - startNs;
+    benchCountersStop(&result.counters);
+
+    benchStage_t *stageBitwise = benchResultAddStage(&result, "bitwise");
+    benchStage_t *stageBytewise = benchResultAddStage(&result, "crc8_dvb_s2() per byte");
+    benchStage_t *stageUpdate = benchResultAddStage(&result, "crc8_dvb_s2_update()");
+    for (uint32_t i = 0; i < iterations; i++) {
+        BENCH_STAGE(stageBitwise, crc = bitwiseCrc8DvbS2(crc, buffer, length));
+        BENCH_STAGE(stageBytewise, crc = bytewiseCrc8DvbS2(crc, buffer, length));
+        BENCH_STAGE(stageUpdate, crc = crc8_dvb_s2_update(crc, buffer, length));
+    }
+
+    benchSink(crc);
+    benchReport(&result);
+}
+
+static void benchFletcher8(uint32_t length)
+{
+    const uint32_t iterations = iterationsFor(length);
+    char name[48];
+    benchResult_t result;
+    uint16_t checksum = 0;
+
+    snprintf(name, sizeof(name), "fletcher8_update, %u bytes", (unsigned)length);
+    benchResultInit(&result, name, BENCH_LOOPRATE_HZ, iterations);
+
+    benchCountersStart();
+    const uint64_t startNs = benchNowNs();
+    for (uint32_t i = 0; i < iterations; i++) {
+        checksum = fletcher8_update(checksum, buffer, length);
+    }
+    result.totalNs = benchNowNs() - startNs;
+    benchCountersStop(&result.counters);
+
+    benchStage_t *stageBytewise = benchResultAddStage(&result, "per byte");
+    benchStage_t *stageUpdate = benchResultAddStage(&result, "fletcher8_update()");
+    for (uint32_t i = 0; i < iterations; i++) {
+        BENCH_STAGE(stageBytewise, checksum = bytewiseFletcher8(checksum, buffer, length));
+        BENCH_STAGE(stageUpdate, checksum = fletcher8_update(checksum, buffer, length));
+    }
+
+    benchSink(checksum);
+    benchReport(&result);
+}
+
+int main(int argc, char *argv[])
+{
+    benchInit(argc, argv);
+
+    uint32_t seed = 1;
+    for (unsigned i = 0; i < sizeof(buffer); i++) {
+        seed = seed * 1103515245 + 12345;
+        buffer[i] = seed >> 16;
+    }
+
+    checkEquivalence();
+
+    for (unsigned i = 0; i < ARRAYLEN(lengths); i++) {
+        benchCrc16(lengths[i]);
+        benchCrc8(lengths[i]);
+        benchFletcher8(lengths[i]);
+    }
+
+    return EXIT_SUCCESS;
+}
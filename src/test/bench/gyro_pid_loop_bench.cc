@@ -0,0 +1,353 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Gyro -> filter -> PID -> mixer hot path benchmark.
+// Links the real gyroFiltering(), rpmFilterUpdate()/rpmFilterApply(),
+// dynNotchUpdate()/dynNotchFilter(), pidController() and mixTable() and feeds
+// them a synthetic gyro stream made of motor noise harmonics, a frame resonance
+// and white noise, at 4k, 8k and 32k loop rates.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <cmath>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "build/debug.h"
+
+    #include "common/axis.h"
+    #include "common/maths.h"
+    #include "common/filter.h"
+
+    #include "config/config.h"
+    #include "config/feature.h"
+
+    #include "drivers/dshot.h"
+    #include "drivers/motor.h"
+    #include "drivers/system.h"
+    #include "drivers/time.h"
+
+    #include "fc/controlrate_profile.h"
+    #include "fc/core.h"
+    #include "fc/rc.h"
+    #include "fc/rc_controls.h"
+    #include "fc/rc_modes.h"
+    #include "fc/runtime_config.h"
+
+    #include "io/beeper.h"
+    #include "io/gps.h"
+
+    #include "flight/dyn_notch_filter.h"
+    #include "flight/imu.h"
+    #include "flight/mixer.h"
+    #include "flight/mixer_init.h"
+    #include "flight/pid.h"
+    #include "flight/pid_init.h"
+    #include "flight/rpm_filter.h"
+
+    #include "pg/motor.h"
+    #include "pg/pg.h"
+    #include "pg/rpm_filter.h"
+    #include "pg/dyn_notch.h"
+
+    #include "rx/rx.h"
+
+    #include "scheduler/scheduler.h"
+
+    #include "sensors/acceleration.h"
+    #include "sensors/gyro.h"
+    #include "sensors/gyro_init.h"
+    #include "sensors/sensors.h"
+
+    #include "bench.h"
+
+    STATIC_UNIT_TESTED void gyroApplyFilterStages(float values[XYZ_AXIS_COUNT]);
+}
+
+#define BENCH_MOTOR_COUNT       4
+#define BENCH_IDLE_MOTOR_HZ     120.0f
+#define BENCH_MAX_MOTOR_HZ      600.0f
+#define BENCH_FRAME_RESONANCE_HZ 180.0f
+
+static const uint32_t looprates[] = { 4000, 8000, 32000 };
+
+static timeUs_t currentTimeUs;
+static float throttleCommand;
+static float motorHz[BENCH_MOTOR_COUNT];
+static uint32_t motorHzUpdateCount;
+static float motorPhase[BENCH_MOTOR_COUNT];
+static float resonancePhase;
+static uint32_t noiseSeed = 1;
+
+static float whiteNoise(void)
+{
+    // xorshift32, deterministic across runs
+    noiseSeed ^= noiseSeed << 13;
+    noiseSeed ^= noiseSeed >> 17;
+    noiseSeed ^= noiseSeed << 5;
+    return (noiseSeed & 0xffff) / 32768.0f - 1.0f;
+}
+
+// Advance the synthetic model by one loop and leave a raw sample in the gyro downsampling accumulator
+static void synthesizeGyroSample(uint32_t iteration, float dtS)
+{
+    // slow throttle sweep so the RPM and dynamic notches keep moving
+    throttleCommand = 0.5f + 0.4f * sinf(2.0f * M_PIf * 0.5f * iteration * dtS);
+
+    float motorNoise = 0.0f;
+    for (int motor = 0; motor < BENCH_MOTOR_COUNT; motor++) {
+        motorHz[motor] = BENCH_IDLE_MOTOR_HZ + (BENCH_MAX_MOTOR_HZ - BENCH_IDLE_MOTOR_HZ) * throttleCommand * (1.0f + 0.02f * motor);
+        motorPhase[motor] += 2.0f * M_PIf * motorHz[motor] * dtS;
+        if (motorPhase[motor] > 2.0f * M_PIf) {
+            motorPhase[motor] -= 2.0f * M_PIf;
+        }
+        motorNoise += 20.0f * sinf(motorPhase[motor]) + 8.0f * sinf(2.0f * motorPhase[motor]) + 4.0f * sinf(3.0f * motorPhase[motor]);
+    }
+    // RPM telemetry arrives every loop
+    motorHzUpdateCount++;
+
+    resonancePhase += 2.0f * M_PIf * BENCH_FRAME_RESONANCE_HZ * dtS;
+    if (resonancePhase > 2.0f * M_PIf) {
+        resonancePhase -= 2.0f * M_PIf;
+    }
+    const float resonance = 15.0f * sinf(resonancePhase);
+
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        const float motion = 100.0f * sinf(2.0f * M_PIf * 2.0f * iteration * dtS + axis);
+        gyro.gyroADC[axis] = motion + motorNoise * (1.0f - 0.2f * axis) + resonance + 5.0f * whiteNoise();
+        gyro.sampleSum[axis] = gyro.gyroADC[axis];
+    }
+    gyro.sampleCount = 1;
+}
+
+static void setupLoop(uint32_t looprateHz)
+{
+    pgResetAll();
+
+    rpmFilterConfigMutable()->rpm_filter_harmonics = 3;
+    dynNotchConfigMutable()->dyn_notch_count = 3;
+    gyroConfigMutable()->gyro_soft_notch_hz_1 = 0;
+    gyroConfigMutable()->gyro_soft_notch_hz_2 = 0;
+
+    currentPidProfile = pidProfilesMutable(0);
+    loadControlRateProfile();
+    useDshotTelemetry = true;
+
+    gyro.sampleRateHz = looprateHz;
+    gyroSetTargetLooptime(1);
+    gyroInitFilters();
+
+    mixerInit(MIXER_QUADX);
+    mixerInitProfile();
+
+    pidInit(currentPidProfile);
+    pidStabilisationState(PID_STABILISATION_ON);
+    ENABLE_ARMING_FLAG(ARMED);
+
+    currentTimeUs = 0;
+    for (int motor = 0; motor < BENCH_MOTOR_COUNT; motor++) {
+        motorPhase[motor] = 0.0f;
+    }
+    resonancePhase = 0.0f;
+    noiseSeed = 1;
+}
+
+static void runLoop(uint32_t iteration, float dtS)
+{
+    synthesizeGyroSample(iteration, dtS);
+    rpmFilterUpdate();
+    gyroFiltering(currentTimeUs);
+    pidController(currentPidProfile, currentTimeUs);
+    mixTable(currentTimeUs);
+    currentTimeUs += gyro.targetLooptime;
+}
+
+static void benchLoop(uint32_t looprateHz)
+{
+    const uint32_t iterations = benchIterations();
+    benchResult_t result;
+
+    setupLoop(looprateHz);
+    const float dtS = gyro.targetLooptime * 1e-6f;
+
+    // warm up filters, caches and branch predictors
+    for (uint32_t i = 0; i < iterations / 10; i++) {
+        runLoop(i, dtS);
+    }
+
+    benchResultInit(&result, "gyro/filter/pid/mixer loop", looprateHz, iterations);
+
+    // uninstrumented pass for total ns/iteration and hardware counters
+    benchCountersStart();
+    const uint64_t startNs = benchNowNs();
+    for (uint32_t i = 0; i < iterations; i++) {
+        runLoop(i, dtS);
+    }
+    result.totalNs = benchNowNs() - startNs;
+    benchCountersStop(&result.counters);
+
+    // instrumented pass for the per-stage breakdown
+    benchStage_t *stageRpmUpdate = benchResultAddStage(&result, "rpmFilterUpdate");
+    benchStage_t *stageGyroFiltering = benchResultAddStage(&result, "gyroFiltering");
+    benchStage_t *stagePid = benchResultAddStage(&result, "pidController");
+    benchStage_t *stageMixer = benchResultAddStage(&result, "mixTable");
+
+    for (uint32_t i = 0; i < iterations; i++) {
+        synthesizeGyroSample(i, dtS);
+        BENCH_STAGE(stageRpmUpdate, rpmFilterUpdate());
+        BENCH_STAGE(stageGyroFiltering, gyroFiltering(currentTimeUs));
+        BENCH_STAGE(stagePid, pidController(currentPidProfile, currentTimeUs));
+        BENCH_STAGE(stageMixer, mixTable(currentTimeUs));
+        currentTimeUs += gyro.targetLooptime;
+    }
+
+    benchSink(motor[0]);
+    benchReport(&result);
+}
+
+// Breakdown of the stages that gyroFiltering() runs internally
+static void benchGyroFilterStages(uint32_t looprateHz)
+{
+    const uint32_t iterations = benchIterations();
+    benchResult_t result;
+
+    setupLoop(looprateHz);
+    const float dtS = gyro.targetLooptime * 1e-6f;
+
+    benchResultInit(&result, "gyroFiltering stages", looprateHz, iterations);
+    benchStage_t *stageRpmApply = benchResultAddStage(&result, "rpmFilterApply (3 axes)");
+    benchStage_t *stageStatic = benchResultAddStage(&result, "notch1/notch2/lowpass (3 axes)");
+    benchStage_t *stageDynNotchFilter = benchResultAddStage(&result, "dynNotchFilter (3 axes)");
+    benchStage_t *stageDynNotchUpdate = benchResultAddStage(&result, "dynNotchUpdate");
+
+    const uint64_t startNs = benchNowNs();
+    float output = 0.0f;
+    for (uint32_t i = 0; i < iterations; i++) {
+        synthesizeGyroSample(i, dtS);
+        rpmFilterUpdate();
+
+        float sample[XYZ_AXIS_COUNT];
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            sample[axis] = gyro.sampleSum[axis];
+        }
+
+        BENCH_STAGE(stageRpmApply, rpmFilterApply(sample));
+        BENCH_STAGE(stageStatic, gyroApplyFilterStages(sample));
+        BENCH_STAGE(stageDynNotchFilter,
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                dynNotchPush(axis, sample[axis]);
+                sample[axis] = dynNotchFilter(axis, sample[axis]);
+            }
+        );
+        BENCH_STAGE(stageDynNotchUpdate, dynNotchUpdate());
+
+        output += sample[FD_ROLL];
+    }
+    result.totalNs = benchNowNs() - startNs;
+
+    benchSink(output);
+    benchReport(&result);
+}
+
+int main(int argc, char *argv[])
+{
+    benchInit(argc, argv);
+
+    for (unsigned i = 0; i < ARRAYLEN(looprates); i++) {
+        benchLoop(looprates[i]);
+        benchGyroFilterStages(looprates[i]);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// STUBS
+
+extern "C" {
+    uint8_t debugMode;
+    int16_t debug[DEBUG16_VALUE_COUNT];
+
+    acc_t acc;
+    attitudeEulerAngles_t attitude;
+    gpsSolutionData_t gpsSol;
+    rxRuntimeState_t rxRuntimeState;
+    float rcCommand[4];
+    float rcData[MAX_SUPPORTED_RC_CHANNEL_COUNT];
+    bool useDshotTelemetry;
+    pidProfile_t *currentPidProfile;
+    uint8_t detectedSensors[SENSOR_INDEX_COUNT];
+    uint8_t detectedGyros[GYRO_COUNT];
+
+    PG_REGISTER(accelerometerConfig_t, accelerometerConfig, PG_ACCELEROMETER_CONFIG, 0);
+    PG_REGISTER(systemConfig_t, systemConfig, PG_SYSTEM_CONFIG, 2);
+    PG_REGISTER(flight3DConfig_t, flight3DConfig, PG_MOTOR_3D_CONFIG, 0);
+
+    uint32_t micros(void) { return currentTimeUs; }
+    uint32_t millis(void) { return currentTimeUs / 1000; }
+
+    float getMotorFrequencyHz(uint8_t motorIndex) { return motorHz[motorIndex % BENCH_MOTOR_COUNT]; }
+    uint32_t getMotorFrequencyUpdateCount(void) { return motorHzUpdateCount; }
+    float schedulerGetCycleTimeMultiplier(void) { return 1.0f; }
+
+    float getSetpointRate(int axis) { return 200.0f * sinf(currentTimeUs * 1e-6f + axis); }
+    float getRcDeflection(int axis) { return getSetpointRate(axis) / 670.0f; }
+    float getRcDeflectionRaw(int axis) { return getRcDeflection(axis); }
+    float getRcDeflectionAbs(int axis) { return fabsf(getRcDeflection(axis)); }
+    float getMaxRcDeflectionAbs(void) { return 0.3f; }
+    float getRawSetpoint(int axis) { return getSetpointRate(axis); }
+    float getFeedforward(int axis) { UNUSED(axis); return 0.0f; }
+    float getMaxRcRate(int axis) { UNUSED(axis); return 670.0f; }
+    float getThrottle(void) { return throttleCommand; }
+    bool wasThrottleRaised(void) { return true; }
+    bool isLaunchControlActive(void) { return false; }
+    bool isBelowLandingAltitude(void) { return false; }
+    void disarm(flightLogDisarmReason_e) { }
+    void systemBeep(bool) { }
+    void beeperConfirmationBeeps(uint8_t) { }
+    void initRcProcessing(void) { }
+    uint8_t calculateThrottlePercentAbs(void) { return throttleCommand * 100; }
+    float getCosTiltAngle(void) { return 1.0f; }
+    bool isCrashFlipModeActive(void) { return false; }
+    bool isMotorsReversed(void) { return false; }
+    bool failsafeIsActive(void) { return false; }
+    bool isMotorProtocolDshot(void) { return true; }
+    void motorWriteAll(float *) { }
+    void motorInitEndpoints(const motorConfig_t *, float outputLimit, float *outputLow, float *outputHigh, float *disarm, float *deadbandMotor3dHigh, float *deadbandMotor3dLow)
+    {
+        // DShot endpoints
+        *disarm = 0.0f;
+        *outputLow = 48.0f;
+        *outputHigh = 48.0f + 1999.0f * outputLimit;
+        *deadbandMotor3dHigh = 1048.0f;
+        *deadbandMotor3dLow = 1047.0f;
+    }
+    void dshotSetPidLoopTime(uint32_t) { }
+    void mixerTricopterInit(void) { }
+    float mixerTricopterMotorCorrection(int) { return 0.0f; }
+    void schedulerResetTaskStatistics(taskId_e) { }
+    void beeper(beeperMode_e) { }
+    void writeEEPROM(void) { }
+    void delay(uint32_t) { }
+    void failureMode(failureMode_e) { }
+    void parseRcChannels(const char *, rxConfig_t *) { }
+}
@@ -0,0 +1,573 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "pg/bus_spi.h"
+
+    #include "drivers/sdcard.h"
+    #include "drivers/sdcard_impl.h"
+
+    #include "io/asyncfatfs/asyncfatfs.h"
+    #include "io/asyncfatfs/fat_standard.h"
+
+    afatfsOperationStatus_e afatfs_appendSupercluster(afatfsFilePtr_t file);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+/*
+ * The card is an image file served by the SITL's sdcard_file driver, laid out as src/utils/mksdimg.py does it: a
+ * 64MB card holding one FAT32 partition with a cluster of one sector.
+ */
+#define SECTOR_SIZE         512
+#define CARD_SECTORS        (64 * 1024 * 1024 / SECTOR_SIZE)
+#define PARTITION_START     2048
+#define PARTITION_SECTORS   (CARD_SECTORS - PARTITION_START)
+#define RESERVED_SECTORS    32
+#define FAT_SECTORS         1008
+#define FAT_START           (PARTITION_START + RESERVED_SECTORS)
+#define CLUSTER_START       (FAT_START + 2 * FAT_SECTORS)
+#define CLUSTER_COUNT       (PARTITION_SECTORS - RESERVED_SECTORS - 2 * FAT_SECTORS)
+#define ROOT_DIR_SECTOR     CLUSTER_START
+
+#define WRITE_LOG_SIZE      4096
+
+static char imageDir[64];
+static uint32_t millisValue;
+
+// The sectors written to the card, in the order they were handed to it
+static uint32_t writeLog[WRITE_LOG_SIZE];
+static int writeLogCount;
+
+static afatfsFilePtr_t openedFile;
+
+static void putU16(uint8_t *p, uint16_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+static void putU32(uint8_t *p, uint32_t value)
+{
+    putU16(p, value);
+    putU16(p + 2, value >> 16);
+}
+
+static void writeSector(FILE *f, uint32_t sector, const uint8_t *data, size_t length)
+{
+    fseek(f, (long)sector * SECTOR_SIZE, SEEK_SET);
+    fwrite(data, length, 1, f);
+}
+
+static void makeImage(void)
+{
+    uint8_t sector[SECTOR_SIZE];
+    FILE *f = fopen("sdcard.img", "wb");
+    ASSERT_NE(nullptr, f);
+    ASSERT_EQ(0, ftruncate(fileno(f), (off_t)CARD_SECTORS * SECTOR_SIZE));
+
+    memset(sector, 0, sizeof(sector));
+    sector[446 + 4] = 0x0C; // FAT32 LBA
+    putU32(&sector[446 + 8], PARTITION_START);
+    putU32(&sector[446 + 12], PARTITION_SECTORS);
+    sector[510] = 0x55;
+    sector[511] = 0xAA;
+    writeSector(f, 0, sector, sizeof(sector));
+
+    memset(sector, 0, sizeof(sector));
+    memcpy(sector, "\xEB\x58\x90" "BTFL    ", 11);
+    putU16(&sector[11], SECTOR_SIZE);
+    sector[13] = 1; // sectors per cluster
+    putU16(&sector[14], RESERVED_SECTORS);
+    sector[16] = 2; // FATs
+    sector[21] = 0xF8;
+    putU32(&sector[28], PARTITION_START);
+    putU32(&sector[32], PARTITION_SECTORS);
+    putU32(&sector[36], FAT_SECTORS);
+    putU32(&sector[44], 2); // root directory cluster
+    putU16(&sector[48], 1); // FSInfo sector
+    putU16(&sector[50], 6); // backup boot sector
+    sector[66] = 0x29;
+    memcpy(&sector[71], "BETAFLIGHT FAT32   ", 19);
+    sector[510] = 0x55;
+    sector[511] = 0xAA;
+    writeSector(f, PARTITION_START, sector, sizeof(sector));
+    writeSector(f, PARTITION_START + 6, sector, sizeof(sector));
+
+    memset(sector, 0, sizeof(sector));
+    putU32(&sector[0], 0x41615252);
+    putU32(&sector[484], 0x61417272);
+    putU32(&sector[488], CLUSTER_COUNT - 1);
+    putU32(&sector[492], 3);
+    putU32(&sector[508], 0xAA550000);
+    writeSector(f, PARTITION_START + 1, sector, sizeof(sector));
+    writeSector(f, PARTITION_START + 7, sector, sizeof(sector));
+
+    // Media and reserved entries, then the end of the root directory's chain
+    memset(sector, 0, sizeof(sector));
+    putU32(&sector[0], 0x0FFFFFF8);
+    putU32(&sector[4], 0x0FFFFFFF);
+    putU32(&sector[8], 0x0FFFFFFF);
+    writeSector(f, FAT_START, sector, 12);
+    writeSector(f, FAT_START + FAT_SECTORS, sector, 12);
+
+    fclose(f);
+}
+
+static void poll(void)
+{
+    millisValue++;
+    afatfs_poll();
+}
+
+// Mount a freshly formatted card in a directory of its own
+static void mountNewCard(void)
+{
+    strcpy(imageDir, "/tmp/asyncfatfs_unittestXXXXXX");
+    ASSERT_NE(nullptr, mkdtemp(imageDir));
+    ASSERT_EQ(0, chdir(imageDir));
+    makeImage();
+
+    sdcardFileVTable.sdcard_init(NULL, NULL);
+    afatfs_init();
+    for (int i = 0; i < 1000000 && afatfs_getFilesystemState() == AFATFS_FILESYSTEM_STATE_INITIALIZATION; i++) {
+        poll();
+    }
+    ASSERT_EQ(AFATFS_FILESYSTEM_STATE_READY, afatfs_getFilesystemState());
+    // Including the freefile it made
+    for (int i = 0; i < 100000 && !(afatfs_flush() && afatfs_sectorCacheInSync()); i++) {
+        poll();
+    }
+    writeLogCount = 0;
+}
+
+static void unmountCard(void)
+{
+    for (int i = 0; i < 100000 && !afatfs_destroy(false); i++) {
+        poll();
+    }
+    unlink("sdcard.img");
+    EXPECT_EQ(0, chdir("/"));
+    rmdir(imageDir);
+}
+
+static void fileOpened(afatfsFilePtr_t file)
+{
+    openedFile = file;
+}
+
+static afatfsFilePtr_t openFile(const char *name, const char *mode)
+{
+    openedFile = NULL;
+    EXPECT_TRUE(afatfs_fopen(name, mode, fileOpened));
+    for (int i = 0; i < 100000 && !openedFile; i++) {
+        poll();
+    }
+    return openedFile;
+}
+
+static void closeFile(afatfsFilePtr_t file)
+{
+    EXPECT_TRUE(afatfs_fclose(file, NULL));
+    // Until every dirty sector has reached the card
+    for (int i = 0; i < 100000 && !(afatfs_flush() && afatfs_sectorCacheInSync()); i++) {
+        poll();
+    }
+}
+
+static void writeFile(afatfsFilePtr_t file, const uint8_t *data, uint32_t length)
+{
+    for (int i = 0; i < 1000000 && length > 0; i++) {
+        const uint32_t written = afatfs_fwrite(file, data, length);
+        data += written;
+        length -= written;
+        poll();
+    }
+    EXPECT_EQ(0U, length);
+}
+
+static uint32_t readFile(afatfsFilePtr_t file, uint8_t *data, uint32_t length)
+{
+    uint32_t total = 0;
+    for (int i = 0; i < 1000000 && total < length && !afatfs_feof(file); i++) {
+        total += afatfs_fread(file, data + total, length - total);
+        poll();
+    }
+    return total;
+}
+
+static void fillPattern(uint8_t *data, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; i++) {
+        data[i] = i * 7 + (i >> 9);
+    }
+}
+
+static void readImageSector(uint32_t sectorIndex, uint8_t *sector)
+{
+    FILE *f = fopen("sdcard.img", "rb");
+    fseek(f, (long)sectorIndex * SECTOR_SIZE, SEEK_SET);
+    EXPECT_EQ(1U, fread(sector, SECTOR_SIZE, 1, f));
+    fclose(f);
+}
+
+// Find the directory entry with the given 8.3 name in the root directory as the card holds it
+static bool findOnCard(const char *name, fatDirectoryEntry_t *result)
+{
+    uint8_t sector[SECTOR_SIZE];
+    readImageSector(ROOT_DIR_SECTOR, sector);
+
+    for (int i = 0; i < SECTOR_SIZE; i += sizeof(fatDirectoryEntry_t)) {
+        const fatDirectoryEntry_t *entry = (const fatDirectoryEntry_t *)&sector[i];
+        if (memcmp(entry->filename, name, FAT_FILENAME_LENGTH) == 0) {
+            *result = *entry;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns the size of the file with the given 8.3 name in the root directory as the card holds it, or -1
+static int64_t sizeOnCard(const char *name)
+{
+    fatDirectoryEntry_t entry;
+    return findOnCard(name, &entry) ? entry.fileSize : -1;
+}
+
+static uint32_t firstClusterOf(const fatDirectoryEntry_t *entry)
+{
+    return entry->firstClusterLow | ((uint32_t)entry->firstClusterHigh << 16);
+}
+
+static uint32_t fatEntryOnCard(uint32_t cluster)
+{
+    uint32_t sector[SECTOR_SIZE / sizeof(uint32_t)];
+    readImageSector(FAT_START + cluster / ARRAYLEN(sector), (uint8_t *)sector);
+    return sector[cluster % ARRAYLEN(sector)] & 0x0FFFFFFF;
+}
+
+// Returns the number of clusters in the chain starting at the given cluster, which must be contiguous
+static uint32_t chainLengthOnCard(uint32_t cluster)
+{
+    uint32_t length = 1;
+    uint32_t next;
+    while (!fat32_isEndOfChainMarker(next = fatEntryOnCard(cluster))) {
+        EXPECT_EQ(cluster + 1, next);
+        cluster = next;
+        length++;
+    }
+    return length;
+}
+
+TEST(AsyncFatFsTest, TestCacheHitsAndEvictions)
+{
+    mountNewCard();
+
+    static uint8_t data[64 * SECTOR_SIZE];
+    static uint8_t readBack[sizeof(data)];
+    fillPattern(data, sizeof(data));
+
+    afatfsFilePtr_t file = openFile("CACHE.BIN", "w");
+    ASSERT_NE(nullptr, file);
+    writeFile(file, data, sizeof(data));
+    closeFile(file);
+
+    const afatfsStatistics_t *statistics = afatfs_getStatistics();
+    EXPECT_EQ(sizeof(data), statistics->bytesWritten);
+
+    // The last sectors written are still cached, so reading them back needn't touch the card
+    file = openFile("CACHE.BIN", "r");
+    ASSERT_NE(nullptr, file);
+    uint32_t sectorsRead = statistics->sectorsRead;
+    EXPECT_NE(AFATFS_OPERATION_FAILURE, afatfs_fseek(file, sizeof(data) - 4 * SECTOR_SIZE, AFATFS_SEEK_SET));
+    EXPECT_EQ(4U * SECTOR_SIZE, readFile(file, readBack, 4 * SECTOR_SIZE));
+    EXPECT_EQ(0, memcmp(&data[sizeof(data) - 4 * SECTOR_SIZE], readBack, 4 * SECTOR_SIZE));
+    EXPECT_EQ(sectorsRead, statistics->sectorsRead);
+
+    // Reading the whole file misses on the start, which evicts the end from the cache
+    EXPECT_NE(AFATFS_OPERATION_FAILURE, afatfs_fseek(file, 0, AFATFS_SEEK_SET));
+    EXPECT_EQ(sizeof(data), readFile(file, readBack, sizeof(data)));
+    EXPECT_EQ(0, memcmp(data, readBack, sizeof(data)));
+    EXPECT_LE(sectorsRead + 64 - AFATFS_NUM_CACHE_SECTORS, statistics->sectorsRead);
+
+    // The start of the file is a hit now
+    sectorsRead = statistics->sectorsRead;
+    EXPECT_NE(AFATFS_OPERATION_FAILURE, afatfs_fseek(file, sizeof(data) - 4 * SECTOR_SIZE, AFATFS_SEEK_SET));
+    EXPECT_EQ(4U * SECTOR_SIZE, readFile(file, readBack, 4 * SECTOR_SIZE));
+    EXPECT_EQ(sectorsRead, statistics->sectorsRead);
+
+    // but the start had to be read from the card again
+    EXPECT_NE(AFATFS_OPERATION_FAILURE, afatfs_fseek(file, 0, AFATFS_SEEK_SET));
+    EXPECT_EQ(4U * SECTOR_SIZE, readFile(file, readBack, 4 * SECTOR_SIZE));
+    EXPECT_EQ(0, memcmp(data, readBack, 4 * SECTOR_SIZE));
+    EXPECT_LT(sectorsRead, statistics->sectorsRead);
+
+    closeFile(file);
+    unmountCard();
+}
+
+TEST(AsyncFatFsTest, TestFileDataReachesCardBeforeItsSize)
+{
+    mountNewCard();
+
+    static uint8_t data[40 * SECTOR_SIZE + 100];
+    fillPattern(data, sizeof(data));
+
+    afatfsFilePtr_t file = openFile("ORDER.BIN", "a");
+    ASSERT_NE(nullptr, file);
+    writeFile(file, data, sizeof(data));
+
+    const int writesBeforeClose = writeLogCount;
+    closeFile(file);
+    ASSERT_LT(writesBeforeClose, writeLogCount);
+    EXPECT_EQ((int64_t)sizeof(data), sizeOnCard("ORDER   BIN"));
+
+    // The directory sector holding the final size is only written once every data sector is on the card
+    int lastDirectoryWrite = -1;
+    int lastDataWrite = -1;
+    for (int i = 0; i < writeLogCount; i++) {
+        if (writeLog[i] == ROOT_DIR_SECTOR) {
+            lastDirectoryWrite = i;
+        } else if (writeLog[i] > ROOT_DIR_SECTOR) {
+            lastDataWrite = i;
+        }
+    }
+    EXPECT_GT(lastDataWrite, -1);
+    EXPECT_GT(lastDirectoryWrite, lastDataWrite);
+
+    unmountCard();
+}
+
+TEST(AsyncFatFsTest, TestFileDataWrittenInRuns)
+{
+    mountNewCard();
+
+    static uint8_t data[100 * SECTOR_SIZE];
+    fillPattern(data, sizeof(data));
+
+    afatfsFilePtr_t file = openFile("RUNS.BIN", "as");
+    ASSERT_NE(nullptr, file);
+    const afatfsStatistics_t *statistics = afatfs_getStatistics();
+    const uint32_t sectorsWritten = statistics->sectorsWritten;
+    const uint32_t writeBursts = statistics->writeBursts;
+    writeFile(file, data, sizeof(data));
+    closeFile(file);
+
+    // Write-behind batches the appended sectors into runs of consecutive sectors
+    EXPECT_LE(sectorsWritten + 100, statistics->sectorsWritten);
+    EXPECT_GE((statistics->sectorsWritten - sectorsWritten) / AFATFS_WRITE_BEHIND_SECTORS * 2, statistics->writeBursts - writeBursts);
+
+    // and what reaches the card is what was written
+    file = openFile("RUNS.BIN", "r");
+    ASSERT_NE(nullptr, file);
+    static uint8_t readBack[sizeof(data)];
+    EXPECT_EQ(sizeof(data), readFile(file, readBack, sizeof(data)));
+    EXPECT_EQ(0, memcmp(data, readBack, sizeof(data)));
+    closeFile(file);
+
+    unmountCard();
+}
+
+TEST(AsyncFatFsTest, TestPreallocatedExtentIsCappedAndTrimmedOnClose)
+{
+    mountNewCard();
+
+    const uint32_t superclusterSize = SECTOR_SIZE / sizeof(uint32_t) * SECTOR_SIZE;
+    fatDirectoryEntry_t freeFile;
+    ASSERT_TRUE(findOnCard("FREESPACE  ", &freeFile));
+    const uint32_t freeFileStart = firstClusterOf(&freeFile);
+    const uint32_t freeFileSize = freeFile.fileSize;
+
+    static uint8_t data[2 * 64 * 1024 + 100];
+    fillPattern(data, sizeof(data));
+
+    afatfsFilePtr_t file = openFile("PREALLOCBIN", "al");
+    ASSERT_NE(nullptr, file);
+    writeFile(file, data, sizeof(data));
+    for (int i = 0; i < 1000; i++) {
+        poll();
+    }
+
+    // If we lost power now, the card would hold one extent, capped to a small share of the free space
+    fatDirectoryEntry_t entry;
+    ASSERT_TRUE(findOnCard("PREALLOCBIN", &entry));
+    ASSERT_TRUE(findOnCard("FREESPACE  ", &freeFile));
+    EXPECT_EQ(freeFileStart, firstClusterOf(&entry));
+    const uint32_t extentClusters = chainLengthOnCard(firstClusterOf(&entry));
+    EXPECT_LT(sizeof(data), extentClusters * SECTOR_SIZE);
+    EXPECT_GE(freeFileSize / superclusterSize / 32 * superclusterSize, extentClusters * SECTOR_SIZE);
+    EXPECT_EQ(freeFileStart + extentClusters, firstClusterOf(&freeFile));
+    EXPECT_EQ(freeFileSize - extentClusters * SECTOR_SIZE, freeFile.fileSize);
+
+    // Closing the file keeps the superclusters holding its content and gives the rest back to the freefile
+    closeFile(file);
+
+    const uint32_t keptClusters = 3 * superclusterSize / SECTOR_SIZE;
+    ASSERT_TRUE(findOnCard("PREALLOCBIN", &entry));
+    ASSERT_TRUE(findOnCard("FREESPACE  ", &freeFile));
+    EXPECT_EQ(sizeof(data), entry.fileSize);
+    EXPECT_EQ(keptClusters, chainLengthOnCard(firstClusterOf(&entry)));
+    EXPECT_EQ(freeFileStart + keptClusters, firstClusterOf(&freeFile));
+    EXPECT_EQ(freeFileSize - keptClusters * SECTOR_SIZE, freeFile.fileSize);
+
+    // The clusters given back are chained on into the freefile
+    EXPECT_EQ(freeFileStart + extentClusters, fatEntryOnCard(freeFileStart + extentClusters - 1));
+
+    file = openFile("PREALLOCBIN", "r");
+    ASSERT_NE(nullptr, file);
+    static uint8_t readBack[sizeof(data)];
+    EXPECT_EQ(sizeof(data), readFile(file, readBack, sizeof(data)));
+    EXPECT_EQ(0, memcmp(data, readBack, sizeof(data)));
+    closeFile(file);
+
+    unmountCard();
+}
+
+TEST(AsyncFatFsTest, TestPreallocatedExtentNotBorderingFreeFileIsFreedOnClose)
+{
+    mountNewCard();
+
+    const uint32_t superclusterClusters = SECTOR_SIZE / sizeof(uint32_t);
+    fatDirectoryEntry_t freeFile;
+    ASSERT_TRUE(findOnCard("FREESPACE  ", &freeFile));
+    const uint32_t freeFileStart = firstClusterOf(&freeFile);
+
+    static uint8_t data[64 * 1024 + 100];
+    fillPattern(data, sizeof(data));
+
+    afatfsFilePtr_t file = openFile("PREALLOCBIN", "al");
+    ASSERT_NE(nullptr, file);
+    writeFile(file, data, sizeof(data));
+    for (int i = 0; i < 1000; i++) {
+        poll();
+    }
+
+    fatDirectoryEntry_t entry;
+    ASSERT_TRUE(findOnCard("PREALLOCBIN", &entry));
+    const uint32_t extentClusters = chainLengthOnCard(firstClusterOf(&entry));
+
+    // Another file takes the supercluster at the start of the freefile, right after our extent
+    afatfsFilePtr_t other = openFile("OTHER   BIN", "a");
+    ASSERT_NE(nullptr, other);
+    EXPECT_NE(AFATFS_OPERATION_FAILURE, afatfs_appendSupercluster(other));
+    for (int i = 0; i < 1000; i++) {
+        poll();
+    }
+
+    // Closing the file keeps the superclusters holding its content and frees the rest of the extent
+    closeFile(file);
+
+    const uint32_t keptClusters = 2 * superclusterClusters;
+    ASSERT_TRUE(findOnCard("PREALLOCBIN", &entry));
+    ASSERT_TRUE(findOnCard("FREESPACE  ", &freeFile));
+    EXPECT_EQ(sizeof(data), entry.fileSize);
+    EXPECT_EQ(keptClusters, chainLengthOnCard(firstClusterOf(&entry)));
+    for (uint32_t cluster = freeFileStart + keptClusters; cluster < freeFileStart + extentClusters; cluster++) {
+        EXPECT_EQ(0U, fatEntryOnCard(cluster));
+    }
+
+    // The other file's supercluster and the freefile are left alone
+    EXPECT_EQ(superclusterClusters, chainLengthOnCard(freeFileStart + extentClusters));
+    EXPECT_EQ(freeFileStart + extentClusters + superclusterClusters, firstClusterOf(&freeFile));
+
+    closeFile(other);
+
+    file = openFile("PREALLOCBIN", "r");
+    ASSERT_NE(nullptr, file);
+    static uint8_t readBack[sizeof(data)];
+    EXPECT_EQ(sizeof(data), readFile(file, readBack, sizeof(data)));
+    EXPECT_EQ(0, memcmp(data, readBack, sizeof(data)));
+    closeFile(file);
+
+    unmountCard();
+}
+
+// STUBS
+
+extern "C" {
+
+uint32_t millis(void)
+{
+    return millisValue;
+}
+
+void sdcard_init(const sdcardConfig_t *config)
+{
+    UNUSED(config);
+}
+
+bool sdcard_readBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    return sdcardFileVTable.sdcard_readBlock(blockIndex, buffer, callback, callbackData);
+}
+
+sdcardOperationStatus_e sdcard_beginWriteBlocks(uint32_t blockIndex, uint32_t blockCount)
+{
+    return sdcardFileVTable.sdcard_beginWriteBlocks(blockIndex, blockCount);
+}
+
+sdcardOperationStatus_e sdcard_writeBlock(uint32_t blockIndex, uint8_t *buffer, sdcard_operationCompleteCallback_c callback, uint32_t callbackData)
+{
+    const sdcardOperationStatus_e status = sdcardFileVTable.sdcard_writeBlock(blockIndex, buffer, callback, callbackData);
+
+    if (status == SDCARD_OPERATION_IN_PROGRESS && writeLogCount < WRITE_LOG_SIZE) {
+        writeLog[writeLogCount++] = blockIndex;
+    }
+    return status;
+}
+
+bool sdcard_poll(void)
+{
+    return sdcardFileVTable.sdcard_poll();
+}
+
+bool sdcard_isFunctional(void)
+{
+    return sdcardFileVTable.sdcard_isFunctional();
+}
+
+bool sdcard_isInitialized(void)
+{
+    return sdcardFileVTable.sdcard_isInitialized();
+}
+
+const sdcardMetadata_t* sdcard_getMetadata(void)
+{
+    return sdcardFileVTable.sdcard_getMetadata();
+}
+
+void sdcard_setProfilerCallback(sdcard_profilerCallback_c callback)
+{
+    UNUSED(callback);
+}
+
+}
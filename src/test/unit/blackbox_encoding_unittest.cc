@@ -17,6 +17,9 @@
 #include <stdint.h>
 #include <string.h>
 
+#include <random>
+#include <vector>
+
 extern "C" {
     #include "platform.h"
 
@@ -240,12 +243,296 @@ TEST(BlackboxTest, TestWriteTag2_3SVariable_BITS887)
     EXPECT_EQ(0, buf[3]); // ensure next byte has not been written
     buf += 3;
 }
+// Host side decoder, following the reference decoder in blackbox-tools, to check the encoders byte for byte
+
+class BlackboxDecoder {
+public:
+    BlackboxDecoder(const uint8_t *data, const uint8_t *end) : pos(data), end(end) {}
+
+    uint8_t readByte()
+    {
+        EXPECT_LT(pos, end);
+        return *pos++;
+    }
+
+    uint32_t readUnsignedVB()
+    {
+        uint32_t result = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            const uint8_t b = readByte();
+            result |= (uint32_t)(b & 0x7F) << shift;
+            if (b < 128) {
+                return result;
+            }
+        }
+        ADD_FAILURE() << "overlong variable byte field";
+        return 0;
+    }
+
+    int32_t readSignedVB()
+    {
+        const uint32_t i = readUnsignedVB();
+        return (int32_t)((i >> 1) ^ -(int32_t)(i & 1));
+    }
+
+    void readTag2_3S32(int32_t *values)
+    {
+        const uint8_t leadByte = readByte();
+
+        switch (leadByte >> 6) {
+        case 0:
+            values[0] = signExtend(leadByte >> 4, 2);
+            values[1] = signExtend(leadByte >> 2, 2);
+            values[2] = signExtend(leadByte, 2);
+            break;
+        case 1: {
+            values[0] = signExtend(leadByte, 4);
+            const uint8_t b = readByte();
+            values[1] = signExtend(b >> 4, 4);
+            values[2] = signExtend(b, 4);
+            break;
+        }
+        case 2:
+            values[0] = signExtend(leadByte, 6);
+            values[1] = signExtend(readByte(), 6);
+            values[2] = signExtend(readByte(), 6);
+            break;
+        case 3: {
+            uint8_t selector = leadByte;
+            for (int i = 0; i < 3; i++, selector >>= 2) {
+                const int byteCount = (selector & 0x03) + 1;
+                uint32_t value = 0;
+                for (int b = 0; b < byteCount; b++) {
+                    value |= (uint32_t)readByte() << (8 * b);
+                }
+                values[i] = signExtend(value, 8 * byteCount);
+            }
+            break;
+        }
+        }
+    }
+
+    void readTag8_4S16(int32_t *values)
+    {
+        uint8_t selector = readByte();
+        bool nibbleIndex = false;
+        uint8_t buffer = 0;
+
+        for (int i = 0; i < 4; i++, selector >>= 2) {
+            switch (selector & 0x03) {
+            case 0:
+                values[i] = 0;
+                break;
+            case 1:
+                if (!nibbleIndex) {
+                    buffer = readByte();
+                    values[i] = signExtend(buffer >> 4, 4);
+                } else {
+                    values[i] = signExtend(buffer, 4);
+                }
+                nibbleIndex = !nibbleIndex;
+                break;
+            case 2:
+                if (!nibbleIndex) {
+                    values[i] = (int8_t)readByte();
+                } else {
+                    const uint8_t high = buffer << 4;
+                    buffer = readByte();
+                    values[i] = (int8_t)(high | (buffer >> 4));
+                }
+                break;
+            case 3:
+                if (!nibbleIndex) {
+                    const uint8_t high = readByte();
+                    values[i] = (int16_t)((high << 8) | readByte());
+                } else {
+                    const uint8_t high = readByte();
+                    const uint16_t top = (buffer & 0x0F) << 12;
+                    buffer = readByte();
+                    values[i] = (int16_t)(top | (high << 4) | (buffer >> 4));
+                }
+                break;
+            }
+        }
+    }
+
+    void readTag8_8SVB(int32_t *values, int valueCount)
+    {
+        if (valueCount == 1) {
+            values[0] = readSignedVB();
+            return;
+        }
+        uint8_t header = readByte();
+        for (int i = 0; i < valueCount; i++, header >>= 1) {
+            values[i] = (header & 0x01) ? readSignedVB() : 0;
+        }
+    }
+
+    const uint8_t *pos;
+    const uint8_t *end;
+
+private:
+    static int32_t signExtend(uint32_t value, int bits)
+    {
+        const int shift = 32 - bits;
+        return (int32_t)(value << shift) >> shift;
+    }
+};
+
+// Values around every encoding boundary plus a spread of random ones
+static std::vector<int32_t> encodingTestValues(int32_t min, int32_t max)
+{
+    std::vector<int32_t> values;
+    static const int64_t edges[] = { 0, 1, 2, 4, 8, 16, 32, 64, 128, 256, 8192, 32768, 1 << 20, 1 << 23, 1 << 27, 1LL << 31 };
+    for (int64_t edge : edges) {
+        for (int64_t v : { edge - 1, edge, -edge - 1, -edge }) {
+            if (v >= min && v <= max) {
+                values.push_back(v);
+            }
+        }
+    }
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int32_t> wide(min, max);
+    std::uniform_int_distribution<int32_t> narrow(-40, 40);
+    for (int i = 0; i < 500; i++) {
+        values.push_back(wide(rng));
+        values.push_back(narrow(rng));
+    }
+    return values;
+}
+
+TEST(BlackboxEncodingTest, TestUnsignedVBRoundTrip)
+{
+    uint8_t buf[BLACKBOX_VB_SIZE_MAX];
+
+    for (int32_t value : encodingTestValues(INT32_MIN, INT32_MAX)) {
+        // Reference encoding, one 7 bit group at a time
+        uint8_t expected[BLACKBOX_VB_SIZE_MAX];
+        int length = 0;
+        uint32_t v = value;
+        while (v > 127) {
+            expected[length++] = (uint8_t)(v | 0x80);
+            v >>= 7;
+        }
+        expected[length++] = v;
+
+        const uint8_t *end = blackboxEncodeUnsignedVB(buf, value);
+        ASSERT_EQ(length, end - buf);
+        EXPECT_EQ(0, memcmp(expected, buf, length));
+
+        BlackboxDecoder decoder(buf, end);
+        EXPECT_EQ((uint32_t)value, decoder.readUnsignedVB());
+    }
+}
+
+TEST(BlackboxEncodingTest, TestSignedVBArrayRoundTrip)
+{
+    const std::vector<int32_t> values = encodingTestValues(INT32_MIN, INT32_MAX);
+    std::vector<uint8_t> buf(values.size() * BLACKBOX_VB_SIZE_MAX);
+
+    const uint8_t *end = blackboxEncodeSignedVBArray(buf.data(), values.data(), values.size());
+
+    BlackboxDecoder decoder(buf.data(), end);
+    for (int32_t value : values) {
+        EXPECT_EQ(value, decoder.readSignedVB());
+    }
+    EXPECT_EQ(end, decoder.pos);
+}
+
+TEST(BlackboxEncodingTest, TestTag2_3S32RoundTrip)
+{
+    const std::vector<int32_t> values = encodingTestValues(INT32_MIN, INT32_MAX);
+    uint8_t buf[BLACKBOX_TAG2_3S32_SIZE_MAX];
+
+    for (size_t i = 0; i + 3 <= values.size(); i++) {
+        const uint8_t *end = blackboxEncodeTag2_3S32(buf, &values[i]);
+        EXPECT_LE(end - buf, BLACKBOX_TAG2_3S32_SIZE_MAX);
+
+        int32_t decoded[3];
+        BlackboxDecoder decoder(buf, end);
+        decoder.readTag2_3S32(decoded);
+        EXPECT_EQ(end, decoder.pos);
+        for (int x = 0; x < 3; x++) {
+            EXPECT_EQ(values[i + x], decoded[x]);
+        }
+    }
+}
+
+TEST(BlackboxEncodingTest, TestTag8_4S16RoundTrip)
+{
+    const std::vector<int32_t> values = encodingTestValues(INT16_MIN, INT16_MAX);
+    uint8_t buf[BLACKBOX_TAG8_4S16_SIZE_MAX];
+
+    for (size_t i = 0; i + 4 <= values.size(); i++) {
+        const uint8_t *end = blackboxEncodeTag8_4S16(buf, &values[i]);
+        EXPECT_LE(end - buf, BLACKBOX_TAG8_4S16_SIZE_MAX);
+
+        int32_t decoded[4];
+        BlackboxDecoder decoder(buf, end);
+        decoder.readTag8_4S16(decoded);
+        EXPECT_EQ(end, decoder.pos);
+        for (int x = 0; x < 4; x++) {
+            EXPECT_EQ(values[i + x], decoded[x]);
+        }
+    }
+}
+
+TEST(BlackboxEncodingTest, TestTag8_8SVBRoundTrip)
+{
+    std::vector<int32_t> values = encodingTestValues(INT32_MIN, INT32_MAX);
+    // Mostly zeros, which is what this encoding is for
+    for (size_t i = 0; i < values.size(); i += 3) {
+        values[i] = 0;
+    }
+    uint8_t buf[BLACKBOX_TAG8_8SVB_SIZE_MAX(8)];
+
+    for (int count = 1; count <= 8; count++) {
+        for (size_t i = 0; i + count <= values.size(); i++) {
+            const uint8_t *end = blackboxEncodeTag8_8SVB(buf, &values[i], count);
+
+            int32_t decoded[8];
+            BlackboxDecoder decoder(buf, end);
+            decoder.readTag8_8SVB(decoded, count);
+            EXPECT_EQ(end, decoder.pos);
+            for (int x = 0; x < count; x++) {
+                EXPECT_EQ(values[i + x], decoded[x]);
+            }
+        }
+    }
+}
+
+TEST(BlackboxEncodingTest, TestWriteMatchesEncode)
+{
+    serialTestResetBuffers();
+
+    int32_t values[4] = { 3, -200, 0, 7 };
+    uint8_t expected[32];
+    uint8_t *end = expected;
+    end = blackboxEncodeTag8_4S16(end, values);
+    end = blackboxEncodeTag2_3S32(end, values);
+    end = blackboxEncodeTag8_8SVB(end, values, 4);
+
+    blackboxWriteTag8_4S16(values);
+    blackboxWriteTag2_3S32(values);
+    blackboxWriteTag8_8SVB(values, 4);
+
+    ASSERT_EQ(end - expected, serialWritePos);
+    EXPECT_EQ(0, memcmp(expected, serialWriteBuffer, serialWritePos));
+}
+
 // STUBS
 extern "C" {
 PG_REGISTER(blackboxConfig_t, blackboxConfig, PG_BLACKBOX_CONFIG, 0);
 int32_t blackboxHeaderBudget;
 void mspSerialAllocatePorts(void) {}
 void blackboxWrite(uint8_t value) {serialWrite(blackboxPort, value);}
+uint8_t *blackboxWriteBegin(int length)
+{
+    EXPECT_LE(serialWritePos + length, SERIAL_BUFFER_SIZE);
+    return &serialWriteBuffer[serialWritePos];
+}
+void blackboxWriteEnd(const uint8_t *end) {serialWritePos = end - serialWriteBuffer;}
 int blackboxWriteString(const char *s)
 {
     const uint8_t *pos = (uint8_t*)s;
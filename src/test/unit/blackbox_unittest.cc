@@ -23,6 +23,9 @@ extern "C" {
     #include "build/debug.h"
 
     #include "blackbox/blackbox.h"
+    #include "blackbox/blackbox_encoding.h"
+    #include "blackbox/blackbox_io.h"
+    #include "common/huffman.h"
     #include "common/utils.h"
 
     #include "pg/pg.h"
@@ -41,6 +44,8 @@ extern "C" {
     #include "fc/rc_controls.h"
     #include "fc/rc_modes.h"
 
+    #include "io/beeper.h"
+    #include "io/flashfs.h"
     #include "io/gps.h"
     #include "io/serial.h"
 
@@ -58,6 +63,16 @@ extern "C" {
 
 gyroDev_t gyroDev;
 
+static serialPort_t testSerialPort;
+static serialPortConfig_t testSerialPortConfig;
+static uint32_t serialTxFree;
+static uint8_t serialWriteData[BLACKBOX_FRAME_BUFFER_SIZE];
+static int serialWriteCount;
+static int serialWriteBufCalls;
+static uint32_t flashFree;
+static uint8_t flashData[1024];
+static uint32_t flashDataLength;
+
 TEST(BlackboxTest, TestInitIntervals)
 {
     blackboxConfigMutable()->sample_rate = 4; // sample_rate = PID loop frequency / 16
@@ -330,6 +345,128 @@ TEST(BlackboxTest, Test_CalculateRates)
 }
 
 
+TEST(BlackboxTest, TestFrameCommittedAsSingleSpan)
+{
+    const uint8_t device = blackboxConfig()->device;
+    blackboxConfigMutable()->device = BLACKBOX_DEVICE_SERIAL;
+    EXPECT_TRUE(blackboxDeviceOpen());
+
+    serialTxFree = 64;
+    serialWriteCount = 0;
+    serialWriteBufCalls = 0;
+
+    blackboxWrite('I');
+    blackboxWriteUnsignedVB(300);
+    blackboxWriteString("ab");
+    EXPECT_EQ(0, serialWriteBufCalls);
+
+    blackboxDeviceCommit();
+    EXPECT_EQ(1, serialWriteBufCalls);
+    EXPECT_EQ(5, serialWriteCount);
+    EXPECT_EQ('I', serialWriteData[0]);
+    EXPECT_EQ(0xAC, serialWriteData[1]);
+    EXPECT_EQ(0x02, serialWriteData[2]);
+    EXPECT_EQ('a', serialWriteData[3]);
+    EXPECT_EQ('b', serialWriteData[4]);
+
+    // Nothing staged, nothing written
+    blackboxDeviceCommit();
+    EXPECT_EQ(1, serialWriteBufCalls);
+
+    // Bytes that don't fit in the transmit buffer are dropped from the end of the span
+    serialTxFree = 2;
+    serialWriteCount = 0;
+    blackboxWriteU32(0x04030201);
+    blackboxDeviceCommit();
+    EXPECT_EQ(2, serialWriteCount);
+    EXPECT_EQ(0x01, serialWriteData[0]);
+    EXPECT_EQ(0x02, serialWriteData[1]);
+
+    blackboxDeviceClose();
+    blackboxConfigMutable()->device = device;
+}
+
+// Returns the length of the block at `pos` in the compressed stream, and the length of its data before coding
+static int compressedBlockLength(uint32_t pos, uint16_t *dataLength)
+{
+    const uint16_t blockHeader = flashData[pos] | (flashData[pos + 1] << 8);
+    *dataLength = blockHeader & ~BLACKBOX_COMPRESSED_BLOCK_STORED;
+    return blockHeader & BLACKBOX_COMPRESSED_BLOCK_STORED ? 2 + *dataLength : -1;
+}
+
+static int encodedLength(const uint8_t *data, int length)
+{
+    uint8_t encoded[BLACKBOX_FRAME_BUFFER_SIZE];
+    const int encodedLength = huffmanEncodeBlock(encoded, length - 1, data, length, huffmanTable);
+    return 2 + (encodedLength < 0 ? length : encodedLength);
+}
+
+TEST(BlackboxTest, TestCompressedBlocksAreNeverSplit)
+{
+    const uint8_t device = blackboxConfig()->device;
+    const uint8_t compression = blackboxConfig()->compression;
+    blackboxConfigMutable()->device = BLACKBOX_DEVICE_FLASH;
+    blackboxConfigMutable()->compression = BLACKBOX_COMPRESSION_HUFFMAN;
+    EXPECT_TRUE(blackboxDeviceOpen());
+
+    uint8_t first[40];
+    uint8_t second[30];
+    uint8_t third[20];
+    for (unsigned i = 0; i < sizeof(first); i++) {
+        first[i] = i * 7;
+    }
+    memset(second, 0, sizeof(second));
+    memset(third, 'P', sizeof(third));
+
+    // The device only takes part of the header and the first block
+    flashFree = 4;
+    flashDataLength = 0;
+    for (unsigned i = 0; i < sizeof(first); i++) {
+        blackboxWrite(first[i]);
+    }
+    blackboxDeviceCommit();
+    EXPECT_EQ(4U, flashDataLength);
+
+    // It then takes only some of the rest, so the span committed meanwhile stays staged
+    flashFree = 10;
+    for (unsigned i = 0; i < sizeof(second); i++) {
+        blackboxWrite(second[i]);
+    }
+    blackboxDeviceCommit();
+    EXPECT_EQ(14U, flashDataLength);
+    EXPECT_FALSE(blackboxDeviceFlushForce());
+
+    // Once there is room the rest of the block goes out, then the staged spans as the next one
+    flashFree = sizeof(flashData);
+    for (unsigned i = 0; i < sizeof(third); i++) {
+        blackboxWrite(third[i]);
+    }
+    blackboxDeviceCommit();
+    EXPECT_TRUE(blackboxDeviceFlushForce());
+
+    uint8_t secondAndThird[sizeof(second) + sizeof(third)];
+    memcpy(secondAndThird, second, sizeof(second));
+    memcpy(secondAndThird + sizeof(second), third, sizeof(third));
+
+    ASSERT_EQ(BLACKBOX_COMPRESSED_HEADER_SIZE + encodedLength(first, sizeof(first)) + encodedLength(secondAndThird, sizeof(secondAndThird)), (int)flashDataLength);
+    EXPECT_EQ(0, memcmp(flashData, BLACKBOX_COMPRESSED_MAGIC, 4));
+
+    uint32_t pos = BLACKBOX_COMPRESSED_HEADER_SIZE;
+    uint16_t dataLength;
+    const int firstLength = compressedBlockLength(pos, &dataLength);
+    EXPECT_EQ(sizeof(first), dataLength);
+    EXPECT_EQ(2 + (int)sizeof(first), firstLength);
+    EXPECT_EQ(0, memcmp(&flashData[pos + 2], first, sizeof(first)));
+
+    pos += firstLength;
+    compressedBlockLength(pos, &dataLength);
+    EXPECT_EQ(sizeof(secondAndThird), dataLength);
+
+    blackboxDeviceClose();
+    blackboxConfigMutable()->device = device;
+    blackboxConfigMutable()->compression = compression;
+}
+
 // STUBS
 extern "C" {
 
@@ -370,13 +507,19 @@ bool isModeActivationConditionPresent(boxId_e) {return false;}
 uint32_t millis(void) {return 0;}
 bool sensors(uint32_t) {return false;}
 void serialWrite(serialPort_t *, uint8_t) {}
-uint32_t serialTxBytesFree(const serialPort_t *) {return 0;}
+void serialWriteBuf(serialPort_t *, const uint8_t *data, int count)
+{
+    memcpy(serialWriteData, data, count);
+    serialWriteCount = count;
+    serialWriteBufCalls++;
+}
+uint32_t serialTxBytesFree(const serialPort_t *) {return serialTxFree;}
 bool isSerialTransmitBufferEmpty(const serialPort_t *) {return false;}
 bool featureIsEnabled(uint32_t) {return false;}
 void mspSerialReleasePortIfAllocated(serialPort_t *) {}
-const serialPortConfig_t *findSerialPortConfig(serialPortFunction_e ) {return NULL;}
+const serialPortConfig_t *findSerialPortConfig(serialPortFunction_e ) {return &testSerialPortConfig;}
 serialPort_t *findSharedSerialPort(uint16_t , serialPortFunction_e ) {return NULL;}
-serialPort_t *openSerialPort(serialPortIdentifier_e, serialPortFunction_e, serialReceiveCallbackPtr, void *, uint32_t, portMode_e, portOptions_e) {return NULL;}
+serialPort_t *openSerialPort(serialPortIdentifier_e, serialPortFunction_e, serialReceiveCallbackPtr, void *, uint32_t, portMode_e, portOptions_e) {return &testSerialPort;}
 void closeSerialPort(serialPort_t *) {}
 portSharing_e determinePortSharing(const serialPortConfig_t *, serialPortFunction_e ) {return PORTSHARING_UNUSED;}
 failsafePhase_e failsafePhase(void) {return FAILSAFE_IDLE;}
@@ -385,4 +528,23 @@ bool isRxReceivingSignal(void) {return false;}
 bool isRssiConfigured(void) {return false;}
 float getMotorOutputLow(void) {return 0.0;}
 float getMotorOutputHigh(void) {return 0.0;}
+void beeper(beeperMode_e) {}
+bool flashfsIsSupported(void) {return true;}
+bool flashfsIsReady(void) {return true;}
+bool flashfsIsEOF(void) {return false;}
+void flashfsBeginLog(void) {}
+bool flashfsEndLog(void) {return true;}
+void flashfsClose(void) {}
+void flashfsEraseCompletely(void) {}
+bool flashfsFlushAsync(bool) {return true;}
+uint32_t flashfsGetWriteBufferFreeSpace(void) {return flashFree;}
+uint32_t flashfsGetWriteBufferSize(void) {return sizeof(flashData);}
+uint32_t flashfsWrite(const uint8_t *data, unsigned int len, bool)
+{
+    const uint32_t accepted = MIN(len, flashFree);
+    memcpy(&flashData[flashDataLength], data, accepted);
+    flashDataLength += accepted;
+    flashFree -= accepted;
+    return accepted;
+}
 }
@@ -70,6 +70,7 @@ extern "C" {
         { .name = "wos_unit_test",     .type = VAR_UINT8 | MODE_STRING | MASTER_VALUE, .config = { .string = { 0, 16, STRING_FLAGS_WRITEONCE }}, .pgn = PG_RESERVED_FOR_TESTING_1, .offset = 0 },
     };
     const uint16_t valueTableEntryCount = ARRAYLEN(valueTable);
+    uint16_t valueTableNameIndex[ARRAYLEN(valueTable)];
     const lookupTableEntry_t lookupTables[] = {};
     const char * const lookupTableOsdDisplayPortDevice[] = {};
     const char * const buildKey = NULL;
@@ -207,6 +208,19 @@ TEST(CLIUnittest, TestCliSetStringWriteOnce)
     EXPECT_EQ(0,   data[6]);
 }
 
+TEST(CLIUnittest, TestCliGetSettingIndex)
+{
+    EXPECT_EQ(0, cliGetSettingIndex((char *)"array_unit_test", 15));
+    EXPECT_EQ(1, cliGetSettingIndex((char *)"STR_Unit_Test = 1", 13));
+    EXPECT_EQ(2, cliGetSettingIndex((char *)"wos_unit_test", 13));
+
+    // names must match exactly
+    EXPECT_EQ(valueTableEntryCount, cliGetSettingIndex((char *)"str_unit", 8));
+    EXPECT_EQ(valueTableEntryCount, cliGetSettingIndex((char *)"str_unit_tests", 14));
+    EXPECT_EQ(valueTableEntryCount, cliGetSettingIndex((char *)"aaa", 3));
+    EXPECT_EQ(valueTableEntryCount, cliGetSettingIndex((char *)"zzz", 3));
+}
+
 // STUBS
 extern "C" {
 
@@ -24,6 +24,7 @@
 
 extern "C" {
     #include "common/filter.h"
+    #include "common/utils.h"
 }
 
 #include "unittest_macros.h"
@@ -114,3 +115,85 @@ TEST(FilterUnittest, TestSlewFilter)
     slewFilterApply(&filter, 200.0f);
     EXPECT_EQ(200, filter.state);
 }
+
+TEST(FilterUnittest, TestBiquadFilterBankMatchesSerialBiquads)
+{
+    // three notches in cascade, applied to three independent signals
+    const float notchHz[] = { 120.0f, 240.0f, 360.0f };
+    const float weights[] = { 1.0f, 0.5f, 0.25f };
+    const int sectionCount = ARRAYLEN(notchHz);
+
+    biquadFilter_t serial[3][sectionCount];
+    biquadBankSection_t sections[sectionCount];
+    biquadFilterBank_t bank;
+
+    biquadFilterBankInit(&bank, sections, sectionCount);
+    for (int i = 0; i < sectionCount; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            biquadFilterInit(&serial[axis][i], notchHz[i], 125, 5.0f, FILTER_NOTCH, weights[i]);
+        }
+        biquadFilterBankUpdate(&bank, i, notchHz[i], 125, 5.0f, FILTER_NOTCH, weights[i]);
+    }
+
+    for (int n = 0; n < 500; n++) {
+        float values[BIQUAD_BANK_LANES] = { 0 };
+        float expected[3];
+
+        for (int axis = 0; axis < 3; axis++) {
+            expected[axis] = 100.0f * sinf(0.1f * n * (axis + 1)) + 10.0f * axis;
+            values[axis] = expected[axis];
+            for (int i = 0; i < sectionCount; i++) {
+                expected[axis] = biquadFilterApplyDF1Weighted(&serial[axis][i], expected[axis]);
+            }
+        }
+
+        biquadFilterBankApplyDF1Weighted(&bank, values);
+
+        for (int axis = 0; axis < 3; axis++) {
+            EXPECT_FLOAT_EQ(expected[axis], values[axis]);
+        }
+        // padding lane carries no signal
+        EXPECT_EQ(0.0f, values[3]);
+    }
+
+    // retuning a section only changes its coefficients, not its state
+    biquadFilterBankUpdate(&bank, 1, 300.0f, 125, 5.0f, FILTER_NOTCH, 1.0f);
+    biquadFilterUpdate(&serial[0][1], 300.0f, 125, 5.0f, FILTER_NOTCH, 1.0f);
+    EXPECT_FLOAT_EQ(serial[0][1].b1, sections[1].b1);
+    EXPECT_FLOAT_EQ(serial[0][1].x1, sections[1].x1[0]);
+}
+
+TEST(FilterUnittest, TestBiquadNotchTableMatchesDirectCalculation)
+{
+    float coeffs[256][2];
+    biquadNotchTable_t table;
+    biquadNotchTableInit(&table, coeffs, ARRAYLEN(coeffs), 100.0f, 3000.0f, 125, 5.0f);
+
+    biquadBankSection_t sections[2];
+    biquadFilterBank_t bank;
+    biquadFilterBankInit(&bank, sections, ARRAYLEN(sections));
+
+    for (float hz = 100.0f; hz <= 3000.0f; hz += 7.3f) {
+        EXPECT_TRUE(biquadFilterBankUpdateNotchFromTable(&bank, 0, &table, hz, 0.5f));
+        biquadFilterBankUpdate(&bank, 1, hz, 125, 5.0f, FILTER_NOTCH, 0.5f);
+
+        EXPECT_NEAR(sections[1].b0, sections[0].b0, 1e-4f);
+        EXPECT_NEAR(sections[1].b1, sections[0].b1, 1e-4f);
+        EXPECT_NEAR(sections[1].b2, sections[0].b2, 1e-4f);
+        EXPECT_NEAR(sections[1].a1, sections[0].a1, 1e-4f);
+        EXPECT_NEAR(sections[1].a2, sections[0].a2, 2e-4f);
+        EXPECT_FLOAT_EQ(0.5f, sections[0].weight);
+    }
+
+    // table nodes are exact
+    EXPECT_TRUE(biquadFilterBankUpdateNotchFromTable(&bank, 0, &table, 3000.0f, 1.0f));
+    EXPECT_FLOAT_EQ(coeffs[255][1], sections[0].b1);
+
+    // out of range frequencies are left to the caller
+    EXPECT_FALSE(biquadFilterBankUpdateNotchFromTable(&bank, 0, &table, 99.0f, 1.0f));
+    EXPECT_FALSE(biquadFilterBankUpdateNotchFromTable(&bank, 0, &table, 3001.0f, 1.0f));
+
+    // an empty range never matches
+    biquadNotchTableInit(&table, coeffs, ARRAYLEN(coeffs), 100.0f, 100.0f, 125, 5.0f);
+    EXPECT_FALSE(biquadFilterBankUpdateNotchFromTable(&bank, 0, &table, 100.0f, 1.0f));
+}
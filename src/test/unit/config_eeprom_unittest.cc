@@ -0,0 +1,344 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/crc.h"
+    #include "common/utils.h"
+
+    #include "config/config_eeprom.h"
+    #include "config/config_eeprom_impl.h"
+    #include "config/config_streamer.h"
+    #include "config/config_streamer_impl.h"
+
+    #include "drivers/system.h"
+
+    #include "pg/pg.h"
+    #include "pg/pg_ids.h"
+
+    typedef struct testConfig_s {
+        uint32_t value;
+    } testConfig_t;
+
+    typedef struct testArrayConfig_s {
+        uint8_t values[8];
+    } testArrayConfig_t;
+
+    PG_DECLARE(testConfig_t, testConfig);
+    PG_REGISTER(testConfig_t, testConfig, PG_RESERVED_FOR_TESTING_1, 0);
+    PG_DECLARE(testArrayConfig_t, testArrayConfig);
+    PG_REGISTER(testArrayConfig_t, testArrayConfig, PG_RESERVED_FOR_TESTING_2, 0);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// Log blocks holding one record of each PG, with the header and CRC
+#define CONFIG_BLOCK_SIZE       (8 + 6 + sizeof(testConfig_t) + 2)
+#define ARRAY_BLOCK_SIZE        (8 + 6 + sizeof(testArrayConfig_t) + 2)
+
+// Offset of the generation in the saved copy, it is the first record after the header
+#define GENERATION_OFFSET       (2 + 6)
+
+static bool programmedUnerased;
+static int failWordOffset = -1;
+static bool failed;
+
+static void eraseStorage(void)
+{
+    memset(eepromData, 0xFF, sizeof(eepromData));
+    programmedUnerased = false;
+    failWordOffset = -1;
+    failed = false;
+}
+
+static uint32_t savedGeneration(void)
+{
+    uint32_t generation;
+    memcpy(&generation, &eepromData[GENERATION_OFFSET], sizeof(generation));
+    return generation;
+}
+
+static void saveValue(uint32_t value)
+{
+    testConfigMutable()->value = value;
+    writeConfigToEEPROM();
+    EXPECT_FALSE(failed);
+}
+
+// Load the stored config as it would be at boot, returns the value it holds
+static uint32_t reboot(void)
+{
+    testConfigMutable()->value = 0xDEAD;
+    memset(testArrayConfigMutable(), 0, sizeof(testArrayConfig_t));
+
+    EXPECT_TRUE(isEEPROMVersionValid());
+    EXPECT_TRUE(isEEPROMStructureValid());
+    EXPECT_TRUE(loadEEPROM());
+    return testConfig()->value;
+}
+
+// Write a complete log block holding one testConfig record, as an older copy of the config would have
+static void writeBlock(uint16_t offset, uint32_t generation, uint32_t value)
+{
+    uint8_t block[CONFIG_BLOCK_SIZE];
+    const uint16_t magic = 0xC10C;
+    const uint16_t blockSize = sizeof(block);
+    const uint16_t recordSize = 6 + sizeof(value);
+    const uint16_t pgn = PG_RESERVED_FOR_TESTING_1;
+
+    memcpy(&block[0], &magic, 2);
+    memcpy(&block[2], &blockSize, 2);
+    memcpy(&block[4], &generation, 4);
+    memcpy(&block[8], &recordSize, 2);
+    memcpy(&block[10], &pgn, 2);
+    block[12] = 0; // version
+    block[13] = 0; // flags
+    memcpy(&block[14], &value, sizeof(value));
+
+    const uint16_t crc = crc16_ccitt_update(0xFFFF, block, sizeof(block) - 2);
+    const uint16_t invertedBigEndianCrc = ~(((crc & 0xFF) << 8) | (crc >> 8));
+    memcpy(&block[sizeof(block) - 2], &invertedBigEndianCrc, 2);
+
+    memcpy(&eepromData[offset], block, sizeof(block));
+}
+
+TEST(ConfigEepromTest, TestChangedPGsAreAppended)
+{
+    eraseStorage();
+    pgResetAll();
+
+    saveValue(1);
+    EXPECT_EQ(1U, savedGeneration());
+    uint8_t copy[sizeof(eepromData)];
+    memcpy(copy, eepromData, sizeof(copy));
+
+    saveValue(2);
+    const uint16_t logStart = getEEPROMConfigSize() - CONFIG_BLOCK_SIZE;
+    EXPECT_EQ(1U, savedGeneration());
+    EXPECT_EQ(0, memcmp(copy, eepromData, logStart));
+    EXPECT_EQ(0x0C, eepromData[logStart]);
+    EXPECT_EQ(0xC1, eepromData[logStart + 1]);
+
+    // A block only holds the PGs that changed
+    testArrayConfigMutable()->values[3] = 42;
+    writeConfigToEEPROM();
+    EXPECT_EQ(logStart + CONFIG_BLOCK_SIZE + ARRAY_BLOCK_SIZE, getEEPROMConfigSize());
+
+    // and nothing is written when nothing changed
+    writeConfigToEEPROM();
+    EXPECT_EQ(logStart + CONFIG_BLOCK_SIZE + ARRAY_BLOCK_SIZE, getEEPROMConfigSize());
+
+    EXPECT_EQ(2U, reboot());
+    EXPECT_EQ(42, testArrayConfig()->values[3]);
+    EXPECT_FALSE(programmedUnerased);
+}
+
+TEST(ConfigEepromTest, TestLogIsCompactedWhenFull)
+{
+    eraseStorage();
+    pgResetAll();
+
+    saveValue(0);
+    const uint32_t generation = savedGeneration();
+    const uint16_t copySize = getEEPROMConfigSize();
+
+    uint32_t value = 0;
+    while (savedGeneration() == generation && value < sizeof(eepromData) / CONFIG_BLOCK_SIZE + 1) {
+        saveValue(++value);
+    }
+
+    // The log filled up, so the config was written out again as a single copy
+    EXPECT_EQ(generation + 1, savedGeneration());
+    EXPECT_EQ(copySize, getEEPROMConfigSize());
+    EXPECT_EQ(value, reboot());
+
+    // and the log carries on after it, over the blocks of the old copy as each erase unit is reached
+    while (getEEPROMConfigSize() < FLASH_CONFIG_ERASE_SIZE + CONFIG_BLOCK_SIZE) {
+        saveValue(++value);
+        ASSERT_EQ(generation + 1, savedGeneration());
+    }
+    EXPECT_EQ(value, reboot());
+    EXPECT_FALSE(programmedUnerased);
+}
+
+TEST(ConfigEepromTest, TestTornBlockIsIgnored)
+{
+    eraseStorage();
+    pgResetAll();
+
+    saveValue(1);
+    const uint16_t copySize = getEEPROMConfigSize();
+    saveValue(2);
+    const uint16_t logEnd = getEEPROMConfigSize();
+
+    // Power was lost before the end of the last block was programmed
+    memset(&eepromData[logEnd - 4], 0xFF, 4);
+    EXPECT_EQ(1U, reboot());
+    EXPECT_EQ(copySize, getEEPROMConfigSize());
+
+    // The next block can't go over what is left of it, so the config is written out again without a log
+    saveValue(3);
+    EXPECT_EQ(copySize, getEEPROMConfigSize());
+    EXPECT_EQ(0xFF, eepromData[logEnd - CONFIG_BLOCK_SIZE]);
+    EXPECT_EQ(3U, reboot());
+    EXPECT_FALSE(programmedUnerased);
+}
+
+TEST(ConfigEepromTest, TestStaleBlockIsNotApplied)
+{
+    eraseStorage();
+    pgResetAll();
+
+    saveValue(1);
+    saveValue(2);
+    const uint16_t logStart = getEEPROMConfigSize() - CONFIG_BLOCK_SIZE;
+
+    // A block left in the next erase unit by an older copy, of the generation the next copy would take after this one
+    const uint32_t staleGeneration = savedGeneration() + 1;
+    writeBlock(FLASH_CONFIG_ERASE_SIZE, staleGeneration, 99);
+
+    // The saved copy is from another firmware version, so its generation can't be trusted
+    eepromData[0] = EEPROM_CONF_VERSION + 1;
+    saveValue(3);
+    EXPECT_GT(savedGeneration(), staleGeneration);
+    EXPECT_EQ(3U, reboot());
+
+    // Fill the log up to the stale block exactly, with blocks of one PG or the other
+    unsigned arrayBlocks = 0;
+    while ((FLASH_CONFIG_ERASE_SIZE - logStart - arrayBlocks * ARRAY_BLOCK_SIZE) % CONFIG_BLOCK_SIZE != 0) {
+        arrayBlocks++;
+    }
+    const unsigned configBlocks = (FLASH_CONFIG_ERASE_SIZE - logStart - arrayBlocks * ARRAY_BLOCK_SIZE) / CONFIG_BLOCK_SIZE;
+    for (unsigned i = 0; i < arrayBlocks; i++) {
+        testArrayConfigMutable()->values[0]++;
+        writeConfigToEEPROM();
+    }
+    for (unsigned i = 0; i < configBlocks; i++) {
+        saveValue(10 + i);
+    }
+    ASSERT_EQ(FLASH_CONFIG_ERASE_SIZE, getEEPROMConfigSize());
+
+    EXPECT_EQ(10 + configBlocks - 1, reboot());
+    EXPECT_FALSE(programmedUnerased);
+}
+
+TEST(ConfigEepromTest, TestBlockIsNotWrittenOverUnerasedBytes)
+{
+    eraseStorage();
+    pgResetAll();
+
+    saveValue(1);
+    uint32_t value = 1;
+    // Until the next block would cross a page, but stay in the same erase unit
+    while (getEEPROMConfigSize() + CONFIG_BLOCK_SIZE <= FLASH_PAGE_SIZE) {
+        saveValue(++value);
+    }
+    const uint16_t logEnd = getEEPROMConfigSize();
+    const uint32_t generation = savedGeneration();
+    ASSERT_GT(logEnd + CONFIG_BLOCK_SIZE, FLASH_PAGE_SIZE);
+
+    // The end of the next block's space, in the next page, isn't erased
+    eepromData[logEnd + CONFIG_BLOCK_SIZE - 1] = 0x00;
+    saveValue(++value);
+
+    EXPECT_FALSE(programmedUnerased);
+    EXPECT_EQ(generation + 1, savedGeneration());
+    EXPECT_EQ(value, reboot());
+}
+
+TEST(ConfigEepromTest, TestBlockThatDoesNotReadBackIsRewritten)
+{
+    eraseStorage();
+    pgResetAll();
+
+    saveValue(1);
+    saveValue(2);
+    const uint32_t generation = savedGeneration();
+
+    // A word of the next block doesn't program
+    failWordOffset = getEEPROMConfigSize() + 8;
+    saveValue(3);
+
+    EXPECT_EQ(generation + 1, savedGeneration());
+    EXPECT_EQ(3U, reboot());
+    EXPECT_FALSE(programmedUnerased);
+}
+
+// STUBS
+
+extern "C" {
+
+void configUnlock(void)
+{
+}
+
+void configLock(void)
+{
+}
+
+void configClearFlags(void)
+{
+}
+
+// Program a word like flash does, erasing each erase unit when its first word is written
+configStreamerResult_e configWriteWord(uintptr_t address, config_streamer_buffer_type_t *buffer)
+{
+    const uintptr_t offset = address - (uintptr_t)eepromData;
+    if (offset % FLASH_CONFIG_ERASE_SIZE == 0) {
+        memset(&eepromData[offset], 0xFF, FLASH_CONFIG_ERASE_SIZE);
+    }
+
+    for (unsigned i = 0; i < sizeof(*buffer); i++) {
+        if (eepromData[offset + i] != 0xFF) {
+            programmedUnerased = true;
+        }
+    }
+
+    if ((int)offset == failWordOffset) {
+        failWordOffset = -1;
+        return CONFIG_RESULT_SUCCESS;
+    }
+
+    // Programming can only clear bits
+    for (unsigned i = 0; i < sizeof(*buffer); i++) {
+        eepromData[offset + i] &= ((const uint8_t *)buffer)[i];
+    }
+    return CONFIG_RESULT_SUCCESS;
+}
+
+bool loadEEPROMFromFile(void)
+{
+    return true;
+}
+
+void failureMode(failureMode_e mode)
+{
+    UNUSED(mode);
+    failed = true;
+}
+
+}
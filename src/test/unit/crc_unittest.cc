@@ -0,0 +1,190 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/crc.h"
+    #include "common/streambuf.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// The bit by bit CRCs the tables are built from
+static uint16_t referenceCrc16Ccitt(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    while (length--) {
+        crc ^= (uint16_t)*data++ << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint8_t referenceCrc8(uint8_t crc, const uint8_t *data, uint32_t length, uint8_t poly)
+{
+    while (length--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ poly : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint8_t testData[256];
+
+static void fillTestData(void)
+{
+    uint32_t seed = 1;
+    for (unsigned i = 0; i < sizeof(testData); i++) {
+        seed = seed * 1103515245 + 12345;
+        testData[i] = seed >> 16;
+    }
+}
+
+TEST(CrcUnittest, TestCheckValues)
+{
+    const char *check = "123456789";
+
+    EXPECT_EQ(0x31C3, crc16_ccitt_update(0, check, 9));
+    EXPECT_EQ(0x29B1, crc16_ccitt_update(0xFFFF, check, 9));
+    EXPECT_EQ(0xBC, crc8_dvb_s2_update(0, check, 9));
+}
+
+TEST(CrcUnittest, TestMatchesBitwiseCrc)
+{
+    fillTestData();
+
+    // every length and alignment, so each number of whole slices is followed by each length of tail
+    for (unsigned offset = 0; offset < 8; offset++) {
+        for (unsigned length = 0; length < sizeof(testData) - offset; length++) {
+            const uint8_t *data = testData + offset;
+            ASSERT_EQ(referenceCrc16Ccitt(0x1D0F, data, length), crc16_ccitt_update(0x1D0F, data, length));
+            ASSERT_EQ(referenceCrc8(0x5A, data, length, 0xD5), crc8_dvb_s2_update(0x5A, data, length));
+            ASSERT_EQ(referenceCrc8(0x5A, data, length, 0xBA), crc8_update(0x5A, data, length, 0xBA));
+        }
+    }
+
+    for (unsigned i = 0; i < sizeof(testData); i++) {
+        ASSERT_EQ(referenceCrc16Ccitt(0x1234, &testData[i], 1), crc16_ccitt(0x1234, testData[i]));
+        ASSERT_EQ(referenceCrc8(0x12, &testData[i], 1, 0xD5), crc8_dvb_s2(0x12, testData[i]));
+        ASSERT_EQ(referenceCrc8(0x12, &testData[i], 1, 0xBA), crc8_poly_0xba(0x12, testData[i]));
+    }
+}
+
+TEST(CrcUnittest, TestSbufAppend)
+{
+    fillTestData();
+
+    uint8_t buf[64];
+    sbuf_t sbuf = { .ptr = buf, .end = ARRAYEND(buf) };
+    sbufWriteData(&sbuf, testData, 40);
+    crc16_ccitt_sbuf_append(&sbuf, buf);
+    crc8_dvb_s2_sbuf_append(&sbuf, buf);
+
+    EXPECT_EQ(43, sbuf.ptr - buf);
+    const uint16_t crc16 = referenceCrc16Ccitt(0, testData, 40);
+    EXPECT_EQ(crc16 & 0xFF, buf[40]);
+    EXPECT_EQ(crc16 >> 8, buf[41]);
+    EXPECT_EQ(referenceCrc8(0, buf, 42, 0xD5), buf[42]);
+}
+
+TEST(CrcUnittest, TestFletcher8)
+{
+    fillTestData();
+
+    // every length and alignment, so each number of whole words is followed by each length of tail
+    for (unsigned offset = 0; offset < 4; offset++) {
+        for (unsigned length = 0; length < sizeof(testData) - offset; length++) {
+            const uint8_t *data = testData + offset;
+            uint8_t a = 0x12;
+            uint8_t b = 0x34;
+            for (unsigned i = 0; i < length; i++) {
+                a += data[i];
+                b += a;
+            }
+            ASSERT_EQ(a | b << 8, fletcher8_update(0x3412, data, length));
+        }
+    }
+
+    // UBX-CFG-PRT poll, class, ID and length, is sent with checksum 0x06 0x18
+    const uint8_t poll[] = { 0x06, 0x00, 0x00, 0x00 };
+    EXPECT_EQ(0x1806, fletcher8_update(0, poll, sizeof(poll)));
+}
+
+static bool hardwareAvailable;
+static int hardwareCalls;
+
+static bool testCcittUpdate(uint16_t *crc, const void *data, uint32_t length)
+{
+    hardwareCalls++;
+    if (!hardwareAvailable) {
+        return false;
+    }
+    *crc = referenceCrc16Ccitt(*crc, (const uint8_t *)data, length);
+    return true;
+}
+
+static bool testDvbS2Update(uint8_t *crc, const void *data, uint32_t length)
+{
+    hardwareCalls++;
+    if (!hardwareAvailable) {
+        return false;
+    }
+    *crc = referenceCrc8(*crc, (const uint8_t *)data, length, 0xD5);
+    return true;
+}
+
+static const crcEngine_t testEngine = {
+    .crc16CcittUpdate = testCcittUpdate,
+    .crc8DvbS2Update = testDvbS2Update,
+};
+
+TEST(CrcUnittest, TestHardwareUsedForLongBuffers)
+{
+    fillTestData();
+    crcSetHardwareEngine(&testEngine);
+
+    hardwareAvailable = true;
+    hardwareCalls = 0;
+    crc16_ccitt_update(0, testData, CRC_HARDWARE_MIN_LENGTH - 1);
+    crc8_dvb_s2_update(0, testData, CRC_HARDWARE_MIN_LENGTH - 1);
+    EXPECT_EQ(0, hardwareCalls);
+
+    EXPECT_EQ(referenceCrc16Ccitt(0, testData, CRC_HARDWARE_MIN_LENGTH), crc16_ccitt_update(0, testData, CRC_HARDWARE_MIN_LENGTH));
+    EXPECT_EQ(referenceCrc8(0, testData, CRC_HARDWARE_MIN_LENGTH, 0xD5), crc8_dvb_s2_update(0, testData, CRC_HARDWARE_MIN_LENGTH));
+    EXPECT_EQ(2, hardwareCalls);
+
+    // a busy peripheral falls back to software
+    hardwareAvailable = false;
+    EXPECT_EQ(referenceCrc16Ccitt(0, testData, sizeof(testData)), crc16_ccitt_update(0, testData, sizeof(testData)));
+    EXPECT_EQ(referenceCrc8(0, testData, sizeof(testData), 0xD5), crc8_dvb_s2_update(0, testData, sizeof(testData)));
+    EXPECT_EQ(4, hardwareCalls);
+
+    crcSetHardwareEngine(NULL);
+}
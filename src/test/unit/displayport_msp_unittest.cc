@@ -0,0 +1,318 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "drivers/display.h"
+    #include "drivers/osd.h"
+
+    #include "io/displayport_msp.h"
+
+    #include "msp/msp.h"
+    #include "msp/msp_protocol.h"
+    #include "msp/msp_serial.h"
+
+    #include "osd/osd.h"
+
+    #include "pg/displayport_profiles.h"
+    #include "pg/pg_ids.h"
+    #include "pg/vcd.h"
+
+    PG_REGISTER(osdConfig_t, osdConfig, PG_OSD_CONFIG, 0);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+typedef std::vector<uint8_t> frame_t;
+
+static std::vector<frame_t> frames;
+static uint32_t txBytesFree;
+
+// The test canvas is blank, any run written to rows 10 and up is only sent again by the row refresh well after the test
+#define ROW 10
+
+static displayPort_t *initDisplayPort(bool batchWrites)
+{
+    pgResetAll();
+    displayPortProfileMspMutable()->batchWrites = batchWrites;
+    vcdProfileMutable()->video_system = VIDEO_SYSTEM_HD;
+    osdConfigMutable()->canvas_rows = OSD_HD_ROWS;
+    osdConfigMutable()->canvas_cols = OSD_HD_COLS;
+    txBytesFree = UINT32_MAX;
+
+    displayPort_t *displayPort = displayPortMspInit();
+    frames.clear();
+    return displayPort;
+}
+
+static frame_t subcommand(uint8_t subcmd)
+{
+    return frame_t { subcmd };
+}
+
+TEST(DisplayPortMspUnittest, TestWritesSentDirectlyWithoutBatching)
+{
+    displayPort_t *displayPort = initDisplayPort(false);
+
+    displayWrite(displayPort, 2, ROW, DISPLAYPORT_SEVERITY_NORMAL, "AB");
+    displayDrawScreen(displayPort);
+
+    ASSERT_EQ(2, frames.size());
+    EXPECT_EQ((frame_t { MSP_DP_WRITE_STRING, ROW, 2, 0, 'A', 'B' }), frames[0]);
+    EXPECT_EQ(subcommand(MSP_DP_DRAW_SCREEN), frames[1]);
+}
+
+TEST(DisplayPortMspUnittest, TestInitClearsTheDisplay)
+{
+    initDisplayPort(true);
+
+    frames.clear();
+    displayPortMspInit();
+
+    ASSERT_EQ(2, frames.size());
+    EXPECT_EQ(subcommand(MSP_DP_CLEAR_SCREEN), frames[0]);
+    EXPECT_EQ(subcommand(MSP_DP_DRAW_SCREEN), frames[1]);
+}
+
+TEST(DisplayPortMspUnittest, TestOnlyChangedCellsSent)
+{
+    displayPort_t *displayPort = initDisplayPort(true);
+
+    displayWrite(displayPort, 2, ROW, DISPLAYPORT_SEVERITY_NORMAL, "ABC");
+    EXPECT_EQ(0, frames.size());
+    EXPECT_FALSE(displayDrawScreen(displayPort));
+
+    ASSERT_EQ(2, frames.size());
+    EXPECT_EQ((frame_t { MSP_DP_WRITE_RUNS, ROW, 2, 0, 3, 'A', 'B', 'C' }), frames[0]);
+    EXPECT_EQ(subcommand(MSP_DP_DRAW_SCREEN), frames[1]);
+
+    // Writing the same again sends nothing, a changed character only itself
+    frames.clear();
+    displayWrite(displayPort, 2, ROW, DISPLAYPORT_SEVERITY_NORMAL, "ABC");
+    displayDrawScreen(displayPort);
+    displayWrite(displayPort, 2, ROW, DISPLAYPORT_SEVERITY_NORMAL, "AXC");
+    displayDrawScreen(displayPort);
+
+    ASSERT_EQ(3, frames.size());
+    EXPECT_EQ(subcommand(MSP_DP_DRAW_SCREEN), frames[0]);
+    EXPECT_EQ((frame_t { MSP_DP_WRITE_RUNS, ROW, 3, 0, 1, 'X' }), frames[1]);
+    EXPECT_EQ(subcommand(MSP_DP_DRAW_SCREEN), frames[2]);
+}
+
+TEST(DisplayPortMspUnittest, TestRunsJoinedAcrossShortGaps)
+{
+    displayPort_t *displayPort = initDisplayPort(true);
+
+    displayWrite(displayPort, 0, ROW, DISPLAYPORT_SEVERITY_NORMAL, "A");
+    displayWrite(displayPort, 3, ROW, DISPLAYPORT_SEVERITY_NORMAL, "B");
+    displayWrite(displayPort, 10, ROW, DISPLAYPORT_SEVERITY_NORMAL, "C");
+    displayWrite(displayPort, 11, ROW, DISPLAYPORT_SEVERITY_CRITICAL, "D");
+    displayWrite(displayPort, 0, ROW + 1, DISPLAYPORT_SEVERITY_NORMAL, "E");
+    displayDrawScreen(displayPort);
+
+    // all the runs go in one frame, but a run doesn't span rows or attributes
+    ASSERT_EQ(2, frames.size());
+    EXPECT_EQ((frame_t { MSP_DP_WRITE_RUNS,
+        ROW, 0, 0, 4, 'A', ' ', ' ', 'B',
+        ROW, 10, 0, 1, 'C',
+        ROW, 11, DISPLAYPORT_SEVERITY_CRITICAL, 1, 'D',
+        ROW + 1, 0, 0, 1, 'E' }), frames[0]);
+}
+
+TEST(DisplayPortMspUnittest, TestRunsSplitAcrossFrames)
+{
+    displayPort_t *displayPort = initDisplayPort(true);
+
+    char row[OSD_HD_COLS + 1];
+    memset(row, 'x', OSD_HD_COLS);
+    row[OSD_HD_COLS] = 0;
+    for (int i = 0; i < 4; i++) {
+        displayWrite(displayPort, 0, ROW + i, DISPLAYPORT_SEVERITY_NORMAL, row);
+    }
+    displayDrawScreen(displayPort);
+
+    unsigned cells = 0;
+    for (unsigned i = 0; i < frames.size() - 1; i++) {
+        const frame_t &frame = frames[i];
+        EXPECT_LE(frame.size(), DISPLAYPORT_MSP_BATCH_FRAME_SIZE);
+        EXPECT_EQ(MSP_DP_WRITE_RUNS, frame[0]);
+        for (unsigned pos = 1; pos < frame.size(); pos += DISPLAYPORT_MSP_BATCH_RUN_HEADER_SIZE + frame[pos + 3]) {
+            EXPECT_EQ(ROW * OSD_HD_COLS + cells, frame[pos] * OSD_HD_COLS + frame[pos + 1]);
+            cells += frame[pos + 3];
+        }
+    }
+    EXPECT_EQ(4 * OSD_HD_COLS, cells);
+    EXPECT_EQ(subcommand(MSP_DP_DRAW_SCREEN), frames.back());
+}
+
+TEST(DisplayPortMspUnittest, TestStaticScreenSendsNothing)
+{
+    displayPort_t *displayPort = initDisplayPort(true);
+
+    // The OSD clears the canvas and draws every element again for each refresh
+    for (int i = 0; i < 2; i++) {
+        frames.clear();
+        displayClearScreen(displayPort, DISPLAY_CLEAR_NONE);
+        displayWrite(displayPort, 0, ROW, DISPLAYPORT_SEVERITY_NORMAL, "AB");
+        displayWrite(displayPort, 7, ROW + 2, DISPLAYPORT_SEVERITY_WARNING, "CD");
+        EXPECT_EQ(0, frames.size());
+        displayDrawScreen(displayPort);
+    }
+
+    ASSERT_EQ(1, frames.size());
+    EXPECT_EQ(subcommand(MSP_DP_DRAW_SCREEN), frames[0]);
+}
+
+TEST(DisplayPortMspUnittest, TestClearedCellsSentAsBlanks)
+{
+    displayPort_t *displayPort = initDisplayPort(true);
+
+    displayWrite(displayPort, 0, ROW, DISPLAYPORT_SEVERITY_NORMAL, "ABC");
+    displayDrawScreen(displayPort);
+
+    frames.clear();
+    displayClearScreen(displayPort, DISPLAY_CLEAR_NONE);
+    displayWrite(displayPort, 0, ROW, DISPLAYPORT_SEVERITY_NORMAL, "AB");
+    displayDrawScreen(displayPort);
+
+    // the display isn't cleared, only the character no longer drawn is overwritten
+    ASSERT_EQ(2, frames.size());
+    EXPECT_EQ((frame_t { MSP_DP_WRITE_RUNS, ROW, 2, 0, 1, ' ' }), frames[0]);
+    EXPECT_EQ(subcommand(MSP_DP_DRAW_SCREEN), frames[1]);
+}
+
+TEST(DisplayPortMspUnittest, TestRedrawClearsAndResendsEverything)
+{
+    displayPort_t *displayPort = initDisplayPort(true);
+
+    displayWrite(displayPort, 0, ROW, DISPLAYPORT_SEVERITY_NORMAL, "AB");
+    displayDrawScreen(displayPort);
+
+    frames.clear();
+    displayRedraw(displayPort);
+
+    ASSERT_EQ(3, frames.size());
+    EXPECT_EQ(subcommand(MSP_DP_CLEAR_SCREEN), frames[0]);
+    EXPECT_EQ((frame_t { MSP_DP_WRITE_RUNS, ROW, 0, 0, 2, 'A', 'B' }), frames[1]);
+    EXPECT_EQ(subcommand(MSP_DP_DRAW_SCREEN), frames[2]);
+}
+
+TEST(DisplayPortMspUnittest, TestDrawWaitsForTransmitBuffer)
+{
+    displayPort_t *displayPort = initDisplayPort(true);
+
+    displayWrite(displayPort, 0, ROW, DISPLAYPORT_SEVERITY_NORMAL, "AB");
+
+    txBytesFree = 20;
+    EXPECT_TRUE(displayDrawScreen(displayPort));
+    EXPECT_EQ(0, frames.size());
+
+    txBytesFree = UINT32_MAX;
+    EXPECT_FALSE(displayDrawScreen(displayPort));
+    ASSERT_EQ(2, frames.size());
+    EXPECT_EQ((frame_t { MSP_DP_WRITE_RUNS, ROW, 0, 0, 2, 'A', 'B' }), frames[0]);
+}
+
+TEST(DisplayPortMspUnittest, TestDrawResumesWhereTransmitBufferFilled)
+{
+    displayPort_t *displayPort = initDisplayPort(true);
+
+    char row[OSD_HD_COLS + 1];
+    memset(row, 'x', OSD_HD_COLS);
+    row[OSD_HD_COLS] = 0;
+    for (int i = 0; i < 4; i++) {
+        displayWrite(displayPort, 0, ROW + i, DISPLAYPORT_SEVERITY_NORMAL, row);
+    }
+
+    // Room for one frame of runs only, the draw screen waits for the rest
+    txBytesFree = (DISPLAYPORT_MSP_BATCH_FRAME_SIZE + MSP_MAX_HEADER_SIZE + 1) + (1 + MSP_MAX_HEADER_SIZE + 1);
+    EXPECT_TRUE(displayDrawScreen(displayPort));
+    ASSERT_EQ(1, frames.size());
+    unsigned firstFrameCells = 0;
+    for (unsigned pos = 1; pos < frames[0].size(); pos += DISPLAYPORT_MSP_BATCH_RUN_HEADER_SIZE + frames[0][pos + 3]) {
+        firstFrameCells += frames[0][pos + 3];
+    }
+    ASSERT_GT(firstFrameCells, (unsigned)OSD_HD_COLS);
+
+    // a cell already sent that changes meanwhile is sent by the next draw
+    displayWrite(displayPort, 0, ROW, DISPLAYPORT_SEVERITY_NORMAL, "y");
+
+    frames.clear();
+    txBytesFree = UINT32_MAX;
+    EXPECT_FALSE(displayDrawScreen(displayPort));
+    EXPECT_EQ(MSP_DP_WRITE_RUNS, frames[0][0]);
+    EXPECT_EQ(ROW * OSD_HD_COLS + firstFrameCells, frames[0][1] * OSD_HD_COLS + frames[0][2]);
+    EXPECT_EQ(subcommand(MSP_DP_DRAW_SCREEN), frames.back());
+
+    frames.clear();
+    displayDrawScreen(displayPort);
+    ASSERT_EQ(2, frames.size());
+    EXPECT_EQ((frame_t { MSP_DP_WRITE_RUNS, ROW, 0, 0, 1, 'y' }), frames[0]);
+}
+
+TEST(DisplayPortMspUnittest, TestRowsRefreshed)
+{
+    displayPort_t *displayPort = initDisplayPort(true);
+
+    displayWrite(displayPort, 5, ROW, DISPLAYPORT_SEVERITY_NORMAL, "AB");
+
+    // Each draw sends one row again, so the row is resent once every OSD_HD_ROWS draws
+    int sent = 0;
+    for (int i = 0; i < 2 * OSD_HD_ROWS; i++) {
+        frames.clear();
+        displayDrawScreen(displayPort);
+        if (frames.size() == 2) {
+            EXPECT_EQ((frame_t { MSP_DP_WRITE_RUNS, ROW, 5, 0, 2, 'A', 'B' }), frames[0]);
+            sent++;
+        }
+    }
+    EXPECT_EQ(3, sent);
+}
+
+// STUBS
+
+extern "C" {
+
+int mspSerialPush(serialPortIdentifier_e port, uint8_t cmd, uint8_t *data, int datalen, mspDirection_e direction, mspVersion_e mspVersion)
+{
+    UNUSED(port);
+    UNUSED(direction);
+    UNUSED(mspVersion);
+
+    EXPECT_EQ(MSP_DISPLAYPORT, cmd);
+    frames.push_back(frame_t(data, data + datalen));
+    txBytesFree -= datalen + MSP_MAX_HEADER_SIZE + 1;
+    return datalen;
+}
+
+uint32_t mspSerialTxBytesFree(void)
+{
+    return txBytesFree;
+}
+
+}
@@ -0,0 +1,323 @@
+/*
+ * This file is part of Cleanflight.
+ *
+ * Cleanflight is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cleanflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cleanflight.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/maths.h"
+
+    #include "drivers/flash/flash.h"
+    #include "drivers/system.h"
+
+    #include "io/flashfs.h"
+
+    #include "pg/flash.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// The RAM flash is 256 sectors of 4KB, the last of which holds the index
+#define VOLUME_SIZE (255 * 4096)
+
+static flashConfig_t testFlashConfig;
+
+// Initialise the flash and flashfs as at boot, the RAM flash keeps its contents
+static void reboot(void)
+{
+    flashInit(&testFlashConfig);
+    flashfsInit();
+}
+
+static void writeLog(int length)
+{
+    uint8_t data[64];
+    memset(data, 0x5A, sizeof(data));
+
+    flashfsBeginLog();
+    while (length > 0) {
+        const int chunk = MIN(length, (int)sizeof(data));
+        flashfsWrite(data, chunk, true);
+        length -= chunk;
+    }
+    while (!flashfsEndLog());
+    // as blackbox does, which writes the end record
+    while (!flashfsFlushAsync(true));
+}
+
+static void eraseVolume(void)
+{
+    reboot();
+    flashfsEraseCompletely();
+    while (flashfsIsEraseInProgress()) {
+        flashfsEraseAsync();
+    }
+}
+
+TEST(FlashfsUnittest, TestIndexAreaIsNotPartOfTheVolume)
+{
+    eraseVolume();
+    reboot();
+
+    EXPECT_EQ(VOLUME_SIZE, flashfsGetSize());
+    EXPECT_EQ(0, flashfsGetOffset());
+    EXPECT_EQ(0, flashfsGetLogCount());
+}
+
+TEST(FlashfsUnittest, TestLogsFoundAtBoot)
+{
+    eraseVolume();
+    reboot();
+
+    writeLog(3000);
+    writeLog(100);
+
+    reboot();
+
+    // each log starts on a 2KB boundary
+    EXPECT_EQ(2, flashfsGetLogCount());
+    EXPECT_EQ(6144, flashfsGetOffset());
+
+    flashfsLog_t log;
+    EXPECT_TRUE(flashfsGetLog(0, &log));
+    EXPECT_EQ(0, log.start);
+    EXPECT_EQ(4096, log.end);
+    EXPECT_TRUE(flashfsGetLog(1, &log));
+    EXPECT_EQ(4096, log.start);
+    EXPECT_EQ(6144, log.end);
+    EXPECT_FALSE(flashfsGetLog(2, &log));
+
+    // and logging resumes after them
+    writeLog(10);
+    EXPECT_EQ(3, flashfsGetLogCount());
+    EXPECT_TRUE(flashfsGetLog(2, &log));
+    EXPECT_EQ(6144, log.start);
+    EXPECT_EQ(8192, log.end);
+}
+
+TEST(FlashfsUnittest, TestOpenLogListed)
+{
+    eraseVolume();
+    reboot();
+
+    uint8_t data[100] = { 0 };
+    flashfsBeginLog();
+    flashfsWrite(data, sizeof(data), true);
+    flashfsFlushSync();
+
+    flashfsLog_t log;
+    EXPECT_EQ(1, flashfsGetLogCount());
+    EXPECT_TRUE(flashfsGetLog(0, &log));
+    EXPECT_EQ(0, log.start);
+    EXPECT_EQ(100, log.end);
+
+    flashfsEndLog();
+    // ending it again changes nothing
+    flashfsEndLog();
+    EXPECT_EQ(1, flashfsGetLogCount());
+    EXPECT_EQ(2048, flashfsGetOffset());
+}
+
+TEST(FlashfsUnittest, TestIndexRecordsWrittenByFlush)
+{
+    eraseVolume();
+    reboot();
+
+    uint8_t record[8];
+    flashfsBeginLog();
+
+    // queued, not programmed, but the log is already listed
+    flashReadBytes(VOLUME_SIZE, record, sizeof(record));
+    EXPECT_EQ(0xFF, record[0]);
+    flashfsLog_t log;
+    EXPECT_EQ(1, flashfsGetLogCount());
+    EXPECT_TRUE(flashfsGetLog(0, &log));
+    EXPECT_EQ(0, log.start);
+
+    uint8_t data[100] = { 0 };
+    flashfsWrite(data, sizeof(data), false);
+    EXPECT_TRUE(flashfsFlushAsync(true));
+
+    // the header and the begin record went out ahead of the log data
+    flashReadBytes(VOLUME_SIZE, record, sizeof(record));
+    EXPECT_NE(0xFF, record[0]);
+    flashReadBytes(VOLUME_SIZE + sizeof(record), record, sizeof(record));
+    EXPECT_NE(0xFF, record[0]);
+    EXPECT_EQ(100, flashfsGetOffset());
+
+    EXPECT_TRUE(flashfsEndLog());
+    flashReadBytes(VOLUME_SIZE + 2 * sizeof(record), record, sizeof(record));
+    EXPECT_EQ(0xFF, record[0]);
+    EXPECT_TRUE(flashfsGetLog(0, &log));
+    EXPECT_EQ(2048, log.end);
+
+    EXPECT_TRUE(flashfsFlushAsync(false));
+    flashReadBytes(VOLUME_SIZE + 2 * sizeof(record), record, sizeof(record));
+    EXPECT_NE(0xFF, record[0]);
+
+    reboot();
+    EXPECT_EQ(1, flashfsGetLogCount());
+    EXPECT_EQ(2048, flashfsGetOffset());
+}
+
+TEST(FlashfsUnittest, TestLogCutShortByPowerLoss)
+{
+    eraseVolume();
+    reboot();
+
+    writeLog(1000);
+
+    uint8_t data[64];
+    memset(data, 0x5A, sizeof(data));
+    flashfsBeginLog();
+    for (int i = 0; i < 80; i++) {
+        flashfsWrite(data, sizeof(data), true);
+    }
+    flashfsFlushSync();
+
+    // no flashfsEndLog()
+    reboot();
+
+    flashfsLog_t log;
+    EXPECT_EQ(2, flashfsGetLogCount());
+    EXPECT_TRUE(flashfsGetLog(1, &log));
+    EXPECT_EQ(2048, log.start);
+    EXPECT_EQ(8192, log.end);
+    EXPECT_EQ(8192, flashfsGetOffset());
+
+    // the recovered end was recorded
+    reboot();
+    EXPECT_EQ(2, flashfsGetLogCount());
+    EXPECT_EQ(8192, flashfsGetOffset());
+}
+
+TEST(FlashfsUnittest, TestVolumeWrittenWithoutIndex)
+{
+    eraseVolume();
+    reboot();
+
+    uint8_t data[64];
+    memset(data, 0x5A, sizeof(data));
+    for (int i = 0; i < 40; i++) {
+        flashfsWrite(data, sizeof(data), true);
+    }
+    flashfsFlushSync();
+    flashfsClose();
+
+    reboot();
+
+    // the existing data is indexed as one log
+    flashfsLog_t log;
+    EXPECT_EQ(1, flashfsGetLogCount());
+    EXPECT_TRUE(flashfsGetLog(0, &log));
+    EXPECT_EQ(0, log.start);
+    EXPECT_EQ(4096, log.end);
+    EXPECT_EQ(4096, flashfsGetOffset());
+}
+
+TEST(FlashfsUnittest, TestIndexFull)
+{
+    eraseVolume();
+    reboot();
+
+    // A 4KB sector holds the header and 255 logs
+    for (int i = 0; i < 300; i++) {
+        writeLog(1);
+    }
+
+    EXPECT_EQ(255, flashfsGetLogCount());
+
+    // the rest are found by searching the volume
+    reboot();
+    EXPECT_EQ(255, flashfsGetLogCount());
+    EXPECT_EQ(300 * 2048, flashfsGetOffset());
+}
+
+TEST(FlashfsUnittest, TestEraseClearsIndex)
+{
+    eraseVolume();
+    reboot();
+
+    writeLog(100);
+    EXPECT_EQ(1, flashfsGetLogCount());
+
+    eraseVolume();
+    EXPECT_EQ(0, flashfsGetLogCount());
+
+    reboot();
+    EXPECT_EQ(0, flashfsGetLogCount());
+    EXPECT_EQ(0, flashfsGetOffset());
+
+    writeLog(100);
+    reboot();
+    EXPECT_EQ(1, flashfsGetLogCount());
+}
+
+TEST(FlashfsUnittest, TestWritesAcrossBufferWrap)
+{
+    eraseVolume();
+    reboot();
+
+    // chunks of every size up to more than the write buffer, so copies start and end all around it
+    static uint8_t data[20000];
+    for (unsigned i = 0; i < sizeof(data); i++) {
+        data[i] = i * 7 + (i >> 8);
+    }
+    unsigned written = 0;
+    for (unsigned chunk = 1; written + chunk <= sizeof(data); chunk = chunk % (FLASHFS_WRITE_BUFFER_SIZE + 40) + 1) {
+        flashfsWrite(&data[written], chunk, chunk & 1);
+        written += chunk;
+    }
+    flashfsFlushSync();
+    EXPECT_EQ(written, flashfsGetOffset());
+
+    static uint8_t readBack[sizeof(data)];
+    EXPECT_EQ((int)written, flashfsReadAbs(0, readBack, written));
+    EXPECT_EQ(0, memcmp(data, readBack, written));
+}
+
+// STUBS
+
+extern "C" {
+
+void failureMode(failureMode_e mode)
+{
+    UNUSED(mode);
+}
+
+void ioPreinitByTag(ioTag_t tag, ioConfig_t config, ioPreinitPinState_e preinitState)
+{
+    UNUSED(tag);
+    UNUSED(config);
+    UNUSED(preinitState);
+}
+
+void ledToggle(int led)
+{
+    UNUSED(led);
+}
+
+void ledSet(int led, bool state)
+{
+    UNUSED(led);
+    UNUSED(state);
+}
+
+}
@@ -0,0 +1,361 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "build/debug.h"
+
+    #include "drivers/serial.h"
+    #include "drivers/time.h"
+
+    #include "io/beeper.h"
+    #include "io/dashboard.h"
+    #include "io/gps.h"
+    #include "io/serial.h"
+
+    #include "pg/gps.h"
+    #include "pg/gps_rescue.h"
+    #include "pg/pg_ids.h"
+
+    #include "scheduler/scheduler.h"
+
+    PG_REGISTER(gpsRescueConfig_t, gpsRescueConfig, PG_GPS_RESCUE, 0);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define UBX_CLASS_NAV           0x01
+#define UBX_MSG_NAV_POSLLH      0x02
+#define UBX_CLASS_TEST          0x7F    // not handled by UBLOX_parse_gps(), only counted
+#define UBX_PAYLOAD_SIZE_MAX    (8 + 12 * GPS_SV_MAXSATS_M8N)
+#define UBX_PAYLOAD_SANITY_SIZE 776
+
+typedef struct parsed_s {
+    std::string packetLog;
+    uint32_t packetCount;
+    int32_t lat;
+    int32_t lon;
+    int32_t altCm;
+    uint32_t time;
+    int16_t debugNavInterval;
+} parsed_t;
+
+static serialPort_t gpsTestPort;
+static std::vector<uint8_t> rxData;
+static uint32_t rxPos;
+static uint32_t spanSize;
+
+static void addFrame(std::vector<uint8_t> &bytes, uint8_t msgClass, uint8_t msgId, const std::vector<uint8_t> &payload)
+{
+    const size_t start = bytes.size();
+    bytes.insert(bytes.end(), { 0xB5, 0x62, msgClass, msgId, (uint8_t)(payload.size() & 0xff), (uint8_t)(payload.size() >> 8) });
+    bytes.insert(bytes.end(), payload.begin(), payload.end());
+
+    uint8_t a = 0;
+    uint8_t b = 0;
+    for (size_t i = start + 2; i < bytes.size(); i++) {
+        b += (a += bytes[i]);
+    }
+    bytes.push_back(a);
+    bytes.push_back(b);
+}
+
+static void addPosllh(std::vector<uint8_t> &bytes, int32_t lat, int32_t lon, int32_t altitudeMslMm, uint32_t time)
+{
+    std::vector<uint8_t> payload(28);
+    memcpy(&payload[0], &time, 4);
+    memcpy(&payload[4], &lon, 4);
+    memcpy(&payload[8], &lat, 4);
+    memcpy(&payload[16], &altitudeMslMm, 4);
+    addFrame(bytes, UBX_CLASS_NAV, UBX_MSG_NAV_POSLLH, payload);
+}
+
+// Feeds bytes to gpsUpdate() in spans of up to spanLength bytes, as the serial driver hands them over
+static parsed_t parse(const std::vector<uint8_t> &bytes, uint32_t spanLength)
+{
+    rxData = bytes;
+    rxPos = 0;
+    spanSize = spanLength;
+    memset(&gpsSol, 0, sizeof(gpsSol));
+    memset(dashboardGpsPacketLog, 0, sizeof(dashboardGpsPacketLog));
+    debug[1] = -1;
+    const uint32_t packetCount = dashboardGpsPacketCount;
+
+    while (rxPos < rxData.size()) {
+        gpsUpdate(0);
+    }
+
+    const parsed_t parsed = {
+        .packetLog = std::string(dashboardGpsPacketLog, sizeof(dashboardGpsPacketLog)),
+        .packetCount = dashboardGpsPacketCount - packetCount,
+        .lat = gpsSol.llh.lat,
+        .lon = gpsSol.llh.lon,
+        .altCm = gpsSol.llh.altCm,
+        .time = gpsSol.time,
+        .debugNavInterval = debug[1],
+    };
+    return parsed;
+}
+
+// The bytes give the same result in spans of spanLength, where whole frames take the fast path, as a byte at a time
+static parsed_t expectSameAsByteAtATime(const std::vector<uint8_t> &bytes, uint32_t spanLength = UINT32_MAX)
+{
+    const parsed_t byteAtATime = parse(bytes, 1);
+    const parsed_t parsed = parse(bytes, spanLength);
+
+    // the log has a character for each frame parsed or error seen
+    EXPECT_EQ(byteAtATime.packetLog, parsed.packetLog);
+    EXPECT_EQ(byteAtATime.packetCount, parsed.packetCount);
+    EXPECT_EQ(byteAtATime.lat, parsed.lat);
+    EXPECT_EQ(byteAtATime.lon, parsed.lon);
+    EXPECT_EQ(byteAtATime.altCm, parsed.altCm);
+    EXPECT_EQ(byteAtATime.time, parsed.time);
+    EXPECT_EQ(byteAtATime.debugNavInterval, parsed.debugNavInterval);
+    return parsed;
+}
+
+static void initGps(void)
+{
+    static bool initialised;
+
+    if (!initialised) {
+        pgResetAll();
+        gpsConfigMutable()->provider = GPS_UBLOX;
+        gpsInit();
+        debugMode = DEBUG_GPS_CONNECTION;
+        initialised = true;
+    }
+    gpsData.state = GPS_STATE_RECEIVING_DATA;
+}
+
+TEST(GpsUbloxUnittest, TestWholeFrame)
+{
+    initGps();
+
+    std::vector<uint8_t> bytes;
+    addPosllh(bytes, 473977418, 85455939, 500000, 1234);
+
+    const parsed_t parsed = expectSameAsByteAtATime(bytes);
+    EXPECT_EQ(1U, parsed.packetCount);
+    EXPECT_EQ(473977418, parsed.lat);
+    EXPECT_EQ(85455939, parsed.lon);
+    EXPECT_EQ(50000, parsed.altCm);
+}
+
+TEST(GpsUbloxUnittest, TestFrameSplitAcrossSpans)
+{
+    initGps();
+
+    std::vector<uint8_t> bytes;
+    addPosllh(bytes, 1, 2, 30, 4);
+    addPosllh(bytes, 5, 6, 70, 8);
+    addPosllh(bytes, 9, 10, 110, 12);
+
+    // every split point within the frames
+    for (uint32_t span = 2; span < bytes.size(); span++) {
+        const parsed_t parsed = expectSameAsByteAtATime(bytes, span);
+        EXPECT_EQ(3U, parsed.packetCount);
+        EXPECT_EQ(9, parsed.lat);
+    }
+}
+
+TEST(GpsUbloxUnittest, TestBadChecksumThenValidFrame)
+{
+    initGps();
+
+    std::vector<uint8_t> bytes;
+    addPosllh(bytes, 1, 2, 30, 4);
+    bytes.back() ^= 0x01;
+    addPosllh(bytes, 5, 6, 70, 8);
+
+    const parsed_t parsed = expectSameAsByteAtATime(bytes);
+    EXPECT_EQ(1U, parsed.packetCount);
+    EXPECT_EQ(5, parsed.lat);
+
+    // and a bad checksum A
+    bytes[bytes.size() / 2 - 2] ^= 0x01;
+    expectSameAsByteAtATime(bytes);
+}
+
+TEST(GpsUbloxUnittest, TestZeroLengthPayload)
+{
+    initGps();
+
+    std::vector<uint8_t> bytes;
+    addFrame(bytes, UBX_CLASS_TEST, 0x01, {});
+    addPosllh(bytes, 5, 6, 70, 8);
+
+    const parsed_t parsed = expectSameAsByteAtATime(bytes);
+    EXPECT_EQ(2U, parsed.packetCount);
+    EXPECT_EQ(5, parsed.lat);
+}
+
+TEST(GpsUbloxUnittest, TestPayloadLargerThanBuffer)
+{
+    initGps();
+
+    // The payload holds what looks like a whole frame, which mustn't be parsed when a span starts on it
+    std::vector<uint8_t> payload(UBX_PAYLOAD_SIZE_MAX, 0xB5);
+    addPosllh(payload, 1, 2, 30, 4);
+    payload.resize(payload.size() + 20, 0x62);
+
+    std::vector<uint8_t> bytes;
+    addFrame(bytes, UBX_CLASS_TEST, 0x01, payload);
+    addPosllh(bytes, 5, 6, 70, 8);
+
+    for (uint32_t span = 2; span < bytes.size(); span++) {
+        const parsed_t parsed = expectSameAsByteAtATime(bytes, span);
+        EXPECT_EQ(2U, parsed.packetCount);
+        EXPECT_EQ(5, parsed.lat);
+    }
+    expectSameAsByteAtATime(bytes);
+}
+
+TEST(GpsUbloxUnittest, TestPayloadOverSanitySizeRejected)
+{
+    initGps();
+
+    std::vector<uint8_t> bytes;
+    addFrame(bytes, UBX_CLASS_TEST, 0x01, std::vector<uint8_t>(UBX_PAYLOAD_SANITY_SIZE + 1, 0x00));
+    addPosllh(bytes, 5, 6, 70, 8);
+
+    const parsed_t parsed = expectSameAsByteAtATime(bytes);
+    EXPECT_EQ(1U, parsed.packetCount);
+    EXPECT_EQ(5, parsed.lat);
+}
+
+TEST(GpsUbloxUnittest, TestNmeaBeforeFrame)
+{
+    initGps();
+
+    const char nmea[] = "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n";
+    std::vector<uint8_t> bytes(nmea, nmea + strlen(nmea));
+    // including a preamble byte just before the frame
+    bytes.push_back(0xB5);
+    addPosllh(bytes, 5, 6, 70, 8);
+
+    const parsed_t parsed = expectSameAsByteAtATime(bytes);
+    EXPECT_EQ(1U, parsed.packetCount);
+    EXPECT_EQ(5, parsed.lat);
+}
+
+// STUBS
+
+extern "C" {
+
+int16_t debug[DEBUG16_VALUE_COUNT];
+uint8_t debugMode;
+
+const uint32_t baudRates[] = {0, 9600, 19200, 38400, 57600, 115200, 230400, 250000, 400000}; // see baudRate_e
+
+uint32_t micros(void) { return 0; }
+uint32_t millis(void) { return 0; }
+
+void beeper(beeperMode_e mode) { UNUSED(mode); }
+void beeperConfirmationBeeps(uint8_t beepCount) { UNUSED(beepCount); }
+void dashboardUpdate(timeUs_t currentTimeUs) { UNUSED(currentTimeUs); }
+void dashboardShowFixedPage(pageId_e pageId) { UNUSED(pageId); }
+void rescheduleTask(taskId_e taskId, timeDelta_t newPeriodUs) { UNUSED(taskId); UNUSED(newPeriodUs); }
+void schedulerSetNextStateTime(timeDelta_t nextStateTime) { UNUSED(nextStateTime); }
+
+baudRate_e lookupBaudRateIndex(uint32_t baudRate)
+{
+    for (unsigned i = 0; i < ARRAYLEN(baudRates); i++) {
+        if (baudRates[i] == baudRate) {
+            return (baudRate_e)i;
+        }
+    }
+    return BAUD_AUTO;
+}
+
+void serialPassthrough(serialPort_t *left, serialPort_t *right, serialConsumer *leftC, serialConsumer *rightC)
+{
+    UNUSED(left);
+    UNUSED(right);
+    UNUSED(leftC);
+    UNUSED(rightC);
+}
+
+void waitForSerialPortToFinishTransmitting(serialPort_t *serialPort) { UNUSED(serialPort); }
+bool isSerialTransmitBufferEmpty(const serialPort_t *instance) { UNUSED(instance); return true; }
+uint32_t serialGetBaudRate(serialPort_t *instance) { UNUSED(instance); return 115200; }
+void serialSetBaudRate(serialPort_t *instance, uint32_t baudRate) { UNUSED(instance); UNUSED(baudRate); }
+void serialSetMode(serialPort_t *instance, portMode_e mode) { UNUSED(instance); UNUSED(mode); }
+void serialPrint(serialPort_t *instance, const char *str) { UNUSED(instance); UNUSED(str); }
+void serialWrite(serialPort_t *instance, uint8_t ch) { UNUSED(instance); UNUSED(ch); }
+void serialWriteBuf(serialPort_t *instance, const uint8_t *data, int count) { UNUSED(instance); UNUSED(data); UNUSED(count); }
+
+static const serialPortConfig_t gpsTestPortConfig = { .functionMask = FUNCTION_GPS, .identifier = SERIAL_PORT_UART1 };
+
+const serialPortConfig_t *findSerialPortConfig(serialPortFunction_e function)
+{
+    EXPECT_EQ(FUNCTION_GPS, function);
+    return &gpsTestPortConfig;
+}
+
+serialType_e serialType(serialPortIdentifier_e identifier)
+{
+    UNUSED(identifier);
+    return SERIALTYPE_UART;
+}
+
+serialPort_t *openSerialPort(serialPortIdentifier_e identifier, serialPortFunction_e function, serialReceiveCallbackPtr rxCallback,
+    void *rxCallbackData, uint32_t baudRate, portMode_e mode, portOptions_e options)
+{
+    UNUSED(identifier);
+    UNUSED(function);
+    UNUSED(rxCallback);
+    UNUSED(rxCallbackData);
+    UNUSED(baudRate);
+    UNUSED(mode);
+    UNUSED(options);
+    return &gpsTestPort;
+}
+
+uint32_t serialRxBytesWaiting(const serialPort_t *instance)
+{
+    UNUSED(instance);
+    return rxData.size() - rxPos;
+}
+
+uint32_t serialReadSpan(serialPort_t *instance, const uint8_t **data)
+{
+    UNUSED(instance);
+    *data = rxData.data() + rxPos;
+    return MIN(spanSize, (uint32_t)(rxData.size() - rxPos));
+}
+
+void serialConsume(serialPort_t *instance, uint32_t count)
+{
+    UNUSED(instance);
+    rxPos += count;
+}
+
+}
@@ -16,6 +16,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 
 extern "C" {
     #include "common/huffman.h"
@@ -546,6 +547,37 @@ TEST(HuffmanUnittest, TestHuffmanDecode)
     EXPECT_EQ(0x07, (int)outBuf[7]);
 }
 
+TEST(HuffmanUnittest, TestHuffmanEncodeBlock)
+{
+    uint8_t inBuf[100];
+    uint8_t expected[OUTBUF_LEN];
+    uint8_t decoded[sizeof(inBuf)];
+
+    // Skewed towards small values, as blackbox data is
+    uint32_t seed = 1;
+    for (unsigned ii = 0; ii < sizeof(inBuf); ++ii) {
+        seed = seed * 1103515245 + 12345;
+        inBuf[ii] = (seed >> 16) % ((ii & 1) ? 256 : 8);
+    }
+
+    for (int inLen = 1; inLen <= (int)sizeof(inBuf); ++inLen) {
+        memset(expected, 0, sizeof(expected));
+        const int expectedLen = huffmanEncodeBuf(expected, OUTBUF_LEN, inBuf, inLen, huffmanTable);
+        ASSERT_GT(expectedLen, 0);
+
+        memset(outBuf, 0, sizeof(outBuf));
+        const int len = huffmanEncodeBlock(outBuf, OUTBUF_LEN, inBuf, inLen, huffmanTable);
+        ASSERT_EQ(expectedLen, len);
+        EXPECT_EQ(0, memcmp(expected, outBuf, len));
+
+        EXPECT_EQ(inLen, huffmanDecodeBuf(decoded, sizeof(decoded), outBuf, len, inLen, huffmanTree));
+        EXPECT_EQ(0, memcmp(inBuf, decoded, inLen));
+
+        // One byte short of the encoded length doesn't fit
+        EXPECT_EQ(-1, huffmanEncodeBlock(outBuf, len - 1, inBuf, inLen, huffmanTable));
+    }
+}
+
 // STUBS
 
 extern "C" {
@@ -0,0 +1,184 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/streambuf.h"
+    #include "common/utils.h"
+
+    #include "msp/msp.h"
+    #include "msp/msp_batch.h"
+    #include "msp/msp_protocol.h"
+    #include "msp/msp_protocol_v2_betaflight.h"
+
+    mspResult_e testProcessCommand(mspDescriptor_t srcDesc, mspPacket_t *cmd, mspPacket_t *reply, mspPostProcessFnPtr *mspPostProcessFn);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// Replies with as many bytes as the first byte of its payload, each the command's low byte
+#define TEST_CMD_REPLY_SIZE     0x1001
+
+typedef struct entry_s {
+    uint16_t cmd;
+    int8_t result;
+    std::vector<uint8_t> reply;
+} entry_t;
+
+static std::vector<uint16_t> commandsRun;
+
+static void addCommand(std::vector<uint8_t> &request, uint16_t cmd, const std::vector<uint8_t> &payload = {})
+{
+    request.push_back(cmd & 0xff);
+    request.push_back(cmd >> 8);
+    request.push_back(payload.size() & 0xff);
+    request.push_back(payload.size() >> 8);
+    request.insert(request.end(), payload.begin(), payload.end());
+}
+
+// Runs the batch with a reply buffer of replySize, returning the entries of its reply
+static std::vector<entry_t> runBatch(std::vector<uint8_t> &request, unsigned replySize, mspResult_e expectedResult = MSP_RESULT_ACK)
+{
+    std::vector<uint8_t> replyBuf(replySize);
+    sbuf_t src = { .ptr = request.data(), .end = request.data() + request.size() };
+    sbuf_t dst = { .ptr = replyBuf.data(), .end = replyBuf.data() + replyBuf.size() };
+
+    commandsRun.clear();
+    EXPECT_EQ(expectedResult, mspBatchProcessCommand(0, &src, &dst, testProcessCommand));
+
+    std::vector<entry_t> entries;
+    sbuf_t reply = { .ptr = replyBuf.data(), .end = dst.ptr };
+    while (sbufBytesRemaining(&reply)) {
+        entry_t entry;
+        entry.cmd = sbufReadU16(&reply);
+        entry.result = sbufReadU8(&reply);
+        const uint16_t size = sbufReadU16(&reply);
+        EXPECT_LE(size, sbufBytesRemaining(&reply));
+        entry.reply.assign(sbufPtr(&reply), sbufPtr(&reply) + size);
+        sbufAdvance(&reply, size);
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+TEST(MspBatchUnittest, TestEachCommandAnsweredInOrder)
+{
+    std::vector<uint8_t> request;
+    addCommand(request, TEST_CMD_REPLY_SIZE, { 2 });
+    addCommand(request, MSP_API_VERSION);
+    addCommand(request, TEST_CMD_REPLY_SIZE, { 0 });
+
+    const std::vector<entry_t> entries = runBatch(request, 64);
+
+    ASSERT_EQ(3U, entries.size());
+    EXPECT_EQ(TEST_CMD_REPLY_SIZE, entries[0].cmd);
+    EXPECT_EQ(MSP_RESULT_ACK, entries[0].result);
+    EXPECT_EQ((std::vector<uint8_t> { 0x01, 0x01 }), entries[0].reply);
+    EXPECT_EQ(MSP_API_VERSION, entries[1].cmd);
+    EXPECT_EQ(MSP_RESULT_ERROR, entries[1].result);
+    EXPECT_EQ(0U, entries[1].reply.size());
+    EXPECT_EQ(TEST_CMD_REPLY_SIZE, entries[2].cmd);
+    EXPECT_EQ(MSP_RESULT_ACK, entries[2].result);
+    EXPECT_EQ(0U, entries[2].reply.size());
+}
+
+TEST(MspBatchUnittest, TestBatchEndsWhenReplyOverflows)
+{
+    std::vector<uint8_t> request;
+    addCommand(request, TEST_CMD_REPLY_SIZE, { 10 });
+    addCommand(request, TEST_CMD_REPLY_SIZE, { 20 });
+    addCommand(request, TEST_CMD_REPLY_SIZE, { 1 });
+
+    // Room for the first entry and the header of the second only
+    const std::vector<entry_t> entries = runBatch(request, 5 + 10 + 5 + 19);
+
+    // the command that didn't fit has still been run, but none after it
+    EXPECT_EQ(2U, commandsRun.size());
+    ASSERT_EQ(2U, entries.size());
+    EXPECT_EQ(MSP_RESULT_ACK, entries[0].result);
+    EXPECT_EQ(10U, entries[0].reply.size());
+    EXPECT_EQ(TEST_CMD_REPLY_SIZE, entries[1].cmd);
+    EXPECT_EQ(MSP_RESULT_NO_REPLY, entries[1].result);
+    EXPECT_EQ(0U, entries[1].reply.size());
+}
+
+TEST(MspBatchUnittest, TestNestedBatchRefused)
+{
+    std::vector<uint8_t> inner;
+    addCommand(inner, TEST_CMD_REPLY_SIZE, { 1 });
+
+    std::vector<uint8_t> request;
+    addCommand(request, MSP2_BATCH, inner);
+    addCommand(request, MSP_REBOOT);
+    addCommand(request, TEST_CMD_REPLY_SIZE, { 1 });
+
+    const std::vector<entry_t> entries = runBatch(request, 64);
+
+    // neither is run, the batch carries on after them
+    EXPECT_EQ((std::vector<uint16_t> { TEST_CMD_REPLY_SIZE }), commandsRun);
+    ASSERT_EQ(3U, entries.size());
+    EXPECT_EQ(MSP2_BATCH, entries[0].cmd);
+    EXPECT_EQ(MSP_RESULT_ERROR, entries[0].result);
+    EXPECT_EQ(MSP_REBOOT, entries[1].cmd);
+    EXPECT_EQ(MSP_RESULT_ERROR, entries[1].result);
+    EXPECT_EQ(MSP_RESULT_ACK, entries[2].result);
+}
+
+TEST(MspBatchUnittest, TestTruncatedPayloadRefused)
+{
+    std::vector<uint8_t> request;
+    addCommand(request, TEST_CMD_REPLY_SIZE, { 1, 2, 3 });
+    request.pop_back();
+
+    runBatch(request, 64, MSP_RESULT_ERROR);
+    EXPECT_EQ(0U, commandsRun.size());
+}
+
+// STUBS
+
+extern "C" {
+
+mspResult_e testProcessCommand(mspDescriptor_t srcDesc, mspPacket_t *cmd, mspPacket_t *reply, mspPostProcessFnPtr *mspPostProcessFn)
+{
+    UNUSED(srcDesc);
+    UNUSED(mspPostProcessFn);
+
+    commandsRun.push_back(cmd->cmd);
+    reply->cmd = cmd->cmd;
+
+    if (cmd->cmd != TEST_CMD_REPLY_SIZE) {
+        return MSP_RESULT_ERROR;
+    }
+    for (int size = sbufReadU8(&cmd->buf); size > 0; size--) {
+        sbufWriteU8(&reply->buf, cmd->cmd & 0xff);
+    }
+    return MSP_RESULT_ACK;
+}
+
+}
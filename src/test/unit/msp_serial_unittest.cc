@@ -0,0 +1,513 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <vector>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "common/crc.h"
+    #include "common/streambuf.h"
+    #include "common/utils.h"
+
+    #include "drivers/serial.h"
+    #include "drivers/system.h"
+
+    #include "io/serial.h"
+
+    #include "msp/msp.h"
+    #include "msp/msp_protocol_v2_betaflight.h"
+    #include "msp/msp_serial.h"
+
+    #include "pg/msp.h"
+    #include "pg/pg.h"
+    #include "pg/pg_ids.h"
+
+    #include "scheduler/scheduler.h"
+
+    PG_REGISTER(serialConfig_t, serialConfig, PG_SERIAL_CONFIG, 0);
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// Commands of the test command handler
+#define TEST_CMD_ECHO           0x1001  // replies with its own command
+#define TEST_CMD_FILL           0x1002  // fills the reply buffer, as the dataflash read does
+#define TEST_CMD_UNKNOWN        0x1003  // refused
+
+typedef struct reply_s {
+    uint16_t cmd;
+    bool error;
+    std::vector<uint8_t> payload;
+} reply_t;
+
+static serialPort_t testPort;
+static std::vector<uint8_t> rxData;
+static uint32_t rxPos;
+static std::vector<uint8_t> txData;
+static uint32_t txQueued;           // bytes in the TX buffer not yet sent
+static int replySpace;              // room the last request had for its reply
+static timeUs_t currentTimeUs;
+static bool streamTaskEnabled;
+
+static void initPort(uint32_t txBufferSize)
+{
+    memset(&testPort, 0, sizeof(testPort));
+    testPort.txBufferSize = txBufferSize;
+    testPort.identifier = SERIAL_PORT_UART1;
+    rxData.clear();
+    rxPos = 0;
+    txData.clear();
+    txQueued = 0;
+    currentTimeUs = 0;
+    streamTaskEnabled = false;
+
+    mspSerialInit();
+}
+
+static void sendRequest(uint16_t cmd, const std::vector<uint8_t> &payload = {})
+{
+    const uint8_t header[] = { 0, (uint8_t)(cmd & 0xff), (uint8_t)(cmd >> 8), (uint8_t)(payload.size() & 0xff), (uint8_t)(payload.size() >> 8) };
+
+    rxData.insert(rxData.end(), { '$', 'X', '<' });
+    rxData.insert(rxData.end(), header, header + sizeof(header));
+    rxData.insert(rxData.end(), payload.begin(), payload.end());
+
+    uint8_t crc = crc8_dvb_s2_update(0, header, sizeof(header));
+    crc = crc8_dvb_s2_update(crc, payload.data(), payload.size());
+    rxData.push_back(crc);
+}
+
+// Takes the replies out of what was sent on the port
+static std::vector<reply_t> receiveReplies(void)
+{
+    std::vector<reply_t> replies;
+
+    for (size_t pos = 0; pos < txData.size(); ) {
+        EXPECT_EQ('$', txData[pos]);
+        EXPECT_EQ('X', txData[pos + 1]);
+        EXPECT_TRUE(txData[pos + 2] == '>' || txData[pos + 2] == '!');
+        const uint8_t *header = &txData[pos + 3];
+        const uint16_t size = header[3] | (header[4] << 8);
+
+        reply_t reply;
+        reply.cmd = header[1] | (header[2] << 8);
+        reply.error = txData[pos + 2] == '!';
+        reply.payload.assign(header + 5, header + 5 + size);
+        EXPECT_EQ(crc8_dvb_s2_update(0, header, 5 + size), header[5 + size]);
+
+        replies.push_back(reply);
+        pos += 3 + 5 + size + 1;
+    }
+    txData.clear();
+
+    return replies;
+}
+
+static mspResult_e testProcessCommand(mspDescriptor_t srcDesc, mspPacket_t *cmd, mspPacket_t *reply, mspPostProcessFnPtr *mspPostProcessFn)
+{
+    UNUSED(mspPostProcessFn);
+
+    sbuf_t *dst = &reply->buf;
+    reply->cmd = cmd->cmd;
+    replySpace = sbufBytesRemaining(dst);
+
+    switch (cmd->cmd) {
+    case TEST_CMD_ECHO:
+        sbufWriteU16(dst, cmd->cmd);
+        break;
+    case TEST_CMD_FILL:
+        while (sbufBytesRemaining(dst)) {
+            sbufWriteU8(dst, 0x55);
+        }
+        break;
+    case MSP2_STREAM_SUBSCRIBE:
+        reply->result = mspSerialStreamSubscribeCommand(srcDesc, &cmd->buf, dst);
+        return (mspResult_e)reply->result;
+    default:
+        return MSP_RESULT_ERROR;
+    }
+    return MSP_RESULT_ACK;
+}
+
+static void process(void)
+{
+    mspSerialProcess(MSP_SKIP_NON_MSP_DATA, testProcessCommand, NULL);
+}
+
+// Sends MSP2_STREAM_SUBSCRIBE with the command and period of each stream, returning the number of streams in its reply
+static int subscribe(const std::vector<std::pair<uint16_t, uint16_t>> &streams, bool expectError = false)
+{
+    std::vector<uint8_t> payload;
+    for (const auto &stream : streams) {
+        payload.insert(payload.end(), { (uint8_t)(stream.first & 0xff), (uint8_t)(stream.first >> 8), (uint8_t)(stream.second & 0xff), (uint8_t)(stream.second >> 8) });
+    }
+    sendRequest(MSP2_STREAM_SUBSCRIBE, payload);
+    process();
+
+    const std::vector<reply_t> replies = receiveReplies();
+    txQueued = 0;
+    EXPECT_EQ(1U, replies.size());
+    if (replies.size() != 1) {
+        return -1;
+    }
+    EXPECT_EQ(MSP2_STREAM_SUBSCRIBE, replies[0].cmd);
+    EXPECT_EQ(expectError, replies[0].error);
+    EXPECT_EQ(1U, replies[0].payload.size());
+    return replies[0].payload[0];
+}
+
+// Runs the stream task at timeMs, returning the commands of the replies it pushed which are then sent
+static std::vector<uint16_t> streamAt(timeMs_t timeMs)
+{
+    currentTimeUs = timeMs * 1000;
+    mspSerialStreamProcess(currentTimeUs, testProcessCommand);
+
+    std::vector<uint16_t> pushed;
+    for (const reply_t &reply : receiveReplies()) {
+        pushed.push_back(reply.cmd);
+    }
+    txQueued = 0;
+    return pushed;
+}
+
+TEST(MspSerialUnittest, TestQueuedRequestsAnsweredInOrder)
+{
+    initPort(1280);
+
+    sendRequest(TEST_CMD_ECHO);
+    sendRequest(TEST_CMD_FILL);
+    sendRequest(TEST_CMD_ECHO);
+    process();
+
+    const std::vector<reply_t> replies = receiveReplies();
+    ASSERT_EQ(3U, replies.size());
+    EXPECT_EQ(TEST_CMD_ECHO, replies[0].cmd);
+    EXPECT_EQ(TEST_CMD_FILL, replies[1].cmd);
+    EXPECT_EQ(TEST_CMD_ECHO, replies[2].cmd);
+    EXPECT_EQ(rxData.size(), rxPos);
+}
+
+TEST(MspSerialUnittest, TestPipelineEndsAtItsDepth)
+{
+    initPort(UINT16_MAX);
+
+    for (int i = 0; i < MSP_SERIAL_PIPELINE_DEPTH + 2; i++) {
+        sendRequest(TEST_CMD_ECHO);
+    }
+
+    process();
+    EXPECT_EQ(MSP_SERIAL_PIPELINE_DEPTH, (int)receiveReplies().size());
+    process();
+    EXPECT_EQ(2U, receiveReplies().size());
+}
+
+TEST(MspSerialUnittest, TestReplySizedToTxBuffer)
+{
+    // Smaller than MSP_PORT_OUTBUF_SIZE_MIN, as UART TX buffers are without the MSP displayport
+    initPort(256);
+
+    sendRequest(TEST_CMD_FILL);
+    process();
+
+    EXPECT_EQ(256 - 1 - MSP_MAX_HEADER_SIZE - MSP_MAX_CHECKSUM_SIZE, replySpace);
+    const std::vector<reply_t> replies = receiveReplies();
+    ASSERT_EQ(1U, replies.size());
+    EXPECT_EQ((size_t)replySpace, replies[0].payload.size());
+}
+
+TEST(MspSerialUnittest, TestPipelineWaitsForTxRoom)
+{
+    initPort(256);
+
+    // Any reply might fill the buffer, so the next request waits for it to be sent
+    sendRequest(TEST_CMD_ECHO);
+    sendRequest(TEST_CMD_FILL);
+    process();
+    EXPECT_EQ(1U, receiveReplies().size());
+    EXPECT_LT(rxPos, rxData.size());
+
+    txQueued = 0;
+    process();
+    const std::vector<reply_t> replies = receiveReplies();
+    ASSERT_EQ(1U, replies.size());
+    EXPECT_EQ(TEST_CMD_FILL, replies[0].cmd);
+}
+
+TEST(MspSerialUnittest, TestStreamSubscribe)
+{
+    initPort(1280);
+
+    EXPECT_EQ(1, subscribe({ { TEST_CMD_ECHO, 100 } }));
+    EXPECT_TRUE(streamTaskEnabled);
+
+    // pushed straight away, then once each period
+    EXPECT_EQ((std::vector<uint16_t> { TEST_CMD_ECHO }), streamAt(0));
+    EXPECT_EQ((std::vector<uint16_t> {}), streamAt(50));
+    EXPECT_EQ((std::vector<uint16_t> { TEST_CMD_ECHO }), streamAt(100));
+    EXPECT_EQ((std::vector<uint16_t> { TEST_CMD_ECHO }), streamAt(200));
+}
+
+TEST(MspSerialUnittest, TestStreamPeriodChanged)
+{
+    initPort(1280);
+
+    EXPECT_EQ(1, subscribe({ { TEST_CMD_ECHO, 100 } }));
+    EXPECT_EQ(1U, streamAt(0).size());
+
+    // Subscribing to the same command again only changes its period
+    EXPECT_EQ(1, subscribe({ { TEST_CMD_ECHO, 300 } }));
+    EXPECT_EQ(1U, streamAt(0).size());
+    EXPECT_EQ(0U, streamAt(100).size());
+    EXPECT_EQ(0U, streamAt(200).size());
+    EXPECT_EQ(1U, streamAt(300).size());
+
+    // and a period below the task's is raised to it
+    EXPECT_EQ(1, subscribe({ { TEST_CMD_ECHO, 1 } }));
+    EXPECT_EQ(1U, streamAt(300).size());
+    EXPECT_EQ(0U, streamAt(300 + MSP_STREAM_PERIOD_MIN_MS - 1).size());
+    EXPECT_EQ(1U, streamAt(300 + MSP_STREAM_PERIOD_MIN_MS).size());
+}
+
+TEST(MspSerialUnittest, TestStreamUnsubscribe)
+{
+    initPort(1280);
+
+    EXPECT_EQ(2, subscribe({ { TEST_CMD_ECHO, 100 }, { TEST_CMD_FILL, 100 } }));
+    EXPECT_EQ((std::vector<uint16_t> { TEST_CMD_ECHO, TEST_CMD_FILL }), streamAt(0));
+
+    // A period of 0 stops that stream only
+    EXPECT_EQ(1, subscribe({ { TEST_CMD_ECHO, 0 } }));
+    EXPECT_EQ((std::vector<uint16_t> { TEST_CMD_FILL }), streamAt(100));
+    EXPECT_TRUE(streamTaskEnabled);
+
+    // and no commands at all stop every stream
+    EXPECT_EQ(2, subscribe({ { TEST_CMD_ECHO, 100 } }));
+    EXPECT_EQ(0, subscribe({}));
+    EXPECT_FALSE(streamTaskEnabled);
+    EXPECT_EQ(0U, streamAt(200).size());
+}
+
+TEST(MspSerialUnittest, TestStreamLimit)
+{
+    initPort(UINT16_MAX);
+
+    std::vector<std::pair<uint16_t, uint16_t>> streams;
+    for (int i = 0; i <= MSP_STREAM_COUNT; i++) {
+        streams.push_back({ 0x2000 + i, 100 });
+    }
+
+    // the streams past the limit are refused, those before it are kept
+    EXPECT_EQ(MSP_STREAM_COUNT, subscribe(streams, true));
+    EXPECT_EQ(MSP_STREAM_COUNT, subscribe({ { 0x2000, 200 } }));
+}
+
+TEST(MspSerialUnittest, TestStreamOfUnknownCommandDropped)
+{
+    initPort(1280);
+
+    EXPECT_EQ(1, subscribe({ { TEST_CMD_UNKNOWN, 100 } }));
+    EXPECT_TRUE(streamTaskEnabled);
+
+    // dropped when it is first due, which stops the task
+    EXPECT_EQ(0U, streamAt(0).size());
+    EXPECT_FALSE(streamTaskEnabled);
+    EXPECT_EQ(0, subscribe({ { TEST_CMD_ECHO, 0 } }));
+}
+
+TEST(MspSerialUnittest, TestStreamWaitsForTxRoomWithoutCatchingUp)
+{
+    initPort(256);
+
+    EXPECT_EQ(1, subscribe({ { TEST_CMD_ECHO, 100 } }));
+    EXPECT_EQ(1U, streamAt(0).size());
+
+    // No room for a reply of any size, so the push waits for the TX buffer
+    txQueued = 1;
+    EXPECT_EQ(0U, streamAt(100).size());
+    txQueued = 1;
+    EXPECT_EQ(0U, streamAt(250).size());
+
+    // then pushes once, with the next one a whole period later
+    EXPECT_EQ(1U, streamAt(420).size());
+    EXPECT_EQ(0U, streamAt(500).size());
+    EXPECT_EQ(1U, streamAt(520).size());
+
+    // but a push that is only a little late keeps to the period
+    EXPECT_EQ(1U, streamAt(625).size());
+    EXPECT_EQ(1U, streamAt(720).size());
+}
+
+TEST(MspSerialUnittest, TestStreamTaskStopsWhenPortReleased)
+{
+    initPort(1280);
+
+    EXPECT_EQ(1, subscribe({ { TEST_CMD_ECHO, 100 } }));
+    EXPECT_EQ(1U, streamAt(0).size());
+
+    mspSerialReleasePortIfAllocated(&testPort);
+    EXPECT_EQ(0U, streamAt(100).size());
+    EXPECT_FALSE(streamTaskEnabled);
+}
+
+// STUBS
+
+extern "C" {
+
+const uint32_t baudRates[BAUD_COUNT] = { 0 };
+
+static const serialPortConfig_t testPortConfig = { .functionMask = FUNCTION_MSP, .identifier = SERIAL_PORT_UART1 };
+
+const serialPortConfig_t *findSerialPortConfig(serialPortFunction_e function)
+{
+    EXPECT_EQ(FUNCTION_MSP, function);
+    return &testPortConfig;
+}
+
+const serialPortConfig_t *findNextSerialPortConfig(serialPortFunction_e function)
+{
+    UNUSED(function);
+    return NULL;
+}
+
+serialType_e serialType(serialPortIdentifier_e identifier)
+{
+    UNUSED(identifier);
+    return SERIALTYPE_UART;
+}
+
+bool isSerialPortShared(const serialPortConfig_t *portConfig, uint16_t functionMask, serialPortFunction_e sharedWithFunction)
+{
+    UNUSED(portConfig);
+    UNUSED(functionMask);
+    UNUSED(sharedWithFunction);
+    return false;
+}
+
+serialPort_t *openSerialPort(serialPortIdentifier_e identifier, serialPortFunction_e function, serialReceiveCallbackPtr rxCallback,
+    void *rxCallbackData, uint32_t baudRate, portMode_e mode, portOptions_e options)
+{
+    UNUSED(identifier);
+    UNUSED(function);
+    UNUSED(rxCallback);
+    UNUSED(rxCallbackData);
+    UNUSED(baudRate);
+    UNUSED(mode);
+    UNUSED(options);
+    return &testPort;
+}
+
+void closeSerialPort(serialPort_t *serialPort)
+{
+    UNUSED(serialPort);
+}
+
+uint32_t serialRxBytesWaiting(const serialPort_t *instance)
+{
+    UNUSED(instance);
+    return rxData.size() - rxPos;
+}
+
+uint8_t serialRead(serialPort_t *instance)
+{
+    UNUSED(instance);
+    return rxData[rxPos++];
+}
+
+uint32_t serialReadSpan(serialPort_t *instance, const uint8_t **data)
+{
+    UNUSED(instance);
+    *data = rxData.data() + rxPos;
+    return rxData.size() - rxPos;
+}
+
+void serialConsume(serialPort_t *instance, uint32_t count)
+{
+    UNUSED(instance);
+    rxPos += count;
+}
+
+bool isSerialTransmitBufferEmpty(const serialPort_t *instance)
+{
+    UNUSED(instance);
+    return txQueued == 0;
+}
+
+uint32_t serialTxBytesFree(const serialPort_t *instance)
+{
+    return instance->txBufferSize - 1 - txQueued;
+}
+
+void serialBeginWrite(serialPort_t *instance)
+{
+    UNUSED(instance);
+}
+
+void serialEndWrite(serialPort_t *instance)
+{
+    UNUSED(instance);
+}
+
+void serialWriteBufNoFlush(serialPort_t *instance, const uint8_t *data, int count)
+{
+    txData.insert(txData.end(), data, data + count);
+    txQueued += count;
+    // a frame bigger than the TX buffer would be written over itself
+    EXPECT_LT(txQueued, instance->txBufferSize);
+}
+
+void waitForSerialPortToFinishTransmitting(serialPort_t *serialPort)
+{
+    UNUSED(serialPort);
+}
+
+mspDescriptor_t mspDescriptorAlloc(void)
+{
+    return 0;
+}
+
+void systemResetToBootloader(bootloaderRequestType_e requestType)
+{
+    UNUSED(requestType);
+}
+
+uint32_t millis(void)
+{
+    return currentTimeUs / 1000;
+}
+
+timeUs_t micros(void)
+{
+    return currentTimeUs;
+}
+
+void setTaskEnabled(taskId_e taskId, bool enabled)
+{
+    EXPECT_EQ(TASK_MSP_STREAM, taskId);
+    streamTaskEnabled = enabled;
+}
+
+}
@@ -55,6 +55,15 @@ PG_RESET_TEMPLATE(motorConfig_t, motorConfig,
     .kv = 1000,
     .motorPoleCount = 14,
 );
+
+typedef struct testConfig_s {
+    uint8_t value;
+} testConfig_t;
+
+PG_DECLARE(testConfig_t, testConfig1);
+PG_REGISTER(testConfig_t, testConfig1, PG_RESERVED_FOR_TESTING_1, 0);
+PG_DECLARE(testConfig_t, testConfig2);
+PG_REGISTER(testConfig_t, testConfig2, PG_RESERVED_FOR_TESTING_2, 0);
 }
 
 
@@ -95,6 +104,17 @@ TEST(ParameterGroupsfTest, Test_pgFind)
     EXPECT_EQ(400, motorConfig3.dev.motorPwmRate);
 }
 
+TEST(ParameterGroupsfTest, Test_pgFindIndexed)
+{
+    EXPECT_EQ(testConfig1Mutable(), (testConfig_t *)pgFind(PG_RESERVED_FOR_TESTING_1)->address);
+    EXPECT_EQ(testConfig2Mutable(), (testConfig_t *)pgFind(PG_RESERVED_FOR_TESTING_2)->address);
+    EXPECT_EQ(motorConfigMutable(), (motorConfig_t *)pgFind(PG_MOTOR_CONFIG)->address);
+
+    // PGNs that are not registered
+    EXPECT_EQ(NULL, pgFind(PG_RESERVED_FOR_TESTING_3));
+    EXPECT_EQ(NULL, pgFind(0));
+}
+
 // STUBS
 
 extern "C" {
@@ -137,3 +137,13 @@ typedef struct
 #include "target.h"
 
 #include "target/common_defaults_post.h"
+
+#if defined(CONFIG_IN_FILE)
+// Config storage is the eepromData array, as in target/common_post.h
+#ifndef EEPROM_SIZE
+#define EEPROM_SIZE     4096
+#endif
+extern uint8_t eepromData[EEPROM_SIZE];
+#define __config_start (*eepromData)
+#define __config_end (*ARRAYEND(eepromData))
+#endif
@@ -16,6 +16,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 
 extern "C" {
     #include "drivers/accgyro/accgyro.h"
@@ -108,6 +109,7 @@ extern "C" {
     extern bool queueRemove(task_t *task);
     extern task_t *queueFirst(void);
     extern task_t *queueNext(void);
+    extern void taskHistogramAdd(taskHistogram_t *histogram, uint32_t value10thUs);
 
     task_t tasks[TASK_COUNT];
 
@@ -552,3 +554,142 @@ TEST(SchedulerUnittest, TestGyroTask)
     EXPECT_EQ(static_cast<task_t*>(0), unittest_scheduler_selectedTask);
 }
 
+TEST(SchedulerUnittest, TestTaskHistogram)
+{
+    taskHistogram_t histogram;
+    memset(&histogram, 0, sizeof(histogram));
+
+    EXPECT_EQ(0, taskHistogramPercentile(&histogram, 500));
+
+    taskHistogramAdd(&histogram, 0);
+    taskHistogramAdd(&histogram, 1);
+    taskHistogramAdd(&histogram, 7);
+    taskHistogramAdd(&histogram, 8);
+    taskHistogramAdd(&histogram, 100000000);
+    EXPECT_EQ(1, histogram.count[0]);
+    EXPECT_EQ(1, histogram.count[1]);
+    EXPECT_EQ(1, histogram.count[3]);
+    EXPECT_EQ(1, histogram.count[4]);
+    EXPECT_EQ(1, histogram.count[TASK_HISTOGRAM_BUCKET_COUNT - 1]);
+
+    // 1000 samples at 12.5us with a 0.2% tail at 500us
+    memset(&histogram, 0, sizeof(histogram));
+    for (int i = 0; i < 998; i++) {
+        taskHistogramAdd(&histogram, 125);
+    }
+    taskHistogramAdd(&histogram, 5000);
+    taskHistogramAdd(&histogram, 5000);
+    EXPECT_EQ(128, taskHistogramPercentile(&histogram, 500));
+    EXPECT_EQ(128, taskHistogramPercentile(&histogram, 990));
+    EXPECT_EQ(8192, taskHistogramPercentile(&histogram, 999));
+
+    // saturation halves all buckets but keeps the distribution
+    histogram.count[7] = UINT32_MAX - 2;
+    taskHistogramAdd(&histogram, 125);
+    taskHistogramAdd(&histogram, 125);
+    EXPECT_EQ(UINT32_MAX / 2 + 1, histogram.count[7]);
+    EXPECT_EQ(1, histogram.count[13]);
+}
+
+TEST(SchedulerUnittest, TestTaskHistogramTailSurvivesSaturation)
+{
+    taskHistogram_t histogram;
+    memset(&histogram, 0, sizeof(histogram));
+
+    // A single overrun among a main bucket that keeps saturating
+    taskHistogramAdd(&histogram, 5000);
+    for (int saturations = 0; saturations < 64; saturations++) {
+        histogram.count[7] = UINT32_MAX - 1;
+        taskHistogramAdd(&histogram, 125);
+        ASSERT_LT(histogram.count[7], UINT32_MAX);
+    }
+
+    EXPECT_EQ(1, histogram.count[13]);
+    EXPECT_EQ(8192, taskHistogramPercentile(&histogram, 1000));
+}
+
+TEST(SchedulerUnittest, TestTaskHistogramRecording)
+{
+    schedulerInit();
+    for (int taskId = 0; taskId < TASK_COUNT; ++taskId) {
+        setTaskEnabled(static_cast<taskId_e>(taskId), false);
+    }
+    schedulerResetTaskHistograms();
+    setTaskEnabled(TASK_ACCEL, true);
+    tasks[TASK_ACCEL].lastExecutedAtUs = 1000;
+    tasks[TASK_ACCEL].lastStatsAtUs = 1000;
+    simulatedTime = 1000 + tasks[TASK_ACCEL].attribute->desiredPeriodUs + 50;
+    scheduler();
+    EXPECT_EQ(unittest_scheduler_selectedTask, &tasks[TASK_ACCEL]);
+
+    taskInfo_t taskInfo;
+    getTaskInfo(TASK_ACCEL, &taskInfo);
+    // 32us execution time in [25.6, 51.2) us, started 50us late in [25.6, 51.2) us
+    EXPECT_EQ(1, taskInfo.histogram[TASK_HISTOGRAM_EXEC_TIME].count[9]);
+    EXPECT_EQ(1, taskInfo.histogram[TASK_HISTOGRAM_START_LATENCY].count[9]);
+}
+
+TEST(SchedulerUnittest, TestDeadlineModeEarliestDeadlineFirst)
+{
+    schedulerConfigMutable()->mode = SCHEDULER_MODE_DEADLINE;
+    schedulerInit();
+    for (int taskId = 0; taskId < TASK_COUNT; ++taskId) {
+        setTaskEnabled(static_cast<taskId_e>(taskId), false);
+    }
+
+    // TASK_ATTITUDE is released first, but TASK_ACCEL has the earlier deadline
+    static const uint32_t startTime = 100000;
+    simulatedTime = startTime;
+    tasks[TASK_ACCEL].lastExecutedAtUs = startTime - 1000;      // released at startTime, deadline startTime + 1000
+    tasks[TASK_ATTITUDE].lastExecutedAtUs = startTime - 10500;  // released at startTime - 500, deadline startTime + 9500
+    setTaskEnabled(TASK_ACCEL, true);
+    setTaskEnabled(TASK_ATTITUDE, true);
+
+    // keep the next gyro cycle 100us away
+    tasks[TASK_GYRO].lastExecutedAtUs = simulatedTime - 25;
+    scheduler();
+    EXPECT_EQ(&tasks[TASK_ACCEL], unittest_scheduler_selectedTask);
+    EXPECT_EQ(startTime + TEST_UPDATE_ACCEL_TIME, simulatedTime);
+
+    tasks[TASK_GYRO].lastExecutedAtUs = simulatedTime - 25;
+    scheduler();
+    EXPECT_EQ(&tasks[TASK_ATTITUDE], unittest_scheduler_selectedTask);
+
+    // Both have run and are waiting for their next release
+    tasks[TASK_GYRO].lastExecutedAtUs = simulatedTime - 25;
+    scheduler();
+    EXPECT_EQ(static_cast<task_t*>(0), unittest_scheduler_selectedTask);
+
+    schedulerConfigMutable()->mode = SCHEDULER_MODE_PRIORITY;
+}
+
+TEST(SchedulerUnittest, TestDeadlineModeBudget)
+{
+    schedulerConfigMutable()->mode = SCHEDULER_MODE_DEADLINE;
+    schedulerInit();
+    for (int taskId = 0; taskId < TASK_COUNT; ++taskId) {
+        setTaskEnabled(static_cast<taskId_e>(taskId), false);
+    }
+
+    // TASK_DISPATCH has the earliest deadline but needs more time than is left before the next gyro cycle
+    static const uint32_t startTime = 200000;
+    simulatedTime = startTime;
+    tasks[TASK_DISPATCH].lastExecutedAtUs = startTime - 1100;
+    tasks[TASK_DISPATCH].anticipatedExecutionTime = TEST_DISPATCH_TIME << TASK_EXEC_TIME_SHIFT;
+    tasks[TASK_ACCEL].lastExecutedAtUs = startTime - 1000;
+    tasks[TASK_ACCEL].anticipatedExecutionTime = TEST_UPDATE_ACCEL_TIME << TASK_EXEC_TIME_SHIFT;
+    setTaskEnabled(TASK_DISPATCH, true);
+    setTaskEnabled(TASK_ACCEL, true);
+
+    // so the time is filled with TASK_ACCEL which does fit
+    tasks[TASK_GYRO].lastExecutedAtUs = simulatedTime - 25;
+    scheduler();
+    EXPECT_EQ(&tasks[TASK_ACCEL], unittest_scheduler_selectedTask);
+
+    // TASK_DISPATCH fits with a whole gyro cycle available
+    tasks[TASK_GYRO].lastExecutedAtUs = simulatedTime + 200;
+    scheduler();
+    EXPECT_EQ(&tasks[TASK_DISPATCH], unittest_scheduler_selectedTask);
+
+    schedulerConfigMutable()->mode = SCHEDULER_MODE_PRIORITY;
+}
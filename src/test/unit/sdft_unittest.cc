@@ -0,0 +1,93 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <math.h>
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+// sdft.h uses C99 complex types, so the SDFTs are driven through sdft_unittest_c.c
+#ifndef SDFT_SAMPLE_SIZE
+#define SDFT_SAMPLE_SIZE 72
+#endif
+#define SDFT_BIN_COUNT   (SDFT_SAMPLE_SIZE / 2)
+#define AXIS_COUNT       3
+
+extern "C" {
+    void sdftTestInit(int startBin, int endBin, int numBatches);
+    void sdftTestPushBatch(const float samples[AXIS_COUNT], int batchIdx);
+    int sdftTestBinMismatches(int axis);
+    void sdftTestWinSq(int axis, float *output, float *referenceOutput);
+}
+
+static float sampleAt(int n, int axis)
+{
+    // a tone per axis plus noise, large enough that rounding differences would show
+    static uint32_t seed = 1;
+    seed = seed * 1103515245 + 12345;
+    const float noise = (float)((seed >> 16) & 0x7FFF) / 0x7FFF - 0.5f;
+    return 300.0f * sinf(0.37f * (axis + 1) * n) + 40.0f * noise;
+}
+
+static void expectMatchesReference(int startBin, int endBin, int numBatches)
+{
+    sdftTestInit(startBin, endBin, numBatches);
+
+    for (int n = 0; n < 4 * SDFT_SAMPLE_SIZE; n++) {
+        float samples[AXIS_COUNT];
+        for (int axis = 0; axis < AXIS_COUNT; axis++) {
+            samples[axis] = sampleAt(n, axis);
+        }
+        for (int batchIdx = 0; batchIdx < numBatches; batchIdx++) {
+            sdftTestPushBatch(samples, batchIdx);
+        }
+
+        for (int axis = 0; axis < AXIS_COUNT; axis++) {
+            ASSERT_EQ(0, sdftTestBinMismatches(axis)) << "sample " << n << " axis " << axis;
+
+            float output[SDFT_BIN_COUNT] = { 0 };
+            float referenceOutput[SDFT_BIN_COUNT] = { 0 };
+            sdftTestWinSq(axis, output, referenceOutput);
+            for (int bin = 0; bin < SDFT_BIN_COUNT; bin++) {
+                ASSERT_EQ(referenceOutput[bin], output[bin]) << "sample " << n << " axis " << axis << " bin " << bin;
+            }
+        }
+    }
+}
+
+TEST(SdftUnittest, TestAllBinsMatchScalarSdft)
+{
+    expectMatchesReference(0, SDFT_BIN_COUNT - 1, 1);
+}
+
+TEST(SdftUnittest, TestBatchedRangeMatchesScalarSdft)
+{
+    // the dynamic notch range, in three batches with a remainder in the last
+    expectMatchesReference(2, 31, 3);
+    expectMatchesReference(5, 21, 4);
+}
+
+TEST(SdftUnittest, TestRangeAtEdgesMatchesScalarSdft)
+{
+    expectMatchesReference(0, 10, 3);
+    expectMatchesReference(20, SDFT_BIN_COUNT - 1, 2);
+}
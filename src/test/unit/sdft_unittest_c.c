@@ -0,0 +1,159 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Complex arithmetic is C only, so the single axis SDFT the interleaved one
+// replaced is kept here as the reference and driven from sdft_unittest.cc.
+
+#include <math.h>
+#include <stdbool.h>
+
+#include "platform.h"
+
+#include "common/maths.h"
+#include "common/sdft.h"
+
+#define SDFT_R 0.9999f
+
+typedef struct referenceSdft_s {
+    int idx;
+    int startBin;
+    int endBin;
+    int batchSize;
+    int numBatches;
+    float samples[SDFT_SAMPLE_SIZE];
+    complex_t data[SDFT_BIN_COUNT];
+} referenceSdft_t;
+
+static float rPowerN;
+static complex_t twiddle[SDFT_BIN_COUNT];
+
+static sdftAxes_t axes;
+static referenceSdft_t reference[XYZ_AXIS_COUNT];
+
+static void referenceInit(referenceSdft_t *sdft, const int startBin, const int endBin, const int numBatches)
+{
+    rPowerN = powf(SDFT_R, SDFT_SAMPLE_SIZE);
+    const float c = 2.0f * M_PIf / (float)SDFT_SAMPLE_SIZE;
+    for (int i = 0; i < SDFT_BIN_COUNT; i++) {
+        float phi = c * i;
+        twiddle[i] = SDFT_R * (cos_approx(phi) + _Complex_I * sin_approx(phi));
+    }
+
+    sdft->idx = 0;
+    sdft->startBin = constrain(startBin, 0, SDFT_BIN_COUNT - 1);
+    sdft->endBin = constrain(endBin, sdft->startBin, SDFT_BIN_COUNT - 1);
+    sdft->numBatches = MAX(numBatches, 1);
+    sdft->batchSize = (sdft->endBin - sdft->startBin + 1) / sdft->numBatches;
+
+    for (int i = 0; i < SDFT_SAMPLE_SIZE; i++) {
+        sdft->samples[i] = 0.0f;
+    }
+    for (int i = 0; i < SDFT_BIN_COUNT; i++) {
+        sdft->data[i] = 0.0f;
+    }
+}
+
+static void referencePushBatch(referenceSdft_t *sdft, const float sample, const int batchIdx)
+{
+    const int batchStart = sdft->batchSize * batchIdx + sdft->startBin;
+    int batchEnd = batchStart;
+
+    const float delta = sample - rPowerN * sdft->samples[sdft->idx];
+
+    if (batchIdx == sdft->numBatches - 1) {
+        sdft->samples[sdft->idx] = sample;
+        sdft->idx = (sdft->idx + 1) % SDFT_SAMPLE_SIZE;
+        batchEnd += sdft->endBin - batchStart + 1;
+    } else {
+        batchEnd += sdft->batchSize;
+    }
+
+    for (int i = batchStart; i < batchEnd; i++) {
+        sdft->data[i] = twiddle[i] * (sdft->data[i] + delta);
+    }
+
+    if (sdft->startBin > 0 && batchIdx == 0) {
+        const int idx = sdft->startBin - 1;
+        sdft->data[idx] = twiddle[idx] * (sdft->data[idx] + delta);
+    }
+    if (sdft->endBin < SDFT_BIN_COUNT - 1 && batchIdx == sdft->numBatches - 1) {
+        const int idx = sdft->endBin + 1;
+        sdft->data[idx] = twiddle[idx] * (sdft->data[idx] + delta);
+    }
+}
+
+static void referenceWinSq(const referenceSdft_t *sdft, float *output)
+{
+    complex_t val;
+
+    if (sdft->startBin == 0) {
+        val = sdft->data[sdft->startBin] - sdft->data[sdft->startBin + 1];
+    } else {
+        val = sdft->data[sdft->startBin] - 0.5f * (sdft->data[sdft->startBin - 1] + sdft->data[sdft->startBin + 1]);
+    }
+    output[sdft->startBin] = crealf(val) * crealf(val) + cimagf(val) * cimagf(val);
+
+    for (int i = (sdft->startBin + 1); i < sdft->endBin; i++) {
+        val = sdft->data[i] - 0.5f * (sdft->data[i - 1] + sdft->data[i + 1]);
+        output[i] = crealf(val) * crealf(val) + cimagf(val) * cimagf(val);
+    }
+
+    if (sdft->endBin == SDFT_BIN_COUNT - 1) {
+        val = sdft->data[sdft->endBin] - sdft->data[sdft->endBin - 1];
+    } else {
+        val = sdft->data[sdft->endBin] - 0.5f * (sdft->data[sdft->endBin - 1] + sdft->data[sdft->endBin + 1]);
+    }
+    output[sdft->endBin] = crealf(val) * crealf(val) + cimagf(val) * cimagf(val);
+}
+
+void sdftTestInit(int startBin, int endBin, int numBatches)
+{
+    sdftAxesInit(&axes, startBin, endBin, numBatches);
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        referenceInit(&reference[axis], startBin, endBin, numBatches);
+    }
+}
+
+void sdftTestPushBatch(const float samples[XYZ_AXIS_COUNT], int batchIdx)
+{
+    sdftAxesPushBatch(&axes, samples, batchIdx);
+    for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+        referencePushBatch(&reference[axis], samples[axis], batchIdx);
+    }
+}
+
+// Returns the number of bins of an axis whose raw spectrum differs from the reference in any bit
+int sdftTestBinMismatches(int axis)
+{
+    int mismatches = 0;
+    for (int i = 0; i < SDFT_BIN_COUNT; i++) {
+        if (axes.data[i].re[axis] != crealf(reference[axis].data[i]) || axes.data[i].im[axis] != cimagf(reference[axis].data[i])) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+void sdftTestWinSq(int axis, float *output, float *referenceOutput)
+{
+    sdftAxesWinSq(&axes, axis, output);
+    referenceWinSq(&reference[axis], referenceOutput);
+}
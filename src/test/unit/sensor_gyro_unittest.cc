@@ -19,6 +19,8 @@
 #include <stdbool.h>
 
 #include <limits.h>
+#include <math.h>
+#include <string.h>
 #include <algorithm>
 
 #include "platform.h"
@@ -33,6 +35,7 @@ extern "C" {
     #include "drivers/accgyro/accgyro_virtual.h"
     #include "drivers/accgyro/accgyro_mpu.h"
     #include "drivers/sensor.h"
+    #include "drivers/system.h"
     #include "io/beeper.h"
     #include "pg/pg.h"
     #include "pg/pg_ids.h"
@@ -46,6 +49,8 @@ extern "C" {
     struct gyroSensor_s;
     STATIC_UNIT_TESTED void performGyroCalibration(struct gyroSensor_s *gyroSensor, uint8_t gyroMovementCalibrationThreshold);
     STATIC_UNIT_TESTED bool virtualGyroRead(gyroDev_t *gyro);
+    STATIC_UNIT_TESTED void gyroApplyFilterStages(float values[XYZ_AXIS_COUNT]);
+    STATIC_UNIT_TESTED void gyroAddFilterStage(gyroFilterStageType_e type, void *filters, size_t filterSize);
 
     uint8_t debugMode;
     int16_t debug[DEBUG16_VALUE_COUNT];
@@ -56,6 +61,8 @@ extern "C" {
 extern gyroSensor_s * const gyroSensorPtr;
 extern gyroDev_t * const gyroDevPtr;
 
+static int failureModeCount;
+
 
 TEST(SensorGyro, Detect)
 {
@@ -113,6 +120,110 @@ TEST(SensorGyro, Calibrate)
     EXPECT_EQ(7, gyroDevPtr->gyroZero[Z]);
 }
 
+TEST(SensorGyro, FilterStages)
+{
+    pgResetAll();
+    gyroConfigMutable()->gyro_soft_notch_hz_1 = 200;
+    gyroConfigMutable()->gyro_soft_notch_cutoff_1 = 100;
+    gyroConfigMutable()->gyro_soft_notch_hz_2 = 0;
+    gyroConfigMutable()->gyro_lpf1_type = FILTER_PT1;
+    gyroConfigMutable()->gyro_lpf1_static_hz = 150;
+    gyroInit();
+    gyroSetTargetLooptime(1);
+    gyroInitFilters();
+
+    // disabled notch 2 is left out of the pipeline
+    EXPECT_EQ(2, gyro.filterStageCount);
+    EXPECT_EQ(GYRO_FILTER_STAGE_BIQUAD, gyro.filterStages[0].type);
+    EXPECT_EQ((filter_t *)&gyro.notchFilter1[Y], gyro.filterStages[0].filter[Y]);
+    EXPECT_EQ(GYRO_FILTER_STAGE_PT1, gyro.filterStages[1].type);
+    EXPECT_EQ((filter_t *)&gyro.lowpassFilter[Z], gyro.filterStages[1].filter[Z]);
+
+    // same result as applying the filters one by one
+    biquadFilter_t notch1[XYZ_AXIS_COUNT];
+    gyroLowpassFilter_t lowpass[XYZ_AXIS_COUNT];
+    memcpy(notch1, gyro.notchFilter1, sizeof(notch1));
+    memcpy(lowpass, gyro.lowpassFilter, sizeof(lowpass));
+
+    for (int i = 0; i < 100; i++) {
+        float values[XYZ_AXIS_COUNT];
+        float expected[XYZ_AXIS_COUNT];
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            values[axis] = 100.0f * sinf(0.2f * i * (axis + 1));
+            expected[axis] = gyro.notchFilter1ApplyFn((filter_t *)&notch1[axis], values[axis]);
+            expected[axis] = gyro.lowpassFilterApplyFn((filter_t *)&lowpass[axis], expected[axis]);
+        }
+
+        gyroApplyFilterStages(values);
+
+        for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+            EXPECT_FLOAT_EQ(expected[axis], values[axis]);
+        }
+    }
+}
+
+TEST(SensorGyro, FilterStageTypeSetByFilterInit)
+{
+    const struct {
+        lowpassFilterType_e lpfType;
+        gyroFilterStageType_e stageType;
+    } lowpasses[] = {
+        { FILTER_PT1, GYRO_FILTER_STAGE_PT1 },
+        { FILTER_PT2, GYRO_FILTER_STAGE_PT2 },
+        { FILTER_PT3, GYRO_FILTER_STAGE_PT3 },
+#ifdef USE_DYN_LPF
+        { FILTER_BIQUAD, GYRO_FILTER_STAGE_BIQUAD_DF1 },
+#else
+        { FILTER_BIQUAD, GYRO_FILTER_STAGE_BIQUAD },
+#endif
+    };
+
+    for (const auto &lowpass : lowpasses) {
+        pgResetAll();
+        gyroConfigMutable()->gyro_soft_notch_hz_1 = 0;
+        gyroConfigMutable()->gyro_soft_notch_hz_2 = 0;
+        gyroConfigMutable()->gyro_lpf1_type = lowpass.lpfType;
+        gyroConfigMutable()->gyro_lpf1_static_hz = 150;
+        gyroInit();
+        gyroSetTargetLooptime(1);
+        gyroInitFilters();
+
+        ASSERT_EQ(1, gyro.filterStageCount);
+        EXPECT_EQ(lowpass.stageType, gyro.filterStages[0].type);
+
+        gyroLowpassFilter_t expectedFilter[XYZ_AXIS_COUNT];
+        memcpy(expectedFilter, gyro.lowpassFilter, sizeof(expectedFilter));
+        for (int i = 0; i < 20; i++) {
+            float values[XYZ_AXIS_COUNT] = { 10.0f * i, -5.0f * i, 100.0f };
+            float expected[XYZ_AXIS_COUNT];
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                expected[axis] = gyro.lowpassFilterApplyFn((filter_t *)&expectedFilter[axis], values[axis]);
+            }
+            gyroApplyFilterStages(values);
+            for (int axis = 0; axis < XYZ_AXIS_COUNT; axis++) {
+                EXPECT_FLOAT_EQ(expected[axis], values[axis]);
+            }
+        }
+    }
+}
+
+TEST(SensorGyro, UnknownFilterStageFails)
+{
+    gyro.filterStageCount = 0;
+    failureModeCount = 0;
+
+    gyroAddFilterStage((gyroFilterStageType_e)(GYRO_FILTER_STAGE_BIQUAD_DF1 + 1), gyro.lowpassFilter, sizeof(gyro.lowpassFilter[0]));
+    EXPECT_EQ(1, failureModeCount);
+    EXPECT_EQ(0, gyro.filterStageCount);
+
+    // and so does running out of stages
+    for (int i = 0; i <= GYRO_FILTER_STAGE_COUNT; i++) {
+        gyroAddFilterStage(GYRO_FILTER_STAGE_PT1, gyro.lowpassFilter, sizeof(gyro.lowpassFilter[0]));
+    }
+    EXPECT_EQ(2, failureModeCount);
+    EXPECT_EQ(GYRO_FILTER_STAGE_COUNT, gyro.filterStageCount);
+}
+
 TEST(SensorGyro, Update)
 {
     pgResetAll();
@@ -165,4 +276,5 @@ void sensorsSet(uint32_t) {}
 void schedulerResetTaskStatistics(taskId_e) {}
 int getArmingDisableFlags(void) {return 0;}
 void writeEEPROM(void) {}
+void failureMode(failureMode_e) { failureModeCount++; }
 }
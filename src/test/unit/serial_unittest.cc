@@ -0,0 +1,170 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "drivers/serial.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define RX_BUFFER_SIZE 8
+
+static uint8_t rxBuffer[RX_BUFFER_SIZE];
+
+static uint32_t testRxWaiting(const serialPort_t *instance)
+{
+    if (instance->rxBufferHead >= instance->rxBufferTail) {
+        return instance->rxBufferHead - instance->rxBufferTail;
+    }
+    return instance->rxBufferSize + instance->rxBufferHead - instance->rxBufferTail;
+}
+
+static uint8_t testRead(serialPort_t *instance)
+{
+    const uint8_t ch = instance->rxBuffer[instance->rxBufferTail];
+    serialRxBufferConsume(instance, 1);
+    return ch;
+}
+
+static uint32_t testReadSpan(serialPort_t *instance, const uint8_t **data)
+{
+    return serialRxBufferSpan(instance, data);
+}
+
+// A driver without zero copy reads, and one with them
+static const struct serialPortVTable byteVTable = {
+    .serialWrite = NULL,
+    .serialTotalRxWaiting = testRxWaiting,
+    .serialTotalTxFree = NULL,
+    .serialRead = testRead,
+    .serialSetBaudRate = NULL,
+    .isSerialTransmitBufferEmpty = NULL,
+    .setMode = NULL,
+    .setCtrlLineStateCb = NULL,
+    .setBaudRateCb = NULL,
+    .writeBuf = NULL,
+    .beginWrite = NULL,
+    .endWrite = NULL,
+    .readSpan = NULL,
+    .consume = NULL,
+};
+
+static const struct serialPortVTable spanVTable = {
+    .serialWrite = NULL,
+    .serialTotalRxWaiting = testRxWaiting,
+    .serialTotalTxFree = NULL,
+    .serialRead = testRead,
+    .serialSetBaudRate = NULL,
+    .isSerialTransmitBufferEmpty = NULL,
+    .setMode = NULL,
+    .setCtrlLineStateCb = NULL,
+    .setBaudRateCb = NULL,
+    .writeBuf = NULL,
+    .beginWrite = NULL,
+    .endWrite = NULL,
+    .readSpan = testReadSpan,
+    .consume = serialRxBufferConsume,
+};
+
+static serialPort_t port;
+
+static void initPort(const struct serialPortVTable *vTable)
+{
+    memset(&port, 0, sizeof(port));
+    port.vTable = vTable;
+    port.rxBuffer = rxBuffer;
+    port.rxBufferSize = RX_BUFFER_SIZE;
+}
+
+static void receive(const char *str)
+{
+    while (*str) {
+        rxBuffer[port.rxBufferHead] = *str++;
+        port.rxBufferHead = (port.rxBufferHead + 1) % RX_BUFFER_SIZE;
+    }
+}
+
+TEST(SerialUnittest, TestSpanEndsAtBufferWrap)
+{
+    initPort(&spanVTable);
+    port.rxBufferHead = port.rxBufferTail = 5;
+    receive("abcde");
+
+    const uint8_t *data;
+    ASSERT_EQ(3, serialReadSpan(&port, &data));
+    EXPECT_EQ(0, memcmp(data, "abc", 3));
+
+    // consuming part of the span leaves the rest
+    serialConsume(&port, 2);
+    ASSERT_EQ(1, serialReadSpan(&port, &data));
+    EXPECT_EQ('c', data[0]);
+    serialConsume(&port, 1);
+
+    ASSERT_EQ(2, serialReadSpan(&port, &data));
+    EXPECT_EQ(0, memcmp(data, "de", 2));
+    serialConsume(&port, 2);
+
+    EXPECT_EQ(0, serialReadSpan(&port, &data));
+    EXPECT_EQ(0, serialRxBytesWaiting(&port));
+}
+
+TEST(SerialUnittest, TestSpanOfOneByteWithoutDriverSupport)
+{
+    initPort(&byteVTable);
+    receive("ab");
+
+    const uint8_t *data;
+    ASSERT_EQ(1, serialReadSpan(&port, &data));
+    EXPECT_EQ('a', data[0]);
+
+    // the byte read ahead is still waiting until consumed
+    EXPECT_EQ(2, serialRxBytesWaiting(&port));
+    ASSERT_EQ(1, serialReadSpan(&port, &data));
+    EXPECT_EQ('a', data[0]);
+
+    serialConsume(&port, 1);
+    EXPECT_EQ(1, serialRxBytesWaiting(&port));
+    ASSERT_EQ(1, serialReadSpan(&port, &data));
+    EXPECT_EQ('b', data[0]);
+    serialConsume(&port, 0);
+
+    // and can be read a byte at a time
+    EXPECT_EQ('b', serialRead(&port));
+    EXPECT_EQ(0, serialRxBytesWaiting(&port));
+    EXPECT_EQ(0, serialReadSpan(&port, &data));
+}
+
+// STUBS
+
+extern "C" {
+
+void delay(uint32_t ms)
+{
+    UNUSED(ms);
+}
+
+}
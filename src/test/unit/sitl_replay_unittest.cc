@@ -0,0 +1,183 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "sitl_replay.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+static std::string tracePath;
+static std::string outputPath;
+
+static std::string tempPath(void)
+{
+    char path[] = "/tmp/sitl_replay_unittest_XXXXXX";
+    const int fd = mkstemp(path);
+    EXPECT_GE(fd, 0);
+    close(fd);
+    return path;
+}
+
+// Writes the trace and opens it for replay
+static void openTrace(const char *trace)
+{
+    tracePath = tempPath();
+    outputPath = tempPath();
+
+    FILE *file = fopen(tracePath.c_str(), "w");
+    ASSERT_NE(nullptr, file);
+    fputs(trace, file);
+    fclose(file);
+
+    ASSERT_TRUE(replayOpen(tracePath.c_str(), outputPath.c_str()));
+}
+
+static std::string closeTrace(void)
+{
+    replayClose();
+
+    std::string output;
+    FILE *file = fopen(outputPath.c_str(), "r");
+    if (file) {
+        char buf[256];
+        size_t count;
+        while ((count = fread(buf, 1, sizeof(buf), file)) > 0) {
+            output.append(buf, count);
+        }
+        fclose(file);
+    }
+
+    unlink(tracePath.c_str());
+    unlink(outputPath.c_str());
+    return output;
+}
+
+TEST(SitlReplayUnittest, TestWellFormedRows)
+{
+    openTrace(
+        "# recorded on the bench\n"
+        "time_us,gyro_x,gyro_y,gyro_z,acc_x,acc_y,acc_z,pressure\n"
+        "125,1.5,-2.5,3,0.1,-0.2,1,101325\n"
+        "250, 4, 5, 6, 0, 0, 1, 101300, 1500, 1500,1000\t,2000\n");
+
+    replayRecord_t record;
+    ASSERT_TRUE(replayRead(&record));
+    EXPECT_DOUBLE_EQ(125, record.timeUs);
+    EXPECT_FLOAT_EQ(1.5f, record.gyro[0]);
+    EXPECT_FLOAT_EQ(-2.5f, record.gyro[1]);
+    EXPECT_FLOAT_EQ(3.0f, record.gyro[2]);
+    EXPECT_FLOAT_EQ(0.1f, record.acc[0]);
+    EXPECT_FLOAT_EQ(-0.2f, record.acc[1]);
+    EXPECT_FLOAT_EQ(1.0f, record.acc[2]);
+    EXPECT_FLOAT_EQ(101325.0f, record.pressurePa);
+    EXPECT_EQ(0, record.rcChannelCount);
+
+    ASSERT_TRUE(replayRead(&record));
+    EXPECT_DOUBLE_EQ(250, record.timeUs);
+    EXPECT_FLOAT_EQ(6.0f, record.gyro[2]);
+    EXPECT_FLOAT_EQ(101300.0f, record.pressurePa);
+    ASSERT_EQ(4, record.rcChannelCount);
+    EXPECT_EQ(1500, record.rc[0]);
+    EXPECT_EQ(1500, record.rc[1]);
+    EXPECT_EQ(1000, record.rc[2]);
+    EXPECT_EQ(2000, record.rc[3]);
+
+    EXPECT_FALSE(replayRead(&record));
+
+    const float gyroFiltered[3] = { 1, 2, 3 };
+    const float motors[2] = { 1000, 1100 };
+    replayWrite(125, gyroFiltered, motors, 2);
+    EXPECT_EQ("time_us,gyro_roll,gyro_pitch,gyro_yaw,motor0,motor1\n125,1.000,2.000,3.000,1000.0,1100.0\n", closeTrace());
+}
+
+TEST(SitlReplayUnittest, TestShortAndMalformedRowsSkipped)
+{
+    openTrace(
+        "125,1,2,3,0,0,1\n"             // pressure missing
+        "\n"
+        "250,1,2,x,0,0,1,101325\n"      // not a number part way through
+        "375,1,2,3,0,0,1,101325,abc\n"  // trailing garbage after a whole record
+        "garbage\n"
+        "500,7,8,9,0,0,1,101325\n");
+
+    replayRecord_t record;
+    ASSERT_TRUE(replayRead(&record));
+    EXPECT_DOUBLE_EQ(375, record.timeUs);
+    EXPECT_EQ(0, record.rcChannelCount);
+
+    ASSERT_TRUE(replayRead(&record));
+    EXPECT_DOUBLE_EQ(500, record.timeUs);
+    EXPECT_FLOAT_EQ(7.0f, record.gyro[0]);
+
+    EXPECT_FALSE(replayRead(&record));
+    closeTrace();
+}
+
+TEST(SitlReplayUnittest, TestRcChannelsBeyondMaximumIgnored)
+{
+    std::string row = "125,1,2,3,0,0,1,101325";
+    for (int i = 0; i < REPLAY_RC_CHANNEL_COUNT_MAX + 4; i++) {
+        row += "," + std::to_string(1000 + i);
+    }
+    openTrace((row + "\n").c_str());
+
+    replayRecord_t record;
+    ASSERT_TRUE(replayRead(&record));
+    EXPECT_EQ(REPLAY_RC_CHANNEL_COUNT_MAX, record.rcChannelCount);
+    EXPECT_EQ(1000 + REPLAY_RC_CHANNEL_COUNT_MAX - 1, record.rc[REPLAY_RC_CHANNEL_COUNT_MAX - 1]);
+    closeTrace();
+}
+
+TEST(SitlReplayUnittest, TestEndOfFile)
+{
+    // the last record has no line end
+    openTrace("125,1,2,3,0,0,1,101325\n250,4,5,6,0,0,1,101325");
+
+    replayRecord_t record;
+    ASSERT_TRUE(replayRead(&record));
+    ASSERT_TRUE(replayRead(&record));
+    EXPECT_DOUBLE_EQ(250, record.timeUs);
+    EXPECT_FALSE(replayRead(&record));
+    EXPECT_FALSE(replayRead(&record));
+
+    // nothing is written before the first record is done
+    EXPECT_EQ("", closeTrace());
+
+    // and nothing is read once the trace is closed
+    EXPECT_FALSE(replayRead(&record));
+
+    openTrace("");
+    EXPECT_FALSE(replayRead(&record));
+    closeTrace();
+}
@@ -0,0 +1,239 @@
+/*
+ * This file is part of Betaflight.
+ *
+ * Betaflight is free software. You can redistribute this software
+ * and/or modify this software under the terms of the GNU General
+ * Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * Betaflight is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this software.
+ *
+ * If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+extern "C" {
+    #include "platform.h"
+
+    #include "build/trace.h"
+
+    #include "common/streambuf.h"
+
+    #include "scheduler/scheduler.h"
+}
+
+#include "unittest_macros.h"
+#include "gtest/gtest.h"
+
+#define TEST_CYCLES_PER_US 100
+
+static uint32_t cycleCounter;
+static uint8_t replyBuffer[512];
+
+typedef struct dumpHeader_s {
+    uint16_t cyclesPerUs;
+    uint32_t recorded;
+    uint16_t held;
+    uint16_t offset;
+    uint8_t count;
+} dumpHeader_t;
+
+static void resetTrace(void)
+{
+    memset(traceBuffer, 0, sizeof(traceBuffer));
+    traceHead = 0;
+    traceRunning = true;
+    cycleCounter = 0;
+}
+
+static void mark(int count)
+{
+    for (int i = 0; i < count; i++) {
+        cycleCounter += 10;
+        TRACE_BEGIN(TRACE_ID_PID_CONTROLLER);
+    }
+}
+
+// Requests one page of events, returns the reply header and the cycle stamps of the events
+static dumpHeader_t dumpEvents(uint16_t offset, uint32_t *cycles)
+{
+    uint8_t request[3] = { TRACE_DUMP_EVENTS, (uint8_t)(offset & 0xFF), (uint8_t)(offset >> 8) };
+    sbuf_t src = { .ptr = request, .end = ARRAYEND(request) };
+    sbuf_t dst = { .ptr = replyBuffer, .end = ARRAYEND(replyBuffer) };
+    EXPECT_TRUE(traceDump(&dst, &src));
+
+    sbuf_t reply = { .ptr = replyBuffer, .end = dst.ptr };
+    dumpHeader_t header;
+    header.cyclesPerUs = sbufReadU16(&reply);
+    header.recorded = sbufReadU32(&reply);
+    header.held = sbufReadU16(&reply);
+    header.offset = sbufReadU16(&reply);
+    header.count = sbufReadU8(&reply);
+    for (unsigned i = 0; i < header.count; i++) {
+        cycles[i] = sbufReadU32(&reply);
+        EXPECT_EQ(TRACE_ID_PID_CONTROLLER, sbufReadU8(&reply));
+        EXPECT_EQ(TRACE_PHASE_BEGIN, sbufReadU8(&reply));
+    }
+    EXPECT_EQ(0, sbufBytesRemaining(&reply));
+    return header;
+}
+
+TEST(TraceUnittest, TestMarksAreRecordedInOrder)
+{
+    resetTrace();
+
+    cycleCounter = 1234;
+    TRACE_BEGIN(TRACE_ID_GYRO_UPDATE);
+    cycleCounter = 1300;
+    TRACE_END(TRACE_ID_GYRO_UPDATE);
+
+    EXPECT_EQ(2U, traceHead);
+    EXPECT_EQ(1234U, traceBuffer[0].cycles);
+    EXPECT_EQ(TRACE_ID_GYRO_UPDATE, traceBuffer[0].id);
+    EXPECT_EQ(TRACE_PHASE_BEGIN, traceBuffer[0].phase);
+    EXPECT_EQ(1300U, traceBuffer[1].cycles);
+    EXPECT_EQ(TRACE_PHASE_END, traceBuffer[1].phase);
+}
+
+TEST(TraceUnittest, TestDumpPagesThroughFrozenWindow)
+{
+    resetTrace();
+    mark(TRACE_BUFFER_SIZE + 100);
+
+    uint32_t cycles[TRACE_PAGE_EVENT_COUNT];
+    uint32_t expected = 10 * 101;   // oldest event still held
+    unsigned offset = 0;
+    while (offset < TRACE_BUFFER_SIZE) {
+        const dumpHeader_t header = dumpEvents(offset, cycles);
+        EXPECT_EQ(TEST_CYCLES_PER_US, header.cyclesPerUs);
+        EXPECT_EQ((uint32_t)TRACE_BUFFER_SIZE + 100, header.recorded);
+        EXPECT_EQ(TRACE_BUFFER_SIZE, header.held);
+        EXPECT_EQ(offset, header.offset);
+        ASSERT_GT(header.count, 0);
+        for (unsigned i = 0; i < header.count; i++) {
+            EXPECT_EQ(expected, cycles[i]);
+            expected += 10;
+        }
+        offset += header.count;
+
+        // markers are ignored until the last page has been read
+        if (offset < TRACE_BUFFER_SIZE) {
+            EXPECT_FALSE(traceRunning);
+            mark(1);
+        }
+    }
+
+    EXPECT_TRUE(traceRunning);
+    EXPECT_EQ((uint32_t)TRACE_BUFFER_SIZE + 100, traceHead);
+    mark(1);
+    EXPECT_EQ((uint32_t)TRACE_BUFFER_SIZE + 101, traceHead);
+}
+
+TEST(TraceUnittest, TestAbortedDumpResumesAfterTimeout)
+{
+    resetTrace();
+    mark(200);
+
+    uint32_t cycles[TRACE_PAGE_EVENT_COUNT];
+    dumpEvents(0, cycles);
+    EXPECT_FALSE(traceRunning);
+
+    // the host goes away part way through, capture stays paused until the timeout
+    cycleCounter += TRACE_DUMP_TIMEOUT_MS * 1000 * TEST_CYCLES_PER_US - 100;
+    mark(1);
+    EXPECT_FALSE(traceRunning);
+    EXPECT_EQ(200U, traceHead);
+
+    cycleCounter += 100;
+    mark(1);
+    EXPECT_TRUE(traceRunning);
+    mark(1);
+    EXPECT_EQ(201U, traceHead);
+}
+
+TEST(TraceUnittest, TestNewDumpAfterTimeoutFreezesNewWindow)
+{
+    resetTrace();
+    mark(200);
+
+    uint32_t cycles[TRACE_PAGE_EVENT_COUNT];
+    dumpEvents(0, cycles);
+    cycleCounter += TRACE_DUMP_TIMEOUT_MS * 1000 * TEST_CYCLES_PER_US + 1;
+    mark(11);
+    ASSERT_TRUE(traceRunning);
+    EXPECT_EQ(210U, traceHead);
+
+    // a host carrying on from its old offset sees the new window in the header
+    const dumpHeader_t header = dumpEvents(TRACE_PAGE_EVENT_COUNT, cycles);
+    EXPECT_EQ(210U, header.recorded);
+    EXPECT_EQ(210U, header.held);
+    EXPECT_FALSE(traceRunning);
+
+    // and a new dump from the start is served from it too
+    const dumpHeader_t restart = dumpEvents(0, cycles);
+    EXPECT_EQ(210U, restart.recorded);
+    EXPECT_EQ(TRACE_PAGE_EVENT_COUNT, restart.count);
+}
+
+TEST(TraceUnittest, TestDumpNames)
+{
+    uint8_t request[2] = { TRACE_DUMP_NAMES, 0 };
+    sbuf_t src = { .ptr = request, .end = ARRAYEND(request) };
+    sbuf_t dst = { .ptr = replyBuffer, .end = ARRAYEND(replyBuffer) };
+    EXPECT_TRUE(traceDump(&dst, &src));
+
+    sbuf_t reply = { .ptr = replyBuffer, .end = dst.ptr };
+    const uint8_t count = sbufReadU8(&reply);
+    EXPECT_EQ(TRACE_ID_COUNT + TASK_COUNT, count);
+
+    char name[32];
+    EXPECT_EQ(TRACE_ID_GYRO_UPDATE, sbufReadU8(&reply));
+    const uint8_t length = sbufReadU8(&reply);
+    sbufReadData(&reply, name, length);
+    name[length] = 0;
+    EXPECT_STREQ("gyroUpdate", name);
+}
+
+TEST(TraceUnittest, TestUnknownDumpTypeIsRefused)
+{
+    uint8_t request[1] = { 7 };
+    sbuf_t src = { .ptr = request, .end = ARRAYEND(request) };
+    sbuf_t dst = { .ptr = replyBuffer, .end = ARRAYEND(replyBuffer) };
+    EXPECT_FALSE(traceDump(&dst, &src));
+}
+
+// STUBS
+
+extern "C" {
+
+static task_attribute_t taskAttribute = { .taskName = "TASK" };
+static task_t task = { .attribute = &taskAttribute };
+
+task_t *getTask(unsigned taskId)
+{
+    UNUSED(taskId);
+    return &task;
+}
+
+uint32_t getCycleCounter(void)
+{
+    return cycleCounter;
+}
+
+uint32_t clockMicrosToCycles(uint32_t micros)
+{
+    return micros * TEST_CYCLES_PER_US;
+}
+
+}
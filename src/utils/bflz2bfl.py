@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+#
+# This file is part of Betaflight.
+#
+# Betaflight is free software. You can redistribute this software
+# and/or modify this software under the terms of the GNU General
+# Public License as published by the Free Software Foundation,
+# either version 3 of the License, or (at your option) any later
+# version.
+#
+# Betaflight is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public
+# License along with this software.
+#
+# If not, see <http://www.gnu.org/licenses/>.
+#
+# Expand logs recorded with blackbox_compression = HUFFMAN into plain
+# blackbox logs that the usual tools can read. Uncompressed logs in the
+# same file (e.g. a flash dump holding several flights) are copied as
+# they are. See blackbox/blackbox_io.h for the format.
+#
+#   bflz2bfl.py flash_dump.bbl -o flash_dump_expanded.bbl
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+MAGIC = b'BFLZ'
+VERSION = 1
+COMPRESSION_HUFFMAN = 1
+BLOCK_STORED = 0x8000
+BLOCK_LENGTH_MAX = 0x7FFF
+
+DEFAULT_TABLE = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'main', 'common', 'huffman_table.c')
+
+
+def load_huffman_codes(path):
+    """Map (code length, code) to byte value from the firmware's huffman table source."""
+    codes = {}
+    pattern = re.compile(r'HUFFMAN_CODE\(\s*(\d+),\s*0x([0-9A-Fa-f]+)\s*\),\s*//\s*(0x[0-9A-Fa-f]{2}|EOF)')
+    with open(path) as source:
+        for length, code, symbol in pattern.findall(source.read()):
+            length = int(length)
+            if symbol != 'EOF':
+                codes[(length, int(code, 16) >> (16 - length))] = int(symbol, 16)
+    if len(codes) != 256:
+        raise ValueError('%s: expected 256 huffman codes, found %d' % (path, len(codes)))
+    return codes
+
+
+def huffman_decode(data, pos, count, codes):
+    """Decode count bytes starting at data[pos], returns them and the position after the padded block."""
+    out = bytearray()
+    code = 0
+    length = 0
+    bit = 0
+    while len(out) < count:
+        byte_index = pos + (bit >> 3)
+        if byte_index >= len(data):
+            raise EOFError('truncated block')
+        code = (code << 1) | ((data[byte_index] >> (7 - (bit & 7))) & 1)
+        length += 1
+        bit += 1
+        symbol = codes.get((length, code))
+        if symbol is not None:
+            out.append(symbol)
+            code = 0
+            length = 0
+        elif length > 16:
+            raise ValueError('invalid code')
+    return bytes(out), pos + ((bit + 7) >> 3)
+
+
+def expand_log(data, pos, codes, out):
+    """Expand one compressed log whose header starts at pos, returns where it ends."""
+    version, method = data[pos + 4], data[pos + 5]
+    if version != VERSION or method != COMPRESSION_HUFFMAN:
+        raise ValueError('unsupported compressed log version %d method %d at offset %d' % (version, method, pos))
+    pos += 6
+
+    while pos + 2 <= len(data):
+        if data[pos:pos + len(MAGIC)] == MAGIC:
+            break  # the next log
+        header, = struct.unpack_from('<H', data, pos)
+        length = header & BLOCK_LENGTH_MAX
+        # Erased flash, or the end of a log cut short by power loss
+        if header == 0xFFFF or length == 0:
+            break
+        try:
+            if header & BLOCK_STORED:
+                if pos + 2 + length > len(data):
+                    raise EOFError('truncated block')
+                block, end = data[pos + 2:pos + 2 + length], pos + 2 + length
+            else:
+                block, end = huffman_decode(data, pos + 2, length, codes)
+        except (EOFError, ValueError) as error:
+            print('offset %d: %s, log truncated here' % (pos, error), file=sys.stderr)
+            break
+        out.write(block)
+        pos = end
+
+    return pos
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Expand compressed blackbox logs')
+    parser.add_argument('input')
+    parser.add_argument('-o', '--output', help='defaults to the input name with .expanded.bbl appended')
+    parser.add_argument('--table', default=DEFAULT_TABLE, help='path to huffman_table.c')
+    args = parser.parse_args()
+
+    codes = load_huffman_codes(args.table)
+    with open(args.input, 'rb') as f:
+        data = f.read()
+
+    logs = 0
+    with open(args.output or args.input + '.expanded.bbl', 'wb') as out:
+        pos = 0
+        while pos < len(data):
+            start = data.find(MAGIC, pos)
+            if start < 0:
+                out.write(data[pos:])
+                break
+            out.write(data[pos:start])
+            pos = expand_log(data, start, codes, out)
+            logs += 1
+
+    print('%d compressed log(s) expanded' % logs)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
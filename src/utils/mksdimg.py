@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+#
+# This file is part of Betaflight.
+#
+# Betaflight is free software. You can redistribute this software
+# and/or modify this software under the terms of the GNU General
+# Public License as published by the Free Software Foundation,
+# either version 3 of the License, or (at your option) any later
+# version.
+#
+# Betaflight is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public
+# License along with this software.
+#
+# If not, see <http://www.gnu.org/licenses/>.
+#
+# Make an SD card image for the SITL target to log to (sdcard_mode = FILE):
+# an MBR with one FAT32 partition, which is what asyncfatfs expects to find
+# on a card. The image is created sparse, so only the blocks written take
+# up space on disk. Copy logs out of it with e.g. mtools, or loop mount it.
+#
+#   mksdimg.py sdcard.img --size 256
+
+import argparse
+import struct
+import sys
+
+SECTOR_SIZE = 512
+PARTITION_START = 2048  # 1MB aligned, like a card formatted by the SD association's tool
+RESERVED_SECTORS = 32
+NUM_FATS = 2
+FAT32_MIN_CLUSTERS = 65525
+MBR_PARTITION_TYPE_FAT32_LBA = 0x0C
+
+
+def fat32_layout(partition_sectors):
+    """Choose the largest cluster size that still gives a FAT32 cluster count, returns (sectors per cluster, FAT sectors)."""
+    for sectors_per_cluster in (64, 32, 16, 8, 4, 2, 1):
+        fat_sectors = 1
+        while True:
+            clusters = (partition_sectors - RESERVED_SECTORS - NUM_FATS * fat_sectors) // sectors_per_cluster
+            needed = ((clusters + 2) * 4 + SECTOR_SIZE - 1) // SECTOR_SIZE
+            if needed <= fat_sectors:
+                break
+            fat_sectors = needed
+        if clusters >= FAT32_MIN_CLUSTERS:
+            return sectors_per_cluster, fat_sectors, clusters
+    raise ValueError('image too small for FAT32')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Make a FAT32 formatted SD card image')
+    parser.add_argument('output')
+    parser.add_argument('--size', type=int, default=256, help='image size in MB (at least 40)')
+    args = parser.parse_args()
+
+    total_sectors = args.size * 1024 * 1024 // SECTOR_SIZE
+    partition_sectors = total_sectors - PARTITION_START
+    sectors_per_cluster, fat_sectors, clusters = fat32_layout(partition_sectors)
+
+    mbr = bytearray(SECTOR_SIZE)
+    # status, CHS first (unused), type, CHS last (unused), LBA first, sector count
+    mbr[446:462] = struct.pack('<B3sB3sII', 0, b'\xFE\xFF\xFF', MBR_PARTITION_TYPE_FAT32_LBA, b'\xFE\xFF\xFF',
+                               PARTITION_START, partition_sectors)
+    mbr[510:512] = b'\x55\xAA'
+
+    boot = bytearray(SECTOR_SIZE)
+    struct.pack_into('<3s8sHBHBHHBHHHII', boot, 0, b'\xEB\x58\x90', b'BTFL    ', SECTOR_SIZE, sectors_per_cluster,
+                     RESERVED_SECTORS, NUM_FATS, 0, 0, 0xF8, 0, 63, 255, PARTITION_START, partition_sectors)
+    # FAT size, flags, version, root cluster, FSInfo sector, backup boot sector
+    struct.pack_into('<IHHIHH', boot, 36, fat_sectors, 0, 0, 2, 1, 6)
+    struct.pack_into('<BBBI11s8s', boot, 64, 0x80, 0, 0x29, 0x42544C47, b'BETAFLIGHT ', b'FAT32   ')
+    boot[510:512] = b'\x55\xAA'
+
+    fsinfo = bytearray(SECTOR_SIZE)
+    struct.pack_into('<I', fsinfo, 0, 0x41615252)
+    struct.pack_into('<IIII', fsinfo, 484, 0x61417272, clusters - 1, 3, 0)
+    struct.pack_into('<I', fsinfo, 508, 0xAA550000)
+
+    # Media and reserved entries, then the end of the root directory's chain
+    fat = struct.pack('<III', 0x0FFFFFF8, 0x0FFFFFFF, 0x0FFFFFFF)
+
+    first_fat = PARTITION_START + RESERVED_SECTORS
+    cluster_start = first_fat + NUM_FATS * fat_sectors
+
+    with open(args.output, 'wb') as f:
+        f.truncate(total_sectors * SECTOR_SIZE)
+        for sector, data in ((0, mbr), (PARTITION_START, boot), (PARTITION_START + 1, fsinfo),
+                             (PARTITION_START + 6, boot), (PARTITION_START + 7, fsinfo),
+                             (first_fat, fat), (first_fat + fat_sectors, fat)):
+            f.seek(sector * SECTOR_SIZE)
+            f.write(data)
+        # An empty root directory
+        f.seek(cluster_start * SECTOR_SIZE)
+        f.write(bytes(sectors_per_cluster * SECTOR_SIZE))
+
+    print('%s: %d MB, %d clusters of %d bytes' % (args.output, args.size, clusters, sectors_per_cluster * SECTOR_SIZE))
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+#
+# This file is part of Betaflight.
+#
+# Betaflight is free software. You can redistribute this software
+# and/or modify this software under the terms of the GNU General
+# Public License as published by the Free Software Foundation,
+# either version 3 of the License, or (at your option) any later
+# version.
+#
+# Betaflight is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public
+# License along with this software.
+#
+# If not, see <http://www.gnu.org/licenses/>.
+#
+# Check that the SITL in --lockstep mode is deterministic: drive it twice with
+# the same FDM packets and compare the motor outputs and blackbox logs.
+#
+# A config with blackbox_mode = ALWAYS and blackbox_device = VIRTUAL is made
+# first, so every run logs the filtered gyro and PID terms. Each run sends a
+# burst of packets while the SITL is still starting up, then one packet per
+# step, so packets that arrive before lockstep is established are covered.
+#
+#   sitl_lockstep_check.py obj/main/betaflight_SITL.elf --steps 2000
+
+import argparse
+import hashlib
+import math
+import os
+import shutil
+import signal
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+PORT_PWM_RAW = 9001
+PORT_PWM = 9002
+PORT_STATE = 9003
+PORT_CLI = 5761
+
+FDM_PACKET = struct.Struct('<d3d3d4d3d3dd')
+SERVO_PACKET_SIZE = 4 * 4
+
+
+def fdm_packet(step, step_s):
+    t = step * step_s
+    gyro = (0.5 * math.sin(2 * math.pi * 7 * t) + 0.05 * math.sin(2 * math.pi * 180 * t),
+            0.3 * math.sin(2 * math.pi * 11 * t),
+            0.1 * math.cos(2 * math.pi * 3 * t))
+    acc = (0.0, 0.0, -9.80665)
+    return FDM_PACKET.pack(t, *gyro, *acc, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 101325.0)
+
+
+def wait_for_port(port, timeout=10.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            return socket.create_connection(('127.0.0.1', port), timeout=1.0)
+        except OSError:
+            time.sleep(0.1)
+    sys.exit('SITL did not open TCP port {}'.format(port))
+
+
+def make_config(elf, workdir):
+    sitl = subprocess.Popen([elf], cwd=workdir, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        cli = wait_for_port(PORT_CLI)
+        cli.sendall(b'#')
+        time.sleep(0.5)
+        for command in ('set blackbox_device = VIRTUAL', 'set blackbox_mode = ALWAYS', 'save'):
+            cli.sendall(command.encode() + b'\r\n')
+            time.sleep(0.5)
+        # the SITL exits to reboot once the connection is closed
+        cli.close()
+        sitl.wait(timeout=10)
+    finally:
+        if sitl.poll() is None:
+            sitl.kill()
+    if not os.path.exists(os.path.join(workdir, 'eeprom.bin')):
+        sys.exit('config was not saved')
+
+
+def run(elf, workdir, steps, step_s, burst):
+    pwm = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    pwm.bind(('127.0.0.1', PORT_PWM))
+    pwm.settimeout(10.0)
+    state = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+
+    sitl = subprocess.Popen([elf, '127.0.0.1', '--lockstep'], cwd=workdir,
+                            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    outputs = hashlib.sha256()
+    try:
+        time.sleep(0.2)
+        sent = 0
+        for _ in range(burst):
+            state.sendto(fdm_packet(sent, step_s), ('127.0.0.1', PORT_STATE))
+            sent += 1
+        # the outputs of a step are sent when the next packet is taken
+        for _ in range(steps - 1):
+            data = pwm.recv(64)
+            if len(data) != SERVO_PACKET_SIZE:
+                sys.exit('unexpected motor packet of {} bytes'.format(len(data)))
+            outputs.update(data)
+            if sent < steps:
+                state.sendto(fdm_packet(sent, step_s), ('127.0.0.1', PORT_STATE))
+                sent += 1
+    except socket.timeout:
+        sys.exit('FAIL: SITL stopped answering after {} packets, were packets dropped?'.format(sent))
+    finally:
+        # it is now waiting for the next packet, so the logs are in the same state every run
+        sitl.send_signal(signal.SIGKILL)
+        sitl.wait()
+        pwm.close()
+        state.close()
+
+    logs = hashlib.sha256()
+    size = 0
+    for name in sorted(os.listdir(workdir)):
+        if name.startswith('LOG'):
+            with open(os.path.join(workdir, name), 'rb') as f:
+                data = f.read()
+            logs.update(data)
+            size += len(data)
+    return outputs.hexdigest(), logs.hexdigest(), size
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Check SITL lockstep runs are reproducible')
+    parser.add_argument('elf', nargs='?', default='obj/main/betaflight_SITL.elf')
+    parser.add_argument('--steps', type=int, default=2000, help='FDM packets per run')
+    parser.add_argument('--step-us', type=int, default=1000, help='simulated time per packet')
+    parser.add_argument('--burst', type=int, default=8, help='packets sent before the SITL has started')
+    parser.add_argument('--runs', type=int, default=2)
+    args = parser.parse_args()
+
+    elf = os.path.abspath(args.elf)
+    base = tempfile.mkdtemp(prefix='sitl_lockstep_')
+    try:
+        config = os.path.join(base, 'config')
+        os.mkdir(config)
+        make_config(elf, config)
+
+        results = []
+        for i in range(args.runs):
+            workdir = os.path.join(base, 'run{}'.format(i))
+            os.mkdir(workdir)
+            shutil.copy(os.path.join(config, 'eeprom.bin'), workdir)
+            result = run(elf, workdir, args.steps, args.step_us * 1e-6, max(args.burst, 1))
+            print('run {}: motors {} blackbox {} ({} bytes)'.format(i, result[0][:16], result[1][:16], result[2]))
+            results.append(result)
+    finally:
+        shutil.rmtree(base)
+
+    if results[0][2] == 0:
+        sys.exit('FAIL: no blackbox log was written')
+    if any(result != results[0] for result in results):
+        sys.exit('FAIL: runs differ')
+    print('PASS: {} runs are identical'.format(args.runs))
+
+
+if __name__ == '__main__':
+    main()
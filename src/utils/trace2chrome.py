@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+#
+# This file is part of Betaflight.
+#
+# Betaflight is free software. You can redistribute this software
+# and/or modify this software under the terms of the GNU General
+# Public License as published by the Free Software Foundation,
+# either version 3 of the License, or (at your option) any later
+# version.
+#
+# Betaflight is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public
+# License along with this software.
+#
+# If not, see <http://www.gnu.org/licenses/>.
+#
+# Fetch the trace ring buffer of a firmware built with USE_TRACE over MSP
+# and write it as a Chrome trace (chrome://tracing, https://ui.perfetto.dev).
+#
+#   trace2chrome.py /dev/ttyACM0 -o trace.json
+#   trace2chrome.py tcp:127.0.0.1:5761 -o trace.json      (SITL)
+
+import argparse
+import json
+import socket
+import struct
+import sys
+
+MSP2_TRACE_DUMP = 0x300F
+
+TRACE_DUMP_EVENTS = 0
+TRACE_DUMP_NAMES = 1
+
+TRACE_PHASE_BEGIN = 0
+TRACE_PHASE_END = 1
+
+
+class TcpLink:
+    def __init__(self, host, port):
+        self.sock = socket.create_connection((host, port), timeout=2)
+
+    def write(self, data):
+        self.sock.sendall(data)
+
+    def read(self, size):
+        data = b''
+        while len(data) < size:
+            chunk = self.sock.recv(size - len(data))
+            if not chunk:
+                raise IOError('connection closed')
+            data += chunk
+        return data
+
+
+class SerialLink:
+    def __init__(self, device, baudrate):
+        import serial
+        self.port = serial.Serial(device, baudrate, timeout=2)
+
+    def write(self, data):
+        self.port.write(data)
+
+    def read(self, size):
+        data = self.port.read(size)
+        if len(data) != size:
+            raise IOError('timeout')
+        return data
+
+
+def crc8_dvb_s2(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0xD5) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def msp_request(link, command, payload=b''):
+    frame = struct.pack('<BHH', 0, command, len(payload)) + payload
+    link.write(b'$X<' + frame + bytes([crc8_dvb_s2(frame)]))
+
+    # skip anything that isn't the start of a reply, e.g. a CLI prompt
+    window = b''
+    while window not in (b'$X>', b'$X!'):
+        window = (window + link.read(1))[-3:]
+    header = link.read(5)
+    _, reply_command, size = struct.unpack('<BHH', header)
+    body = link.read(size)
+    if link.read(1)[0] != crc8_dvb_s2(header + body):
+        raise IOError('reply checksum error')
+    if window == b'$X!' or reply_command != command:
+        raise IOError('command 0x%04x not supported, is the firmware built with USE_TRACE?' % command)
+    return body
+
+
+def fetch_names(link):
+    names = {}
+    first_id = 0
+    while True:
+        reply = msp_request(link, MSP2_TRACE_DUMP, struct.pack('<BB', TRACE_DUMP_NAMES, first_id))
+        count, pos = reply[0], 1
+        if count == 0:
+            return names
+        for _ in range(count):
+            event_id, length = reply[pos], reply[pos + 1]
+            names[event_id] = reply[pos + 2:pos + 2 + length].decode('ascii')
+            pos += 2 + length
+            first_id = event_id + 1
+
+
+def fetch_events(link):
+    events = []
+    offset = 0
+    window = None
+    while True:
+        reply = msp_request(link, MSP2_TRACE_DUMP, struct.pack('<BH', TRACE_DUMP_EVENTS, offset))
+        cycles_per_us, recorded, held, _, count = struct.unpack_from('<HIHHB', reply)
+        if window is not None and recorded != window:
+            # the dump timed out and capture resumed, start again from a new window
+            events = []
+            offset = 0
+            window = None
+            continue
+        window = recorded
+        for i in range(count):
+            events.append(struct.unpack_from('<IBB', reply, 11 + 6 * i))
+        offset += count
+        if count == 0 or offset >= held:
+            return cycles_per_us, recorded, events
+
+
+def to_chrome_trace(events, names, cycles_per_us):
+    trace = []
+    open_ids = set()
+    last_cycles = None
+    time_cycles = 0
+
+    for cycles, event_id, phase in events:
+        # unwrap the 32 bit cycle counter
+        if last_cycles is not None:
+            time_cycles += (cycles - last_cycles) & 0xFFFFFFFF
+        last_cycles = cycles
+
+        if phase == TRACE_PHASE_BEGIN:
+            open_ids.add(event_id)
+        elif event_id in open_ids:
+            open_ids.discard(event_id)
+        else:
+            continue  # its begin was overwritten in the ring buffer
+
+        trace.append({
+            'name': names.get(event_id, 'id %d' % event_id),
+            'ph': 'B' if phase == TRACE_PHASE_BEGIN else 'E',
+            'ts': time_cycles / cycles_per_us,
+            'pid': 1,
+            'tid': 1,
+        })
+
+    return {'traceEvents': trace, 'displayTimeUnit': 'ns'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Dump the USE_TRACE ring buffer as a Chrome trace')
+    parser.add_argument('port', help='serial device, or tcp:<host>:<port> for SITL')
+    parser.add_argument('-b', '--baudrate', type=int, default=115200)
+    parser.add_argument('-o', '--output', default='trace.json')
+    args = parser.parse_args()
+
+    if args.port.startswith('tcp:'):
+        _, host, port = args.port.split(':')
+        link = TcpLink(host, int(port))
+    else:
+        link = SerialLink(args.port, args.baudrate)
+
+    names = fetch_names(link)
+    cycles_per_us, recorded, events = fetch_events(link)
+
+    with open(args.output, 'w') as output:
+        json.dump(to_chrome_trace(events, names, cycles_per_us), output)
+
+    print('%d of %d events recorded, %d cycles/us, written to %s' % (len(events), recorded, cycles_per_us, args.output))
+
+
+if __name__ == '__main__':
+    sys.exit(main())